@@ -21,6 +21,7 @@ package com.asylo.client;
 import com.asylo.EnclaveInput;
 import com.asylo.EnclaveOutput;
 import com.google.protobuf.ExtensionRegistry;
+import java.nio.ByteBuffer;
 import java.util.Objects;
 
 /** EnclaveClient class which provides methods for invoking enclave's entry points. */
@@ -70,6 +71,59 @@ public class EnclaveClient extends AutoCloseablePointer {
     return enterAndRun(getPointer(), enclaveInput, registry);
   }
 
+  /**
+   * Enters the enclave and invokes its execution entry point with a serialized {@link
+   * EnclaveInput} held in a direct buffer. This method is equivalent to {@link
+   * #enterAndRunDirect(ByteBuffer, ByteBuffer)} with a null output buffer.
+   *
+   * @param serializedInput Direct buffer holding a serialized EnclaveInput between its position
+   *     and its limit.
+   * @return Direct buffer holding the serialized EnclaveOutput between its position and its limit.
+   * @throws EnclaveException if any exception occurs in native execution.
+   */
+  public ByteBuffer enterAndRunDirect(ByteBuffer serializedInput) {
+    return enterAndRunDirect(serializedInput, null);
+  }
+
+  /**
+   * Enters the enclave and invokes its execution entry point with a serialized {@link
+   * EnclaveInput} held in a direct buffer. The input is passed to the enclave from native memory
+   * and the output is copied once, straight into a direct buffer, so that neither goes through an
+   * intermediate {@code byte[]}. This is intended for callers which exchange large messages with
+   * the enclave.
+   *
+   * <p>The input can be written with {@code input.writeTo(CodedOutputStream.newInstance(buffer))}
+   * and the output decoded with {@code EnclaveOutput.parseFrom(output, registry)}.
+   *
+   * @param serializedInput Direct buffer holding a serialized EnclaveInput between its position
+   *     and its limit. The buffer's position is not changed.
+   * @param outputBuffer Direct buffer to reuse for the output, or null. If it is null or its
+   *     capacity is too small for the output, a new direct buffer is allocated.
+   * @return Direct buffer holding the serialized EnclaveOutput between its position and its limit.
+   *     This is {@code outputBuffer} if it was large enough.
+   * @throws IllegalArgumentException if either buffer is not a direct buffer.
+   * @throws EnclaveException if any exception occurs in native execution.
+   */
+  public ByteBuffer enterAndRunDirect(ByteBuffer serializedInput, ByteBuffer outputBuffer) {
+    Objects.requireNonNull(serializedInput);
+    if (!serializedInput.isDirect()) {
+      throw new IllegalArgumentException("serializedInput must be a direct buffer");
+    }
+    if (outputBuffer != null && !outputBuffer.isDirect()) {
+      throw new IllegalArgumentException("outputBuffer must be a direct buffer");
+    }
+
+    return enterAndRunDirect(
+        getPointer(),
+        serializedInput,
+        serializedInput.position(),
+        serializedInput.remaining(),
+        outputBuffer);
+  }
+
   private native EnclaveOutput enterAndRun(
       long pointer, EnclaveInput enclaveInput, ExtensionRegistry registry);
+
+  private native ByteBuffer enterAndRunDirect(
+      long pointer, ByteBuffer serializedInput, int offset, int length, ByteBuffer outputBuffer);
 }
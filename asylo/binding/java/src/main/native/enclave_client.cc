@@ -18,6 +18,7 @@
 
 #include "asylo/binding/java/src/main/native/enclave_client.h"
 
+#include "absl/strings/string_view.h"
 #include "asylo/binding/java/src/main/native/jni_utils.h"
 #include "asylo/client.h"
 
@@ -44,3 +45,34 @@ JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRun(
 
   return asylo::jni::ConvertNativeToJavaProto(env, &output, registry);
 }
+
+// Executes the enclave with the serialized input held in a direct ByteBuffer
+// and returns a direct ByteBuffer holding the serialized output.
+JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRunDirect(
+    JNIEnv *env, jobject this_object, jlong client_pointer, jobject input,
+    jint offset, jint length, jobject output_buffer) {
+  asylo::EnclaveClient *client =
+      reinterpret_cast<asylo::EnclaveClient *>(client_pointer);
+
+  absl::string_view serialized_input;
+  if (!asylo::jni::GetDirectBufferRegion(env, input, offset, length,
+                                         &serialized_input)) {
+    return nullptr;
+  }
+
+  // The output is copied straight from the enclave's output buffer into the
+  // caller's buffer, which the caller decodes in place.
+  jobject output = nullptr;
+  asylo::Status status = client->EnterAndRunSerialized(
+      serialized_input, [env, output_buffer, &output](absl::string_view data) {
+        output = asylo::jni::CopyToDirectByteBuffer(env, data, output_buffer);
+      });
+  if (!status.ok()) {
+    asylo::jni::ThrowEnclaveException(env, status);
+    return nullptr;
+  }
+  if (output == nullptr && !asylo::jni::CheckForPendingException(env)) {
+    asylo::jni::ThrowEnclaveException(env, "Enclave returned no output.");
+  }
+  return output;
+}
@@ -33,6 +33,15 @@ extern "C" {
 JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRun(
     JNIEnv *, jobject, jlong, jobject, jobject);
 
+/*
+ * Class:     com_asylo_client_EnclaveClient
+ * Method:    enterAndRunDirect
+ * Signature:
+ * (JLjava/nio/ByteBuffer;IILjava/nio/ByteBuffer;)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_com_asylo_client_EnclaveClient_enterAndRunDirect(
+    JNIEnv *, jobject, jlong, jobject, jint, jint, jobject);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
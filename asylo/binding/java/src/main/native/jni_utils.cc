@@ -18,6 +18,9 @@
 
 #include "asylo/binding/java/src/main/native/jni_utils.h"
 
+#include <cstring>
+#include <limits>
+
 #include "absl/memory/memory.h"
 
 namespace asylo {
@@ -108,5 +111,76 @@ jobject ConvertNativeToJavaProto(JNIEnv *env,
 
   return output_java_obj;
 }
+
+bool GetDirectBufferRegion(JNIEnv *env, const jobject buffer, jint offset,
+                           jint length, absl::string_view *region) {
+  auto address = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+  jlong capacity = env->GetDirectBufferCapacity(buffer);
+  if (address == nullptr || capacity < 0) {
+    ThrowEnclaveException(env, "Not able to access a direct buffer.");
+    return false;
+  }
+  if (offset < 0 || length < 0 ||
+      static_cast<jlong>(offset) + length > capacity) {
+    ThrowEnclaveException(env, "Region is out of the bounds of the buffer.");
+    return false;
+  }
+  *region = absl::string_view(address + offset, length);
+  return true;
+}
+
+jobject CopyToDirectByteBuffer(JNIEnv *env, absl::string_view data,
+                               const jobject buffer) {
+  if (data.size() > std::numeric_limits<jint>::max()) {
+    ThrowEnclaveException(env, "Data is too large for a ByteBuffer.");
+    return nullptr;
+  }
+  jint size = static_cast<jint>(data.size());
+
+  jobject target = buffer;
+  if (target == nullptr || env->GetDirectBufferCapacity(target) < size) {
+    jclass byte_buffer_class = env->FindClass("java/nio/ByteBuffer");
+    if (CheckForPendingException(env)) {
+      return nullptr;
+    }
+    jmethodID allocate_direct_id = env->GetStaticMethodID(
+        byte_buffer_class, "allocateDirect", "(I)Ljava/nio/ByteBuffer;");
+    if (CheckForPendingException(env)) {
+      return nullptr;
+    }
+    target = env->CallStaticObjectMethod(byte_buffer_class, allocate_direct_id,
+                                         size);
+    if (CheckForPendingException(env)) {
+      return nullptr;
+    }
+  }
+
+  void *address = env->GetDirectBufferAddress(target);
+  if (address == nullptr) {
+    ThrowEnclaveException(env, "Not able to access a direct buffer.");
+    return nullptr;
+  }
+  memcpy(address, data.data(), data.size());
+
+  // Methods of java.nio.Buffer are used so that the lookup does not depend on
+  // the covariant overrides added to ByteBuffer in Java 9.
+  jclass buffer_class = env->FindClass("java/nio/Buffer");
+  if (CheckForPendingException(env)) {
+    return nullptr;
+  }
+  jmethodID clear_id =
+      env->GetMethodID(buffer_class, "clear", "()Ljava/nio/Buffer;");
+  jmethodID limit_id =
+      env->GetMethodID(buffer_class, "limit", "(I)Ljava/nio/Buffer;");
+  if (CheckForPendingException(env)) {
+    return nullptr;
+  }
+  env->CallObjectMethod(target, clear_id);
+  env->CallObjectMethod(target, limit_id, size);
+  if (CheckForPendingException(env)) {
+    return nullptr;
+  }
+  return target;
+}
 }  // namespace jni
 }  // namespace asylo
@@ -24,6 +24,7 @@
 #include <string>
 
 #include <google/protobuf/message_lite.h>
+#include "absl/strings/string_view.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -51,6 +52,20 @@ bool ConvertJavaToNativeProto(JNIEnv *env, const jobject java_object,
 jobject ConvertNativeToJavaProto(JNIEnv *env,
                                  google::protobuf::MessageLite *native_object,
                                  const jobject &registry);
+
+// Points |region| at the |length| bytes at |offset| in the direct ByteBuffer
+// |buffer|, without copying them. Queues a JVM exception and returns false if
+// |buffer| is not a direct buffer or the region is out of its bounds.
+bool GetDirectBufferRegion(JNIEnv *env, const jobject buffer, jint offset,
+                           jint length, absl::string_view *region);
+
+// Copies |data| into the direct ByteBuffer |buffer| if it is non-null and has
+// enough capacity, or into a newly allocated direct ByteBuffer otherwise.
+// Returns the buffer written to, with its position set to zero and its limit
+// set to the size of |data|. Queues a JVM exception and returns nullptr on
+// failure.
+jobject CopyToDirectByteBuffer(JNIEnv *env, absl::string_view data,
+                               const jobject buffer);
 }  // namespace jni
 }  // namespace asylo
 
@@ -5,6 +5,7 @@ import static org.junit.Assert.assertThrows;
 import com.asylo.EnclaveInput;
 import java.lang.reflect.Constructor;
 import java.lang.reflect.InvocationTargetException;
+import java.nio.ByteBuffer;
 import org.junit.Before;
 import org.junit.Test;
 import org.junit.runner.RunWith;
@@ -36,4 +37,23 @@ public class EnclaveClientTest {
     EnclaveInput input = EnclaveInput.newBuilder().build();
     assertThrows(NullPointerException.class, () -> enclaveClient.enterAndRun(input, null));
   }
+
+  @Test
+  public void testEnterAndRunDirectInputNullCheck() {
+    assertThrows(NullPointerException.class, () -> enclaveClient.enterAndRunDirect(null));
+  }
+
+  @Test
+  public void testEnterAndRunDirectRejectsHeapInput() {
+    ByteBuffer input = ByteBuffer.allocate(16);
+    assertThrows(IllegalArgumentException.class, () -> enclaveClient.enterAndRunDirect(input));
+  }
+
+  @Test
+  public void testEnterAndRunDirectRejectsHeapOutput() {
+    ByteBuffer input = ByteBuffer.allocateDirect(16);
+    ByteBuffer output = ByteBuffer.allocate(16);
+    assertThrows(
+        IllegalArgumentException.class, () -> enclaveClient.enterAndRunDirect(input, output));
+  }
 }
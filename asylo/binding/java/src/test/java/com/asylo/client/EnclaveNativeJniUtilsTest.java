@@ -19,11 +19,13 @@
 package com.asylo.client;
 
 import static com.google.common.truth.Truth.assertThat;
+import static java.nio.charset.StandardCharsets.UTF_8;
 
 import com.asylo.EnclaveInput;
 import com.asylo.EnclaveOutput;
 import com.asylo.test.JniUtilsTestProto;
 import com.google.protobuf.ExtensionRegistry;
+import java.nio.ByteBuffer;
 import java.util.UUID;
 import org.junit.Assert;
 import org.junit.Test;
@@ -77,6 +79,35 @@ public class EnclaveNativeJniUtilsTest {
     assertThat(outData.getStringVal()).isEqualTo(inData.getStringVal());
   }
 
+  @Test
+  public void testCopyToDirectByteBufferReusesLargeBuffer() {
+    ByteBuffer buffer = ByteBuffer.allocateDirect(64);
+    buffer.position(10);
+    ByteBuffer result = nativeCopyToDirectByteBuffer("enclave output", buffer);
+
+    assertThat(result).isSameInstanceAs(buffer);
+    assertThat(result.position()).isEqualTo(0);
+    assertThat(result.limit()).isEqualTo("enclave output".length());
+    byte[] bytes = new byte[result.remaining()];
+    result.get(bytes);
+    assertThat(new String(bytes, UTF_8)).isEqualTo("enclave output");
+  }
+
+  @Test
+  public void testCopyToDirectByteBufferAllocatesWhenTooSmall() {
+    String data = UUID.randomUUID().toString();
+    ByteBuffer buffer = ByteBuffer.allocateDirect(4);
+    ByteBuffer result = nativeCopyToDirectByteBuffer(data, buffer);
+
+    assertThat(result).isNotSameInstanceAs(buffer);
+    assertThat(result.isDirect()).isTrue();
+    byte[] bytes = new byte[result.remaining()];
+    result.get(bytes);
+    assertThat(new String(bytes, UTF_8)).isEqualTo(data);
+
+    assertThat(nativeCopyToDirectByteBuffer(data, null).remaining()).isEqualTo(data.length());
+  }
+
   private native boolean nativeCheckJniException();
 
   private native void nativeThrowEnclaveExceptionUsingStatus();
@@ -85,4 +116,6 @@ public class EnclaveNativeJniUtilsTest {
 
   private native EnclaveOutput nativeProtoConversionBetweenJavaAndNative(
       EnclaveInput input, ExtensionRegistry registry);
+
+  private native ByteBuffer nativeCopyToDirectByteBuffer(String data, ByteBuffer buffer);
 }
@@ -73,3 +73,12 @@ Java_com_asylo_client_EnclaveNativeJniUtilsTest_nativeProtoConversionBetweenJava
   return asylo::jni::ConvertNativeToJavaProto(env, &native_enclave_output,
                                                java_registry);
 }
+
+JNIEXPORT jobject JNICALL
+Java_com_asylo_client_EnclaveNativeJniUtilsTest_nativeCopyToDirectByteBuffer(
+    JNIEnv *env, jobject this_obj, jstring data, jobject buffer) {
+  const char *native_data = env->GetStringUTFChars(data, nullptr);
+  std::string native_string(native_data);
+  env->ReleaseStringUTFChars(data, native_data);
+  return asylo::jni::CopyToDirectByteBuffer(env, native_string, buffer);
+}
@@ -61,6 +61,15 @@ JNIEXPORT jobject JNICALL
 Java_com_asylo_client_EnclaveNativeJniUtilsTest_nativeProtoConversionBetweenJavaAndNative(
     JNIEnv *, jobject, jobject, jobject);
 
+/*
+ * Class:     com_asylo_client_EnclaveNativeJniUtilsTest
+ * Method:    nativeCopyToDirectByteBuffer
+ * Signature: (Ljava/lang/String;Ljava/nio/ByteBuffer;)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL
+Java_com_asylo_client_EnclaveNativeJniUtilsTest_nativeCopyToDirectByteBuffer(
+    JNIEnv *, jobject, jstring, jobject);
+
 #ifdef __cplusplus
 }
 #endif  // __cplusplus
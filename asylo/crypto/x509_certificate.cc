@@ -868,6 +868,10 @@ Status X509Certificate::Verify(const CertificateInterface &issuer_certificate,
 }
 
 StatusOr<std::string> X509Certificate::SubjectKeyDer() const {
+  return subject_key_der_.Get([this] { return ComputeSubjectKeyDer(); });
+}
+
+StatusOr<std::string> X509Certificate::ComputeSubjectKeyDer() const {
   bssl::UniquePtr<EVP_PKEY> evp_key(X509_get_pubkey(x509_.get()));
   if (evp_key == nullptr) {
     return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
@@ -877,6 +881,11 @@ StatusOr<std::string> X509Certificate::SubjectKeyDer() const {
 }
 
 absl::optional<std::string> X509Certificate::SubjectName() const {
+  return subject_name_string_.Get(
+      [this] { return ComputeSubjectNameString(); });
+}
+
+absl::optional<std::string> X509Certificate::ComputeSubjectNameString() const {
   bssl::UniquePtr<BIO> subject_name_bio(BIO_new(BIO_s_mem()));
   if (!X509_NAME_print_ex(subject_name_bio.get(),
                           X509_get_subject_name(x509_.get()), 0,
@@ -921,6 +930,10 @@ absl::optional<int64_t> X509Certificate::CertPathLength() const {
 }
 
 absl::optional<KeyUsageInformation> X509Certificate::KeyUsage() const {
+  return key_usage_.Get([this] { return ComputeKeyUsage(); });
+}
+
+absl::optional<KeyUsageInformation> X509Certificate::ComputeKeyUsage() const {
   uint32_t key_usage_values = X509_get_key_usage(x509_.get());
   if (key_usage_values == std::numeric_limits<uint32_t>::max()) {
     return absl::nullopt;
@@ -944,6 +957,10 @@ StatusOr<bssl::UniquePtr<BIGNUM>> X509Certificate::GetSerialNumber() const {
 }
 
 StatusOr<X509Name> X509Certificate::GetIssuerName() const {
+  return issuer_name_.Get([this] { return ComputeIssuerName(); });
+}
+
+StatusOr<X509Name> X509Certificate::ComputeIssuerName() const {
   return ReadName(*X509_get_issuer_name(x509_.get()));
 }
 
@@ -959,11 +976,21 @@ StatusOr<X509Validity> X509Certificate::GetValidity() const {
 }
 
 StatusOr<X509Name> X509Certificate::GetSubjectName() const {
+  return subject_name_.Get([this] { return ComputeSubjectName(); });
+}
+
+StatusOr<X509Name> X509Certificate::ComputeSubjectName() const {
   return ReadName(*X509_get_subject_name(x509_.get()));
 }
 
 StatusOr<absl::optional<std::vector<uint8_t>>>
 X509Certificate::GetAuthorityKeyIdentifier() const {
+  return authority_key_identifier_.Get(
+      [this] { return ComputeAuthorityKeyIdentifier(); });
+}
+
+StatusOr<absl::optional<std::vector<uint8_t>>>
+X509Certificate::ComputeAuthorityKeyIdentifier() const {
   bssl::UniquePtr<AUTHORITY_KEYID> bssl_key_id;
   ASYLO_ASSIGN_OR_RETURN(bssl_key_id, GetExtensionAsType<AUTHORITY_KEYID>(
                                           NID_authority_key_identifier));
@@ -979,6 +1006,12 @@ X509Certificate::GetAuthorityKeyIdentifier() const {
 
 StatusOr<absl::optional<std::vector<uint8_t>>>
 X509Certificate::GetSubjectKeyIdentifier() const {
+  return subject_key_identifier_.Get(
+      [this] { return ComputeSubjectKeyIdentifier(); });
+}
+
+StatusOr<absl::optional<std::vector<uint8_t>>>
+X509Certificate::ComputeSubjectKeyIdentifier() const {
   bssl::UniquePtr<ASN1_OCTET_STRING> bssl_key_id;
   ASYLO_ASSIGN_OR_RETURN(bssl_key_id, GetExtensionAsType<ASN1_OCTET_STRING>(
                                           NID_subject_key_identifier));
@@ -994,6 +1027,11 @@ X509Certificate::GetSubjectKeyIdentifier() const {
 
 StatusOr<absl::optional<BasicConstraints>>
 X509Certificate::GetBasicConstraints() const {
+  return basic_constraints_.Get([this] { return ComputeBasicConstraints(); });
+}
+
+StatusOr<absl::optional<BasicConstraints>>
+X509Certificate::ComputeBasicConstraints() const {
   bssl::UniquePtr<BASIC_CONSTRAINTS> bssl_constraints;
   ASYLO_ASSIGN_OR_RETURN(
       bssl_constraints,
@@ -1016,6 +1054,12 @@ X509Certificate::GetBasicConstraints() const {
 
 StatusOr<absl::optional<CrlDistributionPoints>>
 X509Certificate::GetCrlDistributionPoints() const {
+  return crl_distribution_points_.Get(
+      [this] { return ComputeCrlDistributionPoints(); });
+}
+
+StatusOr<absl::optional<CrlDistributionPoints>>
+X509Certificate::ComputeCrlDistributionPoints() const {
   bssl::UniquePtr<CRL_DIST_POINTS> bssl_crl_dist_points;
   ASYLO_ASSIGN_OR_RETURN(
       bssl_crl_dist_points,
@@ -1088,6 +1132,11 @@ X509Certificate::GetCrlDistributionPoints() const {
 
 StatusOr<std::vector<X509Extension>> X509Certificate::GetOtherExtensions()
     const {
+  return other_extensions_.Get([this] { return ComputeOtherExtensions(); });
+}
+
+StatusOr<std::vector<X509Extension>>
+X509Certificate::ComputeOtherExtensions() const {
   int extension_count = X509_get_ext_count(x509_.get());
   std::vector<X509Extension> extensions;
   for (int i = 0; i < extension_count; ++i) {
@@ -1118,6 +1167,19 @@ StatusOr<std::vector<X509Extension>> X509Certificate::GetOtherExtensions()
   return extensions;
 }
 
+StatusOr<std::string> X509Certificate::Sha256Digest() const {
+  return sha256_digest_.Get([this] { return ComputeSha256Digest(); });
+}
+
+StatusOr<std::string> X509Certificate::ComputeSha256Digest() const {
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_length = 0;
+  if (X509_digest(x509_.get(), EVP_sha256(), digest, &digest_length) != 1) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  return std::string(reinterpret_cast<char *>(digest), digest_length);
+}
+
 X509Certificate::X509Certificate(bssl::UniquePtr<X509> x509)
     : x509_(std::move(x509)) {}
 
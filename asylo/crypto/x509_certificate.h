@@ -30,6 +30,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
@@ -185,6 +186,11 @@ struct X509CertificateBuilder {
 
 // An implementation of CertificateInterface that can parse and verify
 // X.509 certificates from PEM or DER encodings.
+//
+// Fields decoded from the certificate by the accessors below are decoded on
+// first access and memoized, so repeated accesses, such as those made while
+// verifying certificate chains, do not decode the certificate again. All
+// methods are safe to call concurrently.
 class X509Certificate : public CertificateInterface {
  public:
   // Creates and returns an X509Certificate with the given |certificate| as
@@ -269,11 +275,49 @@ class X509Certificate : public CertificateInterface {
   // extracted by other methods of X509Certificate.
   StatusOr<std::vector<X509Extension>> GetOtherExtensions() const;
 
+  // Returns the SHA-256 digest of this certificate's DER encoding. The digest
+  // identifies the certificate, including its signature, and is suitable as a
+  // key for caches of per-certificate results.
+  StatusOr<std::string> Sha256Digest() const;
+
  private:
   friend struct X509CertificateBuilder;
 
+  // A value that is computed on first access and then shared by all accesses.
+  template <typename T>
+  class Memoized {
+   public:
+    // Returns the value, computing it with |compute| if this is the first
+    // access.
+    template <typename ComputeT>
+    const T &Get(const ComputeT &compute) const {
+      absl::call_once(once_, [this, &compute] { value_.emplace(compute()); });
+      return *value_;
+    }
+
+   private:
+    mutable absl::once_flag once_;
+    mutable absl::optional<T> value_;
+  };
+
   explicit X509Certificate(bssl::UniquePtr<X509> x509);
 
+  // Decode the values returned by the accessors of the same names.
+  StatusOr<std::string> ComputeSubjectKeyDer() const;
+  absl::optional<std::string> ComputeSubjectNameString() const;
+  absl::optional<KeyUsageInformation> ComputeKeyUsage() const;
+  StatusOr<X509Name> ComputeIssuerName() const;
+  StatusOr<X509Name> ComputeSubjectName() const;
+  StatusOr<absl::optional<std::vector<uint8_t>>>
+  ComputeAuthorityKeyIdentifier() const;
+  StatusOr<absl::optional<std::vector<uint8_t>>> ComputeSubjectKeyIdentifier()
+      const;
+  StatusOr<absl::optional<BasicConstraints>> ComputeBasicConstraints() const;
+  StatusOr<absl::optional<CrlDistributionPoints>>
+  ComputeCrlDistributionPoints() const;
+  StatusOr<std::vector<X509Extension>> ComputeOtherExtensions() const;
+  StatusOr<std::string> ComputeSha256Digest() const;
+
   // Returns the extension with NID |nid|, interpreted as the given type, or
   // nullptr if no such extension exists.
   template <typename X509v3ObjectT>
@@ -298,6 +342,23 @@ class X509Certificate : public CertificateInterface {
   StatusOr<X509_EXTENSION *> GetExtensionByNid(int nid) const;
 
   bssl::UniquePtr<X509> x509_;
+
+  // Memoized results of the accessors. |x509_| is never modified after
+  // construction, so the results never become stale.
+  Memoized<StatusOr<std::string>> subject_key_der_;
+  Memoized<absl::optional<std::string>> subject_name_string_;
+  Memoized<absl::optional<KeyUsageInformation>> key_usage_;
+  Memoized<StatusOr<X509Name>> issuer_name_;
+  Memoized<StatusOr<X509Name>> subject_name_;
+  Memoized<StatusOr<absl::optional<std::vector<uint8_t>>>>
+      authority_key_identifier_;
+  Memoized<StatusOr<absl::optional<std::vector<uint8_t>>>>
+      subject_key_identifier_;
+  Memoized<StatusOr<absl::optional<BasicConstraints>>> basic_constraints_;
+  Memoized<StatusOr<absl::optional<CrlDistributionPoints>>>
+      crl_distribution_points_;
+  Memoized<StatusOr<std::vector<X509Extension>>> other_extensions_;
+  Memoized<StatusOr<std::string>> sha256_digest_;
 };
 
 // Creates and returns an X509_REQ object equivalent to the data in |csr|.
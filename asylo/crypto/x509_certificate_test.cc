@@ -46,11 +46,14 @@
 #include "asylo/crypto/certificate_interface.h"
 #include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
 #include "asylo/crypto/fake_certificate.h"
+#include "asylo/crypto/sha256_hash.h"
 #include "asylo/crypto/util/byte_container_util.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/test/util/string_matchers.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include "asylo/util/thread.h"
 
 namespace asylo {
 namespace {
@@ -694,6 +697,57 @@ TEST_F(X509CertificateTest, SubjectKeyDerSucceeds) {
   EXPECT_THAT(x509->SubjectKeyDer(), IsOkAndHolds(root_public_key_));
 }
 
+// Verifies that SubjectKeyDer() returns the same value on every call, including
+// when called concurrently.
+TEST_F(X509CertificateTest, SubjectKeyDerIsStableAcrossThreads) {
+  std::unique_ptr<X509Certificate> x509;
+  ASYLO_ASSERT_OK_AND_ASSIGN(x509,
+                             X509Certificate::CreateFromPem(kTestRootCertPem));
+
+  constexpr int kNumThreads = 8;
+  std::vector<StatusOr<std::string>> results(kNumThreads);
+  std::vector<Thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back(
+        [&x509, &results, i] { results[i] = x509->SubjectKeyDer(); });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+  for (const auto &result : results) {
+    EXPECT_THAT(result, IsOkAndHolds(root_public_key_));
+  }
+  EXPECT_THAT(x509->SubjectKeyDer(), IsOkAndHolds(root_public_key_));
+}
+
+// Verifies that Sha256Digest() is the SHA-256 digest of the DER encoding, and
+// does not depend on the encoding the certificate was parsed from.
+TEST_F(X509CertificateTest, Sha256DigestIdentifiesCertificate) {
+  std::string der = absl::HexStringToBytes(kTestIntermediateCertDerHex);
+  std::unique_ptr<X509Certificate> x509_cert_from_der;
+  ASYLO_ASSERT_OK_AND_ASSIGN(x509_cert_from_der,
+                             X509Certificate::CreateFromDer(der));
+  std::unique_ptr<X509Certificate> x509_cert_from_pem;
+  ASYLO_ASSERT_OK_AND_ASSIGN(x509_cert_from_pem, X509Certificate::CreateFromPem(
+                                                     kTestIntermediateCertPem));
+  std::unique_ptr<X509Certificate> other_x509_cert;
+  ASYLO_ASSERT_OK_AND_ASSIGN(other_x509_cert, X509Certificate::CreateFromPem(
+                                                  kOtherIntermediateCertPem));
+
+  Sha256Hash hash;
+  hash.Update(der);
+  std::vector<uint8_t> expected_digest;
+  ASYLO_ASSERT_OK(hash.CumulativeHash(&expected_digest));
+
+  std::string digest;
+  ASYLO_ASSERT_OK_AND_ASSIGN(digest, x509_cert_from_der->Sha256Digest());
+  EXPECT_THAT(digest, Eq(std::string(expected_digest.begin(),
+                                     expected_digest.end())));
+  EXPECT_THAT(x509_cert_from_pem->Sha256Digest(), IsOkAndHolds(digest));
+  EXPECT_THAT(other_x509_cert->Sha256Digest(), IsOkAndHolds(Ne(digest)));
+}
+
 // Verifies that SubjectName() returns the expected subject name.
 TEST_F(X509CertificateTest, SubjectNameMatches) {
   std::unique_ptr<CertificateInterface> x509;
@@ -23,10 +23,32 @@
 
 #include "asylo/grpc/auth/core/enclave_security_connector.h"
 #include "asylo/grpc/auth/enclave_credentials_options.h"
+#include "include/grpc/support/log.h"
 #include "src/core/lib/channel/channel_args.h"
 #include "src/core/lib/gprpp/ref_counted_ptr.h"
 #include "src/core/lib/security/credentials/credentials.h"
 
+namespace {
+
+// Compiles |peer_acl|, if present. Returns nullptr if |peer_acl| is unset or
+// malformed. A malformed ACL is then reported by the handshaker, which falls
+// back to evaluating the uncompiled ACL.
+std::shared_ptr<const asylo::CompiledIdentityAcl> CompilePeerAcl(
+    const absl::optional<asylo::IdentityAclPredicate> &peer_acl) {
+  if (!peer_acl.has_value()) {
+    return nullptr;
+  }
+  auto compiled_acl_result = asylo::CompiledIdentityAcl::Create(*peer_acl);
+  if (!compiled_acl_result.ok()) {
+    gpr_log(GPR_ERROR, "Failed to compile peer ACL: %s",
+            compiled_acl_result.status().ToString().c_str());
+    return nullptr;
+  }
+  return std::move(compiled_acl_result).ValueOrDie();
+}
+
+}  // namespace
+
 // Creates a grpc_enclave_channel_security_connector object.
 grpc_core::RefCountedPtr<grpc_channel_security_connector>
 grpc_enclave_channel_credentials::create_security_connector(
@@ -53,7 +75,8 @@ grpc_enclave_channel_credentials::grpc_enclave_channel_credentials(
       accepted_peer_assertions(
           std::make_move_iterator(options.accepted_peer_assertions.begin()),
           std::make_move_iterator(options.accepted_peer_assertions.end())),
-      peer_acl(std::move(options.peer_acl)) {}
+      peer_acl(std::move(options.peer_acl)),
+      compiled_peer_acl(CompilePeerAcl(peer_acl)) {}
 
 grpc_enclave_server_credentials::grpc_enclave_server_credentials(
     asylo::EnclaveCredentialsOptions options)
@@ -65,4 +88,5 @@ grpc_enclave_server_credentials::grpc_enclave_server_credentials(
       accepted_peer_assertions(
           std::make_move_iterator(options.accepted_peer_assertions.begin()),
           std::make_move_iterator(options.accepted_peer_assertions.end())),
-      peer_acl(std::move(options.peer_acl)) {}
+      peer_acl(std::move(options.peer_acl)),
+      compiled_peer_acl(CompilePeerAcl(peer_acl)) {}
@@ -19,11 +19,13 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
 #define ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/types/optional.h"
 #include "asylo/grpc/auth/enclave_credentials_options.h"
+#include "asylo/identity/compiled_identity_acl.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "src/core/lib/gprpp/ref_counted_ptr.h"
@@ -58,6 +60,10 @@ struct grpc_enclave_channel_credentials final
 
   // Optional ACL enforced on the server's identity.
   absl::optional<asylo::IdentityAclPredicate> peer_acl;
+
+  // |peer_acl| compiled once for all connections made with these credentials.
+  // Null if |peer_acl| is unset or could not be compiled.
+  std::shared_ptr<const asylo::CompiledIdentityAcl> compiled_peer_acl;
 };
 
 struct grpc_enclave_server_credentials final : public grpc_server_credentials {
@@ -81,6 +87,10 @@ struct grpc_enclave_server_credentials final : public grpc_server_credentials {
 
   // Optional ACL enforced on the client's identity.
   absl::optional<asylo::IdentityAclPredicate> peer_acl;
+
+  // |peer_acl| compiled once for all connections made with these credentials.
+  // Null if |peer_acl| is unset or could not be compiled.
+  std::shared_ptr<const asylo::CompiledIdentityAcl> compiled_peer_acl;
 };
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
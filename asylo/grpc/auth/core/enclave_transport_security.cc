@@ -33,6 +33,7 @@
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
 #include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/grpc/auth/core/server_ekep_handshaker.h"
+#include "asylo/identity/compiled_identity_acl.h"
 #include "asylo/identity/delegating_identity_expectation_matcher.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
@@ -241,12 +242,14 @@ struct tsi_enclave_handshaker {
   tsi_handshaker base;
   bool is_client;
   const absl::optional<IdentityAclPredicate> peer_acl;
+  const std::shared_ptr<const CompiledIdentityAcl> compiled_peer_acl;
   std::unique_ptr<EkepHandshaker> handshaker;
   std::string outgoing_bytes;
 
-  tsi_enclave_handshaker(bool is_client,
-                         const absl::optional<IdentityAclPredicate> &peer_acl,
-                         std::unique_ptr<EkepHandshaker> ekep_handshaker);
+  tsi_enclave_handshaker(
+      bool is_client, const absl::optional<IdentityAclPredicate> &peer_acl,
+      std::shared_ptr<const CompiledIdentityAcl> compiled_peer_acl,
+      std::unique_ptr<EkepHandshaker> ekep_handshaker);
 
   tsi_result evaluate_acl(const std::vector<EnclaveIdentity> &identities);
 };
@@ -370,9 +373,11 @@ const tsi_handshaker_vtable handshaker_vtable = {
 
 tsi_enclave_handshaker::tsi_enclave_handshaker(
     bool is_client, const absl::optional<IdentityAclPredicate> &peer_acl,
+    std::shared_ptr<const CompiledIdentityAcl> compiled_peer_acl,
     std::unique_ptr<EkepHandshaker> ekep_handshaker)
     : is_client(is_client),
       peer_acl(peer_acl),
+      compiled_peer_acl(std::move(compiled_peer_acl)),
       handshaker(std::move(ekep_handshaker)) {
   base.handshaker_result_created = false;
   base.handshake_shutdown = false;
@@ -384,10 +389,15 @@ tsi_result tsi_enclave_handshaker::evaluate_acl(
   if (!peer_acl.has_value()) {
     return TSI_OK;
   }
-  DelegatingIdentityExpectationMatcher matcher;
   std::string explanation;
-  StatusOr<bool> acl_result =
-      EvaluateIdentityAcl(identities, peer_acl.value(), matcher, &explanation);
+  StatusOr<bool> acl_result = false;
+  if (compiled_peer_acl) {
+    acl_result = compiled_peer_acl->Evaluate(identities, &explanation);
+  } else {
+    DelegatingIdentityExpectationMatcher matcher;
+    acl_result = EvaluateIdentityAcl(identities, peer_acl.value(), matcher,
+                                     &explanation);
+  }
   if (!acl_result.ok()) {
     gpr_log(GPR_ERROR, "Error evaluating ACL: %s",
             acl_result.status().ToString().c_str());
@@ -407,6 +417,7 @@ tsi_result tsi_enclave_handshaker_create(
     absl::Span<asylo::AssertionDescription> accepted_peer_assertions,
     absl::string_view additional_authenticated_data,
     const absl::optional<asylo::IdentityAclPredicate> &peer_acl,
+    std::shared_ptr<const asylo::CompiledIdentityAcl> compiled_peer_acl,
     tsi_handshaker **handshaker) {
   GRPC_API_TRACE(
       "tsi_enclave_handshaker_create(is_client=%d, self_assertions=%p, "
@@ -452,6 +463,7 @@ tsi_result tsi_enclave_handshaker_create(
 
   asylo::tsi_enclave_handshaker *tsi_handshaker =
       new asylo::tsi_enclave_handshaker(is_client, peer_acl,
+                                        std::move(compiled_peer_acl),
                                         std::move(ekep_handshaker));
 
   *handshaker = &tsi_handshaker->base;
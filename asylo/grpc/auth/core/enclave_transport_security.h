@@ -19,9 +19,12 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
 #define ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
 
+#include <memory>
+
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "asylo/identity/compiled_identity_acl.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "src/core/tsi/transport_security_interface.h"
@@ -47,11 +50,14 @@
 //   the handshake
 //   * |peer_acl| is the ACL evaluated using the authenticated peer's
 //   identities.
+//   * |compiled_peer_acl| is |peer_acl| in compiled form. If non-null, it is
+//   evaluated instead of |peer_acl|.
 tsi_result tsi_enclave_handshaker_create(
     bool is_client, absl::Span<asylo::AssertionDescription> self_assertions,
     absl::Span<asylo::AssertionDescription> accepted_peer_assertions,
     absl::string_view additional_authenticated_data,
     const absl::optional<asylo::IdentityAclPredicate> &peer_acl,
+    std::shared_ptr<const asylo::CompiledIdentityAcl> compiled_peer_acl,
     tsi_handshaker **handshaker);
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
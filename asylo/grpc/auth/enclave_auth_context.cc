@@ -23,6 +23,7 @@
 #include "asylo/grpc/auth/core/enclave_grpc_security_constants.h"
 #include "asylo/identity/identity_acl_evaluator.h"
 #include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
 #include "src/core/lib/security/context/security_context.h"
 #include "src/core/tsi/transport_security_interface.h"
 
@@ -41,6 +42,7 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
   }
 
   EnclaveIdentities identities;
+  std::string identities_digest;
   uint32_t record_protocol = 0;
   for (auto it = auth_context.begin(); it != auth_context.end(); ++it) {
     ::grpc::AuthProperty auth_property = *it;
@@ -68,6 +70,10 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
         return Status(error::GoogleError::INVALID_ARGUMENT,
                       "Ill-formed peer identity in auth context");
       }
+      ASYLO_ASSIGN_OR_RETURN(
+          identities_digest,
+          CompiledIdentityAcl::DigestSerializedIdentities(absl::string_view(
+              auth_property.second.data(), auth_property.second.length())));
     } else if (auth_property.first ==
                GRPC_TRANSPORT_SECURITY_TYPE_PROPERTY_NAME) {
       if (auth_property.second != GRPC_ENCLAVE_TRANSPORT_SECURITY_TYPE) {
@@ -87,14 +93,16 @@ StatusOr<EnclaveAuthContext> EnclaveAuthContext::CreateFromAuthContext(
     }
   }
 
-  return EnclaveAuthContext(std::move(identities),
+  return EnclaveAuthContext(std::move(identities), std::move(identities_digest),
                             static_cast<RecordProtocol>(record_protocol));
 }
 
 EnclaveAuthContext::EnclaveAuthContext(EnclaveIdentities identities,
+                                       std::string identities_digest,
                                        RecordProtocol record_protocol)
     : identities_(
           {identities.identities().begin(), identities.identities().end()}),
+      identities_digest_(std::move(identities_digest)),
       record_protocol_(record_protocol) {}
 
 RecordProtocol EnclaveAuthContext::GetRecordProtocol() const {
@@ -146,4 +154,14 @@ StatusOr<bool> EnclaveAuthContext::EvaluateAcl(
   return EvaluateAcl(acl, explanation);
 }
 
+StatusOr<bool> EnclaveAuthContext::EvaluateAcl(
+    const CompiledIdentityAcl &acl) const {
+  return EvaluateAcl(acl, /*explanation=*/nullptr);
+}
+
+StatusOr<bool> EnclaveAuthContext::EvaluateAcl(const CompiledIdentityAcl &acl,
+                                               std::string *explanation) const {
+  return acl.Evaluate(identities_, identities_digest_, explanation);
+}
+
 }  // namespace asylo
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/identity/compiled_identity_acl.h"
 #include "asylo/identity/delegating_identity_expectation_matcher.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
@@ -121,15 +122,44 @@ class EnclaveAuthContext {
       const EnclaveIdentityExpectation &expectation,
       std::string *explanation) const;
 
+  /// Evaluates the peer's identities against a compiled `acl`.
+  ///
+  /// Results are memoized in `acl` by a digest of the peer's identities, which
+  /// is computed once when this EnclaveAuthContext is created. Servers that
+  /// authorize every RPC against the same ACL should compile it once and use
+  /// this overload.
+  ///
+  /// \param acl The compiled ACL against which to evaluate the peer's
+  ///            identities.
+  /// \return A bool indicating whether the peer's identities match `acl`, or a
+  ///         non-OK Status if an error occurred while evaluating the ACL.
+  virtual StatusOr<bool> EvaluateAcl(const CompiledIdentityAcl &acl) const;
+
+  /// Evaluates the peer's identities against a compiled `acl`.
+  ///
+  /// \param acl The compiled ACL against which to evaluate the peer's
+  ///            identities.
+  /// \param[out] explanation An explanation of why the peer's identities did
+  ///             not match `acl`, if the result is false.
+  /// \return A bool indicating whether the peer's identities match `acl`, or a
+  ///         non-OK Status if an error occurred while evaluating the ACL.
+  virtual StatusOr<bool> EvaluateAcl(const CompiledIdentityAcl &acl,
+                                     std::string *explanation) const;
+
  private:
   // Creates an EnclaveAuthContext for the given peer's |identities| and the
-  // session |record_protocol|.
+  // session |record_protocol|. |identities_digest| is the digest of
+  // |identities| as computed by CompiledIdentityAcl.
   EnclaveAuthContext(EnclaveIdentities identities,
+                     std::string identities_digest,
                      RecordProtocol record_protocol);
 
   // Enclave identities held by the authenticated peer.
   std::vector<EnclaveIdentity> identities_;
 
+  // Digest of |identities_|, used as the key for memoized ACL results.
+  std::string identities_digest_;
+
   // Secure transport record protocol.
   RecordProtocol record_protocol_;
 
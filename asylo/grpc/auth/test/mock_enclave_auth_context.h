@@ -21,6 +21,7 @@
 
 #include <gmock/gmock.h>
 #include "asylo/grpc/auth/enclave_auth_context.h"
+#include "asylo/identity/compiled_identity_acl.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/identity/identity_acl.pb.h"
 #include "asylo/util/statusor.h"
@@ -42,6 +43,9 @@ class MockEnclaveAuthContext : public EnclaveAuthContext {
   MOCK_CONST_METHOD1(
       EvaluateAcl,
       StatusOr<bool>(const EnclaveIdentityExpectation &expectation));
+
+  MOCK_CONST_METHOD1(EvaluateAcl,
+                     StatusOr<bool>(const CompiledIdentityAcl &acl));
 };
 
 }  // namespace asylo
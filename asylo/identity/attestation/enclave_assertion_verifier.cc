@@ -0,0 +1,39 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/attestation/enclave_assertion_verifier.h"
+
+#include "asylo/util/parallel_for.h"
+
+namespace asylo {
+
+std::vector<Status> EnclaveAssertionVerifier::VerifyBatch(
+    absl::Span<const AssertionVerificationItem> items, size_t max_parallelism,
+    std::vector<EnclaveIdentity> *peer_identities) const {
+  std::vector<Status> statuses(items.size());
+  peer_identities->assign(items.size(), EnclaveIdentity());
+  ParallelFor(items.size(), max_parallelism,
+              [this, items, peer_identities, &statuses](size_t index) {
+                statuses[index] =
+                    Verify(*items[index].user_data, *items[index].assertion,
+                           &(*peer_identities)[index]);
+              });
+  return statuses;
+}
+
+}  // namespace asylo
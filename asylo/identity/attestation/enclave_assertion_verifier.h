@@ -19,8 +19,11 @@
 #ifndef ASYLO_IDENTITY_ATTESTATION_ENCLAVE_ASSERTION_VERIFIER_H_
 #define ASYLO_IDENTITY_ATTESTATION_ENCLAVE_ASSERTION_VERIFIER_H_
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "asylo/identity/enclave_assertion_authority.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/platform/common/static_map.h"
@@ -29,6 +32,13 @@
 
 namespace asylo {
 
+/// An assertion to verify with EnclaveAssertionVerifier::VerifyBatch(), and the
+/// user data it must be bound to. Both are owned by the caller.
+struct AssertionVerificationItem {
+  const std::string *user_data;
+  const Assertion *assertion;
+};
+
 /// Defines an interface for assertion authorities that generate assertion
 /// requests and verify assertions.
 ///
@@ -81,6 +91,29 @@ class EnclaveAssertionVerifier : public EnclaveAssertionAuthority {
   virtual Status Verify(const std::string &user_data,
                         const Assertion &assertion,
                         EnclaveIdentity *peer_identity) const = 0;
+
+  /// Verifies a batch of assertions that are compatible with this verifier's
+  /// identity type and authority type.
+  ///
+  /// Each item is verified as by Verify(), and the items are verified
+  /// concurrently on up to `max_parallelism` threads. Implementations may also
+  /// share work between items, such as the verification of a certificate
+  /// chain that several assertions carry. The default implementation calls
+  /// Verify() for each item.
+  ///
+  /// \param items The assertions to verify.
+  /// \param max_parallelism The maximum number of threads to verify on,
+  ///                        including the calling thread, or zero for one
+  ///                        thread per hardware thread.
+  /// \param[out] peer_identities Resized to the number of items. Holds the
+  ///                             identity extracted from each item whose
+  ///                             verification succeeded.
+  /// \return The Status of the verification of each item, in the order of
+  ///         `items`.
+  virtual std::vector<Status> VerifyBatch(
+      absl::Span<const AssertionVerificationItem> items,
+      size_t max_parallelism,
+      std::vector<EnclaveIdentity> *peer_identities) const;
 };
 
 // \cond Internal
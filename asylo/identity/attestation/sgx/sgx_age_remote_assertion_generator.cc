@@ -33,12 +33,37 @@
 #include "asylo/identity/attestation/sgx/sgx_age_remote_assertion_authority_config.pb.h"
 #include "asylo/identity/platform/sgx/internal/code_identity_constants.h"
 #include "asylo/util/status_macros.h"
+#include "include/grpc/grpc.h"
+#include "include/grpcpp/create_channel.h"
+#include "include/grpcpp/support/channel_arguments.h"
 
 namespace asylo {
 namespace {
 
 const int64_t kDeadlineMicros = absl::Seconds(1) / absl::Microseconds(1);
 
+// Bounds on the backoff between attempts to re-establish a lost connection to
+// the AGE.
+const int kMinReconnectBackoffMillis = 100;
+const int kMaxReconnectBackoffMillis = 5000;
+
+// The number of times an RPC is attempted if the AGE is unavailable, which
+// happens when a pooled connection breaks between uses.
+const int kMaxRpcAttempts = 2;
+
+::grpc::ChannelArguments MakeChannelArguments() {
+  ::grpc::ChannelArguments args;
+
+  // Give each channel in the pool its own connection, rather than letting all
+  // channels to the AGE share one subchannel from gRPC's global pool.
+  args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS,
+              kMinReconnectBackoffMillis);
+  args.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, kMinReconnectBackoffMillis);
+  args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, kMaxReconnectBackoffMillis);
+  return args;
+}
+
 StatusOr<sgx::RemoteAssertionRequestAdditionalInfo> ParseAdditionalInfo(
     const AssertionRequest &request) {
   sgx::RemoteAssertionRequestAdditionalInfo additional_info;
@@ -55,8 +80,10 @@ StatusOr<sgx::RemoteAssertionRequestAdditionalInfo> ParseAdditionalInfo(
 const char *const SgxAgeRemoteAssertionGenerator::kAuthorityType =
     sgx::kSgxAgeRemoteAssertionAuthority;
 
+constexpr int SgxAgeRemoteAssertionGenerator::kChannelPoolSize;
+
 SgxAgeRemoteAssertionGenerator::SgxAgeRemoteAssertionGenerator()
-    : members_(Members()) {}
+    : members_(Members()), next_channel_(0) {}
 
 Status SgxAgeRemoteAssertionGenerator::Initialize(const std::string &config) {
   auto members_view = members_.Lock();
@@ -97,6 +124,18 @@ Status SgxAgeRemoteAssertionGenerator::Initialize(const std::string &config) {
             authority_config.root_ca_certificates().end(),
             std::back_inserter(members_view->root_ca_certificates));
   members_view->server_address = authority_config.server_address();
+
+  // Channels connect lazily, so creating them does not require the AGE to be
+  // running yet.
+  auto channel_credentials =
+      EnclaveChannelCredentials(BidirectionalSgxLocalCredentialsOptions());
+  ::grpc::ChannelArguments channel_arguments = MakeChannelArguments();
+  members_view->channels.reserve(kChannelPoolSize);
+  for (int i = 0; i < kChannelPoolSize; ++i) {
+    members_view->channels.push_back(
+        ::grpc::CreateCustomChannel(members_view->server_address,
+                                    channel_credentials, channel_arguments));
+  }
   members_view->initialized = true;
 
   return Status::OkStatus();
@@ -189,23 +228,22 @@ Status SgxAgeRemoteAssertionGenerator::Generate(const std::string &user_data,
   sgx::RemoteAssertionRequestAdditionalInfo additional_info;
   ASYLO_ASSIGN_OR_RETURN(additional_info, ParseAdditionalInfo(request));
 
-  auto channel_credentials =
-      EnclaveChannelCredentials(BidirectionalSgxLocalCredentialsOptions());
-  std::shared_ptr<::grpc::Channel> channel =
-      ::grpc::CreateChannel(members_view->server_address, channel_credentials);
-
-  gpr_timespec absolute_deadline =
-      gpr_time_add(gpr_now(GPR_CLOCK_REALTIME),
-                   gpr_time_from_micros(kDeadlineMicros, GPR_TIMESPAN));
-
-  if (!channel->WaitForConnected(absolute_deadline)) {
-    return Status(error::GoogleError::INTERNAL, "Failed to connect to server");
+  StatusOr<sgx::RemoteAssertion> remote_assertion_result;
+  for (int attempt = 0; attempt < kMaxRpcAttempts; ++attempt) {
+    std::shared_ptr<::grpc::Channel> channel;
+    ASYLO_ASSIGN_OR_RETURN(channel,
+                           GetConnectedChannel(members_view->channels));
+
+    SgxRemoteAssertionGeneratorClient client(channel);
+    remote_assertion_result = client.GenerateSgxRemoteAssertion(user_data);
+    if (remote_assertion_result.status().CanonicalCode() !=
+        error::GoogleError::UNAVAILABLE) {
+      break;
+    }
   }
 
-  SgxRemoteAssertionGeneratorClient client(channel);
   sgx::RemoteAssertion remote_assertion;
-  ASYLO_ASSIGN_OR_RETURN(remote_assertion,
-                         client.GenerateSgxRemoteAssertion(user_data));
+  ASYLO_ASSIGN_OR_RETURN(remote_assertion, std::move(remote_assertion_result));
 
   if (!remote_assertion.SerializeToString(assertion->mutable_assertion())) {
     return Status(error::GoogleError::INTERNAL,
@@ -218,6 +256,29 @@ Status SgxAgeRemoteAssertionGenerator::Generate(const std::string &user_data,
   return Status::OkStatus();
 }
 
+StatusOr<std::shared_ptr<::grpc::Channel>>
+SgxAgeRemoteAssertionGenerator::GetConnectedChannel(
+    const std::vector<std::shared_ptr<::grpc::Channel>> &channels) const {
+  std::shared_ptr<::grpc::Channel> channel =
+      channels[next_channel_.fetch_add(1) % channels.size()];
+
+  // A channel that is already connected is used without exiting to wait on
+  // it. Otherwise, asking for the state kicks off a connection attempt.
+  if (channel->GetState(/*try_to_connect=*/true) == GRPC_CHANNEL_READY) {
+    return channel;
+  }
+
+  gpr_timespec absolute_deadline =
+      gpr_time_add(gpr_now(GPR_CLOCK_REALTIME),
+                   gpr_time_from_micros(kDeadlineMicros, GPR_TIMESPAN));
+
+  if (!channel->WaitForConnected(absolute_deadline)) {
+    return Status(error::GoogleError::INTERNAL, "Failed to connect to server");
+  }
+
+  return channel;
+}
+
 // Static registration of the SgxAgeRemoteAssertionGenerator library.
 SET_STATIC_MAP_VALUE_OF_DERIVED_TYPE(AssertionGeneratorMap,
                                      SgxAgeRemoteAssertionGenerator);
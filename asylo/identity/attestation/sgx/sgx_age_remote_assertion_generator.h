@@ -19,6 +19,8 @@
 #ifndef ASYLO_IDENTITY_ATTESTATION_SGX_SGX_AGE_REMOTE_ASSERTION_GENERATOR_H_
 #define ASYLO_IDENTITY_ATTESTATION_SGX_SGX_AGE_REMOTE_ASSERTION_GENERATOR_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -29,6 +31,7 @@
 #include "asylo/util/mutex_guarded.h"
 #include "asylo/util/status.h"
 #include "asylo/util/statusor.h"
+#include "include/grpcpp/channel.h"
 
 namespace asylo {
 
@@ -37,6 +40,11 @@ namespace asylo {
 ///
 /// An SgxAgeRemoteAssertionGenerator is capable of generating assertion offers
 /// and assertions for SGX identities that can be remotely verified.
+///
+/// The generator keeps a small pool of long-lived gRPC channels to the AGE, so
+/// that the SGX local attestation handshake that secures each channel is paid
+/// once per channel rather than once per assertion. Channels reconnect with
+/// exponential backoff if their connection to the AGE is lost.
 class SgxAgeRemoteAssertionGenerator final : public EnclaveAssertionGenerator {
  public:
   /// Constructs an uninitialized SgxAgeRemoteAssertionGenerator.
@@ -74,6 +82,15 @@ class SgxAgeRemoteAssertionGenerator final : public EnclaveAssertionGenerator {
   // The authority type handled by this generator.
   static const char *const kAuthorityType;
 
+  // The number of channels to the AGE kept by the generator.
+  static constexpr int kChannelPoolSize = 4;
+
+  // Returns a channel to the AGE that is connected or has been given until a
+  // deadline to connect. Channels are handed out round-robin so that
+  // concurrent callers spread their RPCs over separate connections.
+  StatusOr<std::shared_ptr<::grpc::Channel>> GetConnectedChannel(
+      const std::vector<std::shared_ptr<::grpc::Channel>> &channels) const;
+
   // Struct that holds class members to be guarded by the initialization mutex.
   struct Members {
     // The root CAs' certificates in X.509 format.
@@ -82,6 +99,9 @@ class SgxAgeRemoteAssertionGenerator final : public EnclaveAssertionGenerator {
     // The server address of the Assertion Generator Enclave (AGE).
     std::string server_address;
 
+    // Long-lived channels to the AGE at |server_address|.
+    std::vector<std::shared_ptr<::grpc::Channel>> channels;
+
     // Indicates whether this generator has been initialized.
     bool initialized;
 
@@ -89,6 +109,9 @@ class SgxAgeRemoteAssertionGenerator final : public EnclaveAssertionGenerator {
   };
 
   MutexGuarded<Members> members_;
+
+  // The index in |channels| of the next channel to hand out.
+  mutable std::atomic<size_t> next_channel_;
 };
 
 }  // namespace asylo
@@ -0,0 +1,229 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the rate at which SgxAgeRemoteAssertionGenerator generates
+// assertions against a fake AGE hosted in the same enclave. Run with
+// --benchmarks=all.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/text_format.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/certificate.pb.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/grpc/auth/enclave_server_credentials.h"
+#include "asylo/grpc/auth/sgx_local_credentials_options.h"
+#include "asylo/identity/attestation/sgx/internal/remote_assertion.pb.h"
+#include "asylo/identity/attestation/sgx/internal/sgx_remote_assertion_generator_impl.h"
+#include "asylo/identity/attestation/sgx/sgx_age_remote_assertion_authority_config.pb.h"
+#include "asylo/identity/attestation/sgx/sgx_age_remote_assertion_generator.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/identity/provisioning/sgx/internal/fake_sgx_pki.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include "include/grpcpp/grpcpp.h"
+
+namespace asylo {
+namespace {
+
+constexpr char kAddress[] = "[::1]";
+constexpr char kUserData[] = "User data";
+constexpr char kCertificateChain[] = R"proto(
+  certificates: { format: X509_DER data: "attestation key certificate" }
+  certificates: { format: X509_DER data: "root" }
+)proto";
+
+// A fake AGE: the AGE's gRPC service, signing with a random key and served with
+// bidirectional SGX local credentials, as the real AGE is.
+class FakeAge {
+ public:
+  static StatusOr<std::unique_ptr<FakeAge>> Create() {
+    std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+        GetSgxLocalAssertionAuthorityTestConfig()};
+    ASYLO_RETURN_IF_ERROR(InitializeEnclaveAssertionAuthorities(
+        authority_configs.cbegin(), authority_configs.cend()));
+
+    CertificateChain certificate_chain;
+    if (!google::protobuf::TextFormat::ParseFromString(kCertificateChain,
+                                             &certificate_chain)) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Failed to parse text certificate chain proto");
+    }
+    std::unique_ptr<SigningKey> signing_key;
+    ASYLO_ASSIGN_OR_RETURN(signing_key, EcdsaP256Sha256SigningKey::Create());
+
+    auto fake_age = absl::WrapUnique(new FakeAge);
+    fake_age->service_ = absl::make_unique<SgxRemoteAssertionGeneratorImpl>(
+        std::move(signing_key),
+        std::vector<CertificateChain>{certificate_chain});
+
+    ::grpc::ServerBuilder builder;
+    builder.RegisterService(fake_age->service_.get());
+    int port = 0;
+    builder.AddListeningPort(
+        absl::StrCat(kAddress, ":", port),
+        EnclaveServerCredentials(BidirectionalSgxLocalCredentialsOptions()),
+        &port);
+    fake_age->server_ = builder.BuildAndStart();
+    if (!fake_age->server_ || port == 0) {
+      return Status(error::GoogleError::INTERNAL, "Failed to start fake AGE");
+    }
+    fake_age->address_ = absl::StrCat(kAddress, ":", port);
+    return fake_age;
+  }
+
+  ~FakeAge() { server_->Shutdown(); }
+
+  const std::string &address() const { return address_; }
+
+ private:
+  FakeAge() = default;
+
+  std::unique_ptr<SgxRemoteAssertionGeneratorImpl> service_;
+  std::unique_ptr<::grpc::Server> server_;
+  std::string address_;
+};
+
+// Returns the fake AGE shared by all benchmarks, starting it on first use.
+// Benchmarks run before any test fixture is set up, so the fake AGE cannot be
+// owned by one.
+const FakeAge &GetFakeAge() {
+  static FakeAge *fake_age = [] {
+    auto fake_age_result = FakeAge::Create();
+    CHECK(fake_age_result.ok()) << fake_age_result.status();
+    return std::move(fake_age_result).ValueOrDie().release();
+  }();
+  return *fake_age;
+}
+
+StatusOr<std::unique_ptr<SgxAgeRemoteAssertionGenerator>> CreateGenerator() {
+  SgxAgeRemoteAssertionAuthorityConfig authority_config;
+  authority_config.set_server_address(GetFakeAge().address());
+  *authority_config.mutable_intel_root_certificate() =
+      sgx::GetFakeSgxRootCertificate();
+  std::string config;
+  if (!authority_config.SerializeToString(&config)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize authority config");
+  }
+
+  auto generator = absl::make_unique<SgxAgeRemoteAssertionGenerator>();
+  ASYLO_RETURN_IF_ERROR(generator->Initialize(config));
+  return generator;
+}
+
+StatusOr<AssertionRequest> CreateAssertionRequest() {
+  AssertionRequest request;
+  SetSgxAgeRemoteAssertionDescription(request.mutable_description());
+
+  sgx::RemoteAssertionRequestAdditionalInfo additional_info;
+  *additional_info.add_root_ca_certificates() =
+      sgx::GetFakeSgxRootCertificate();
+  if (!additional_info.SerializeToString(
+          request.mutable_additional_information())) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize request additional info");
+  }
+  return request;
+}
+
+// Generates assertions through one generator, shared by all benchmark threads,
+// so that every assertion after the first few reuses a pooled channel.
+void BM_GenerateWithPooledChannels(benchmark::State &state) {
+  static SgxAgeRemoteAssertionGenerator *generator = [] {
+    auto generator_result = CreateGenerator();
+    CHECK(generator_result.ok()) << generator_result.status();
+    return std::move(generator_result).ValueOrDie().release();
+  }();
+  auto request_result = CreateAssertionRequest();
+  CHECK(request_result.ok()) << request_result.status();
+  AssertionRequest request = std::move(request_result).ValueOrDie();
+
+  for (auto _ : state) {
+    Assertion assertion;
+    Status status = generator->Generate(kUserData, request, &assertion);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateWithPooledChannels)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Generates each assertion through a newly initialized generator, so that
+// every assertion pays for a new channel and its SGX local attestation
+// handshake. This is the cost that channel pooling avoids.
+void BM_GenerateWithNewChannel(benchmark::State &state) {
+  auto request_result = CreateAssertionRequest();
+  CHECK(request_result.ok()) << request_result.status();
+  AssertionRequest request = std::move(request_result).ValueOrDie();
+
+  for (auto _ : state) {
+    auto generator_result = CreateGenerator();
+    if (!generator_result.ok()) {
+      state.SkipWithError(generator_result.status().ToString().c_str());
+      break;
+    }
+    Assertion assertion;
+    Status status =
+        generator_result.ValueOrDie()->Generate(kUserData, request, &assertion);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateWithNewChannel)->ThreadRange(1, 8)->UseRealTime();
+
+// Checks that assertions are generated through the pooled channels, and that
+// the pool survives many more assertions than it has channels.
+TEST(SgxAgeRemoteAssertionGeneratorBenchmarkTest, GenerateThroughPool) {
+  std::unique_ptr<SgxAgeRemoteAssertionGenerator> generator;
+  ASYLO_ASSERT_OK_AND_ASSIGN(generator, CreateGenerator());
+  AssertionRequest request;
+  ASYLO_ASSERT_OK_AND_ASSIGN(request, CreateAssertionRequest());
+
+  for (int i = 0; i < 20; ++i) {
+    Assertion assertion;
+    ASYLO_ASSERT_OK(generator->Generate(kUserData, request, &assertion));
+
+    sgx::RemoteAssertion remote_assertion;
+    ASSERT_TRUE(remote_assertion.ParseFromString(assertion.assertion()));
+    sgx::RemoteAssertionPayload payload;
+    ASSERT_TRUE(payload.ParseFromString(remote_assertion.payload()));
+    EXPECT_EQ(payload.user_data(), kUserData);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -415,8 +415,8 @@ TEST_F(SgxAgeRemoteAssertionGeneratorTest, GenerateSuccess) {
   ASYLO_ASSERT_OK_AND_ASSIGN(enclave_identity,
                              test_enclave_wrapper_->GetSgxSelfIdentity());
 
-  // Attempt to generate an assertion 100 times to ensure that re-establishing
-  // the gRPC channel to the AGE multiple times does not cause server failures.
+  // Attempt to generate an assertion 100 times to ensure that reusing the
+  // generator's pooled gRPC channels to the AGE does not cause server failures.
   for (int i = 0; i < 100; ++i) {
     Assertion assertion;
     ASYLO_ASSERT_OK_AND_ASSIGN(assertion, test_enclave_wrapper_->Generate(
@@ -23,7 +23,9 @@
 #include <algorithm>
 #include <iterator>
 #include <string>
+#include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -60,6 +62,7 @@
 #include "asylo/identity/provisioning/sgx/internal/pck_certificate_util.h"
 #include "asylo/platform/common/static_map.h"
 #include "asylo/util/error_codes.h"
+#include "asylo/util/parallel_for.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/statusor.h"
@@ -312,6 +315,89 @@ Status VerifyQeIdentityMatchesExpectation(
   return Status::OkStatus();
 }
 
+// The results of verifying a PCK certificate chain carried by one or more
+// quotes in a batch.
+struct PckCertChainResult {
+  Status chain_status;
+  Status machine_configuration_status;
+  sgx::MachineConfiguration machine_configuration;
+};
+
+// The results of verifying the certification of a quoting enclave by the PCK,
+// carried by one or more quotes in a batch.
+struct QeCertificationResult {
+  Status pck_signature_status;
+  Status qe_identity_status;
+};
+
+// Returns a key identifying the PCK certificate chain carried by |quote|.
+std::string PckCertChainKey(const sgx::IntelQeQuote &quote) {
+  return std::string(quote.cert_data.qe_cert_data.begin(),
+                     quote.cert_data.qe_cert_data.end());
+}
+
+// Returns a key identifying the quoting enclave certification carried by
+// |quote|: the QE report, the PCK's signature over it, and the certification
+// data that identifies the PCK.
+std::string QeCertificationKey(const sgx::IntelQeQuote &quote) {
+  return absl::StrCat(
+      ConvertTrivialObjectToBinaryString(quote.cert_data.qe_cert_data_type),
+      ConvertTrivialObjectToBinaryString(quote.signature.qe_report),
+      ConvertTrivialObjectToBinaryString(quote.signature.qe_report_signature),
+      PckCertChainKey(quote));
+}
+
+PckCertChainResult VerifyPckCertChainOfQuote(
+    const sgx::IntelQeQuote &quote,
+    const std::vector<std::unique_ptr<CertificateInterface>>
+        &trusted_root_certificates) {
+  PckCertChainResult result;
+  result.chain_status =
+      VerifyPckCertificateChain(quote, trusted_root_certificates);
+  SgxIdentity machine_identity;
+  result.machine_configuration_status =
+      ParseAndAppendPeerMachineConfigurationFromPckCertChain(quote.cert_data,
+                                                             &machine_identity);
+  result.machine_configuration =
+      std::move(*machine_identity.mutable_machine_configuration());
+  return result;
+}
+
+QeCertificationResult VerifyQeCertificationOfQuote(
+    const sgx::IntelQeQuote &quote,
+    const IdentityAclPredicate &qe_expectation) {
+  QeCertificationResult result;
+  result.pck_signature_status = VerifyPckSignatureOverQuotingEnclave(quote);
+  result.qe_identity_status =
+      VerifyQeIdentityMatchesExpectation(quote, qe_expectation);
+  return result;
+}
+
+// Completes the verification of a quote in a batch, given the results of
+// verifying its PCK certificate chain and QE certification. Checks are made
+// in the same order as SgxIntelEcdsaQeRemoteAssertionVerifier::Verify() makes
+// them, so that both report the same error for an invalid quote.
+Status VerifyBatchedQuote(
+    const AdditionalAuthenticatedDataGenerator &aad_generator,
+    const std::string &user_data, const sgx::IntelQeQuote &quote,
+    const PckCertChainResult &chain_result,
+    const QeCertificationResult &qe_result, EnclaveIdentity *peer_identity) {
+  ASYLO_RETURN_IF_ERROR(VerifyQuoteHeader(quote));
+  ASYLO_RETURN_IF_ERROR(
+      VerifyQuoteBodySignature(aad_generator, user_data, quote));
+  ASYLO_RETURN_IF_ERROR(VerifyQeReportDataMatchesQuoteSigningKey(quote));
+  ASYLO_RETURN_IF_ERROR(qe_result.pck_signature_status);
+  ASYLO_RETURN_IF_ERROR(chain_result.chain_status);
+  ASYLO_RETURN_IF_ERROR(qe_result.qe_identity_status);
+  ASYLO_RETURN_IF_ERROR(chain_result.machine_configuration_status);
+
+  SgxIdentity identity = ParseSgxIdentityFromHardwareReport(quote.body);
+  *identity.mutable_machine_configuration() =
+      chain_result.machine_configuration;
+  ASYLO_ASSIGN_OR_RETURN(*peer_identity, SerializeSgxIdentity(identity));
+  return Status::OkStatus();
+}
+
 }  // namespace
 
 SgxIntelEcdsaQeRemoteAssertionVerifier::SgxIntelEcdsaQeRemoteAssertionVerifier()
@@ -415,6 +501,85 @@ Status SgxIntelEcdsaQeRemoteAssertionVerifier::Verify(
   return Status::OkStatus();
 }
 
+std::vector<Status> SgxIntelEcdsaQeRemoteAssertionVerifier::VerifyBatch(
+    absl::Span<const AssertionVerificationItem> items, size_t max_parallelism,
+    std::vector<EnclaveIdentity> *peer_identities) const {
+  std::vector<Status> statuses(items.size());
+  peer_identities->assign(items.size(), EnclaveIdentity());
+
+  Status initialization_status = CheckInitialization(__func__);
+  if (!initialization_status.ok()) {
+    statuses.assign(items.size(), initialization_status);
+    return statuses;
+  }
+
+  // Parse every quote, and collect the distinct PCK certificate chains and QE
+  // certifications that the quotes carry.
+  std::vector<sgx::IntelQeQuote> quotes(items.size());
+  std::vector<size_t> chain_indices(items.size());
+  std::vector<size_t> qe_indices(items.size());
+  std::vector<const sgx::IntelQeQuote *> chain_quotes;
+  std::vector<const sgx::IntelQeQuote *> qe_quotes;
+  absl::flat_hash_map<std::string, size_t> chain_keys;
+  absl::flat_hash_map<std::string, size_t> qe_keys;
+  for (size_t i = 0; i < items.size(); ++i) {
+    const Assertion &assertion = *items[i].assertion;
+    statuses[i] = CheckDescription(assertion.description());
+    if (!statuses[i].ok()) {
+      continue;
+    }
+    auto quote_result = sgx::ParseDcapPackedQuote(assertion.assertion());
+    if (!quote_result.ok()) {
+      statuses[i] = quote_result.status();
+      continue;
+    }
+    quotes[i] = std::move(quote_result).ValueOrDie();
+
+    auto chain =
+        chain_keys.emplace(PckCertChainKey(quotes[i]), chain_quotes.size());
+    if (chain.second) {
+      chain_quotes.push_back(&quotes[i]);
+    }
+    chain_indices[i] = chain.first->second;
+
+    auto qe = qe_keys.emplace(QeCertificationKey(quotes[i]), qe_quotes.size());
+    if (qe.second) {
+      qe_quotes.push_back(&quotes[i]);
+    }
+    qe_indices[i] = qe.first->second;
+  }
+
+  auto members_view = members_.ReaderLock();
+
+  // Verify each distinct chain and QE certification once.
+  std::vector<PckCertChainResult> chain_results(chain_quotes.size());
+  std::vector<QeCertificationResult> qe_results(qe_quotes.size());
+  ParallelFor(chain_quotes.size() + qe_quotes.size(), max_parallelism,
+              [&](size_t index) {
+                if (index < chain_quotes.size()) {
+                  chain_results[index] = VerifyPckCertChainOfQuote(
+                      *chain_quotes[index], members_view->root_certificates);
+                  return;
+                }
+                index -= chain_quotes.size();
+                qe_results[index] = VerifyQeCertificationOfQuote(
+                    *qe_quotes[index], members_view->qe_identity_expectation);
+              });
+
+  // Verify the signature of each quote over its enclave's report.
+  ParallelFor(items.size(), max_parallelism, [&](size_t index) {
+    if (!statuses[index].ok()) {
+      return;
+    }
+    statuses[index] = VerifyBatchedQuote(
+        *members_view->aad_generator, *items[index].user_data, quotes[index],
+        chain_results[chain_indices[index]], qe_results[qe_indices[index]],
+        &(*peer_identities)[index]);
+  });
+
+  return statuses;
+}
+
 Status SgxIntelEcdsaQeRemoteAssertionVerifier::CheckInitialization(
     absl::string_view caller) const {
   return IsInitialized()
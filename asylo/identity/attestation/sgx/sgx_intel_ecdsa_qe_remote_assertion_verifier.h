@@ -19,12 +19,14 @@
 #ifndef ASYLO_IDENTITY_ATTESTATION_SGX_SGX_INTEL_ECDSA_QE_REMOTE_ASSERTION_VERIFIER_H_
 #define ASYLO_IDENTITY_ATTESTATION_SGX_SGX_INTEL_ECDSA_QE_REMOTE_ASSERTION_VERIFIER_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "asylo/crypto/certificate_interface.h"
 #include "asylo/identity/additional_authenticated_data_generator.h"
 #include "asylo/identity/attestation/enclave_assertion_verifier.h"
@@ -72,6 +74,15 @@ class SgxIntelEcdsaQeRemoteAssertionVerifier : public EnclaveAssertionVerifier {
   Status Verify(const std::string &user_data, const Assertion &assertion,
                 EnclaveIdentity *peer_identity) const override;
 
+  /// Verifies a batch of assertions as by Verify(). The PCK certificate chains
+  /// and quoting enclave certifications that several quotes carry are
+  /// verified only once per batch, and the remaining signature verifications
+  /// are spread over up to `max_parallelism` threads.
+  std::vector<Status> VerifyBatch(
+      absl::Span<const AssertionVerificationItem> items,
+      size_t max_parallelism,
+      std::vector<EnclaveIdentity> *peer_identities) const override;
+
  private:
   // Type that holds members for mutex-synchronized access.
   struct Members {
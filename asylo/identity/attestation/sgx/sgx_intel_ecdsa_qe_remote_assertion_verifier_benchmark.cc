@@ -0,0 +1,238 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compares verifying a batch of Intel ECDSA QE assertions one at a time with
+// Verify() against verifying them together with VerifyBatch(). The quotes come
+// from a single fake platform, so they share a PCK certificate chain and a
+// quoting enclave certification, as the quotes received by a server from one
+// fleet of machines largely do.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/crypto/keys.pb.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/crypto/util/bytes.h"
+#include "asylo/crypto/util/trivial_object_util.h"
+#include "asylo/identity/additional_authenticated_data_generator.h"
+#include "asylo/identity/attestation/enclave_assertion_verifier.h"
+#include "asylo/identity/attestation/sgx/internal/fake_pce.h"
+#include "asylo/identity/attestation/sgx/internal/intel_ecdsa_quote.h"
+#include "asylo/identity/attestation/sgx/sgx_intel_ecdsa_qe_remote_assertion_authority_config.pb.h"
+#include "asylo/identity/attestation/sgx/sgx_intel_ecdsa_qe_remote_assertion_verifier.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/platform/sgx/internal/identity_key_management_structs.h"
+#include "asylo/identity/platform/sgx/internal/sgx_identity_util_internal.h"
+#include "asylo/identity/platform/sgx/sgx_identity_util.h"
+#include "asylo/identity/provisioning/sgx/internal/fake_sgx_pki.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
+#include "QuoteVerification/Src/AttestationLibrary/include/QuoteVerification/QuoteConstants.h"
+
+namespace asylo {
+namespace {
+
+constexpr int kBatchSize = 64;
+
+// Signs |data| with |signing_key| and returns the signature in the format of a
+// quote signature.
+StatusOr<UnsafeBytes<64>> SignForQuote(const SigningKey &signing_key,
+                                       ByteContainerView data) {
+  Signature signature;
+  ASYLO_RETURN_IF_ERROR(signing_key.Sign(data, &signature));
+  UnsafeBytes<64> quote_signature;
+  quote_signature.replace(0, signature.ecdsa_signature().r());
+  quote_signature.replace(32, signature.ecdsa_signature().s());
+  return quote_signature;
+}
+
+// A batch of assertions from one fake platform, with the verifier that trusts
+// them.
+struct Batch {
+  std::unique_ptr<SgxIntelEcdsaQeRemoteAssertionVerifier> verifier;
+  std::vector<std::string> user_data;
+  std::vector<Assertion> assertions;
+  std::vector<AssertionVerificationItem> items;
+};
+
+StatusOr<std::unique_ptr<Batch>> CreateBatch(int size) {
+  auto batch = absl::make_unique<Batch>();
+
+  // The quoting enclave certifies one attestation key, which signs every
+  // quote.
+  sgx::ReportBody qe_identity = TrivialRandomObject<sgx::ReportBody>();
+  std::unique_ptr<EcdsaP256Sha256SigningKey> attestation_key;
+  ASYLO_ASSIGN_OR_RETURN(attestation_key, EcdsaP256Sha256SigningKey::Create());
+  EccP256CurvePoint public_key;
+  ASYLO_ASSIGN_OR_RETURN(public_key, attestation_key->GetPublicKeyPoint());
+
+  sgx::IntelQeQuote template_quote;
+  template_quote.signature.public_key.assign(&public_key, sizeof(public_key));
+  AppendTrivialObject(TrivialRandomObject<UnsafeBytes<123>>(),
+                      &template_quote.qe_authn_data);
+
+  Sha256Hash sha256;
+  sha256.Update(template_quote.signature.public_key);
+  sha256.Update(template_quote.qe_authn_data);
+  std::vector<uint8_t> report_data;
+  ASYLO_RETURN_IF_ERROR(sha256.CumulativeHash(&report_data));
+  report_data.resize(sgx::kReportdataSize);
+  qe_identity.reportdata.data.assign(report_data);
+  template_quote.signature.qe_report = qe_identity;
+
+  std::unique_ptr<sgx::FakePce> pce;
+  ASYLO_ASSIGN_OR_RETURN(pce, sgx::FakePce::CreateFromFakePki());
+  sgx::Report qe_report;
+  qe_report.body = qe_identity;
+  std::string qe_report_signature;
+  ASYLO_RETURN_IF_ERROR(pce->PceSignReport(qe_report, sgx::FakePce::kPceSvn,
+                                           qe_identity.cpusvn,
+                                           &qe_report_signature));
+  std::copy(qe_report_signature.begin(), qe_report_signature.end(),
+            template_quote.signature.qe_report_signature.begin());
+
+  template_quote.cert_data.qe_cert_data_type =
+      ::intel::sgx::qvl::constants::PCK_ID_PCK_CERT_CHAIN;
+  for (absl::string_view pem : {sgx::kFakeSgxPck.certificate_pem,
+                                sgx::kFakeSgxProcessorCa.certificate_pem,
+                                sgx::kFakeSgxRootCa.certificate_pem}) {
+    template_quote.cert_data.qe_cert_data.insert(
+        template_quote.cert_data.qe_cert_data.end(), pem.begin(), pem.end());
+  }
+
+  template_quote.header = TrivialRandomObject<sgx::IntelQeQuoteHeader>();
+  template_quote.header.version = ::intel::sgx::qvl::constants::QUOTE_VERSION;
+  template_quote.header.algorithm =
+      ::intel::sgx::qvl::constants::ECDSA_256_WITH_P256_CURVE;
+  template_quote.header.qe_vendor_id.assign(
+      ::intel::sgx::qvl::constants::INTEL_QE_VENDOR_ID.data(),
+      ::intel::sgx::qvl::constants::INTEL_QE_VENDOR_ID.size());
+
+  // Each quote is over the report of a different enclave, bound to different
+  // user data.
+  auto aad_generator =
+      AdditionalAuthenticatedDataGenerator::CreateEkepAadGenerator();
+  batch->user_data.reserve(size);
+  batch->assertions.reserve(size);
+  for (int i = 0; i < size; ++i) {
+    batch->user_data.push_back(absl::StrCat("user data ", i));
+    sgx::IntelQeQuote quote = template_quote;
+    quote.body = TrivialRandomObject<sgx::ReportBody>();
+    ASYLO_ASSIGN_OR_RETURN(quote.body.reportdata.data,
+                           aad_generator->Generate(batch->user_data.back()));
+    ASYLO_ASSIGN_OR_RETURN(
+        quote.signature.body_signature,
+        SignForQuote(*attestation_key,
+                     ByteContainerView(&quote, sizeof(quote.header) +
+                                                   sizeof(quote.body))));
+
+    Assertion assertion;
+    SetSgxIntelEcdsaQeRemoteAssertionDescription(
+        assertion.mutable_description());
+    std::vector<uint8_t> packed_quote = sgx::PackDcapQuote(quote);
+    assertion.set_assertion(packed_quote.data(), packed_quote.size());
+    batch->assertions.push_back(std::move(assertion));
+  }
+  for (int i = 0; i < size; ++i) {
+    batch->items.push_back({&batch->user_data[i], &batch->assertions[i]});
+  }
+
+  // The verifier trusts the fake SGX root and the quoting enclave.
+  SgxIntelEcdsaQeRemoteAssertionAuthorityConfig config;
+  *config.mutable_verifier_info()->add_root_certificates() =
+      sgx::GetFakeSgxRootCertificate();
+  SgxIdentityExpectation qe_expectation;
+  ASYLO_ASSIGN_OR_RETURN(
+      qe_expectation,
+      CreateSgxIdentityExpectation(
+          ParseSgxIdentityFromHardwareReport(template_quote.signature.qe_report),
+          SgxIdentityMatchSpecOptions::DEFAULT));
+  ASYLO_ASSIGN_OR_RETURN(*config.mutable_verifier_info()
+                              ->mutable_qe_identity_expectation()
+                              ->mutable_expectation(),
+                         SerializeSgxIdentityExpectation(qe_expectation));
+  std::string serialized_config;
+  if (!config.SerializeToString(&serialized_config)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to serialize authority config");
+  }
+  batch->verifier = absl::make_unique<SgxIntelEcdsaQeRemoteAssertionVerifier>();
+  ASYLO_RETURN_IF_ERROR(batch->verifier->Initialize(serialized_config));
+  return batch;
+}
+
+// Returns the batch shared by all benchmarks, creating it on first use.
+const Batch &GetBatch() {
+  static Batch *batch = [] {
+    auto batch_result = CreateBatch(kBatchSize);
+    CHECK(batch_result.ok()) << batch_result.status();
+    return std::move(batch_result).ValueOrDie().release();
+  }();
+  return *batch;
+}
+
+// Verifies each assertion in the batch with its own call to Verify().
+void BM_Verify(benchmark::State &state) {
+  const Batch &batch = GetBatch();
+  for (auto _ : state) {
+    for (const AssertionVerificationItem &item : batch.items) {
+      EnclaveIdentity identity;
+      Status status =
+          batch.verifier->Verify(*item.user_data, *item.assertion, &identity);
+      if (!status.ok()) {
+        state.SkipWithError(status.ToString().c_str());
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch.items.size());
+}
+BENCHMARK(BM_Verify)->UseRealTime();
+
+// Verifies the batch with one call to VerifyBatch() on up to state.range(0)
+// threads.
+void BM_VerifyBatch(benchmark::State &state) {
+  const Batch &batch = GetBatch();
+  for (auto _ : state) {
+    std::vector<EnclaveIdentity> identities;
+    std::vector<Status> statuses =
+        batch.verifier->VerifyBatch(batch.items, state.range(0), &identities);
+    for (const Status &status : statuses) {
+      if (!status.ok()) {
+        state.SkipWithError(status.ToString().c_str());
+        return;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch.items.size());
+}
+BENCHMARK(BM_VerifyBatch)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+}  // namespace
+}  // namespace asylo
@@ -66,6 +66,7 @@ namespace {
 using ::testing::Eq;
 using ::testing::HasSubstr;
 using ::testing::IsTrue;
+using ::testing::SizeIs;
 using ::testing::Test;
 
 // clang-format off
@@ -629,5 +630,72 @@ TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest, VerifySuccess) {
             quote.body.isvsvn);
 }
 
+TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest,
+       VerifyBatchFailsIfNotInitialized) {
+  SgxIntelEcdsaQeRemoteAssertionVerifier verifier;
+
+  std::string user_data = "user data";
+  Assertion assertion = CreateAssertion(GenerateValidQuote(user_data));
+  std::vector<AssertionVerificationItem> items(3, {&user_data, &assertion});
+  std::vector<EnclaveIdentity> identities;
+  std::vector<Status> statuses =
+      verifier.VerifyBatch(items, /*max_parallelism=*/2, &identities);
+
+  ASSERT_THAT(statuses, SizeIs(items.size()));
+  EXPECT_THAT(identities, SizeIs(items.size()));
+  for (const Status &status : statuses) {
+    EXPECT_THAT(status, StatusIs(error::GoogleError::FAILED_PRECONDITION,
+                                 HasSubstr("VerifyBatch")));
+  }
+}
+
+TEST_F(SgxIntelEcdsaQeRemoteAssertionVerifierTest,
+       VerifyBatchMatchesVerifyForEachItem) {
+  SgxIntelEcdsaQeRemoteAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(valid_config_));
+
+  std::string user_data = "user data";
+  std::string other_user_data = "other user data";
+  Assertion valid = CreateAssertion(GenerateValidQuote(user_data));
+  Assertion other_valid = CreateAssertion(GenerateValidQuote(other_user_data));
+  Assertion unknown_qe = CreateAssertion(
+      GenerateValidQuote(user_data, TrivialRandomObject<sgx::ReportBody>()));
+  Assertion unparseable = ParseTextProtoOrDie(kValidAssertionDescriptionProto);
+  unparseable.set_assertion("can't parse this");
+  Assertion wrong_description = valid;
+  wrong_description.mutable_description()->set_authority_type("bad authority");
+
+  // Every quote carries the same PCK certificate chain, so the batch verifies
+  // it once on behalf of all items.
+  std::vector<AssertionVerificationItem> items = {
+      {&user_data, &valid},        {&other_user_data, &other_valid},
+      {&other_user_data, &valid},  {&user_data, &unknown_qe},
+      {&user_data, &unparseable},  {&user_data, &wrong_description},
+      {&user_data, &valid},
+  };
+  std::vector<EnclaveIdentity> identities;
+  std::vector<Status> statuses =
+      verifier.VerifyBatch(items, /*max_parallelism=*/4, &identities);
+
+  ASSERT_THAT(statuses, SizeIs(items.size()));
+  ASSERT_THAT(identities, SizeIs(items.size()));
+  for (size_t i = 0; i < items.size(); ++i) {
+    EnclaveIdentity identity;
+    Status status =
+        verifier.Verify(*items[i].user_data, *items[i].assertion, &identity);
+    EXPECT_THAT(statuses[i], Eq(status)) << "item " << i;
+    if (status.ok()) {
+      EXPECT_THAT(identities[i], EqualsProto(identity)) << "item " << i;
+    }
+  }
+  ASYLO_EXPECT_OK(statuses[0]);
+  ASYLO_EXPECT_OK(statuses[1]);
+  EXPECT_THAT(statuses[2], StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(statuses[3], StatusIs(error::GoogleError::UNAUTHENTICATED));
+  EXPECT_THAT(statuses[4], StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(statuses[5], StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  ASYLO_EXPECT_OK(statuses[6]);
+}
+
 }  // namespace
 }  // namespace asylo
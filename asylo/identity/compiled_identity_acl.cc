@@ -0,0 +1,255 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/compiled_identity_acl.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/identity/delegating_identity_expectation_matcher.h"
+#include "asylo/identity/identity_acl_evaluator.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+
+constexpr size_t CompiledIdentityAcl::kDefaultMaxCachedResults;
+
+StatusOr<std::unique_ptr<CompiledIdentityAcl>> CompiledIdentityAcl::Create(
+    const IdentityAclPredicate &acl,
+    std::unique_ptr<IdentityExpectationMatcher> matcher,
+    size_t max_cached_results) {
+  if (!matcher) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Matcher must not be null");
+  }
+
+  auto compiled_acl = absl::WrapUnique(
+      new CompiledIdentityAcl(acl, std::move(matcher), max_cached_results));
+  absl::flat_hash_map<std::string, int32_t> expectation_indices;
+  ASYLO_RETURN_IF_ERROR(
+      compiled_acl->CompilePredicate(compiled_acl->acl_, &expectation_indices));
+  return std::move(compiled_acl);
+}
+
+StatusOr<std::unique_ptr<CompiledIdentityAcl>> CompiledIdentityAcl::Create(
+    const IdentityAclPredicate &acl) {
+  return Create(acl, absl::make_unique<DelegatingIdentityExpectationMatcher>());
+}
+
+StatusOr<std::string> CompiledIdentityAcl::DigestIdentities(
+    const std::vector<EnclaveIdentity> &identities) {
+  EnclaveIdentities identities_proto;
+  for (const EnclaveIdentity &identity : identities) {
+    *identities_proto.add_identities() = identity;
+  }
+  return DigestSerializedIdentities(identities_proto.SerializeAsString());
+}
+
+StatusOr<std::string> CompiledIdentityAcl::DigestSerializedIdentities(
+    absl::string_view serialized_identities) {
+  Sha256Hash hash;
+  hash.Update(serialized_identities);
+  std::vector<uint8_t> digest;
+  ASYLO_RETURN_IF_ERROR(hash.CumulativeHash(&digest));
+  return std::string(digest.cbegin(), digest.cend());
+}
+
+StatusOr<bool> CompiledIdentityAcl::Evaluate(
+    const std::vector<EnclaveIdentity> &identities,
+    std::string *explanation) const {
+  if (max_cached_results_ == 0) {
+    return Evaluate(identities, /*identities_digest=*/"", explanation);
+  }
+  std::string identities_digest;
+  ASYLO_ASSIGN_OR_RETURN(identities_digest, DigestIdentities(identities));
+  return Evaluate(identities, identities_digest, explanation);
+}
+
+StatusOr<bool> CompiledIdentityAcl::Evaluate(
+    const std::vector<EnclaveIdentity> &identities,
+    const std::string &identities_digest, std::string *explanation) const {
+  bool use_memo = max_cached_results_ > 0 && !identities_digest.empty();
+
+  absl::optional<bool> memoized_result;
+  if (use_memo) {
+    auto results_view = results_.ReaderLock();
+    auto it = results_view->find(identities_digest);
+    if (it != results_view->end()) {
+      memoized_result = it->second;
+    }
+  }
+
+  bool result;
+  if (memoized_result.has_value()) {
+    result = memoized_result.value();
+  } else {
+    ASYLO_ASSIGN_OR_RETURN(result, EvaluateProgram(identities));
+    if (use_memo) {
+      auto results_view = results_.Lock();
+      if (results_view->size() >= max_cached_results_) {
+        results_view->clear();
+      }
+      results_view->emplace(identities_digest, result);
+    }
+  }
+
+  // Explanations are only needed on failure, so defer the cost of building
+  // one to the original, explanation-producing evaluator.
+  if (!result && explanation != nullptr) {
+    StatusOr<bool> explained_result =
+        EvaluateIdentityAcl(identities, acl_, *matcher_, explanation);
+    if (!explained_result.ok()) {
+      return explained_result.status();
+    }
+  }
+  return result;
+}
+
+CompiledIdentityAcl::CompiledIdentityAcl(
+    IdentityAclPredicate acl,
+    std::unique_ptr<IdentityExpectationMatcher> matcher,
+    size_t max_cached_results)
+    : acl_(std::move(acl)),
+      matcher_(std::move(matcher)),
+      max_cached_results_(max_cached_results),
+      results_(absl::flat_hash_map<std::string, bool>()) {}
+
+Status CompiledIdentityAcl::CompilePredicate(
+    const IdentityAclPredicate &predicate,
+    absl::flat_hash_map<std::string, int32_t> *expectation_indices) {
+  size_t pc = program_.size();
+  program_.emplace_back();
+
+  switch (predicate.item_case()) {
+    case IdentityAclPredicate::kExpectation: {
+      std::string key = predicate.expectation().SerializeAsString();
+      auto it = expectation_indices->find(key);
+      if (it == expectation_indices->end()) {
+        it = expectation_indices
+                 ->emplace(std::move(key),
+                           static_cast<int32_t>(expectations_.size()))
+                 .first;
+        expectations_.push_back(predicate.expectation());
+      }
+      program_[pc].opcode = Opcode::kMatchExpectation;
+      program_[pc].expectation_index = it->second;
+      break;
+    }
+    case IdentityAclPredicate::kAclGroup: {
+      const IdentityAclGroup &group = predicate.acl_group();
+      if (group.predicates().empty()) {
+        return Status(error::GoogleError::INVALID_ARGUMENT,
+                      "ACL predicate groups cannot be empty");
+      }
+      switch (group.type()) {
+        case IdentityAclGroup::OR:
+          program_[pc].opcode = Opcode::kOr;
+          break;
+        case IdentityAclGroup::AND:
+          program_[pc].opcode = Opcode::kAnd;
+          break;
+        case IdentityAclGroup::NOT:
+          if (group.predicates_size() != 1) {
+            return Status(error::GoogleError::INVALID_ARGUMENT,
+                          "NOT predicate groups must have exactly one element");
+          }
+          program_[pc].opcode = Opcode::kNot;
+          break;
+        default:
+          return Status(
+              error::GoogleError::INVALID_ARGUMENT,
+              absl::StrCat("Unknown acl_group type: ", group.type()));
+      }
+      program_[pc].expectation_index = -1;
+      for (const IdentityAclPredicate &child : group.predicates()) {
+        ASYLO_RETURN_IF_ERROR(CompilePredicate(child, expectation_indices));
+      }
+      break;
+    }
+    case IdentityAclPredicate::ITEM_NOT_SET:
+      return Status(
+          error::GoogleError::INVALID_ARGUMENT,
+          "Invalid ACL predicate: must be either a group or an expectation.");
+    default:
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Unknown acl item: ", predicate.item_case()));
+  }
+
+  program_[pc].end = static_cast<int32_t>(program_.size());
+  return Status::OkStatus();
+}
+
+StatusOr<bool> CompiledIdentityAcl::EvaluateInstruction(
+    size_t pc, const std::vector<EnclaveIdentity> &identities,
+    std::vector<int8_t> *expectation_results) const {
+  const Instruction &instruction = program_[pc];
+
+  if (instruction.opcode == Opcode::kMatchExpectation) {
+    int8_t &cached = (*expectation_results)[instruction.expectation_index];
+    if (cached >= 0) {
+      return cached == 1;
+    }
+    const EnclaveIdentityExpectation &expectation =
+        expectations_[instruction.expectation_index];
+    bool matched = false;
+    for (const EnclaveIdentity &identity : identities) {
+      ASYLO_ASSIGN_OR_RETURN(
+          matched, matcher_->MatchAndExplain(identity, expectation,
+                                             /*explanation=*/nullptr));
+      if (matched) {
+        break;
+      }
+    }
+    cached = matched ? 1 : 0;
+    return matched;
+  }
+
+  if (instruction.opcode == Opcode::kNot) {
+    bool child_result;
+    ASYLO_ASSIGN_OR_RETURN(child_result, EvaluateInstruction(
+                                             pc + 1, identities,
+                                             expectation_results));
+    return !child_result;
+  }
+
+  // An AND group is decided by its first false child, and an OR group by its
+  // first true child.
+  const bool deciding_value = instruction.opcode == Opcode::kOr;
+  for (size_t child = pc + 1; child < static_cast<size_t>(instruction.end);
+       child = program_[child].end) {
+    bool child_result;
+    ASYLO_ASSIGN_OR_RETURN(child_result, EvaluateInstruction(
+                                             child, identities,
+                                             expectation_results));
+    if (child_result == deciding_value) {
+      return deciding_value;
+    }
+  }
+  return !deciding_value;
+}
+
+StatusOr<bool> CompiledIdentityAcl::EvaluateProgram(
+    const std::vector<EnclaveIdentity> &identities) const {
+  std::vector<int8_t> expectation_results(expectations_.size(), -1);
+  return EvaluateInstruction(/*pc=*/0, identities, &expectation_results);
+}
+
+}  // namespace asylo
@@ -0,0 +1,169 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
+#define ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/identity_acl.pb.h"
+#include "asylo/identity/identity_expectation_matcher.h"
+#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// A pre-validated, flattened form of an `IdentityAclPredicate` that can be
+/// evaluated repeatedly against sets of peer identities.
+///
+/// Compiling an ACL checks all of the structural constraints described in
+/// identity_acl_evaluator.h once, flattens the predicate tree into a pre-order
+/// instruction sequence, and de-duplicates identical expectations so that each
+/// distinct expectation is matched at most once per evaluation.
+///
+/// A CompiledIdentityAcl also memoizes evaluation results keyed by a SHA-256
+/// digest of the evaluated identities. Since a peer's identities do not change
+/// over the lifetime of a connection, repeated evaluations for the same peer
+/// (for example, once per RPC) are answered from the memo. The memo holds at
+/// most `max_cached_results` entries and is cleared when it fills up.
+///
+/// Unlike `EvaluateIdentityAcl()`, evaluation short-circuits both `AND` and
+/// `OR` groups, so a matcher error in a predicate that does not affect the
+/// result may go unreported. An explanation is only constructed when the ACL
+/// is not satisfied and the caller asks for one.
+///
+/// This class is thread-safe.
+class CompiledIdentityAcl {
+ public:
+  /// The default upper bound on the number of memoized results.
+  static constexpr size_t kDefaultMaxCachedResults = 1024;
+
+  /// Compiles `acl` for evaluation with `matcher`.
+  ///
+  /// \param acl The ACL to compile.
+  /// \param matcher The matcher used to evaluate expectations in `acl`.
+  /// \param max_cached_results The maximum number of memoized results. A value
+  ///                           of zero disables memoization.
+  /// \return The compiled ACL, or a non-OK Status if `acl` is malformed.
+  static StatusOr<std::unique_ptr<CompiledIdentityAcl>> Create(
+      const IdentityAclPredicate &acl,
+      std::unique_ptr<IdentityExpectationMatcher> matcher,
+      size_t max_cached_results = kDefaultMaxCachedResults);
+
+  /// Compiles `acl` for evaluation with a
+  /// `DelegatingIdentityExpectationMatcher`.
+  static StatusOr<std::unique_ptr<CompiledIdentityAcl>> Create(
+      const IdentityAclPredicate &acl);
+
+  CompiledIdentityAcl(const CompiledIdentityAcl &other) = delete;
+  CompiledIdentityAcl &operator=(const CompiledIdentityAcl &other) = delete;
+
+  /// Computes the digest used to memoize results for `identities`.
+  static StatusOr<std::string> DigestIdentities(
+      const std::vector<EnclaveIdentity> &identities);
+
+  /// Computes the digest used to memoize results for a serialized
+  /// `EnclaveIdentities` message. For a canonically-serialized message, this
+  /// produces the same value as `DigestIdentities()` for its parsed form.
+  static StatusOr<std::string> DigestSerializedIdentities(
+      absl::string_view serialized_identities);
+
+  /// Evaluates whether `identities` satisfies the compiled ACL.
+  ///
+  /// \param identities A list of identities to match against the ACL.
+  /// \param[out] explanation An explanation of why the match failed, if the
+  ///             result is false. May be nullptr.
+  /// \return A bool indicating whether the ACL evaluated to true, or a non-OK
+  ///         Status if the matcher failed.
+  StatusOr<bool> Evaluate(const std::vector<EnclaveIdentity> &identities,
+                          std::string *explanation = nullptr) const;
+
+  /// Like `Evaluate()` above, but uses a caller-provided `identities_digest`,
+  /// which must have been computed by `DigestIdentities()` or
+  /// `DigestSerializedIdentities()` for `identities`.
+  StatusOr<bool> Evaluate(const std::vector<EnclaveIdentity> &identities,
+                          const std::string &identities_digest,
+                          std::string *explanation) const;
+
+  /// Returns the ACL from which this object was compiled.
+  const IdentityAclPredicate &acl() const { return acl_; }
+
+ private:
+  // The operation performed by an Instruction.
+  enum class Opcode : uint8_t {
+    kMatchExpectation,
+    kAnd,
+    kOr,
+    kNot,
+  };
+
+  // A single node of the flattened predicate tree. The children of a group
+  // instruction at index i start at index i + 1, and the subtree rooted at i
+  // ends just before index |end|.
+  struct Instruction {
+    Opcode opcode;
+
+    // Index into |expectations_| for kMatchExpectation instructions.
+    int32_t expectation_index;
+
+    // One past the last instruction of the subtree rooted at this instruction.
+    int32_t end;
+  };
+
+  CompiledIdentityAcl(IdentityAclPredicate acl,
+                      std::unique_ptr<IdentityExpectationMatcher> matcher,
+                      size_t max_cached_results);
+
+  // Appends the instructions for |predicate| to |program_|.
+  Status CompilePredicate(
+      const IdentityAclPredicate &predicate,
+      absl::flat_hash_map<std::string, int32_t> *expectation_indices);
+
+  // Evaluates the subtree rooted at |pc|. |expectation_results| memoizes the
+  // result of each entry in |expectations_| for |identities|, with -1
+  // indicating an unevaluated expectation.
+  StatusOr<bool> EvaluateInstruction(
+      size_t pc, const std::vector<EnclaveIdentity> &identities,
+      std::vector<int8_t> *expectation_results) const;
+
+  // Evaluates the compiled program against |identities| without building an
+  // explanation.
+  StatusOr<bool> EvaluateProgram(
+      const std::vector<EnclaveIdentity> &identities) const;
+
+  const IdentityAclPredicate acl_;
+  const std::unique_ptr<IdentityExpectationMatcher> matcher_;
+  const size_t max_cached_results_;
+
+  std::vector<Instruction> program_;
+  std::vector<EnclaveIdentityExpectation> expectations_;
+
+  // Memoized evaluation results, keyed by identities digest.
+  mutable MutexGuarded<absl::flat_hash_map<std::string, bool>> results_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
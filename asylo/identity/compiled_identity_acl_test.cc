@@ -0,0 +1,260 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/compiled_identity_acl.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/identity_acl.pb.h"
+#include "asylo/identity/identity_acl_evaluator.h"
+#include "asylo/identity/identity_expectation_matcher.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::Not;
+
+constexpr char kAuthorityType[] = "Test authority";
+constexpr char kBadIdentity[] = "bad identity";
+
+// Matcher that considers an identity to match an expectation if the identity
+// equals the expectation's reference identity, and that counts its
+// invocations. Returns an error for identities equal to kBadIdentity.
+class CountingMatcher : public IdentityExpectationMatcher {
+ public:
+  explicit CountingMatcher(std::atomic<int> *count) : count_(count) {}
+
+  StatusOr<bool> MatchAndExplain(const EnclaveIdentity &identity,
+                                 const EnclaveIdentityExpectation &expectation,
+                                 std::string *explanation) const override {
+    ++*count_;
+    if (identity.identity() == kBadIdentity) {
+      return Status(error::GoogleError::INVALID_ARGUMENT, "Bad identity");
+    }
+    if (identity.identity() == expectation.reference_identity().identity()) {
+      return true;
+    }
+    if (explanation != nullptr) {
+      *explanation = identity.identity() + " does not match " +
+                     expectation.reference_identity().identity();
+    }
+    return false;
+  }
+
+ private:
+  std::atomic<int> *count_;
+};
+
+EnclaveIdentity MakeIdentity(const std::string &id) {
+  EnclaveIdentity identity;
+  identity.mutable_description()->set_identity_type(CODE_IDENTITY);
+  identity.mutable_description()->set_authority_type(kAuthorityType);
+  identity.set_identity(id);
+  return identity;
+}
+
+IdentityAclPredicate MakeExpectationPredicate(const std::string &id) {
+  IdentityAclPredicate predicate;
+  *predicate.mutable_expectation()->mutable_reference_identity() =
+      MakeIdentity(id);
+  return predicate;
+}
+
+IdentityAclPredicate MakeGroup(IdentityAclGroup::GroupType type,
+                               std::vector<IdentityAclPredicate> predicates) {
+  IdentityAclPredicate group;
+  group.mutable_acl_group()->set_type(type);
+  for (IdentityAclPredicate &predicate : predicates) {
+    *group.mutable_acl_group()->add_predicates() = std::move(predicate);
+  }
+  return group;
+}
+
+class CompiledIdentityAclTest : public ::testing::Test {
+ protected:
+  StatusOr<std::unique_ptr<CompiledIdentityAcl>> Compile(
+      const IdentityAclPredicate &acl,
+      size_t max_cached_results =
+          CompiledIdentityAcl::kDefaultMaxCachedResults) {
+    return CompiledIdentityAcl::Create(
+        acl, absl::make_unique<CountingMatcher>(&match_count_),
+        max_cached_results);
+  }
+
+  std::atomic<int> match_count_{0};
+};
+
+TEST_F(CompiledIdentityAclTest, RejectsMalformedAcls) {
+  EXPECT_THAT(Compile(IdentityAclPredicate()),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(Compile(MakeGroup(IdentityAclGroup::OR, {})),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(Compile(MakeGroup(IdentityAclGroup::NOT,
+                                {MakeExpectationPredicate("a"),
+                                 MakeExpectationPredicate("b")})),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      Compile(MakeGroup(IdentityAclGroup::AND,
+                        {MakeExpectationPredicate("a"),
+                         MakeGroup(IdentityAclGroup::OR, {})})),
+      StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(CompiledIdentityAclTest, RejectsNullMatcher) {
+  EXPECT_THAT(
+      CompiledIdentityAcl::Create(MakeExpectationPredicate("a"), nullptr),
+      StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(CompiledIdentityAclTest, AgreesWithEvaluateIdentityAcl) {
+  // (a AND NOT b) OR (c AND d)
+  IdentityAclPredicate acl = MakeGroup(
+      IdentityAclGroup::OR,
+      {MakeGroup(IdentityAclGroup::AND,
+                 {MakeExpectationPredicate("a"),
+                  MakeGroup(IdentityAclGroup::NOT,
+                            {MakeExpectationPredicate("b")})}),
+       MakeGroup(IdentityAclGroup::AND, {MakeExpectationPredicate("c"),
+                                         MakeExpectationPredicate("d")})});
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(compiled, Compile(acl, /*max_cached_results=*/0));
+
+  std::atomic<int> unused_count{0};
+  CountingMatcher matcher(&unused_count);
+  const std::vector<std::vector<std::string>> identity_sets = {
+      {},         {"a"},      {"a", "b"}, {"c"},      {"c", "d"},
+      {"b", "d"}, {"d", "c"}, {"e"},      {"b", "c", "d"}};
+  for (const auto &ids : identity_sets) {
+    std::vector<EnclaveIdentity> identities;
+    for (const std::string &id : ids) {
+      identities.push_back(MakeIdentity(id));
+    }
+    bool expected;
+    ASYLO_ASSERT_OK_AND_ASSIGN(expected,
+                               EvaluateIdentityAcl(identities, acl, matcher));
+    EXPECT_THAT(compiled->Evaluate(identities), IsOkAndHolds(expected));
+  }
+}
+
+TEST_F(CompiledIdentityAclTest, DeduplicatesExpectations) {
+  IdentityAclPredicate acl = MakeGroup(
+      IdentityAclGroup::AND,
+      {MakeExpectationPredicate("a"),
+       MakeGroup(IdentityAclGroup::NOT, {MakeExpectationPredicate("b")}),
+       MakeExpectationPredicate("a")});
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(compiled, Compile(acl, /*max_cached_results=*/0));
+
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity("a")}), IsOkAndHolds(true));
+
+  // "a" is matched once and "b" is matched once.
+  EXPECT_THAT(match_count_.load(), Eq(2));
+}
+
+TEST_F(CompiledIdentityAclTest, MemoizesResultsByIdentities) {
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(compiled, Compile(MakeExpectationPredicate("a")));
+
+  std::vector<EnclaveIdentity> matching = {MakeIdentity("a")};
+  std::vector<EnclaveIdentity> other = {MakeIdentity("b")};
+  EXPECT_THAT(compiled->Evaluate(matching), IsOkAndHolds(true));
+  EXPECT_THAT(compiled->Evaluate(other), IsOkAndHolds(false));
+  int count = match_count_.load();
+
+  EXPECT_THAT(compiled->Evaluate(matching), IsOkAndHolds(true));
+  EXPECT_THAT(compiled->Evaluate(other), IsOkAndHolds(false));
+  EXPECT_THAT(match_count_.load(), Eq(count));
+}
+
+TEST_F(CompiledIdentityAclTest, SerializedDigestMatchesIdentitiesDigest) {
+  std::vector<EnclaveIdentity> identities = {MakeIdentity("a"),
+                                             MakeIdentity("b")};
+  EnclaveIdentities identities_proto;
+  for (const EnclaveIdentity &identity : identities) {
+    *identities_proto.add_identities() = identity;
+  }
+
+  std::string digest;
+  ASYLO_ASSERT_OK_AND_ASSIGN(digest,
+                             CompiledIdentityAcl::DigestIdentities(identities));
+  EXPECT_THAT(CompiledIdentityAcl::DigestSerializedIdentities(
+                  identities_proto.SerializeAsString()),
+              IsOkAndHolds(digest));
+  EXPECT_THAT(
+      CompiledIdentityAcl::DigestIdentities({MakeIdentity("a")}),
+      IsOkAndHolds(Not(Eq(digest))));
+}
+
+TEST_F(CompiledIdentityAclTest, ExplanationOnlyOnFailure) {
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(compiled, Compile(MakeExpectationPredicate("a")));
+
+  std::string explanation;
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity("a")}, &explanation),
+              IsOkAndHolds(true));
+  EXPECT_THAT(explanation, IsEmpty());
+
+  // The explanation is produced even when the result is memoized.
+  for (int i = 0; i < 2; ++i) {
+    explanation.clear();
+    EXPECT_THAT(compiled->Evaluate({MakeIdentity("b")}, &explanation),
+                IsOkAndHolds(false));
+    EXPECT_THAT(explanation, HasSubstr("b does not match a"));
+  }
+}
+
+TEST_F(CompiledIdentityAclTest, MatcherErrorsAreNotMemoized) {
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(compiled, Compile(MakeExpectationPredicate("a")));
+
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity(kBadIdentity)}),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity(kBadIdentity)}),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(match_count_.load(), Eq(2));
+}
+
+TEST_F(CompiledIdentityAclTest, MemoIsBounded) {
+  std::unique_ptr<CompiledIdentityAcl> compiled;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      compiled,
+      Compile(MakeExpectationPredicate("a"), /*max_cached_results=*/1));
+
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity("a")}), IsOkAndHolds(true));
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity("b")}), IsOkAndHolds(false));
+
+  // The result for "a" was evicted to make room for "b".
+  int count = match_count_.load();
+  EXPECT_THAT(compiled->Evaluate({MakeIdentity("a")}), IsOkAndHolds(true));
+  EXPECT_THAT(match_count_.load(), Eq(count + 1));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,446 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.h"
+
+#include <openssl/asn1.h>
+#include <openssl/base.h>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/certificate.pb.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb_info_from_json.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/path.h"
+#include "asylo/util/status_macros.h"
+#include "asylo/util/time_conversions.h"
+#include "google/protobuf/timestamp.pb.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+// Returns the time at which |tcb_info| is due to be updated.
+StatusOr<absl::Time> TcbInfoNextUpdate(const SignedTcbInfo &signed_tcb_info) {
+  TcbInfo tcb_info;
+  ASYLO_ASSIGN_OR_RETURN(tcb_info,
+                         TcbInfoFromJson(signed_tcb_info.tcb_info_json()));
+  return ConvertTime<absl::Time>(tcb_info.impl().next_update());
+}
+
+// Returns the time at which |crl| is due to be updated.
+StatusOr<absl::Time> CrlNextUpdate(const CertificateRevocationList &crl) {
+  bssl::UniquePtr<X509_CRL> x509_crl;
+  switch (crl.format()) {
+    case CertificateRevocationList::X509_PEM: {
+      bssl::UniquePtr<BIO> crl_bio(
+          BIO_new_mem_buf(crl.data().data(), crl.data().size()));
+      x509_crl.reset(PEM_read_bio_X509_CRL(crl_bio.get(), /*x=*/nullptr,
+                                           /*cb=*/nullptr, /*u=*/nullptr));
+      break;
+    }
+    case CertificateRevocationList::X509_DER: {
+      const uint8_t *data = reinterpret_cast<const uint8_t *>(crl.data().data());
+      x509_crl.reset(d2i_X509_CRL(/*a=*/nullptr, &data, crl.data().size()));
+      break;
+    }
+    default:
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Unsupported CRL format");
+  }
+  if (x509_crl == nullptr) {
+    return Status(error::GoogleError::INVALID_ARGUMENT, BsslLastErrorString());
+  }
+
+  const ASN1_TIME *next_update = X509_CRL_get0_nextUpdate(x509_crl.get());
+  if (next_update == nullptr) {
+    return Status(error::GoogleError::NOT_FOUND, "CRL has no nextUpdate");
+  }
+  bssl::UniquePtr<ASN1_TIME> unix_epoch(ASN1_TIME_set(/*s=*/nullptr, 0));
+  int num_days;
+  int num_seconds;
+  if (unix_epoch == nullptr ||
+      ASN1_TIME_diff(&num_days, &num_seconds, unix_epoch.get(), next_update) !=
+          1) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  return absl::UnixEpoch() + num_days * absl::Hours(24) +
+         absl::Seconds(num_seconds);
+}
+
+// Returns the expiration time recorded in |result|, or absl::InfinitePast() if
+// it is missing or invalid.
+absl::Time ExpirationOf(const CachedSgxPcsResult &result) {
+  if (!result.has_expiration()) {
+    return absl::InfinitePast();
+  }
+  StatusOr<absl::Time> expiration_result =
+      ConvertTime<absl::Time>(result.expiration());
+  return expiration_result.ok() ? expiration_result.ValueOrDie()
+                                : absl::InfinitePast();
+}
+
+// Records |expiration| in |result|.
+Status SetExpiration(absl::Time expiration, CachedSgxPcsResult *result) {
+  ASYLO_ASSIGN_OR_RETURN(
+      *result->mutable_expiration(),
+      ConvertTime<google::protobuf::Timestamp>(expiration));
+  return Status::OkStatus();
+}
+
+// Returns the name of the file in which the result for |key| is stored. Keys
+// contain platform identifiers, so they are hashed rather than used directly.
+StatusOr<std::string> CacheFileName(const std::string &key) {
+  Sha256Hash hash;
+  hash.Update(key);
+  std::vector<uint8_t> digest;
+  ASYLO_RETURN_IF_ERROR(hash.CumulativeHash(&digest));
+  return absl::StrCat(
+      absl::BytesToHexString(absl::string_view(
+          reinterpret_cast<const char *>(digest.data()), digest.size())),
+      ".binarypb");
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<SgxPcsClient>> CachingSgxPcsClient::Create(
+    std::unique_ptr<SgxPcsClient> client, Options options) {
+  if (client == nullptr) {
+    return Status(error::GoogleError::INVALID_ARGUMENT, "client is null");
+  }
+  if (options.max_entries == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "max_entries must be positive");
+  }
+  if (options.default_ttl <= absl::ZeroDuration() ||
+      options.max_ttl <= absl::ZeroDuration()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "default_ttl and max_ttl must be positive");
+  }
+  if (!options.clock) {
+    return Status(error::GoogleError::INVALID_ARGUMENT, "clock is not set");
+  }
+  if (!options.cache_directory.empty()) {
+    struct stat stat_buffer;
+    if (stat(options.cache_directory.c_str(), &stat_buffer) != 0 ||
+        !S_ISDIR(stat_buffer.st_mode)) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Cache directory ", options.cache_directory,
+                                 " is not a directory"));
+    }
+  }
+
+  // Using `new` to access a non-public constructor.
+  return absl::WrapUnique<SgxPcsClient>(
+      new CachingSgxPcsClient(std::move(client), std::move(options)));
+}
+
+CachingSgxPcsClient::CachingSgxPcsClient(std::unique_ptr<SgxPcsClient> client,
+                                         Options options)
+    : client_(std::move(client)), options_(std::move(options)) {}
+
+StatusOr<GetPckCertificateResult> CachingSgxPcsClient::GetPckCertificate(
+    const Ppid &ppid, const CpuSvn &cpu_svn, const PceSvn &pce_svn,
+    const PceId &pce_id) {
+  std::string key = absl::StrCat(
+      "pckcert/", absl::BytesToHexString(ppid.value()), "/",
+      absl::BytesToHexString(cpu_svn.value()), "/", pce_svn.value(), "/",
+      pce_id.value());
+  auto fetch = [&]() -> StatusOr<CachedSgxPcsResult> {
+    GetPckCertificateResult result;
+    ASYLO_ASSIGN_OR_RETURN(
+        result, client_->GetPckCertificate(ppid, cpu_svn, pce_svn, pce_id));
+    CachedSgxPcsResult fetched;
+    *fetched.mutable_pck_cert() = std::move(result.pck_cert);
+    *fetched.mutable_issuer_cert_chain() =
+        std::move(result.issuer_cert_chain);
+    *fetched.mutable_tcbm() = std::move(result.tcbm);
+    ASYLO_RETURN_IF_ERROR(SetExpiration(
+        ExpirationFor(options_.clock() + options_.default_ttl), &fetched));
+    return fetched;
+  };
+  CachedSgxPcsResult cached;
+  ASYLO_ASSIGN_OR_RETURN(cached, GetOrFetch(key, fetch));
+
+  GetPckCertificateResult result;
+  result.pck_cert = std::move(*cached.mutable_pck_cert());
+  result.issuer_cert_chain = std::move(*cached.mutable_issuer_cert_chain());
+  result.tcbm = std::move(*cached.mutable_tcbm());
+  return result;
+}
+
+StatusOr<GetPckCertificatesResult> CachingSgxPcsClient::GetPckCertificates(
+    const Ppid &ppid, const PceId &pce_id) {
+  std::string key = absl::StrCat(
+      "pckcerts/", absl::BytesToHexString(ppid.value()), "/", pce_id.value());
+  auto fetch = [&]() -> StatusOr<CachedSgxPcsResult> {
+    GetPckCertificatesResult result;
+    ASYLO_ASSIGN_OR_RETURN(result,
+                           client_->GetPckCertificates(ppid, pce_id));
+    CachedSgxPcsResult fetched;
+    *fetched.mutable_pck_certs() = std::move(result.pck_certs);
+    *fetched.mutable_issuer_cert_chain() =
+        std::move(result.issuer_cert_chain);
+    ASYLO_RETURN_IF_ERROR(SetExpiration(
+        ExpirationFor(options_.clock() + options_.default_ttl), &fetched));
+    return fetched;
+  };
+  CachedSgxPcsResult cached;
+  ASYLO_ASSIGN_OR_RETURN(cached, GetOrFetch(key, fetch));
+
+  GetPckCertificatesResult result;
+  result.pck_certs = std::move(*cached.mutable_pck_certs());
+  result.issuer_cert_chain = std::move(*cached.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<GetCrlResult> CachingSgxPcsClient::GetCrl(SgxCaType sgx_ca_type) {
+  std::string key = absl::StrCat("pckcrl/", sgx_ca_type);
+  auto fetch = [&]() -> StatusOr<CachedSgxPcsResult> {
+    GetCrlResult result;
+    ASYLO_ASSIGN_OR_RETURN(result, client_->GetCrl(sgx_ca_type));
+    CachedSgxPcsResult fetched;
+    ASYLO_RETURN_IF_ERROR(SetExpiration(
+        ExpirationFor(CrlNextUpdate(result.pck_crl)), &fetched));
+    *fetched.mutable_pck_crl() = std::move(result.pck_crl);
+    *fetched.mutable_issuer_cert_chain() =
+        std::move(result.issuer_cert_chain);
+    return fetched;
+  };
+  CachedSgxPcsResult cached;
+  ASYLO_ASSIGN_OR_RETURN(cached, GetOrFetch(key, fetch));
+
+  GetCrlResult result;
+  result.pck_crl = std::move(*cached.mutable_pck_crl());
+  result.issuer_cert_chain = std::move(*cached.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<GetTcbInfoResult> CachingSgxPcsClient::GetTcbInfo(
+    const Fmspc &fmspc) {
+  std::string key =
+      absl::StrCat("tcb/", absl::BytesToHexString(fmspc.value()));
+  auto fetch = [&]() -> StatusOr<CachedSgxPcsResult> {
+    GetTcbInfoResult result;
+    ASYLO_ASSIGN_OR_RETURN(result, client_->GetTcbInfo(fmspc));
+    CachedSgxPcsResult fetched;
+    ASYLO_RETURN_IF_ERROR(SetExpiration(
+        ExpirationFor(TcbInfoNextUpdate(result.tcb_info)), &fetched));
+    *fetched.mutable_tcb_info() = std::move(result.tcb_info);
+    *fetched.mutable_issuer_cert_chain() =
+        std::move(result.issuer_cert_chain);
+    return fetched;
+  };
+  CachedSgxPcsResult cached;
+  ASYLO_ASSIGN_OR_RETURN(cached, GetOrFetch(key, fetch));
+
+  GetTcbInfoResult result;
+  result.tcb_info = std::move(*cached.mutable_tcb_info());
+  result.issuer_cert_chain = std::move(*cached.mutable_issuer_cert_chain());
+  return result;
+}
+
+StatusOr<CachedSgxPcsResult> CachingSgxPcsClient::GetOrFetch(
+    const std::string &key,
+    const std::function<StatusOr<CachedSgxPcsResult>()> &fetch) {
+  std::shared_ptr<InFlightFetch> in_flight;
+  bool is_fetcher = false;
+  {
+    absl::MutexLock lock(&mu_);
+    CachedSgxPcsResult result;
+    if (LookUp(key, options_.clock(), &result)) {
+      return result;
+    }
+
+    std::shared_ptr<InFlightFetch> &slot = in_flight_[key];
+    if (slot == nullptr) {
+      slot = std::make_shared<InFlightFetch>();
+      is_fetcher = true;
+    }
+    in_flight = slot;
+  }
+
+  // Another caller is already fetching this result, so wait for it.
+  if (!is_fetcher) {
+    in_flight->done.WaitForNotification();
+    if (!in_flight->status.ok()) {
+      return in_flight->status;
+    }
+    return in_flight->result;
+  }
+
+  CachedSgxPcsResult result;
+  Status status = Status::OkStatus();
+  if (!ReadFromDisk(key, &result)) {
+    StatusOr<CachedSgxPcsResult> fetch_result = fetch();
+    status = fetch_result.status();
+    if (status.ok()) {
+      result = std::move(fetch_result).ValueOrDie();
+      result.set_key(key);
+      if (ExpirationOf(result) > options_.clock()) {
+        WriteToDisk(key, result);
+      }
+    }
+  }
+
+  {
+    absl::MutexLock lock(&mu_);
+    absl::Time expiration = ExpirationOf(result);
+    if (status.ok() && expiration > options_.clock()) {
+      Insert(key, result, expiration);
+    }
+    in_flight_.erase(key);
+  }
+  in_flight->status = status;
+  in_flight->result = result;
+  in_flight->done.Notify();
+
+  if (!status.ok()) {
+    return status;
+  }
+  return result;
+}
+
+bool CachingSgxPcsClient::LookUp(const std::string &key, absl::Time now,
+                                 CachedSgxPcsResult *result) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  if (it->second.expiration <= now) {
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  *result = it->second.result;
+  return true;
+}
+
+void CachingSgxPcsClient::Insert(const std::string &key,
+                                 const CachedSgxPcsResult &result,
+                                 absl::Time expiration) {
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+  }
+  lru_.push_front(key);
+  entries_[key] = Entry{result, expiration, lru_.begin()};
+  while (entries_.size() > options_.max_entries) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+bool CachingSgxPcsClient::ReadFromDisk(const std::string &key,
+                                       CachedSgxPcsResult *result) const {
+  if (options_.cache_directory.empty()) {
+    return false;
+  }
+  StatusOr<std::string> file_name_result = CacheFileName(key);
+  if (!file_name_result.ok()) {
+    return false;
+  }
+  std::ifstream input(
+      JoinPath(options_.cache_directory, file_name_result.ValueOrDie()),
+      std::ios::binary);
+  if (!input) {
+    return false;
+  }
+
+  // Ignore files that are corrupt, belong to a key with a colliding hash, or
+  // have expired.
+  CachedSgxPcsResult cached;
+  if (!cached.ParseFromIstream(&input) || cached.key() != key ||
+      ExpirationOf(cached) <= options_.clock()) {
+    return false;
+  }
+  *result = std::move(cached);
+  return true;
+}
+
+void CachingSgxPcsClient::WriteToDisk(const std::string &key,
+                                      const CachedSgxPcsResult &result) const {
+  // Distinguishes the temporary files of concurrent writers in this process.
+  static std::atomic<uint64_t> next_temp_file_id(0);
+
+  if (options_.cache_directory.empty()) {
+    return;
+  }
+  StatusOr<std::string> file_name_result = CacheFileName(key);
+  if (!file_name_result.ok()) {
+    LOG(WARNING) << "Failed to name cache file: " << file_name_result.status();
+    return;
+  }
+  std::string path =
+      JoinPath(options_.cache_directory, file_name_result.ValueOrDie());
+
+  // Write to a temporary file and rename it into place, so that readers never
+  // see a partially-written file.
+  std::string temp_path =
+      absl::StrCat(path, ".tmp.", getpid(), ".", next_temp_file_id++);
+  {
+    std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+    if (!output || !result.SerializeToOstream(&output)) {
+      LOG(WARNING) << "Failed to write cache file " << temp_path;
+      unlink(temp_path.c_str());
+      return;
+    }
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Failed to rename cache file " << temp_path << " to "
+                 << path << ": " << strerror(errno);
+    unlink(temp_path.c_str());
+  }
+}
+
+absl::Time CachingSgxPcsClient::ExpirationFor(
+    const StatusOr<absl::Time> &stale_at) const {
+  absl::Time now = options_.clock();
+  absl::Time expiration = now + options_.default_ttl;
+  if (stale_at.ok()) {
+    expiration = stale_at.ValueOrDie();
+  } else {
+    LOG(WARNING) << "Caching result for the default TTL: "
+                 << stale_at.status();
+  }
+  return std::min(expiration, now + options_.max_ttl);
+}
+
+}  // namespace sgx
+}  // namespace asylo
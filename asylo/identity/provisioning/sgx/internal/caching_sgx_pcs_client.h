@@ -0,0 +1,160 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
+#define ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/identity/platform/sgx/machine_configuration.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.pb.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace sgx {
+
+// Implements SgxPcsClient by caching the results of another SgxPcsClient.
+//
+// Results are kept in an in-memory LRU cache and, optionally, in files in a
+// cache directory, so that they survive restarts and can be shared between
+// processes. Each result is cached until it is due to be updated:
+//
+//   * TCB infos until their |next_update|.
+//   * CRLs until their nextUpdate.
+//   * PCK certificates for |default_ttl|, since they carry no update time.
+//
+// No result is cached for longer than |max_ttl|. Errors are never cached.
+//
+// Concurrent calls for the same result share a single call to the underlying
+// client.
+class CachingSgxPcsClient : public SgxPcsClient {
+ public:
+  struct Options {
+    // The maximum number of results held in memory. Must be positive.
+    size_t max_entries = 1024;
+
+    // How long to cache results that carry no update time, or whose update
+    // time cannot be parsed.
+    absl::Duration default_ttl = absl::Hours(24);
+
+    // The longest time for which any result is cached.
+    absl::Duration max_ttl = absl::Hours(24 * 30);
+
+    // A directory in which to persist results. If empty, results are only
+    // cached in memory. Otherwise, the directory must exist.
+    std::string cache_directory;
+
+    // The source of the current time.
+    std::function<absl::Time()> clock = absl::Now;
+  };
+
+  // Creates a CachingSgxPcsClient that caches the results of |client|
+  // according to |options|.
+  static StatusOr<std::unique_ptr<SgxPcsClient>> Create(
+      std::unique_ptr<SgxPcsClient> client, Options options);
+
+  // From SgxPcsClient.
+
+  StatusOr<GetPckCertificateResult> GetPckCertificate(
+      const Ppid &ppid, const CpuSvn &cpu_svn, const PceSvn &pce_svn,
+      const PceId &pce_id) override;
+
+  StatusOr<GetPckCertificatesResult> GetPckCertificates(
+      const Ppid &ppid, const PceId &pce_id) override;
+
+  StatusOr<GetCrlResult> GetCrl(SgxCaType sgx_ca_type) override;
+
+  StatusOr<GetTcbInfoResult> GetTcbInfo(const Fmspc &fmspc) override;
+
+ private:
+  // A result held in memory, and its position in |lru_|.
+  struct Entry {
+    CachedSgxPcsResult result;
+    absl::Time expiration;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  // A call to the underlying client whose result is awaited by one or more
+  // callers.
+  struct InFlightFetch {
+    absl::Notification done;
+    Status status;
+    CachedSgxPcsResult result;
+  };
+
+  CachingSgxPcsClient(std::unique_ptr<SgxPcsClient> client, Options options);
+
+  // Returns the result cached under |key|, calling |fetch| to produce it if
+  // it is neither in memory nor on disk. |fetch| returns a result with its
+  // |expiration| set.
+  StatusOr<CachedSgxPcsResult> GetOrFetch(
+      const std::string &key,
+      const std::function<StatusOr<CachedSgxPcsResult>()> &fetch);
+
+  // Looks up |key| in memory, dropping it if it has expired by |now|.
+  bool LookUp(const std::string &key, absl::Time now,
+              CachedSgxPcsResult *result) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Adds |result| to memory under |key|, evicting the least recently used
+  // results if the cache is full.
+  void Insert(const std::string &key, const CachedSgxPcsResult &result,
+              absl::Time expiration) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Reads the result for |key| from the cache directory. Returns false if
+  // there is no usable file for |key|.
+  bool ReadFromDisk(const std::string &key, CachedSgxPcsResult *result) const;
+
+  // Writes |result| for |key| to the cache directory. Failures are logged and
+  // otherwise ignored, since the cache directory is only an optimization.
+  void WriteToDisk(const std::string &key,
+                   const CachedSgxPcsResult &result) const;
+
+  // Returns the expiration time of a result that becomes stale at |stale_at|,
+  // or that is cached for the default TTL if |stale_at| is an error.
+  absl::Time ExpirationFor(const StatusOr<absl::Time> &stale_at) const;
+
+  const std::unique_ptr<SgxPcsClient> client_;
+  const Options options_;
+
+  absl::Mutex mu_;
+
+  // Keys of the results in |entries_|, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, std::shared_ptr<InFlightFetch>> in_flight_
+      ABSL_GUARDED_BY(mu_);
+};
+
+}  // namespace sgx
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_PROVISIONING_SGX_INTERNAL_CACHING_SGX_PCS_CLIENT_H_
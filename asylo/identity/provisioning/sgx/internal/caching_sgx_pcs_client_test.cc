@@ -0,0 +1,501 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/provisioning/sgx/internal/caching_sgx_pcs_client.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/identity/platform/sgx/machine_configuration.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/fake_sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/platform_provisioning.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client.pb.h"
+#include "asylo/identity/provisioning/sgx/internal/sgx_pcs_client_impl.h"
+#include "asylo/identity/provisioning/sgx/internal/tcb.pb.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/test/util/test_flags.h"
+#include "asylo/util/http_fetcher.h"
+#include "asylo/util/path.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+using ::testing::Eq;
+
+// An API key for SgxPcsClientImpl. It is never checked.
+constexpr char kApiKey[] = "deadbeefdeadd00ddeadbeefdeadd00d";
+
+// The HTTP header key for the CRL issuer cert chain.
+constexpr char kGetCrlHttpResponseHeaderIssuerCertChainKey[] =
+    "SGX-PCK-CRL-Issuer-Chain";
+
+// The HTTP header value for the CRL issuer cert chain.
+constexpr char kGetCrlHttpResponseHeaderIssuerCertChainValue[] =
+    "-----BEGIN%20CERTIFICATE-----%0AMIIClzCCAj6gAwIBAgIVANDoqtp11%2FkuSReYPHsU"
+    "ZdDV8llNMAoGCCqGSM49BAMC%0AMGgxGjAYBgNVBAMMEUludGVsIFNHWCBSb290IENBMRowGAY"
+    "DVQQKDBFJbnRlbCBD%0Ab3Jwb3JhdGlvbjEUMBIGA1UEBwwLU2FudGEgQ2xhcmExCzAJBgNVBA"
+    "gMAkNBMQsw%0ACQYDVQQGEwJVUzAeFw0xODA1MjExMDQ1MDhaFw0zMzA1MjExMDQ1MDhaMHExI"
+    "zAh%0ABgNVBAMMGkludGVsIFNHWCBQQ0sgUHJvY2Vzc29yIENBMRowGAYDVQQKDBFJbnRl%0Ab"
+    "CBDb3Jwb3JhdGlvbjEUMBIGA1UEBwwLU2FudGEgQ2xhcmExCzAJBgNVBAgMAkNB%0AMQswCQYD"
+    "VQQGEwJVUzBZMBMGByqGSM49AgEGCCqGSM49AwEHA0IABL9q%2BNMp2IOg%0Atdl1bk%2FuWZ5"
+    "%2BTGQm8aCi8z78fs%2BfKCQ3d%2BuDzXnVTAT2ZhDCifyIuJwvN3wNBp9i%0AHBSSMJMJrBOj"
+    "gbswgbgwHwYDVR0jBBgwFoAUImUM1lqdNInzg7SVUr9QGzknBqww%0AUgYDVR0fBEswSTBHoEW"
+    "gQ4ZBaHR0cHM6Ly9jZXJ0aWZpY2F0ZXMudHJ1c3RlZHNl%0AcnZpY2VzLmludGVsLmNvbS9Jbn"
+    "RlbFNHWFJvb3RDQS5jcmwwHQYDVR0OBBYEFNDo%0Aqtp11%2FkuSReYPHsUZdDV8llNMA4GA1U"
+    "dDwEB%2FwQEAwIBBjASBgNVHRMBAf8ECDAG%0AAQH%2FAgEAMAoGCCqGSM49BAMCA0cAMEQCIC"
+    "%2F9j%2B84T%2BHztVO%2FsOQBWJbSd%2B%2F2uexK%0A4%2BaA0jcFBLcpAiA3dhMrF5cD52t"
+    "6FqMvAIpj8XdGmy2beeljLJK%2BpzpcRA%3D%3D%0A-----END%20CERTIFICATE-----%0A--"
+    "---BEGIN%20CERTIFICATE-----%0AMIICjjCCAjSgAwIBAgIUImUM1lqdNInzg7SVUr9QGzkn"
+    "BqwwCgYIKoZIzj0EAwIw%0AaDEaMBgGA1UEAwwRSW50ZWwgU0dYIFJvb3QgQ0ExGjAYBgNVBAo"
+    "MEUludGVsIENv%0AcnBvcmF0aW9uMRQwEgYDVQQHDAtTYW50YSBDbGFyYTELMAkGA1UECAwCQ0"
+    "ExCzAJ%0ABgNVBAYTAlVTMB4XDTE4MDUyMTEwNDExMVoXDTMzMDUyMTEwNDExMFowaDEaMBgG%"
+    "0AA1UEAwwRSW50ZWwgU0dYIFJvb3QgQ0ExGjAYBgNVBAoMEUludGVsIENvcnBvcmF0%0AaW9uM"
+    "RQwEgYDVQQHDAtTYW50YSBDbGFyYTELMAkGA1UECAwCQ0ExCzAJBgNVBAYT%0AAlVTMFkwEwYH"
+    "KoZIzj0CAQYIKoZIzj0DAQcDQgAEC6nEwMDIYZOj%2FiPWsCzaEKi7%0A1OiOSLRFhWGjbnBVJ"
+    "fVnkY4u3IjkDYYL0MxO4mqsyYjlBalTVYxFP2sJBK5zlKOB%0AuzCBuDAfBgNVHSMEGDAWgBQi"
+    "ZQzWWp00ifODtJVSv1AbOScGrDBSBgNVHR8ESzBJ%0AMEegRaBDhkFodHRwczovL2NlcnRpZml"
+    "jYXRlcy50cnVzdGVkc2VydmljZXMuaW50%0AZWwuY29tL0ludGVsU0dYUm9vdENBLmNybDAdBg"
+    "NVHQ4EFgQUImUM1lqdNInzg7SV%0AUr9QGzknBqwwDgYDVR0PAQH%2FBAQDAgEGMBIGA1UdEwE"
+    "B%2FwQIMAYBAf8CAQEwCgYI%0AKoZIzj0EAwIDSAAwRQIgQQs%2F08rycdPauCFk8UPQXCMAls"
+    "loBe7NwaQGTcdpa0EC%0AIQCUt8SGvxKmjpcM%2Fz0WP9Dvo8h2k5du1iWDdBkAn%2B0iiA%3D"
+    "%3D%0A-----END%20CERTIFICATE-----%0A";
+
+// The body of the HTTP response for GetCrl.
+constexpr char kGetCrlHttpResponseBody[] =
+    "-----BEGIN X509 CRL-----\n"
+    "MIIBKjCB0QIBATAKBggqhkjOPQQDAjBxMSMwIQYDVQQDDBpJbnRlbCBTR1ggUENLIFByb2Nlc3"
+    "Nv\nciBDQTEaMBgGA1UECgwRSW50ZWwgQ29ycG9yYXRpb24xFDASBgNVBAcMC1NhbnRhIENsYX"
+    "JhMQsw\nCQYDVQQIDAJDQTELMAkGA1UEBhMCVVMXDTE5MDkyMzE5MzkyM1oXDTE5MTAyMzE5Mz"
+    "kyM1qgLzAt\nMAoGA1UdFAQDAgEBMB8GA1UdIwQYMBaAFNDoqtp11/kuSReYPHsUZdDV8llNMA"
+    "oGCCqGSM49BAMC\nA0gAMEUCICOCtmDnHjkL22nitHxWVBrCkxubRx+eKMzOk0SQBiTrAiEAsC"
+    "JQEgZuJ6eFS7J/b2AP\n44xKZbvx9IqgBn9YoomMRbw=\n"
+    "-----END X509 CRL-----\n";
+
+// The nextUpdate of the CRL in kGetCrlHttpResponseBody.
+absl::Time CrlNextUpdate() {
+  return absl::FromCivil(absl::CivilSecond(2019, 10, 23, 19, 39, 23),
+                         absl::UTCTimeZone());
+}
+
+// A clock that only moves when told to.
+class FakeClock {
+ public:
+  explicit FakeClock(absl::Time now) : now_(now) {}
+
+  absl::Time Now() {
+    absl::MutexLock lock(&mu_);
+    return now_;
+  }
+
+  void Set(absl::Time now) {
+    absl::MutexLock lock(&mu_);
+    now_ = now;
+  }
+
+  void Advance(absl::Duration duration) {
+    absl::MutexLock lock(&mu_);
+    now_ += duration;
+  }
+
+ private:
+  absl::Mutex mu_;
+  absl::Time now_ ABSL_GUARDED_BY(mu_);
+};
+
+// An SgxPcsClient that counts the calls it forwards to another client. If
+// |release| is set, GetTcbInfo() blocks until it is notified.
+class CountingSgxPcsClient : public SgxPcsClient {
+ public:
+  explicit CountingSgxPcsClient(SgxPcsClient *client,
+                                absl::Notification *release = nullptr)
+      : client_(client), release_(release) {}
+
+  StatusOr<GetPckCertificateResult> GetPckCertificate(
+      const Ppid &ppid, const CpuSvn &cpu_svn, const PceSvn &pce_svn,
+      const PceId &pce_id) override {
+    ++calls_;
+    return client_->GetPckCertificate(ppid, cpu_svn, pce_svn, pce_id);
+  }
+
+  StatusOr<GetPckCertificatesResult> GetPckCertificates(
+      const Ppid &ppid, const PceId &pce_id) override {
+    ++calls_;
+    return client_->GetPckCertificates(ppid, pce_id);
+  }
+
+  StatusOr<GetCrlResult> GetCrl(SgxCaType sgx_ca_type) override {
+    ++calls_;
+    return client_->GetCrl(sgx_ca_type);
+  }
+
+  StatusOr<GetTcbInfoResult> GetTcbInfo(const Fmspc &fmspc) override {
+    ++calls_;
+    if (release_ != nullptr) {
+      release_->WaitForNotification();
+    }
+    return client_->GetTcbInfo(fmspc);
+  }
+
+  int calls() const { return calls_; }
+
+ private:
+  SgxPcsClient *const client_;
+  absl::Notification *const release_;
+  std::atomic<int> calls_{0};
+};
+
+// An HttpFetcher that serves the CRL response to every request and counts the
+// requests.
+class CountingCrlFetcher : public HttpFetcher {
+ public:
+  explicit CountingCrlFetcher(std::atomic<int> *requests)
+      : requests_(requests) {}
+
+  StatusOr<HttpResponse> Get(
+      absl::string_view url,
+      const std::vector<HttpHeaderField> &custom_headers) override {
+    ++*requests_;
+    HttpResponse response;
+    response.status_code = 200;
+    response.body = kGetCrlHttpResponseBody;
+    response.header = {{kGetCrlHttpResponseHeaderIssuerCertChainKey,
+                        kGetCrlHttpResponseHeaderIssuerCertChainValue}};
+    return response;
+  }
+
+ private:
+  std::atomic<int> *const requests_;
+};
+
+class CachingSgxPcsClientTest : public ::testing::Test {
+ protected:
+  CachingSgxPcsClientTest() : clock_(absl::Now()) {
+    platform_properties_.ca = SgxCaType::PLATFORM;
+    platform_properties_.pce_id.set_value(0);
+  }
+
+  // Returns options using |clock_|.
+  CachingSgxPcsClient::Options ClockedOptions() {
+    CachingSgxPcsClient::Options options;
+    options.clock = [this] { return clock_.Now(); };
+    return options;
+  }
+
+  // Returns a CachingSgxPcsClient over a new CountingSgxPcsClient over
+  // |fake_client_|, and sets |counting_client_| to the latter.
+  std::unique_ptr<SgxPcsClient> CreateCachingClient(
+      CachingSgxPcsClient::Options options,
+      absl::Notification *release = nullptr) {
+    auto counting_client =
+        absl::make_unique<CountingSgxPcsClient>(&fake_client_, release);
+    counting_client_ = counting_client.get();
+    auto client_result = CachingSgxPcsClient::Create(std::move(counting_client),
+                                                     std::move(options));
+    CHECK(client_result.ok()) << client_result.status();
+    return std::move(client_result).ValueOrDie();
+  }
+
+  // Adds a new FMSPC with a valid TCB info to |fake_client_|.
+  Fmspc AddFmspc() {
+    auto fmspc_result =
+        FakeSgxPcsClient::CreateFmspcWithProperties(platform_properties_);
+    CHECK(fmspc_result.ok()) << fmspc_result.status();
+    Fmspc fmspc = fmspc_result.ValueOrDie();
+
+    TcbInfo tcb_info;
+    TcbInfoImpl *impl = tcb_info.mutable_impl();
+    impl->set_version(2);
+    impl->mutable_issue_date()->set_seconds(0);
+    impl->mutable_next_update()->set_seconds(1);
+    *impl->mutable_fmspc() = fmspc;
+    *impl->mutable_pce_id() = platform_properties_.pce_id;
+    impl->set_tcb_type(TcbType::TCB_TYPE_0);
+    impl->set_tcb_evaluation_data_number(2);
+    TcbLevel *tcb_level = impl->add_tcb_levels();
+    tcb_level->mutable_tcb()->set_components("0123456789abcdef");
+    tcb_level->mutable_tcb()->mutable_pce_svn()->set_value(7);
+    tcb_level->mutable_status()->set_known_status(TcbStatus::UP_TO_DATE);
+    tcb_level->mutable_tcb_date()->set_seconds(1000);
+    CHECK(fake_client_.AddFmspc(fmspc, tcb_info).ok());
+    return fmspc;
+  }
+
+  // Returns a new, empty directory for this test's cache files.
+  std::string CreateCacheDirectory() {
+    std::string directory = JoinPath(
+        absl::GetFlag(FLAGS_test_tmpdir),
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    CHECK_EQ(mkdir(directory.c_str(), 0700), 0) << directory;
+    return directory;
+  }
+
+  FakeClock clock_;
+  FakeSgxPcsClient::PlatformProperties platform_properties_;
+  FakeSgxPcsClient fake_client_;
+  CountingSgxPcsClient *counting_client_;
+};
+
+TEST_F(CachingSgxPcsClientTest, CreateRejectsInvalidOptions) {
+  CachingSgxPcsClient::Options options;
+  EXPECT_THAT(CachingSgxPcsClient::Create(nullptr, options),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  options.max_entries = 0;
+  EXPECT_THAT(CachingSgxPcsClient::Create(
+                  absl::make_unique<CountingSgxPcsClient>(&fake_client_),
+                  options),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+
+  options = CachingSgxPcsClient::Options();
+  options.cache_directory =
+      JoinPath(absl::GetFlag(FLAGS_test_tmpdir), "does_not_exist");
+  EXPECT_THAT(CachingSgxPcsClient::Create(
+                  absl::make_unique<CountingSgxPcsClient>(&fake_client_),
+                  options),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(CachingSgxPcsClientTest, TcbInfoIsCachedUntilNextUpdate) {
+  Fmspc fmspc = AddFmspc();
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(ClockedOptions());
+
+  GetTcbInfoResult first;
+  ASYLO_ASSERT_OK_AND_ASSIGN(first, client->GetTcbInfo(fmspc));
+  GetTcbInfoResult second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(second, client->GetTcbInfo(fmspc));
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+  EXPECT_THAT(second.tcb_info, EqualsProto(first.tcb_info));
+  EXPECT_THAT(second.issuer_cert_chain, EqualsProto(first.issuer_cert_chain));
+
+  // FakeSgxPcsClient sets the next update 30 days after the current time.
+  clock_.Advance(absl::Hours(24 * 29));
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+
+  clock_.Advance(absl::Hours(24 * 2));
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(2));
+}
+
+TEST_F(CachingSgxPcsClientTest, MaxTtlBoundsTcbInfoLifetime) {
+  Fmspc fmspc = AddFmspc();
+  CachingSgxPcsClient::Options options = ClockedOptions();
+  options.max_ttl = absl::Hours(1);
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  clock_.Advance(absl::Hours(2));
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(2));
+}
+
+TEST_F(CachingSgxPcsClientTest, PckCertificatesAreCachedForDefaultTtl) {
+  Fmspc fmspc = AddFmspc();
+  Ppid ppid;
+  ASYLO_ASSERT_OK_AND_ASSIGN(ppid, FakeSgxPcsClient::CreatePpidForFmspc(fmspc));
+  CachingSgxPcsClient::Options options = ClockedOptions();
+  options.default_ttl = absl::Hours(6);
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+
+  GetPckCertificatesResult first;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      first, client->GetPckCertificates(ppid, platform_properties_.pce_id));
+  clock_.Advance(absl::Hours(5));
+  GetPckCertificatesResult second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      second, client->GetPckCertificates(ppid, platform_properties_.pce_id));
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+  EXPECT_THAT(second.pck_certs, EqualsProto(first.pck_certs));
+
+  clock_.Advance(absl::Hours(2));
+  ASYLO_ASSERT_OK(
+      client->GetPckCertificates(ppid, platform_properties_.pce_id).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(2));
+}
+
+TEST_F(CachingSgxPcsClientTest, ErrorsAreNotCached) {
+  Fmspc fmspc;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      fmspc, FakeSgxPcsClient::CreateFmspcWithProperties(platform_properties_));
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(ClockedOptions());
+
+  EXPECT_THAT(client->GetTcbInfo(fmspc),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  EXPECT_THAT(client->GetTcbInfo(fmspc),
+              StatusIs(error::GoogleError::NOT_FOUND));
+  EXPECT_THAT(counting_client_->calls(), Eq(2));
+}
+
+TEST_F(CachingSgxPcsClientTest, LeastRecentlyUsedResultIsEvicted) {
+  Fmspc fmspc1 = AddFmspc();
+  Fmspc fmspc2 = AddFmspc();
+  Fmspc fmspc3 = AddFmspc();
+  CachingSgxPcsClient::Options options = ClockedOptions();
+  options.max_entries = 2;
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc1).status());
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc2).status());
+  // Use |fmspc1| again, so that |fmspc2| is the least recently used.
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc1).status());
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc3).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(3));
+
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc1).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(3));
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc2).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(4));
+}
+
+TEST_F(CachingSgxPcsClientTest, ConcurrentRequestsShareOneFetch) {
+  constexpr int kNumThreads = 8;
+
+  Fmspc fmspc = AddFmspc();
+  absl::Notification release;
+  std::unique_ptr<SgxPcsClient> client =
+      CreateCachingClient(ClockedOptions(), &release);
+
+  std::vector<GetTcbInfoResult> results(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&client, &fmspc, &results, i] {
+      auto result = client->GetTcbInfo(fmspc);
+      ASYLO_ASSERT_OK(result.status());
+      results[i] = std::move(result).ValueOrDie();
+    });
+  }
+
+  // Callers that arrive after the fetch completes find the result in memory,
+  // so there is only one fetch however the threads are scheduled.
+  absl::SleepFor(absl::Milliseconds(100));
+  release.Notify();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+  for (const GetTcbInfoResult &result : results) {
+    EXPECT_THAT(result.tcb_info, EqualsProto(results[0].tcb_info));
+  }
+}
+
+TEST_F(CachingSgxPcsClientTest, ResultsPersistAcrossClients) {
+  Fmspc fmspc = AddFmspc();
+  CachingSgxPcsClient::Options options = ClockedOptions();
+  options.cache_directory = CreateCacheDirectory();
+
+  GetTcbInfoResult first;
+  {
+    std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+    ASYLO_ASSERT_OK_AND_ASSIGN(first, client->GetTcbInfo(fmspc));
+    EXPECT_THAT(counting_client_->calls(), Eq(1));
+  }
+
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+  GetTcbInfoResult second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(second, client->GetTcbInfo(fmspc));
+  EXPECT_THAT(counting_client_->calls(), Eq(0));
+  EXPECT_THAT(second.tcb_info, EqualsProto(first.tcb_info));
+  EXPECT_THAT(second.issuer_cert_chain, EqualsProto(first.issuer_cert_chain));
+
+  // Results on disk expire like results in memory.
+  clock_.Advance(absl::Hours(24 * 31));
+  client = CreateCachingClient(options);
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+}
+
+TEST_F(CachingSgxPcsClientTest, CorruptCacheFilesAreIgnored) {
+  Fmspc fmspc = AddFmspc();
+  CachingSgxPcsClient::Options options = ClockedOptions();
+  options.cache_directory = CreateCacheDirectory();
+  ASYLO_ASSERT_OK(CreateCachingClient(options)->GetTcbInfo(fmspc).status());
+
+  DIR *directory = opendir(options.cache_directory.c_str());
+  ASSERT_THAT(directory, testing::NotNull());
+  int num_files = 0;
+  while (struct dirent *entry = readdir(directory)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    std::ofstream(JoinPath(options.cache_directory, entry->d_name),
+                  std::ios::trunc)
+        << "not a serialized proto";
+    ++num_files;
+  }
+  closedir(directory);
+  EXPECT_THAT(num_files, Eq(1));
+
+  std::unique_ptr<SgxPcsClient> client = CreateCachingClient(options);
+  ASYLO_ASSERT_OK(client->GetTcbInfo(fmspc).status());
+  EXPECT_THAT(counting_client_->calls(), Eq(1));
+}
+
+TEST_F(CachingSgxPcsClientTest, CrlIsCachedUntilNextUpdate) {
+  std::atomic<int> requests(0);
+  std::unique_ptr<SgxPcsClient> pcs_client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      pcs_client, SgxPcsClientImpl::CreateWithoutPpidEncryptionKey(
+                      absl::make_unique<CountingCrlFetcher>(&requests),
+                      kApiKey));
+  clock_.Set(CrlNextUpdate() - absl::Hours(24));
+  std::unique_ptr<SgxPcsClient> client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(client,
+                             CachingSgxPcsClient::Create(std::move(pcs_client),
+                                                         ClockedOptions()));
+
+  GetCrlResult first;
+  ASYLO_ASSERT_OK_AND_ASSIGN(first, client->GetCrl(SgxCaType::PROCESSOR));
+  clock_.Set(CrlNextUpdate() - absl::Seconds(1));
+  GetCrlResult second;
+  ASYLO_ASSERT_OK_AND_ASSIGN(second, client->GetCrl(SgxCaType::PROCESSOR));
+  EXPECT_THAT(requests.load(), Eq(1));
+  EXPECT_THAT(second.pck_crl, EqualsProto(first.pck_crl));
+
+  // Each CA type is cached separately.
+  ASYLO_ASSERT_OK(client->GetCrl(SgxCaType::PLATFORM).status());
+  EXPECT_THAT(requests.load(), Eq(2));
+
+  clock_.Set(CrlNextUpdate());
+  ASYLO_ASSERT_OK(client->GetCrl(SgxCaType::PROCESSOR).status());
+  EXPECT_THAT(requests.load(), Eq(3));
+}
+
+}  // namespace
+}  // namespace sgx
+}  // namespace asylo
@@ -124,6 +124,18 @@ class RingBuffer {
     return already_written;
   }
 
+  // Reads up to |nbyte| bytes without blocking, returning the number
+  // successfully read. Returns zero if the buffer is empty.
+  size_t TryRead(uint8_t *buf, size_t nbyte) {
+    return NonBlockingRead(buf, nbyte);
+  }
+
+  // Writes up to |nbyte| bytes without blocking, returning the number
+  // successfully written. Returns zero if the buffer is full.
+  size_t TryWrite(const uint8_t *buf, size_t nbyte) {
+    return NonBlockingWrite(buf, nbyte);
+  }
+
   // Sets the closed-for-write flag, indicating that no more writes to this
   // buffer are expected and the reader should not wait for more data.
   void close_for_write() { closed_for_write_ = 1; }
@@ -0,0 +1,474 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_SLOT_RING_H_
+#define ASYLO_PLATFORM_COMMON_SLOT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace asylo {
+
+// Bounded queues of fixed-size slots, intended to be placed in memory shared
+// between the enclave and the host and used from both sides.
+//
+//   SpscRing<T, kCapacity, Futex> supports one producer and one consumer.
+//   MpmcRing<T, kCapacity, Futex> supports any number of producers and consumers.
+//
+// The producer and consumer indices are kept on cache lines of their own, and
+// apart from the flags and wait queues, so that producers and consumers do not
+// contend on the same lines.
+//
+// NOTE: As with RingBuffer, the contents of a ring may be corrupted at any time
+// by an untrusted party. Slot indices are always reduced modulo kCapacity, and
+// every shared field and slot is read exactly once into private memory before
+// it is used, so that a consumer in the enclave never acts on a value the host
+// changed after it was checked. A corrupted ring may return garbage values or
+// report itself empty or full, but never accesses memory outside itself and
+// never loops forever in TryPush() or TryPop(). Values returned by a ring
+// filled by the host must be validated like any other untrusted input.
+//
+// Push() and Pop() spin briefly and then sleep on a futex until the ring has
+// room or a value. Wakeups cost a system call only when a thread is asleep on
+// the other side. The futex calls are made through the |Futex| policy, which
+// provides static Wait(int32_t *futex, int32_t expected) and
+// WakeAll(int32_t *futex) functions:
+//
+//   SysFutex (asylo/platform/common/sys_futex.h) is for code outside an
+//   enclave.
+//   UntrustedFutex (asylo/platform/host_call/trusted/untrusted_futex.h) is for
+//   code inside an enclave, and requires the ring to be in untrusted memory.
+//
+// The policy does not change the layout of a ring, so both sides may use the
+// same ring through their own policies. This header depends on neither, so
+// that enclave code does not pull in the host futex implementation.
+//
+// As with RingBuffer, the layout of a ring is stamped into each instance, so
+// that both sides can check that they agree on it before sharing one:
+//
+// SpscRing<T, kCapacity, Futex>::TypeVersion() == instance->InstanceVersion();
+
+namespace internal_slot_ring {
+
+constexpr size_t kCacheLineSize = 64;
+
+// The number of failed attempts a blocking operation makes before sleeping.
+constexpr int kSpinCount = 128;
+
+// Folds |values| into |version| with FNV-1a, one value at a time.
+constexpr uint64_t LayoutVersion(uint64_t version) { return version; }
+
+template <typename... Values>
+constexpr uint64_t LayoutVersion(uint64_t version, uint64_t value,
+                                 Values... values) {
+  return LayoutVersion((version ^ value) * 0x100000001b3ULL, values...);
+}
+
+// The threads sleeping until one side of a ring changes. Sleepers raise a flag
+// before checking the ring a last time, and notifiers that lower it bump the
+// futex word after changing the ring, so that a change made while a thread
+// goes to sleep is never missed, and a sleeper is woken once rather than by
+// every later change.
+class alignas(kCacheLineSize) WaitQueue {
+ public:
+  static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+                "std::atomic<int32_t> cannot be used as a futex word.");
+
+  WaitQueue() : futex_(0), sleeping_(0) {}
+
+  // Calls |attempt| until it returns true, sleeping between attempts once
+  // spinning has not helped.
+  template <typename Futex, typename Attempt>
+  void Await(const Attempt &attempt) {
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (attempt()) {
+        return;
+      }
+    }
+    while (true) {
+      int32_t value = futex_.load();
+      sleeping_.store(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (attempt()) {
+        return;
+      }
+      Futex::Wait(reinterpret_cast<int32_t *>(&futex_), value);
+    }
+  }
+
+  // Wakes the threads sleeping in Await(), if any. Must be called after the
+  // change they wait for is made.
+  template <typename Futex>
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) != 0 &&
+        sleeping_.exchange(0) != 0) {
+      futex_.fetch_add(1);
+      Futex::WakeAll(reinterpret_cast<int32_t *>(&futex_));
+    }
+  }
+
+ private:
+  std::atomic<int32_t> futex_;     // Bumped by every wakeup.
+  std::atomic<int32_t> sleeping_;  // Whether a thread may be asleep.
+};
+
+}  // namespace internal_slot_ring
+
+// A bounded queue of |kCapacity| values of type |T| supporting exactly one
+// producer and exactly one consumer. See the comment at the top of this file.
+template <typename T, size_t kCapacity, typename Futex>
+class SpscRing {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Values shared across the enclave boundary must be trivially "
+                "copyable.");
+  static_assert(kCapacity > 1 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two greater than one.");
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  SpscRing()
+      : instance_version_(TypeVersion()),
+        closed_(0),
+        head_(0),
+        cached_tail_(0),
+        tail_(0),
+        cached_head_(0) {}
+
+  SpscRing(const SpscRing &other) = delete;
+  SpscRing &operator=(const SpscRing &other) = delete;
+
+  // Appends |value| without blocking. Returns false if the ring is full.
+  bool TryPush(const T &value) {
+    if (!Enqueue(value)) {
+      return false;
+    }
+    not_empty_.template Notify<Futex>();
+    return true;
+  }
+
+  // Removes the oldest value into |value| without blocking. Returns false if
+  // the ring is empty.
+  bool TryPop(T *value) {
+    if (!Dequeue(value)) {
+      return false;
+    }
+    not_full_.template Notify<Futex>();
+    return true;
+  }
+
+  // Appends |value|, blocking while the ring is full. Returns false without
+  // appending it if the ring is closed.
+  bool Push(const T &value) {
+    bool pushed = false;
+    not_full_.template Await<Futex>([this, &value, &pushed] {
+      pushed = !is_closed() && Enqueue(value);
+      return pushed || is_closed();
+    });
+    if (pushed) {
+      not_empty_.template Notify<Futex>();
+    }
+    return pushed;
+  }
+
+  // Removes the oldest value into |value|, blocking while the ring is empty.
+  // Returns false once the ring is closed and empty.
+  bool Pop(T *value) {
+    bool popped = false;
+    not_empty_.template Await<Futex>([this, value, &popped] {
+      // A value pushed before the ring was closed is still popped.
+      bool closed = is_closed();
+      popped = Dequeue(value);
+      return popped || closed;
+    });
+    if (popped) {
+      not_full_.template Notify<Futex>();
+    }
+    return popped;
+  }
+
+  // Closes the ring, so that Push() fails and Pop() fails once the ring is
+  // empty, and wakes the threads blocked in either.
+  void Close() {
+    closed_.store(1);
+    not_empty_.template Notify<Futex>();
+    not_full_.template Notify<Futex>();
+  }
+
+  // Returns whether Close() has been called.
+  bool is_closed() const { return closed_.load() != 0; }
+
+  // Returns the number of slots in the ring.
+  constexpr size_t capacity() const { return kCapacity; }
+
+  // Returns a signature reflecting the layout of this concrete instance.
+  uint64_t InstanceVersion() const { return instance_version_; }
+
+  // Returns a signature reflecting the layout of this abstract type.
+  static constexpr uint64_t TypeVersion() {
+    return internal_slot_ring::LayoutVersion(
+        0xcbf29ce484222325ULL, /*variant=*/1, sizeof(T), kCapacity,
+        sizeof(SpscRing), offsetof(SpscRing, closed_),
+        offsetof(SpscRing, head_), offsetof(SpscRing, tail_),
+        offsetof(SpscRing, not_empty_), offsetof(SpscRing, not_full_),
+        offsetof(SpscRing, slots_));
+  }
+
+ private:
+  static constexpr uint64_t kMask = kCapacity - 1;
+
+  bool Enqueue(const T &value) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t cached_head = cached_head_;
+    if (tail - cached_head >= kCapacity) {
+      cached_head = head_.load(std::memory_order_acquire);
+      cached_head_ = cached_head;
+      if (tail - cached_head >= kCapacity) {
+        return false;
+      }
+    }
+    memcpy(&slots_[tail & kMask], &value, sizeof(T));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Dequeue(T *value) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t cached_tail = cached_tail_;
+    if (head == cached_tail) {
+      cached_tail = tail_.load(std::memory_order_acquire);
+      cached_tail_ = cached_tail;
+      if (head == cached_tail) {
+        return false;
+      }
+    }
+    memcpy(value, &slots_[head & kMask], sizeof(T));
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  const uint64_t instance_version_;  // Layout of the struct.
+  std::atomic<uint32_t> closed_;     // No more values will be pushed.
+
+  // The consumer's position, and its last read of the producer's.
+  alignas(internal_slot_ring::kCacheLineSize) std::atomic<uint64_t> head_;
+  uint64_t cached_tail_;
+
+  // The producer's position, and its last read of the consumer's.
+  alignas(internal_slot_ring::kCacheLineSize) std::atomic<uint64_t> tail_;
+  uint64_t cached_head_;
+
+  internal_slot_ring::WaitQueue not_empty_;  // Consumers waiting for values.
+  internal_slot_ring::WaitQueue not_full_;   // Producers waiting for room.
+
+  alignas(internal_slot_ring::kCacheLineSize) T slots_[kCapacity];
+};
+
+// A bounded queue of |kCapacity| values of type |T| supporting any number of
+// producers and consumers. Each slot carries a sequence number recording
+// whether it is ready to be written or read at the current position. See the
+// comment at the top of this file.
+template <typename T, size_t kCapacity, typename Futex>
+class MpmcRing {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Values shared across the enclave boundary must be trivially "
+                "copyable.");
+  static_assert(kCapacity > 1 && (kCapacity & (kCapacity - 1)) == 0,
+                "The capacity must be a power of two greater than one.");
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                "std::atomic<uint64_t> is not lock free.");
+
+  MpmcRing()
+      : instance_version_(TypeVersion()),
+        closed_(0),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (uint64_t i = 0; i < kCapacity; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRing(const MpmcRing &other) = delete;
+  MpmcRing &operator=(const MpmcRing &other) = delete;
+
+  // Appends |value| without blocking. Returns false if the ring is full.
+  bool TryPush(const T &value) {
+    if (!Enqueue(value)) {
+      return false;
+    }
+    not_empty_.template Notify<Futex>();
+    return true;
+  }
+
+  // Removes the oldest value into |value| without blocking. Returns false if
+  // the ring is empty.
+  bool TryPop(T *value) {
+    if (!Dequeue(value)) {
+      return false;
+    }
+    not_full_.template Notify<Futex>();
+    return true;
+  }
+
+  // Appends |value|, blocking while the ring is full. Returns false without
+  // appending it if the ring is closed.
+  bool Push(const T &value) {
+    bool pushed = false;
+    not_full_.template Await<Futex>([this, &value, &pushed] {
+      pushed = !is_closed() && Enqueue(value);
+      return pushed || is_closed();
+    });
+    if (pushed) {
+      not_empty_.template Notify<Futex>();
+    }
+    return pushed;
+  }
+
+  // Removes the oldest value into |value|, blocking while the ring is empty.
+  // Returns false once the ring is closed and empty.
+  bool Pop(T *value) {
+    bool popped = false;
+    not_empty_.template Await<Futex>([this, value, &popped] {
+      // A value pushed before the ring was closed is still popped.
+      bool closed = is_closed();
+      popped = Dequeue(value);
+      return popped || closed;
+    });
+    if (popped) {
+      not_full_.template Notify<Futex>();
+    }
+    return popped;
+  }
+
+  // Closes the ring, so that Push() fails and Pop() fails once the ring is
+  // empty, and wakes the threads blocked in either.
+  void Close() {
+    closed_.store(1);
+    not_empty_.template Notify<Futex>();
+    not_full_.template Notify<Futex>();
+  }
+
+  // Returns whether Close() has been called.
+  bool is_closed() const { return closed_.load() != 0; }
+
+  // Returns the number of slots in the ring.
+  constexpr size_t capacity() const { return kCapacity; }
+
+  // Returns a signature reflecting the layout of this concrete instance.
+  uint64_t InstanceVersion() const { return instance_version_; }
+
+  // Returns a signature reflecting the layout of this abstract type.
+  static constexpr uint64_t TypeVersion() {
+    return internal_slot_ring::LayoutVersion(
+        0xcbf29ce484222325ULL, /*variant=*/2, sizeof(T), kCapacity,
+        sizeof(MpmcRing), sizeof(Slot), offsetof(Slot, value),
+        offsetof(MpmcRing, closed_), offsetof(MpmcRing, enqueue_pos_),
+        offsetof(MpmcRing, dequeue_pos_), offsetof(MpmcRing, not_empty_),
+        offsetof(MpmcRing, not_full_), offsetof(MpmcRing, slots_));
+  }
+
+ private:
+  static constexpr uint64_t kMask = kCapacity - 1;
+
+  // A slot at position |pos| may be written once its sequence is |pos|, and
+  // read once its sequence is |pos| + 1.
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    T value;
+  };
+
+  bool Enqueue(const T &value) {
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots_[pos & kMask];
+      uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(sequence - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        // Another producer has taken |pos|. The position it advanced is
+        // visible by now, so finding it unchanged means the ring is corrupt.
+        uint64_t current = enqueue_pos_.load(std::memory_order_relaxed);
+        if (current == pos) {
+          return false;
+        }
+        pos = current;
+      }
+    }
+    memcpy(&slot->value, &value, sizeof(T));
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Dequeue(T *value) {
+    uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &slots_[pos & kMask];
+      uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        // As in Enqueue(), another consumer has taken |pos|.
+        uint64_t current = dequeue_pos_.load(std::memory_order_relaxed);
+        if (current == pos) {
+          return false;
+        }
+        pos = current;
+      }
+    }
+    memcpy(value, &slot->value, sizeof(T));
+    slot->sequence.store(pos + kCapacity, std::memory_order_release);
+    return true;
+  }
+
+  const uint64_t instance_version_;  // Layout of the struct.
+  std::atomic<uint32_t> closed_;     // No more values will be pushed.
+
+  // The next positions to be taken by producers and by consumers.
+  alignas(internal_slot_ring::kCacheLineSize)
+      std::atomic<uint64_t> enqueue_pos_;
+  alignas(internal_slot_ring::kCacheLineSize)
+      std::atomic<uint64_t> dequeue_pos_;
+
+  internal_slot_ring::WaitQueue not_empty_;  // Consumers waiting for values.
+  internal_slot_ring::WaitQueue not_full_;   // Producers waiting for room.
+
+  alignas(internal_slot_ring::kCacheLineSize) Slot slots_[kCapacity];
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_SLOT_RING_H_
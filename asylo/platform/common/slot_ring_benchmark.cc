@@ -0,0 +1,118 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+#include "asylo/platform/common/ring_buffer.h"
+#include "asylo/platform/common/slot_ring.h"
+#include "asylo/platform/common/sys_futex.h"
+
+namespace asylo {
+namespace {
+
+// Every benchmark thread runs the same number of iterations, so each benchmark
+// pushes as many values as it pops and leaves its ring empty for the next run.
+
+constexpr size_t kCapacity = 1024;
+
+// 1:1. The first thread produces and the second consumes.
+template <typename RingT>
+void BM_OneToOne(benchmark::State &state) {
+  static RingT *ring = new RingT;
+  uint64_t value = 0;
+  for (auto _ : state) {
+    if (state.thread_index == 0) {
+      ring->Push(value++);
+    } else {
+      ring->Pop(&value);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  if (state.thread_index == 0) {
+    state.SetItemsProcessed(state.iterations());
+  }
+}
+BENCHMARK_TEMPLATE(BM_OneToOne, SpscRing<uint64_t, kCapacity, SysFutex>)
+    ->Threads(2)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_OneToOne, MpmcRing<uint64_t, kCapacity, SysFutex>)
+    ->Threads(2)
+    ->UseRealTime();
+
+// The byte ring the slot rings replace, moving the same 8-byte values.
+void BM_RingBufferOneToOne(benchmark::State &state) {
+  static RingBuffer<kCapacity * sizeof(uint64_t)> *ring =
+      new RingBuffer<kCapacity * sizeof(uint64_t)>;
+  uint64_t value = 0;
+  for (auto _ : state) {
+    if (state.thread_index == 0) {
+      ++value;
+      ring->Write(reinterpret_cast<const uint8_t *>(&value), sizeof(value));
+    } else {
+      ring->Read(reinterpret_cast<uint8_t *>(&value), sizeof(value));
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  if (state.thread_index == 0) {
+    state.SetItemsProcessed(state.iterations());
+  }
+}
+BENCHMARK(BM_RingBufferOneToOne)->Threads(2)->UseRealTime();
+
+// N:1. The first thread consumes a value from each of the others every
+// iteration.
+void BM_ManyToOne(benchmark::State &state) {
+  static auto *ring = new MpmcRing<uint64_t, kCapacity, SysFutex>;
+  uint64_t value = 0;
+  for (auto _ : state) {
+    if (state.thread_index == 0) {
+      for (int i = 1; i < state.threads; ++i) {
+        ring->Pop(&value);
+      }
+      benchmark::DoNotOptimize(value);
+    } else {
+      ring->Push(value++);
+    }
+  }
+  if (state.thread_index != 0) {
+    state.SetItemsProcessed(state.iterations());
+  }
+}
+BENCHMARK(BM_ManyToOne)->DenseThreadRange(2, 9, 1)->UseRealTime();
+
+// N:M. Even threads produce and odd threads consume.
+void BM_ManyToMany(benchmark::State &state) {
+  static auto *ring = new MpmcRing<uint64_t, kCapacity, SysFutex>;
+  uint64_t value = 0;
+  for (auto _ : state) {
+    if (state.thread_index % 2 == 0) {
+      ring->Push(value++);
+    } else {
+      ring->Pop(&value);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+  if (state.thread_index % 2 == 0) {
+    state.SetItemsProcessed(state.iterations());
+  }
+}
+BENCHMARK(BM_ManyToMany)->DenseThreadRange(2, 16, 2)->UseRealTime();
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,208 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/common/slot_ring.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "asylo/platform/common/sys_futex.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsFalse;
+using ::testing::IsTrue;
+using ::testing::Lt;
+using ::testing::Ne;
+
+constexpr size_t kCapacity = 16;
+constexpr uint64_t kNumValues = 100000;
+
+template <typename RingT>
+class SlotRingTest : public ::testing::Test {
+ protected:
+  SlotRingTest() : ring_(absl::make_unique<RingT>()) {}
+
+  std::unique_ptr<RingT> ring_;
+};
+
+using RingTypes = ::testing::Types<SpscRing<uint64_t, kCapacity, SysFutex>,
+                                   MpmcRing<uint64_t, kCapacity, SysFutex>>;
+TYPED_TEST_SUITE(SlotRingTest, RingTypes);
+
+TYPED_TEST(SlotRingTest, InstanceVersionMatchesTypeVersion) {
+  EXPECT_THAT(this->ring_->InstanceVersion(), Eq(TypeParam::TypeVersion()));
+}
+
+TYPED_TEST(SlotRingTest, TryOperationsFailWhenFullOrEmpty) {
+  uint64_t value;
+  EXPECT_THAT(this->ring_->TryPop(&value), IsFalse());
+
+  for (uint64_t i = 0; i < kCapacity; ++i) {
+    EXPECT_THAT(this->ring_->TryPush(i), IsTrue());
+  }
+  EXPECT_THAT(this->ring_->TryPush(kCapacity), IsFalse());
+
+  for (uint64_t i = 0; i < kCapacity; ++i) {
+    ASSERT_THAT(this->ring_->TryPop(&value), IsTrue());
+    EXPECT_THAT(value, Eq(i));
+  }
+  EXPECT_THAT(this->ring_->TryPop(&value), IsFalse());
+}
+
+TYPED_TEST(SlotRingTest, PreservesOrderAcrossWraparound) {
+  uint64_t value;
+  for (uint64_t i = 0; i < 10 * kCapacity; ++i) {
+    ASSERT_THAT(this->ring_->Push(i), IsTrue());
+    ASSERT_THAT(this->ring_->Pop(&value), IsTrue());
+    EXPECT_THAT(value, Eq(i));
+  }
+}
+
+TYPED_TEST(SlotRingTest, ClosedRingRejectsPushesAndDrains) {
+  ASSERT_THAT(this->ring_->Push(1), IsTrue());
+  ASSERT_THAT(this->ring_->Push(2), IsTrue());
+  this->ring_->Close();
+  EXPECT_THAT(this->ring_->is_closed(), IsTrue());
+  EXPECT_THAT(this->ring_->Push(3), IsFalse());
+
+  uint64_t value;
+  ASSERT_THAT(this->ring_->Pop(&value), IsTrue());
+  EXPECT_THAT(value, Eq(1));
+  ASSERT_THAT(this->ring_->Pop(&value), IsTrue());
+  EXPECT_THAT(value, Eq(2));
+  EXPECT_THAT(this->ring_->Pop(&value), IsFalse());
+}
+
+TYPED_TEST(SlotRingTest, CloseWakesBlockedThreads) {
+  std::thread consumer([this] {
+    uint64_t value;
+    EXPECT_THAT(this->ring_->Pop(&value), IsFalse());
+  });
+  this->ring_->Close();
+  consumer.join();
+
+  auto full_ring = absl::make_unique<TypeParam>();
+  for (uint64_t i = 0; i < kCapacity; ++i) {
+    ASSERT_THAT(full_ring->TryPush(i), IsTrue());
+  }
+  std::thread producer(
+      [&full_ring] { EXPECT_THAT(full_ring->Push(kCapacity), IsFalse()); });
+  full_ring->Close();
+  producer.join();
+}
+
+TYPED_TEST(SlotRingTest, TransfersValuesInOrderBetweenThreads) {
+  std::thread producer([this] {
+    for (uint64_t i = 0; i < kNumValues; ++i) {
+      ASSERT_THAT(this->ring_->Push(i), IsTrue());
+    }
+    this->ring_->Close();
+  });
+
+  uint64_t expected = 0;
+  uint64_t value;
+  while (this->ring_->Pop(&value)) {
+    ASSERT_THAT(value, Eq(expected));
+    ++expected;
+  }
+  producer.join();
+  EXPECT_THAT(expected, Eq(kNumValues));
+}
+
+// Fills a ring with random bytes, as a hostile host could, and checks that
+// operating on it terminates and stays within the ring.
+TYPED_TEST(SlotRingTest, SurvivesCorruptedSharedState) {
+  srandom(::testing::UnitTest::GetInstance()->random_seed());
+  for (int trial = 0; trial < 100; ++trial) {
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(this->ring_.get());
+    for (size_t i = sizeof(uint64_t); i < sizeof(TypeParam); ++i) {
+      bytes[i] = random();
+    }
+    uint64_t value;
+    for (size_t i = 0; i < 2 * kCapacity; ++i) {
+      this->ring_->TryPush(i);
+      this->ring_->TryPop(&value);
+    }
+  }
+}
+
+TEST(SlotRingTest, VariantsHaveDistinctVersions) {
+  EXPECT_THAT((SpscRing<uint64_t, kCapacity, SysFutex>::TypeVersion()),
+              Ne((MpmcRing<uint64_t, kCapacity, SysFutex>::TypeVersion())));
+  EXPECT_THAT((SpscRing<uint64_t, kCapacity, SysFutex>::TypeVersion()),
+              Ne((SpscRing<uint64_t, 2 * kCapacity, SysFutex>::TypeVersion())));
+  EXPECT_THAT((SpscRing<uint32_t, kCapacity, SysFutex>::TypeVersion()),
+              Ne((SpscRing<uint64_t, kCapacity, SysFutex>::TypeVersion())));
+}
+
+TEST(SlotRingTest, TransfersEachValueOnceBetweenManyThreads) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumConsumers = 4;
+  auto ring = absl::make_unique<MpmcRing<uint64_t, kCapacity, SysFutex>>();
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kNumProducers; ++p) {
+    producers.emplace_back([&ring, p] {
+      for (uint64_t i = p; i < kNumValues; i += kNumProducers) {
+        ASSERT_THAT(ring->Push(i), IsTrue());
+      }
+    });
+  }
+
+  std::vector<std::vector<uint64_t>> popped(kNumConsumers);
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < kNumConsumers; ++c) {
+    consumers.emplace_back([&ring, &popped, c] {
+      uint64_t value;
+      while (ring->Pop(&value)) {
+        popped[c].push_back(value);
+      }
+    });
+  }
+
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  ring->Close();
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+
+  std::vector<int> counts(kNumValues, 0);
+  for (const auto &values : popped) {
+    for (uint64_t value : values) {
+      ASSERT_THAT(value, Lt(kNumValues));
+      ++counts[value];
+    }
+  }
+  for (uint64_t i = 0; i < kNumValues; ++i) {
+    EXPECT_THAT(counts[i], Eq(1)) << "value " << i;
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,43 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_COMMON_SYS_FUTEX_H_
+#define ASYLO_PLATFORM_COMMON_SYS_FUTEX_H_
+
+#include <cstdint>
+#include <limits>
+
+#include "asylo/platform/common/futex.h"
+
+namespace asylo {
+
+// The futex policy for SpscRing and MpmcRing used outside an enclave. Sleeps on
+// and wakes futex words through sys_futex_wait() and sys_futex_wake().
+struct SysFutex {
+  static void Wait(int32_t *futex, int32_t expected) {
+    sys_futex_wait(futex, expected, /*timeout_microsec=*/0);
+  }
+
+  static void WakeAll(int32_t *futex) {
+    sys_futex_wake(futex, std::numeric_limits<int32_t>::max());
+  }
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_COMMON_SYS_FUTEX_H_
@@ -0,0 +1,120 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_call_dispatcher.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+
+namespace asylo {
+
+StatusOr<std::unique_ptr<EnclaveCallDispatcher>> EnclaveCallDispatcher::Create(
+    EnclaveClient *client, size_t num_workers, size_t max_queued_calls) {
+  if (num_workers == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "An enclave call dispatcher needs at least one worker");
+  }
+  if (max_queued_calls == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "An enclave call dispatcher must queue at least one call");
+  }
+
+  auto dispatcher =
+      absl::WrapUnique(new EnclaveCallDispatcher(client, max_queued_calls));
+  dispatcher->workers_.reserve(num_workers);
+  for (size_t i = 0; i < num_workers; ++i) {
+    dispatcher->workers_.emplace_back(&EnclaveCallDispatcher::WorkLoop,
+                                      dispatcher.get());
+  }
+  return std::move(dispatcher);
+}
+
+EnclaveCallDispatcher::EnclaveCallDispatcher(EnclaveClient *client,
+                                             size_t max_queued_calls)
+    : client_(client), max_queued_calls_(max_queued_calls) {}
+
+EnclaveCallDispatcher::~EnclaveCallDispatcher() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+Status EnclaveCallDispatcher::TrySubmit(EnclaveInput input,
+                                        EnclaveCallDone done) {
+  return Enqueue(std::move(input), std::move(done), absl::ZeroDuration());
+}
+
+Status EnclaveCallDispatcher::Submit(EnclaveInput input, EnclaveCallDone done,
+                                     absl::Duration timeout) {
+  return Enqueue(std::move(input), std::move(done), timeout);
+}
+
+size_t EnclaveCallDispatcher::QueuedCalls() const {
+  absl::MutexLock lock(&mu_);
+  return queue_.size();
+}
+
+Status EnclaveCallDispatcher::Enqueue(EnclaveInput input, EnclaveCallDone done,
+                                      absl::Duration timeout) {
+  absl::MutexLock lock(&mu_);
+  auto has_room = [this]() {
+    mu_.AssertHeld();
+    return queue_.size() < max_queued_calls_;
+  };
+  if (!mu_.AwaitWithTimeout(absl::Condition(&has_room), timeout)) {
+    return Status(error::GoogleError::RESOURCE_EXHAUSTED,
+                  "The enclave call queue is full");
+  }
+  queue_.push_back(Call{std::move(input), std::move(done), absl::Now()});
+  return Status::OkStatus();
+}
+
+void EnclaveCallDispatcher::WorkLoop() {
+  while (true) {
+    Call call;
+    {
+      absl::MutexLock lock(&mu_);
+      auto queued_or_stopping = [this]() {
+        mu_.AssertHeld();
+        return stopping_ || !queue_.empty();
+      };
+      mu_.Await(absl::Condition(&queued_or_stopping));
+      // Calls queued before the dispatcher started stopping are still run.
+      if (queue_.empty()) {
+        return;
+      }
+      call = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    EnclaveCallResult result;
+    absl::Time start = absl::Now();
+    result.queueing_time = start - call.queued_at;
+    result.status = client_->EnterAndRun(call.input, &result.output);
+    result.service_time = absl::Now() - start;
+    call.done(std::move(result));
+  }
+}
+
+}  // namespace asylo
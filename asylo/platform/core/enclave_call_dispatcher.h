@@ -0,0 +1,160 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CALL_DISPATCHER_H_
+#define ASYLO_PLATFORM_CORE_ENCLAVE_CALL_DISPATCHER_H_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_client.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// The outcome of a call made through an EnclaveCallDispatcher.
+struct EnclaveCallResult {
+  /// The status returned by EnclaveClient::EnterAndRun().
+  Status status;
+
+  /// The output of the enclave.
+  EnclaveOutput output;
+
+  /// The time the call spent queued before a worker took it.
+  absl::Duration queueing_time = absl::ZeroDuration();
+
+  /// The time the call spent in EnclaveClient::EnterAndRun().
+  absl::Duration service_time = absl::ZeroDuration();
+};
+
+/// A callback receiving the result of a call made through an
+/// EnclaveCallDispatcher.
+using EnclaveCallDone = std::function<void(EnclaveCallResult result)>;
+
+/// Makes calls to the execution entry point of an enclave asynchronously.
+///
+/// Calls are queued by any number of host threads and run by a fixed set of
+/// worker threads, each of which enters the enclave with one call at a time.
+/// The number of host threads inside the enclave, and so the number of TCS in
+/// use, is therefore at most the number of workers, however many calls are in
+/// flight. The completion callback of each call is run on the worker that made
+/// it, once the call has returned from the enclave.
+///
+/// The queue is bounded. Once it is full, TrySubmit() fails and Submit()
+/// waits for room, so that callers can push back on their own clients.
+///
+/// Example:
+///
+/// ```
+///   ASYLO_ASSIGN_OR_RETURN(
+///       std::unique_ptr<EnclaveCallDispatcher> dispatcher,
+///       EnclaveCallDispatcher::Create(client, /*num_workers=*/4,
+///                                     /*max_queued_calls=*/64));
+///   ...
+///   ASYLO_RETURN_IF_ERROR(dispatcher->TrySubmit(
+///       std::move(input), [](EnclaveCallResult result) {
+///         ...
+///       }));
+/// ```
+///
+/// Callers that prefer futures can set a `std::promise` from the callback.
+class EnclaveCallDispatcher {
+ public:
+  /// Creates a dispatcher making calls to |client| from |num_workers| worker
+  /// threads, and starts the workers.
+  ///
+  /// \param client The enclave to call, which must outlive the dispatcher.
+  /// \param num_workers The number of calls made at once. It should not exceed
+  ///                    the number of threads the enclave was configured
+  ///                    with.
+  /// \param max_queued_calls The number of calls that may be waiting for a
+  ///                         worker.
+  /// \return The new dispatcher, or INVALID_ARGUMENT if either count is zero.
+  static StatusOr<std::unique_ptr<EnclaveCallDispatcher>> Create(
+      EnclaveClient *client, size_t num_workers, size_t max_queued_calls);
+
+  EnclaveCallDispatcher(const EnclaveCallDispatcher &other) = delete;
+  EnclaveCallDispatcher &operator=(const EnclaveCallDispatcher &other) =
+      delete;
+
+  /// Runs the calls already queued and stops the workers. No call may be
+  /// submitted once destruction has begun.
+  ~EnclaveCallDispatcher();
+
+  /// Queues a call with |input| without waiting.
+  ///
+  /// \param input The input of the call.
+  /// \param done The callback receiving the result of the call.
+  /// \return An OK status if the call was queued, in which case |done| will be
+  ///         called exactly once, or RESOURCE_EXHAUSTED if the queue is full.
+  Status TrySubmit(EnclaveInput input, EnclaveCallDone done)
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Queues a call with |input|, waiting for room in the queue if it is full.
+  ///
+  /// \param input The input of the call.
+  /// \param done The callback receiving the result of the call.
+  /// \param timeout The longest time to wait for room in the queue.
+  /// \return An OK status if the call was queued, in which case |done| will be
+  ///         called exactly once, or RESOURCE_EXHAUSTED if the queue stayed
+  ///         full for |timeout|.
+  Status Submit(EnclaveInput input, EnclaveCallDone done,
+                absl::Duration timeout = absl::InfiniteDuration())
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Returns the number of calls waiting for a worker.
+  size_t QueuedCalls() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Call {
+    EnclaveInput input;
+    EnclaveCallDone done;
+    absl::Time queued_at;
+  };
+
+  EnclaveCallDispatcher(EnclaveClient *client, size_t max_queued_calls);
+
+  // Queues a call, waiting at most |timeout| for room.
+  Status Enqueue(EnclaveInput input, EnclaveCallDone done,
+                 absl::Duration timeout) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // The body of each worker thread.
+  void WorkLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  EnclaveClient *const client_;
+  const size_t max_queued_calls_;
+
+  mutable absl::Mutex mu_;
+  std::deque<Call> queue_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_ENCLAVE_CALL_DISPATCHER_H_
@@ -19,8 +19,12 @@
 #ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 #define ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 
+#include <functional>
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/core/shared_name.h"
 #include "asylo/util/status.h"  // IWYU pragma: export
@@ -49,6 +53,36 @@ class EnclaveClient {
   virtual Status EnterAndRun(const EnclaveInput &input,
                              EnclaveOutput *output) = 0;
 
+  /// Enters the enclave and invokes its execution entry point with an input
+  /// that is already serialized.
+  ///
+  /// This variant lets callers which hold serialized messages in their own
+  /// memory, such as language bindings, avoid parsing the input and output
+  /// messages and copying them between intermediate buffers.
+  ///
+  /// \param serialized_input A serialized EnclaveInput.
+  /// \param output_consumer A callback which is passed the serialized
+  ///                        EnclaveOutput if the enclave returned one. The
+  ///                        view is only valid for the duration of the call.
+  /// \return The status returned by the enclave.
+  virtual Status EnterAndRunSerialized(
+      absl::string_view serialized_input,
+      const std::function<void(absl::string_view)> &output_consumer) {
+    EnclaveInput input;
+    if (!input.ParseFromArray(serialized_input.data(),
+                              serialized_input.size())) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Failed to parse EnclaveInput");
+    }
+    EnclaveOutput output;
+    Status status = EnterAndRun(input, &output);
+    std::string serialized_output;
+    if (output.SerializeToString(&serialized_output)) {
+      output_consumer(serialized_output);
+    }
+    return status;
+  }
+
   /// Returns the name of the enclave.
   ///
   /// \return The name of the enclave.
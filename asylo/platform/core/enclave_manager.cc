@@ -356,6 +356,28 @@ void EnclaveManager::RemoveEnclaveReference(absl::string_view name) {
   name_by_client_.erase(client);
 }
 
+Status EnclaveManager::RenameEnclave(EnclaveClient *client,
+                                     absl::string_view name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  auto name_it = name_by_client_.find(client);
+  if (name_it == name_by_client_.end()) {
+    return Status(error::GoogleError::NOT_FOUND, "Enclave is not loaded");
+  }
+  if (client_by_name_.find(name) != client_by_name_.end()) {
+    return Status(error::GoogleError::ALREADY_EXISTS,
+                  absl::StrCat("Name already exists: ", name));
+  }
+
+  // Inserting may rehash the table, so the client is taken out first.
+  auto client_it = client_by_name_.find(name_it->second);
+  std::unique_ptr<EnclaveClient> owned_client = std::move(client_it->second);
+  client_by_name_.erase(client_it);
+  client_by_name_.emplace(name, std::move(owned_client));
+  name_it->second = std::string(name);
+  client->name_ = std::string(name);
+  return Status::OkStatus();
+}
+
 primitives::Client *LoadEnclaveInChildProcess(absl::string_view enclave_name,
                                               void *enclave_base_address,
                                               size_t enclave_size) {
@@ -42,6 +42,7 @@
 
 namespace asylo {
 class EnclaveLoader;
+class EnclavePool;
 
 /// Enclave Manager configuration.
 /// \deprecated EnclaveManager no longer needs to be configured.
@@ -240,6 +241,15 @@ class EnclaveManager {
   void RemoveEnclaveReference(absl::string_view name)
       ABSL_LOCKS_EXCLUDED(client_table_lock_);
 
+  // Binds |client|, a loaded enclave, to |name| in place of the name it was
+  // loaded under, and updates the name it reports. Used by EnclavePool to hand
+  // out enclaves it loaded in advance. The enclave itself keeps the name it was
+  // initialized with.
+  Status RenameEnclave(EnclaveClient *client, absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(client_table_lock_);
+
+  friend class EnclavePool;
+
   // Manager object for untrusted resources shared with enclaves.
   SharedResourceManager shared_resource_manager_;
 
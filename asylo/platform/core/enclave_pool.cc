@@ -0,0 +1,272 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_pool.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "asylo/util/logging.h"
+#include "asylo/platform/primitives/dlopen/loader.pb.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// The delays between consecutive failed loads.
+constexpr absl::Duration kMinLoadRetryDelay = absl::Milliseconds(10);
+constexpr absl::Duration kMaxLoadRetryDelay = absl::Seconds(1);
+
+// How often a single-instance pool checks whether its acquired enclave has
+// been destroyed.
+constexpr absl::Duration kDestroyedEnclavePollInterval = absl::Milliseconds(50);
+
+}  // namespace
+
+StatusOr<std::unique_ptr<EnclavePool>> EnclavePool::Create(
+    const EnclaveLoadConfig &load_config, size_t size,
+    size_t max_parallel_loads) {
+  if (size == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "An enclave pool must hold at least one enclave");
+  }
+  if (load_config.config().enable_fork()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Fork is not supported by pooled enclaves");
+  }
+
+  bool single_instance = load_config.HasExtension(dlopen_load_config);
+  if (single_instance && size != 1) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "A pool of dlopen enclaves must hold a single enclave");
+  }
+
+  EnclaveManager *manager;
+  ASYLO_ASSIGN_OR_RETURN(manager, EnclaveManager::Instance());
+
+  if (max_parallel_loads == 0) {
+    max_parallel_loads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  max_parallel_loads = std::min(max_parallel_loads, size);
+
+  auto pool = absl::WrapUnique(
+      new EnclavePool(manager, load_config, size, single_instance));
+  pool->loaders_.reserve(max_parallel_loads);
+  for (size_t i = 0; i < max_parallel_loads; ++i) {
+    pool->loaders_.emplace_back(&EnclavePool::LoadLoop, pool.get());
+  }
+  return std::move(pool);
+}
+
+EnclavePool::EnclavePool(EnclaveManager *manager,
+                         const EnclaveLoadConfig &load_config, size_t size,
+                         bool single_instance)
+    : manager_(manager),
+      load_config_(load_config),
+      size_(size),
+      single_instance_(single_instance) {}
+
+EnclavePool::~EnclavePool() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  for (auto &loader : loaders_) {
+    loader.join();
+  }
+
+  EnclaveFinal final_input;
+  for (EnclaveClient *client : ready_) {
+    Status status =
+        manager_->DestroyEnclave(client, final_input, /*skip_finalize=*/true);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to destroy pooled enclave: " << status;
+    }
+  }
+}
+
+StatusOr<EnclaveClient *> EnclavePool::Acquire(absl::string_view name,
+                                               absl::Duration timeout) {
+  absl::Time start = absl::Now();
+  absl::MutexLock lock(&mu_);
+  bool waited = ready_.empty();
+
+  // Wait for a loaded enclave, or for a load to fail while none is loaded.
+  uint64_t failed_loads = stats_.failed_loads;
+  auto ready_or_failed = [this, failed_loads]() {
+    mu_.AssertHeld();
+    return !ready_.empty() || stats_.failed_loads != failed_loads;
+  };
+  if (!mu_.AwaitWithTimeout(absl::Condition(&ready_or_failed), timeout)) {
+    ++stats_.failed_acquisitions;
+    return Status(error::GoogleError::DEADLINE_EXCEEDED,
+                  "Timed out waiting for a pooled enclave to be loaded");
+  }
+  if (ready_.empty()) {
+    ++stats_.failed_acquisitions;
+    return last_load_status_;
+  }
+
+  EnclaveClient *client = ready_.front();
+  Status status = manager_->RenameEnclave(client, name);
+  if (!status.ok()) {
+    ++stats_.failed_acquisitions;
+    return status;
+  }
+  ready_.pop_front();
+  if (single_instance_) {
+    acquired_.emplace_back(std::string(name), client);
+  }
+
+  absl::Duration latency = absl::Now() - start;
+  ++stats_.acquisitions;
+  if (waited) {
+    ++stats_.waited_acquisitions;
+  }
+  stats_.total_acquisition_latency += latency;
+  stats_.max_acquisition_latency =
+      std::max(stats_.max_acquisition_latency, latency);
+  return client;
+}
+
+Status EnclavePool::WaitUntilFull(absl::Duration timeout) {
+  absl::MutexLock lock(&mu_);
+  auto full = [this]() {
+    mu_.AssertHeld();
+    if (single_instance_) {
+      ForgetDestroyedEnclaves();
+    }
+    return ready_.size() + acquired_.size() >= size_;
+  };
+  absl::Time deadline = absl::Now() + timeout;
+  // A single-instance pool is full once its acquired enclave is destroyed,
+  // which it polls for.
+  while (!mu_.AwaitWithDeadline(
+      absl::Condition(&full),
+      std::min(deadline, absl::Now() + kDestroyedEnclavePollInterval))) {
+    if (absl::Now() >= deadline) {
+      return Status(error::GoogleError::DEADLINE_EXCEEDED,
+                    "Timed out waiting for the enclave pool to fill");
+    }
+  }
+  return Status::OkStatus();
+}
+
+size_t EnclavePool::ReadyCount() const {
+  absl::MutexLock lock(&mu_);
+  return ready_.size();
+}
+
+EnclavePoolStats EnclavePool::GetStats() const {
+  absl::MutexLock lock(&mu_);
+  return stats_;
+}
+
+void EnclavePool::LoadLoop() {
+  absl::Duration retry_delay = kMinLoadRetryDelay;
+  while (true) {
+    {
+      absl::MutexLock lock(&mu_);
+      auto vacant_or_stopping = [this]() {
+        mu_.AssertHeld();
+        return stopping_ || Vacancies() > 0;
+      };
+      if (single_instance_) {
+        // The pool is not notified of the destruction of its acquired
+        // enclave, so poll for it.
+        while (!mu_.AwaitWithTimeout(absl::Condition(&vacant_or_stopping),
+                                     kDestroyedEnclavePollInterval)) {
+        }
+      } else {
+        mu_.Await(absl::Condition(&vacant_or_stopping));
+      }
+      if (stopping_) {
+        return;
+      }
+      ++loading_;
+    }
+
+    absl::Time start = absl::Now();
+    StatusOr<EnclaveClient *> client_result = LoadOne();
+    absl::Duration latency = absl::Now() - start;
+
+    absl::MutexLock lock(&mu_);
+    --loading_;
+    if (!client_result.ok()) {
+      LOG(ERROR) << "Failed to load pooled enclave: "
+                 << client_result.status();
+      ++stats_.failed_loads;
+      last_load_status_ = client_result.status();
+      // Back off, but wake up to stop.
+      auto stopping = [this]() {
+        mu_.AssertHeld();
+        return stopping_;
+      };
+      mu_.AwaitWithTimeout(absl::Condition(&stopping), retry_delay);
+      retry_delay = std::min(retry_delay * 2, kMaxLoadRetryDelay);
+      continue;
+    }
+    retry_delay = kMinLoadRetryDelay;
+    ++stats_.loads;
+    stats_.total_load_latency += latency;
+    last_load_status_ = Status::OkStatus();
+    ready_.push_back(client_result.ValueOrDie());
+  }
+}
+
+StatusOr<EnclaveClient *> EnclavePool::LoadOne() {
+  EnclaveLoadConfig load_config = load_config_;
+  {
+    absl::MutexLock lock(&mu_);
+    load_config.set_name(
+        absl::StrCat(load_config_.name(), "/pool/", next_id_++));
+  }
+  ASYLO_RETURN_IF_ERROR(manager_->LoadEnclave(load_config));
+
+  EnclaveClient *client = manager_->GetClient(load_config.name());
+  if (!client) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("Pooled enclave ", load_config.name(),
+                               " was destroyed before it was acquired"));
+  }
+  return client;
+}
+
+size_t EnclavePool::Vacancies() {
+  size_t occupied = ready_.size() + loading_;
+  if (single_instance_) {
+    ForgetDestroyedEnclaves();
+    occupied += acquired_.size();
+  }
+  return occupied >= size_ ? 0 : size_ - occupied;
+}
+
+void EnclavePool::ForgetDestroyedEnclaves() {
+  acquired_.erase(
+      std::remove_if(acquired_.begin(), acquired_.end(),
+                     [this](const std::pair<std::string,
+                                            const EnclaveClient *> &acquired) {
+                       return manager_->GetClient(acquired.first) !=
+                              acquired.second;
+                     }),
+      acquired_.end());
+}
+
+}  // namespace asylo
@@ -0,0 +1,207 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_ENCLAVE_POOL_H_
+#define ASYLO_PLATFORM_CORE_ENCLAVE_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_client.h"
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// Counters and latencies of the enclaves handed out and loaded by an
+/// EnclavePool.
+struct EnclavePoolStats {
+  /// The number of successful calls to EnclavePool::Acquire().
+  int64_t acquisitions = 0;
+
+  /// The number of successful acquisitions that found no loaded enclave
+  /// and waited for one.
+  int64_t waited_acquisitions = 0;
+
+  /// The number of calls to EnclavePool::Acquire() that failed.
+  int64_t failed_acquisitions = 0;
+
+  /// The number of enclaves loaded and initialized by the pool.
+  int64_t loads = 0;
+
+  /// The number of loads that failed.
+  int64_t failed_loads = 0;
+
+  /// The total and the longest time taken by successful acquisitions.
+  absl::Duration total_acquisition_latency = absl::ZeroDuration();
+  absl::Duration max_acquisition_latency = absl::ZeroDuration();
+
+  /// The total time taken by successful loads.
+  absl::Duration total_load_latency = absl::ZeroDuration();
+
+  /// Returns the mean time taken by a successful acquisition.
+  absl::Duration MeanAcquisitionLatency() const {
+    return acquisitions == 0 ? absl::ZeroDuration()
+                             : total_acquisition_latency / acquisitions;
+  }
+
+  /// Returns the mean time taken to load and initialize an enclave.
+  absl::Duration MeanLoadLatency() const {
+    return loads == 0 ? absl::ZeroDuration() : total_load_latency / loads;
+  }
+};
+
+/// A pool of enclaves loaded and initialized in advance from a single
+/// EnclaveLoadConfig, so that a new enclave is ready to use without waiting
+/// for it to be created and initialized.
+///
+/// The pool loads enclaves from background threads until it holds as many
+/// loaded enclaves as its size, loading several at once on hosts with several
+/// cores. Acquire() takes a loaded enclave from the pool and registers it with
+/// the EnclaveManager under the requested name, from where it is used and
+/// destroyed like any other enclave. The pool loads a replacement in the
+/// background.
+///
+/// Example:
+///
+/// ```
+///   ASYLO_ASSIGN_OR_RETURN(std::unique_ptr<EnclavePool> pool,
+///                          EnclavePool::Create(load_config, /*size=*/4));
+///   ...
+///   ASYLO_ASSIGN_OR_RETURN(EnclaveClient *client,
+///                          pool->Acquire("request_handler_17"));
+/// ```
+///
+/// Enclaves that have not been acquired are destroyed with the pool, without
+/// being finalized.
+///
+/// The dlopen backend cannot hold two instances of the same enclave binary at
+/// once, so a pool of dlopen enclaves has a size of one, and loads a
+/// replacement only once the enclave acquired from it has been destroyed.
+class EnclavePool {
+ public:
+  /// Creates a pool of |size| enclaves loaded from |load_config|, and starts
+  /// loading them in the background.
+  ///
+  /// The |name| of |load_config| is used as a prefix of the names the pool
+  /// loads enclaves under until they are acquired. Fork support is not
+  /// available to pooled enclaves.
+  ///
+  /// \param load_config The configuration to load each enclave from.
+  /// \param size The number of loaded enclaves the pool maintains.
+  /// \param max_parallel_loads The number of enclaves the pool loads at once,
+  ///                           or zero to load as many at once as the host
+  ///                           has cores.
+  /// \return The new pool, or an error if the configuration is not supported.
+  static StatusOr<std::unique_ptr<EnclavePool>> Create(
+      const EnclaveLoadConfig &load_config, size_t size,
+      size_t max_parallel_loads = 0);
+
+  EnclavePool(const EnclavePool &other) = delete;
+  EnclavePool &operator=(const EnclavePool &other) = delete;
+
+  /// Stops loading enclaves and destroys the enclaves that were not acquired.
+  ~EnclavePool();
+
+  /// Takes a loaded enclave from the pool and registers it with the
+  /// EnclaveManager under |name|. Waits for the pool to load an enclave if
+  /// none is ready.
+  ///
+  /// \param name The name to register the enclave under.
+  /// \param timeout The longest time to wait for an enclave to be loaded.
+  /// \return A client of the acquired enclave, ALREADY_EXISTS if an enclave
+  ///         named |name| exists, DEADLINE_EXCEEDED if no enclave was loaded
+  ///         within |timeout|, or the error of the last failed load if the
+  ///         pool fails to load enclaves.
+  StatusOr<EnclaveClient *> Acquire(
+      absl::string_view name,
+      absl::Duration timeout = absl::InfiniteDuration())
+      ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Waits until the pool holds as many loaded enclaves as it can.
+  ///
+  /// \param timeout The longest time to wait.
+  /// \return An OK status once the pool is full, or DEADLINE_EXCEEDED.
+  Status WaitUntilFull(absl::Duration timeout) ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Returns the number of loaded enclaves in the pool.
+  size_t ReadyCount() const ABSL_LOCKS_EXCLUDED(mu_);
+
+  /// Returns the statistics of the pool since it was created.
+  EnclavePoolStats GetStats() const ABSL_LOCKS_EXCLUDED(mu_);
+
+ private:
+  EnclavePool(EnclaveManager *manager, const EnclaveLoadConfig &load_config,
+              size_t size, bool single_instance);
+
+  // The body of each loading thread.
+  void LoadLoop() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Loads and initializes an enclave under a unique name, and returns its
+  // client.
+  StatusOr<EnclaveClient *> LoadOne() ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of loaded or loading enclaves the pool may add before
+  // it is full.
+  size_t Vacancies() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Forgets the enclaves acquired from a single-instance pool that have since
+  // been destroyed.
+  void ForgetDestroyedEnclaves() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  EnclaveManager *const manager_;
+  const EnclaveLoadConfig load_config_;
+  const size_t size_;
+
+  // Whether at most one enclave of |load_config_| may exist at a time.
+  const bool single_instance_;
+
+  mutable absl::Mutex mu_;
+  std::deque<EnclaveClient *> ready_ ABSL_GUARDED_BY(mu_);
+  size_t loading_ ABSL_GUARDED_BY(mu_) = 0;
+  uint64_t next_id_ ABSL_GUARDED_BY(mu_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+
+  // The names and clients of the enclaves acquired from a single-instance pool
+  // that may still exist.
+  std::vector<std::pair<std::string, const EnclaveClient *>> acquired_
+      ABSL_GUARDED_BY(mu_);
+
+  // The status of the latest load, returned by acquisitions while loads fail.
+  Status last_load_status_ ABSL_GUARDED_BY(mu_);
+
+  EnclavePoolStats stats_ ABSL_GUARDED_BY(mu_);
+
+  std::vector<std::thread> loaders_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_ENCLAVE_POOL_H_
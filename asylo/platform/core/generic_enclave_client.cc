@@ -19,8 +19,12 @@
 #include "asylo/platform/core/generic_enclave_client.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 #include "absl/strings/string_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/core/entry_selectors.h"
@@ -33,6 +37,47 @@
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+
+// Parses the status field of the serialized EnclaveOutput |serialized_output|
+// into |status_proto|, skipping all other fields and extensions. Returns false
+// if |serialized_output| is malformed.
+bool ParseOutputStatus(absl::string_view serialized_output,
+                       StatusProto *status_proto) {
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t *>(serialized_output.data()),
+      serialized_output.size());
+  status_proto->Clear();
+  while (true) {
+    uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      return input.ConsumedEntireMessage();
+    }
+    if (WireFormatLite::GetTagFieldNumber(tag) !=
+            EnclaveOutput::kStatusFieldNumber ||
+        WireFormatLite::GetTagWireType(tag) !=
+            WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      if (!WireFormatLite::SkipField(&input, tag)) {
+        return false;
+      }
+      continue;
+    }
+    uint32_t length;
+    if (!input.ReadVarint32(&length)) {
+      return false;
+    }
+    auto limit = input.PushLimit(length);
+    if (!status_proto->MergePartialFromCodedStream(&input) ||
+        !input.ConsumedEntireMessage()) {
+      return false;
+    }
+    input.PopLimit(limit);
+  }
+}
+
+}  // namespace
 
 std::unique_ptr<GenericEnclaveClient> GenericEnclaveClient::Create(
     const absl::string_view name,
@@ -150,6 +195,32 @@ Status GenericEnclaveClient::EnterAndRun(const EnclaveInput &input,
   return status;
 }
 
+Status GenericEnclaveClient::EnterAndRunSerialized(
+    absl::string_view serialized_input,
+    const std::function<void(absl::string_view)> &output_consumer) {
+  primitives::MessageWriter in;
+  in.PushByReference(
+      primitives::Extent{serialized_input.data(), serialized_input.size()});
+  primitives::MessageReader out;
+  ASYLO_RETURN_IF_ERROR(
+      primitive_client_->EnclaveCall(kSelectorAsyloRun, &in, &out));
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(out, 1);
+  auto output_extent = out.next();
+  absl::string_view serialized_output(output_extent.As<char>(),
+                                      output_extent.size());
+
+  StatusProto status_proto;
+  if (!ParseOutputStatus(serialized_output, &status_proto)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to deserialize EnclaveOutput");
+  }
+  output_consumer(serialized_output);
+
+  Status status;
+  status.RestoreFrom(status_proto);
+  return status;
+}
+
 Status GenericEnclaveClient::EnterAndFinalize(const EnclaveFinal &final_input) {
   std::string buf;
   if (!final_input.SerializeToString(&buf)) {
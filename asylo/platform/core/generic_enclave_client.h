@@ -35,6 +35,13 @@ class GenericEnclaveClient : public EnclaveClient {
 
   Status EnterAndRun(const EnclaveInput &input, EnclaveOutput *output) override;
 
+  // Passes |serialized_input| to the enclave by reference and hands the
+  // enclave's output to |output_consumer| without copying it. Only the status
+  // field of the output is parsed.
+  Status EnterAndRunSerialized(
+      absl::string_view serialized_input,
+      const std::function<void(absl::string_view)> &output_consumer) override;
+
   std::shared_ptr<primitives::Client> GetPrimitiveClient() const {
     return primitive_client_;
   }
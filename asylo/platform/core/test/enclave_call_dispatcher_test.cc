@@ -0,0 +1,256 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_call_dispatcher.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/platform/core/test/proto_test.pb.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAreArray;
+
+constexpr absl::Duration kServiceTime = absl::Milliseconds(10);
+
+// An enclave client whose execution entry point echoes the test string of its
+// input after sleeping for |service_time|, optionally waiting for a release
+// first, and which records how many calls it runs at once.
+class FakeEnclaveClient : public EnclaveClient {
+ public:
+  explicit FakeEnclaveClient(absl::Duration service_time)
+      : EnclaveClient("fake_enclave"), service_time_(service_time) {}
+
+  Status EnterAndRun(const EnclaveInput &input,
+                     EnclaveOutput *output) override {
+    int inside = ++inside_;
+    int max_inside = max_inside_.load();
+    while (inside > max_inside &&
+           !max_inside_.compare_exchange_weak(max_inside, inside)) {
+    }
+    if (!first_entered_.exchange(true)) {
+      entered_.Notify();
+    }
+    if (hold_) {
+      release_.WaitForNotification();
+    }
+    absl::SleepFor(service_time_);
+    --inside_;
+
+    if (!input.HasExtension(enclave_api_test_input)) {
+      return Status(error::GoogleError::INVALID_ARGUMENT, "No test input");
+    }
+    output->MutableExtension(enclave_api_test_output)
+        ->set_test_string(
+            input.GetExtension(enclave_api_test_input).test_string());
+    return Status::OkStatus();
+  }
+
+  // Makes calls wait for Release() once they have entered.
+  void Hold() { hold_ = true; }
+  void Release() { release_.Notify(); }
+
+  // Waits until the first call has entered.
+  void WaitForEntry() { entered_.WaitForNotification(); }
+
+  int max_inside() const { return max_inside_.load(); }
+
+ private:
+  Status EnterAndInitialize(const EnclaveConfig &config) override {
+    return Status::OkStatus();
+  }
+
+  Status EnterAndFinalize(const EnclaveFinal &final_input) override {
+    return Status::OkStatus();
+  }
+
+  Status DestroyEnclave() override { return Status::OkStatus(); }
+
+  const absl::Duration service_time_;
+  std::atomic<int> inside_{0};
+  std::atomic<int> max_inside_{0};
+  std::atomic<bool> first_entered_{false};
+  bool hold_ = false;
+  absl::Notification entered_;
+  absl::Notification release_;
+};
+
+EnclaveInput TestInput(const std::string &test_string) {
+  EnclaveInput input;
+  input.MutableExtension(enclave_api_test_input)->set_test_string(test_string);
+  return input;
+}
+
+// Collects the results of calls.
+class Results {
+ public:
+  EnclaveCallDone Callback() {
+    return [this](EnclaveCallResult result) {
+      absl::MutexLock lock(&mu_);
+      results_.push_back(std::move(result));
+    };
+  }
+
+  // Waits for |count| results and returns them.
+  std::vector<EnclaveCallResult> WaitFor(size_t count) {
+    absl::MutexLock lock(&mu_);
+    auto done = [this, count]() {
+      mu_.AssertHeld();
+      return results_.size() >= count;
+    };
+    mu_.Await(absl::Condition(&done));
+    return results_;
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::vector<EnclaveCallResult> results_ ABSL_GUARDED_BY(mu_);
+};
+
+TEST(EnclaveCallDispatcherTest, CreateFailsForZeroCounts) {
+  FakeEnclaveClient client(kServiceTime);
+  EXPECT_THAT(EnclaveCallDispatcher::Create(&client, 0, 1).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(EnclaveCallDispatcher::Create(&client, 1, 0).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(EnclaveCallDispatcherTest, RunsCallsOnAtMostNumWorkersThreads) {
+  constexpr int kNumWorkers = 3;
+  constexpr int kNumCalls = 20;
+  FakeEnclaveClient client(kServiceTime);
+  std::unique_ptr<EnclaveCallDispatcher> dispatcher;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      dispatcher, EnclaveCallDispatcher::Create(&client, kNumWorkers,
+                                                /*max_queued_calls=*/kNumCalls));
+
+  Results results;
+  std::vector<std::string> expected;
+  for (int i = 0; i < kNumCalls; ++i) {
+    expected.push_back(absl::StrCat("call ", i));
+    ASYLO_ASSERT_OK(
+        dispatcher->TrySubmit(TestInput(expected.back()), results.Callback()));
+  }
+
+  std::vector<std::string> outputs;
+  for (const EnclaveCallResult &result : results.WaitFor(kNumCalls)) {
+    ASYLO_EXPECT_OK(result.status);
+    EXPECT_THAT(result.service_time, Ge(kServiceTime));
+    outputs.push_back(
+        result.output.GetExtension(enclave_api_test_output).test_string());
+  }
+  EXPECT_THAT(outputs, UnorderedElementsAreArray(expected));
+  EXPECT_THAT(client.max_inside(), Le(kNumWorkers));
+}
+
+TEST(EnclaveCallDispatcherTest, ReportsTheStatusOfFailedCalls) {
+  FakeEnclaveClient client(absl::ZeroDuration());
+  std::unique_ptr<EnclaveCallDispatcher> dispatcher;
+  ASYLO_ASSERT_OK_AND_ASSIGN(dispatcher,
+                             EnclaveCallDispatcher::Create(&client, 1, 1));
+
+  Results results;
+  ASYLO_ASSERT_OK(dispatcher->Submit(EnclaveInput(), results.Callback()));
+  EXPECT_THAT(results.WaitFor(1).front().status,
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST(EnclaveCallDispatcherTest, FullQueueRejectsCalls) {
+  constexpr size_t kMaxQueuedCalls = 2;
+  FakeEnclaveClient client(absl::ZeroDuration());
+  client.Hold();
+  std::unique_ptr<EnclaveCallDispatcher> dispatcher;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      dispatcher, EnclaveCallDispatcher::Create(&client, /*num_workers=*/1,
+                                                kMaxQueuedCalls));
+
+  // The first call occupies the only worker, and the next ones fill the
+  // queue.
+  Results results;
+  ASYLO_ASSERT_OK(dispatcher->TrySubmit(TestInput("0"), results.Callback()));
+  client.WaitForEntry();
+  for (size_t i = 1; i <= kMaxQueuedCalls; ++i) {
+    ASYLO_ASSERT_OK(dispatcher->TrySubmit(TestInput(absl::StrCat(i)),
+                                          results.Callback()));
+  }
+  EXPECT_THAT(dispatcher->QueuedCalls(), Eq(kMaxQueuedCalls));
+  EXPECT_THAT(dispatcher->TrySubmit(TestInput("rejected"), results.Callback()),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+  EXPECT_THAT(dispatcher->Submit(TestInput("rejected"), results.Callback(),
+                                 absl::Milliseconds(10)),
+              StatusIs(error::GoogleError::RESOURCE_EXHAUSTED));
+
+  absl::SleepFor(kServiceTime);
+  client.Release();
+  std::vector<EnclaveCallResult> completed =
+      results.WaitFor(1 + kMaxQueuedCalls);
+  ASSERT_THAT(completed, SizeIs(1 + kMaxQueuedCalls));
+  // The queued calls waited for the first one to be released.
+  for (size_t i = 1; i < completed.size(); ++i) {
+    EXPECT_THAT(completed[i].queueing_time, Ge(kServiceTime));
+  }
+}
+
+TEST(EnclaveCallDispatcherTest, SubmitWaitsForRoom) {
+  FakeEnclaveClient client(kServiceTime);
+  std::unique_ptr<EnclaveCallDispatcher> dispatcher;
+  ASYLO_ASSERT_OK_AND_ASSIGN(dispatcher,
+                             EnclaveCallDispatcher::Create(&client, 1, 1));
+
+  Results results;
+  for (int i = 0; i < 5; ++i) {
+    ASYLO_ASSERT_OK(
+        dispatcher->Submit(TestInput(absl::StrCat(i)), results.Callback()));
+  }
+  EXPECT_THAT(results.WaitFor(5), SizeIs(5));
+}
+
+TEST(EnclaveCallDispatcherTest, DestructionRunsQueuedCalls) {
+  constexpr int kNumCalls = 5;
+  FakeEnclaveClient client(kServiceTime);
+  Results results;
+  {
+    std::unique_ptr<EnclaveCallDispatcher> dispatcher;
+    ASYLO_ASSERT_OK_AND_ASSIGN(
+        dispatcher, EnclaveCallDispatcher::Create(&client, 1, kNumCalls));
+    for (int i = 0; i < kNumCalls; ++i) {
+      ASYLO_ASSERT_OK(dispatcher->TrySubmit(TestInput(absl::StrCat(i)),
+                                            results.Callback()));
+    }
+  }
+  EXPECT_THAT(results.WaitFor(kNumCalls), SizeIs(kNumCalls));
+}
+
+}  // namespace
+}  // namespace asylo
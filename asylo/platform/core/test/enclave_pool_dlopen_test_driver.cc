@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/platform/core/enclave_pool.h"
+#include "asylo/platform/primitives/dlopen/loader.pb.h"
+#include "asylo/test/util/status_matchers.h"
+
+ABSL_FLAG(std::string, enclave_path, "", "Path to enclave");
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+constexpr absl::Duration kTimeout = absl::Seconds(60);
+
+class EnclavePoolDlopenTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASYLO_ASSERT_OK_AND_ASSIGN(manager_, EnclaveManager::Instance());
+
+    load_config_.set_name("/enclave_pool_dlopen_test");
+    DlopenLoadConfig dlopen_config;
+    dlopen_config.set_enclave_path(absl::GetFlag(FLAGS_enclave_path));
+    *load_config_.MutableExtension(dlopen_load_config) = dlopen_config;
+  }
+
+  void DestroyEnclave(EnclaveClient *client) {
+    EnclaveFinal final_input;
+    ASYLO_EXPECT_OK(manager_->DestroyEnclave(client, final_input));
+  }
+
+  EnclaveManager *manager_;
+  EnclaveLoadConfig load_config_;
+};
+
+TEST_F(EnclavePoolDlopenTest, CreateFailsForMoreThanOneEnclave) {
+  EXPECT_THAT(EnclavePool::Create(load_config_, 2).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+TEST_F(EnclavePoolDlopenTest, ReloadsOnceAcquiredEnclaveIsDestroyed) {
+  std::unique_ptr<EnclavePool> pool;
+  ASYLO_ASSERT_OK_AND_ASSIGN(pool, EnclavePool::Create(load_config_, 1));
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+
+  EnclaveClient *client;
+  ASYLO_ASSERT_OK_AND_ASSIGN(client, pool->Acquire("/acquired", kTimeout));
+  EXPECT_THAT(manager_->GetClient("/acquired"), Eq(client));
+  EXPECT_THAT(client->get_name(), Eq("/acquired"));
+
+  // The pool counts as full, and loads no second instance of the enclave,
+  // while the acquired enclave exists.
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+  EXPECT_THAT(pool->ReadyCount(), Eq(0));
+  EXPECT_THAT(pool->Acquire("/second", absl::Milliseconds(200)).status(),
+              StatusIs(error::GoogleError::DEADLINE_EXCEEDED));
+  EXPECT_THAT(pool->GetStats().loads, Eq(1));
+
+  // Destroying the acquired enclave makes room for a replacement.
+  DestroyEnclave(client);
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+  EXPECT_THAT(pool->ReadyCount(), Eq(1));
+  EXPECT_THAT(pool->GetStats().loads, Eq(2));
+
+  ASYLO_ASSERT_OK_AND_ASSIGN(client, pool->Acquire("/reacquired", kTimeout));
+  EXPECT_THAT(client, Ne(nullptr));
+  EXPECT_THAT(manager_->GetClient("/reacquired"), Eq(client));
+  DestroyEnclave(client);
+}
+
+}  // namespace
+}  // namespace asylo
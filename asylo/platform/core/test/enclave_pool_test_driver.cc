@@ -0,0 +1,144 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/enclave_pool.h"
+
+#include <memory>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/flags/flag.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/enclave_manager.h"
+#include "asylo/platform/primitives/sgx/loader.pb.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/statusor.h"
+
+ABSL_FLAG(std::string, enclave_path, "", "Path to enclave");
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::IsNull;
+using ::testing::Ne;
+
+constexpr size_t kPoolSize = 3;
+constexpr absl::Duration kTimeout = absl::Seconds(60);
+
+class EnclavePoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASYLO_ASSERT_OK_AND_ASSIGN(manager_, EnclaveManager::Instance());
+
+    load_config_.set_name("/enclave_pool_test");
+    SgxLoadConfig sgx_config;
+    sgx_config.mutable_file_enclave_config()->set_enclave_path(
+        absl::GetFlag(FLAGS_enclave_path));
+    sgx_config.set_debug(true);
+    *load_config_.MutableExtension(sgx_load_config) = sgx_config;
+  }
+
+  void DestroyEnclave(absl::string_view name) {
+    EnclaveClient *client = manager_->GetClient(name);
+    ASSERT_THAT(client, Ne(nullptr));
+    EnclaveFinal final_input;
+    ASYLO_EXPECT_OK(manager_->DestroyEnclave(client, final_input));
+  }
+
+  EnclaveManager *manager_;
+  EnclaveLoadConfig load_config_;
+};
+
+TEST_F(EnclavePoolTest, FillsInBackground) {
+  std::unique_ptr<EnclavePool> pool;
+  ASYLO_ASSERT_OK_AND_ASSIGN(pool,
+                             EnclavePool::Create(load_config_, kPoolSize));
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+  EXPECT_THAT(pool->ReadyCount(), Eq(kPoolSize));
+
+  EnclavePoolStats stats = pool->GetStats();
+  EXPECT_THAT(stats.loads, Eq(kPoolSize));
+  EXPECT_THAT(stats.failed_loads, Eq(0));
+  EXPECT_THAT(stats.MeanLoadLatency(), Ne(absl::ZeroDuration()));
+}
+
+TEST_F(EnclavePoolTest, AcquiredEnclavesAreRegisteredByNameAndReplaced) {
+  std::unique_ptr<EnclavePool> pool;
+  ASYLO_ASSERT_OK_AND_ASSIGN(pool,
+                             EnclavePool::Create(load_config_, kPoolSize));
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+
+  for (size_t i = 0; i < 2 * kPoolSize; ++i) {
+    std::string name = absl::StrCat("/acquired_", i);
+    EnclaveClient *client;
+    ASYLO_ASSERT_OK_AND_ASSIGN(client, pool->Acquire(name, kTimeout));
+    EXPECT_THAT(manager_->GetClient(name), Eq(client));
+    EXPECT_THAT(manager_->GetName(client), Eq(name));
+    EXPECT_THAT(client->get_name(), Eq(name));
+  }
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+
+  EnclavePoolStats stats = pool->GetStats();
+  EXPECT_THAT(stats.acquisitions, Eq(2 * kPoolSize));
+  EXPECT_THAT(stats.failed_acquisitions, Eq(0));
+  EXPECT_THAT(stats.loads, Eq(3 * kPoolSize));
+  EXPECT_THAT(stats.max_acquisition_latency,
+              Ge(stats.MeanAcquisitionLatency()));
+
+  for (size_t i = 0; i < 2 * kPoolSize; ++i) {
+    DestroyEnclave(absl::StrCat("/acquired_", i));
+  }
+}
+
+TEST_F(EnclavePoolTest, AcquireFailsForExistingName) {
+  std::unique_ptr<EnclavePool> pool;
+  ASYLO_ASSERT_OK_AND_ASSIGN(pool, EnclavePool::Create(load_config_, 1));
+  ASYLO_ASSERT_OK(pool->Acquire("/duplicate", kTimeout).status());
+
+  EXPECT_THAT(pool->Acquire("/duplicate", kTimeout).status(),
+              StatusIs(error::GoogleError::ALREADY_EXISTS));
+  EXPECT_THAT(pool->GetStats().failed_acquisitions, Eq(1));
+
+  // The enclave is kept for the next acquisition.
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+  EXPECT_THAT(pool->ReadyCount(), Eq(1));
+  DestroyEnclave("/duplicate");
+}
+
+TEST_F(EnclavePoolTest, UnacquiredEnclavesAreDestroyedWithThePool) {
+  std::unique_ptr<EnclavePool> pool;
+  ASYLO_ASSERT_OK_AND_ASSIGN(pool, EnclavePool::Create(load_config_, 1));
+  ASYLO_ASSERT_OK(pool->WaitUntilFull(kTimeout));
+  pool.reset();
+
+  EXPECT_THAT(manager_->GetClient("/enclave_pool_test/pool/0"), IsNull());
+}
+
+TEST_F(EnclavePoolTest, CreateFailsForForkEnabledConfigs) {
+  load_config_.mutable_config()->set_enable_fork(true);
+  EXPECT_THAT(EnclavePool::Create(load_config_, kPoolSize).status(),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace asylo
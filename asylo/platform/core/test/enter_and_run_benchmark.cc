@@ -0,0 +1,156 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compares the host-side cost of the two paths a language binding can take
+// into an enclave's execution entry point with large messages:
+//
+//  * The proto path, which is what the Java binding's enterAndRun does: the
+//    serialized input is parsed into an EnclaveInput, EnterAndRun serializes
+//    it again and parses the enclave's output, and the EnclaveOutput is
+//    serialized into a new buffer to be handed back.
+//  * The serialized path, which is what enterAndRunDirect does: the serialized
+//    input is passed to EnterAndRunSerialized by reference and the output is
+//    copied once into a reusable buffer.
+//
+// The enclave is emulated by a primitives::Client which copies its input, as
+// the enclave boundary does, and returns a pre-serialized output of the same
+// size, so only the host-side copies and parsing are measured.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "asylo/enclave.pb.h"
+#include "asylo/platform/core/entry_selectors.h"
+#include "asylo/platform/core/generic_enclave_client.h"
+#include "asylo/platform/core/test/proto_test.pb.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+// Emulates an enclave whose execution entry point returns an EnclaveOutput
+// carrying a payload of a fixed size.
+class FakeEnclaveClient : public primitives::Client {
+ public:
+  explicit FakeEnclaveClient(size_t payload_size)
+      : Client(/*name=*/"fake_enclave",
+               absl::make_unique<primitives::DispatchTable>()) {
+    EnclaveOutput output;
+    output.MutableExtension(enclave_api_test_output)
+        ->set_test_string(std::string(payload_size, 'o'));
+    Status::OkStatus().SaveTo(output.mutable_status());
+    serialized_output_ = output.SerializeAsString();
+  }
+
+  bool IsClosed() const override { return false; }
+
+  Status Destroy() override { return Status::OkStatus(); }
+
+  Status EnclaveCallInternal(uint64_t selector,
+                             primitives::MessageWriter *input,
+                             primitives::MessageReader *output) override {
+    if (selector != kSelectorAsyloRun) {
+      return Status(error::GoogleError::INVALID_ARGUMENT, "Unknown selector");
+    }
+    // Copy the input in, and the output out, of the enclave.
+    enclave_input_.resize(input->MessageSize());
+    input->Serialize(enclave_input_.data());
+    primitives::MessageWriter writer;
+    writer.PushByReference(primitives::Extent{serialized_output_.data(),
+                                              serialized_output_.size()});
+    std::vector<char> buffer(writer.MessageSize());
+    writer.Serialize(buffer.data());
+    output->Deserialize(buffer.data(), buffer.size());
+    return Status::OkStatus();
+  }
+
+ private:
+  std::string serialized_output_;
+  std::vector<char> enclave_input_;
+};
+
+// Returns a serialized EnclaveInput carrying a payload of |payload_size|
+// bytes.
+std::string SerializedInput(size_t payload_size) {
+  EnclaveInput input;
+  input.MutableExtension(enclave_api_test_input)
+      ->set_test_string(std::string(payload_size, 'i'));
+  return input.SerializeAsString();
+}
+
+void BM_ProtoPath(benchmark::State &state) {
+  size_t payload_size = state.range(0);
+  auto client = GenericEnclaveClient::Create(
+      "fake_enclave", std::make_shared<FakeEnclaveClient>(payload_size));
+  std::string serialized_input = SerializedInput(payload_size);
+
+  for (auto _ : state) {
+    EnclaveInput input;
+    input.ParseFromArray(serialized_input.data(), serialized_input.size());
+    EnclaveOutput output;
+    Status status = client->EnterAndRun(input, &output);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+    auto output_buffer = absl::make_unique<char[]>(output.ByteSizeLong());
+    output.SerializeToArray(output_buffer.get(), output.ByteSizeLong());
+    benchmark::DoNotOptimize(output_buffer.get());
+  }
+  state.SetBytesProcessed(state.iterations() * payload_size * 2);
+}
+
+void BM_SerializedPath(benchmark::State &state) {
+  size_t payload_size = state.range(0);
+  auto client = GenericEnclaveClient::Create(
+      "fake_enclave", std::make_shared<FakeEnclaveClient>(payload_size));
+  std::string serialized_input = SerializedInput(payload_size);
+  std::vector<char> output_buffer;
+
+  for (auto _ : state) {
+    Status status = client->EnterAndRunSerialized(
+        serialized_input, [&output_buffer](absl::string_view output) {
+          if (output_buffer.size() < output.size()) {
+            output_buffer.resize(output.size());
+          }
+          memcpy(output_buffer.data(), output.data(), output.size());
+        });
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(output_buffer.data());
+  }
+  state.SetBytesProcessed(state.iterations() * payload_size * 2);
+}
+
+BENCHMARK(BM_ProtoPath)->RangeMultiplier(16)->Range(1 << 10, 16 << 20);
+BENCHMARK(BM_SerializedPath)->RangeMultiplier(16)->Range(1 << 10, 16 << 20);
+
+}  // namespace
+}  // namespace asylo
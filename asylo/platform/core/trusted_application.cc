@@ -38,6 +38,7 @@
 #include "asylo/platform/posix/io/io_manager.h"
 #include "asylo/platform/posix/io/native_paths.h"
 #include "asylo/platform/posix/io/random_devices.h"
+#include "asylo/platform/posix/memory/thread_caching_malloc.h"
 #include "asylo/platform/posix/threading/thread_manager.h"
 #include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
@@ -46,6 +47,7 @@
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/platform/primitives/util/status_serializer.h"
+#include "asylo/platform/storage/secure/aead_handler.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
@@ -201,6 +203,9 @@ Status InitializeEnvironmentVariables(
 }
 
 Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
+  if (config.enable_thread_caching_malloc()) {
+    EnableThreadCachingMalloc();
+  }
   InitializeIO(config);
   Status status =
       InitializeEnvironmentVariables(config.environment_variables());
@@ -258,6 +263,10 @@ void InitializeIO(const EnclaveConfig &config) {
       RandomPathHandler::kURandomPath,
       ::absl::make_unique<RandomPathHandler>());
 
+  // Size the block caches of secure files opened from now on.
+  platform::storage::AeadHandler::GetInstance().SetBlockCacheCapacity(
+      config.secure_storage_block_cache_blocks());
+
   // Set the current working directory so that relative paths can be handled.
   io_manager.SetCurrentWorkingDirectory(config.current_working_directory());
 }
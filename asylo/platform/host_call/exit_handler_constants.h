@@ -53,10 +53,12 @@ static constexpr uint64_t kReallocHandler = primitives::kSelectorHostCall + 5;
 // Exit handler constant for |SleepHandler|.
 static constexpr uint64_t kSleepHandler = primitives::kSelectorHostCall + 6;
 
-// Exit handler constant for |SendMsgHandler|.
+// Exit handler constant for |SendMsgHandler|, which serves both sendmsg and
+// sendmmsg.
 static constexpr uint64_t kSendMsgHandler = primitives::kSelectorHostCall + 7;
 
-// Exit handler constant for |RecvMsgHandler|.
+// Exit handler constant for |RecvMsgHandler|, which serves both recvmsg and
+// recvmmsg.
 static constexpr uint64_t kRecvMsgHandler = primitives::kSelectorHostCall + 8;
 
 // Exit handler constant for |GetSocknameHandler|.
@@ -139,9 +141,23 @@ static constexpr uint64_t kSysFutexWakeHandler =
 static constexpr uint64_t kLocalLifetimeAllocHandler =
     primitives::kSelectorHostCall + 30;
 
+// Exit handler constant for |SystemCallBatchHandler|.
+static constexpr uint64_t kSystemCallBatchHandler =
+    primitives::kSelectorHostCall + 31;
+
+// Exit handler constant for |EpollWaitHandler|.
+static constexpr uint64_t kEpollWaitHandler =
+    primitives::kSelectorHostCall + 32;
+
+// Exit handler constant for |WritevHandler|.
+static constexpr uint64_t kWritevHandler = primitives::kSelectorHostCall + 33;
+
+// Exit handler constant for |ReadvHandler|.
+static constexpr uint64_t kReadvHandler = primitives::kSelectorHostCall + 34;
+
 // Assert that the largest host call handler lies in
 // [kSelectorHostCall, kSelectorRemote).
-static_assert(kLocalLifetimeAllocHandler < primitives::kSelectorRemote,
+static_assert(kReadvHandler < primitives::kSelectorRemote,
               "Cannot have host call handler constant spill over into "
               "|kSelectorRemote|.");
 
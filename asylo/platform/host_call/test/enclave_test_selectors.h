@@ -19,6 +19,8 @@
 #ifndef ASYLO_PLATFORM_HOST_CALL_TEST_ENCLAVE_TEST_SELECTORS_H_
 #define ASYLO_PLATFORM_HOST_CALL_TEST_ENCLAVE_TEST_SELECTORS_H_
 
+#include <cstddef>
+
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/system_call/sysno.h"
 
@@ -153,6 +155,16 @@ constexpr uint64_t kTestRaise = kHostLibCSelector + 11;
 constexpr uint64_t kTestGetSockOpt = kHostLibCSelector + 12;
 constexpr uint64_t kTestGetAddrInfo = kHostLibCSelector + 13;
 constexpr uint64_t kTestClockGettime = kHostLibCSelector + 14;
+constexpr uint64_t kTestWritev = kHostLibCSelector + 15;
+constexpr uint64_t kTestReadv = kHostLibCSelector + 16;
+constexpr uint64_t kTestSendMmsg = kHostLibCSelector + 17;
+constexpr uint64_t kTestRecvMmsg = kHostLibCSelector + 18;
+constexpr uint64_t kTestTooManyIovecs = kHostLibCSelector + 19;
+constexpr uint64_t kTestSlotRingPop = kHostLibCSelector + 20;
+
+// The capacity of the SpscRing of int64_t values the host shares with the
+// enclave in kTestSlotRingPop.
+constexpr size_t kTestSlotRingCapacity = 8;
 
 }  // namespace host_call
 }  // namespace asylo
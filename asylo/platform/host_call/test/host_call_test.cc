@@ -36,16 +36,20 @@
 #include <ostream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/base/macros.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "asylo/enclave_manager.h"
+#include "asylo/platform/common/slot_ring.h"
+#include "asylo/platform/common/sys_futex.h"
 #include "asylo/platform/common/time_util.h"
 #include "asylo/platform/host_call/test/enclave_test_selectors.h"
 #include "asylo/platform/host_call/untrusted/host_call_handlers_initializer.h"
@@ -543,8 +547,10 @@ TEST_F(HostCallTest, TestRecvMsg) {
   in.Push<int>(/*value=flags*/ 0);
   MessageReader out;
   ASYLO_ASSERT_OK(client_->EnclaveCall(kTestRecvMsg, &in, &out));
-  ASSERT_THAT(out, SizeIs(1));
+  ASSERT_THAT(out, SizeIs(3));
   EXPECT_THAT(out.next<int>(), Eq(sizeof(kMsg1) + sizeof(kMsg2)));
+  EXPECT_THAT(out.next().As<char>(), StrEq(kMsg1));
+  EXPECT_THAT(out.next().As<char>(), StrEq(kMsg2));
 
   close(socket_fd);
   close(client_sock);
@@ -816,6 +822,188 @@ TEST_F(HostCallTest, TestWrite) {
   EXPECT_THAT(read_buf, StrEq(write_buf));
 }
 
+// Tests enc_untrusted_writev() by making a host call from inside the enclave to
+// write two buffers to a file, and verifying that the file on the host holds
+// their concatenation.
+TEST_F(HostCallTest, TestWritev) {
+  std::string test_file =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/test_file.tmp");
+
+  int fd =
+      open(test_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  platform::storage::FdCloser fd_closer(fd);
+  ASSERT_GE(fd, 0);
+
+  std::string buf1 = "first buffer, ";
+  std::string buf2 = "second buffer";
+  MessageWriter in;
+  in.Push<int>(/*value=fd=*/fd);
+  in.PushByReference(Extent{buf1.data(), buf1.size()});
+  in.PushString(buf2);
+
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestWritev, &in, &out));
+  ASSERT_THAT(out, SizeIs(1));  // Should only contain return value.
+  EXPECT_THAT(out.next<ssize_t>(), Eq(buf1.size() + buf2.size() + 1));
+
+  ASSERT_THAT(lseek(fd, 0, SEEK_SET), Eq(0));
+  char read_buf[64];
+  EXPECT_THAT(read(fd, read_buf, sizeof(read_buf)),
+              Eq(buf1.size() + buf2.size() + 1));
+  EXPECT_THAT(read_buf, StrEq(buf1 + buf2));
+}
+
+// Tests enc_untrusted_readv() by making a host call from inside the enclave to
+// read a file into two buffers, and verifying that the file content is split
+// across them.
+TEST_F(HostCallTest, TestReadv) {
+  std::string test_file =
+      absl::StrCat(absl::GetFlag(FLAGS_test_tmpdir), "/test_file.tmp");
+
+  int fd =
+      open(test_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  platform::storage::FdCloser fd_closer(fd);
+  ASSERT_GE(fd, 0);
+
+  std::string content = "0123456789abcdef";
+  ASSERT_THAT(write(fd, content.data(), content.size()), Eq(content.size()));
+  ASSERT_THAT(lseek(fd, 0, SEEK_SET), Eq(0));
+
+  MessageWriter in;
+  in.Push<int>(/*value=fd=*/fd);
+  in.Push<size_t>(10);
+  in.Push<size_t>(10);
+
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestReadv, &in, &out));
+  ASSERT_THAT(out, SizeIs(3));
+  EXPECT_THAT(out.next<ssize_t>(), Eq(content.size()));
+  auto buf1 = out.next();
+  auto buf2 = out.next();
+  EXPECT_THAT(std::string(buf1.As<char>(), 10), Eq(content.substr(0, 10)));
+  EXPECT_THAT(std::string(buf2.As<char>(), 6), Eq(content.substr(10)));
+}
+
+// Tests enc_untrusted_sendmmsg() by sending three datagrams from inside the
+// enclave in one host call, and verifying that each is received separately.
+TEST_F(HostCallTest, TestSendMmsg) {
+  int fds[2];
+  ASSERT_THAT(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), Eq(0));
+  platform::storage::FdCloser sender_closer(fds[0]);
+  platform::storage::FdCloser receiver_closer(fds[1]);
+
+  std::vector<std::string> datagrams = {"first", "second datagram", "third"};
+  MessageWriter in;
+  in.Push<int>(/*value=sockfd=*/fds[0]);
+  for (const std::string &datagram : datagrams) {
+    in.PushByReference(Extent{datagram.data(), datagram.size()});
+  }
+
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestSendMmsg, &in, &out));
+  ASSERT_THAT(out, SizeIs(1 + datagrams.size()));
+  EXPECT_THAT(out.next<int>(), Eq(datagrams.size()));
+  for (const std::string &datagram : datagrams) {
+    EXPECT_THAT(out.next<unsigned int>(), Eq(datagram.size()));
+  }
+
+  char buffer[64];
+  for (const std::string &datagram : datagrams) {
+    ssize_t received = recv(fds[1], buffer, sizeof(buffer), 0);
+    ASSERT_THAT(received, Eq(datagram.size()));
+    EXPECT_THAT(std::string(buffer, received), Eq(datagram));
+  }
+}
+
+// Tests that enc_untrusted_writev(), enc_untrusted_sendmsg() and
+// enc_untrusted_sendmmsg() fail as in Linux on messages with more buffers than
+// IOV_MAX, instead of passing them on to the host.
+TEST_F(HostCallTest, TestTooManyIovecs) {
+  int fds[2];
+  ASSERT_THAT(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), Eq(0));
+  platform::storage::FdCloser sender_closer(fds[0]);
+  platform::storage::FdCloser receiver_closer(fds[1]);
+
+  MessageWriter in;
+  in.Push<int>(/*value=sockfd=*/fds[0]);
+
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestTooManyIovecs, &in, &out));
+  ASSERT_THAT(out, SizeIs(5));
+  EXPECT_THAT(out.next<int64_t>(), Eq(-1));
+  EXPECT_THAT(out.next<int>(), Eq(EINVAL));
+  EXPECT_THAT(out.next<int64_t>(), Eq(-1));
+  EXPECT_THAT(out.next<int>(), Eq(EMSGSIZE));
+  EXPECT_THAT(out.next<int>(), Eq(1));
+
+  // Only the first message of the batch was sent.
+  char buffer[8];
+  EXPECT_THAT(recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT), Eq(1));
+  EXPECT_THAT(recv(fds[1], buffer, sizeof(buffer), MSG_DONTWAIT), Eq(-1));
+}
+
+// Tests the futex policy of slot rings inside the enclave by draining a ring in
+// untrusted memory from the enclave while the host fills it, pausing now and
+// then so that the enclave sleeps on the futex.
+TEST_F(HostCallTest, TestSlotRingPop) {
+  constexpr int64_t kCount = 100;
+  auto ring =
+      absl::make_unique<SpscRing<int64_t, kTestSlotRingCapacity, SysFutex>>();
+  std::thread producer([&ring] {
+    for (int64_t i = 1; i <= kCount; ++i) {
+      if (i % 10 == 0) {
+        absl::SleepFor(absl::Milliseconds(10));
+      }
+      ring->Push(i);
+    }
+    ring->Close();
+  });
+
+  MessageWriter in;
+  in.Push<uint64_t>(reinterpret_cast<uint64_t>(ring.get()));
+  MessageReader out;
+  Status status = client_->EnclaveCall(kTestSlotRingPop, &in, &out);
+  // Unblocks the producer if the enclave stopped popping early.
+  ring->Close();
+  producer.join();
+
+  ASYLO_ASSERT_OK(status);
+  ASSERT_THAT(out, SizeIs(2));
+  EXPECT_THAT(out.next<int64_t>(), Eq(kCount));
+  EXPECT_THAT(out.next<int64_t>(), Eq(kCount * (kCount + 1) / 2));
+}
+
+// Tests enc_untrusted_recvmmsg() by queuing two datagrams and receiving them
+// from inside the enclave in one host call into scattered buffers.
+TEST_F(HostCallTest, TestRecvMmsg) {
+  int fds[2];
+  ASSERT_THAT(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), Eq(0));
+  platform::storage::FdCloser sender_closer(fds[0]);
+  platform::storage::FdCloser receiver_closer(fds[1]);
+
+  std::vector<std::string> datagrams = {"0123456789abcdef", "short"};
+  for (const std::string &datagram : datagrams) {
+    ASSERT_THAT(send(fds[0], datagram.data(), datagram.size(), 0),
+                Eq(datagram.size()));
+  }
+
+  MessageWriter in;
+  in.Push<int>(/*value=sockfd=*/fds[1]);
+  in.Push<size_t>(/*value=vlen=*/4);
+  in.Push<size_t>(/*value=buffer_size=*/10);
+  in.Push<int>(/*value=flags=*/MSG_DONTWAIT);
+
+  MessageReader out;
+  ASYLO_ASSERT_OK(client_->EnclaveCall(kTestRecvMmsg, &in, &out));
+  ASSERT_THAT(out, SizeIs(1 + datagrams.size()));
+  EXPECT_THAT(out.next<int>(), Eq(datagrams.size()));
+  for (const std::string &datagram : datagrams) {
+    auto received = out.next();
+    EXPECT_THAT(std::string(received.As<char>(), received.size()),
+                Eq(datagram));
+  }
+}
+
 // Tests enc_untrusted_symlink() by attempting to create a symlink from inside
 // the enclave and verifying that the created symlink is accessible.
 TEST_F(HostCallTest, TestSymlink) {
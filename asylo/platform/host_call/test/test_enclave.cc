@@ -24,12 +24,17 @@
 #include <sys/un.h>
 #include <sys/wait.h>
 
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/base/macros.h"
+#include "asylo/platform/common/slot_ring.h"
 #include "asylo/platform/host_call/test/enclave_test_selectors.h"
 #include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/host_call/trusted/untrusted_futex.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/trusted_runtime.h"
@@ -396,6 +401,175 @@ PrimitiveStatus TestRecvMsg(void *context, MessageReader *in,
   msg.msg_iov = msg_iov;
   msg.msg_iovlen = 2;
   out->Push<int64_t>(enc_untrusted_recvmsg(sockfd, &msg, flags));
+  out->PushByCopy(Extent{msg1_buffer.get(), static_cast<size_t>(msg1_size)});
+  out->PushByCopy(Extent{msg2_buffer.get(), static_cast<size_t>(msg2_size)});
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestWritev(void *context, MessageReader *in,
+                           MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+
+  int fd = in->next<int>();
+  const auto buf1 = in->next();
+  const auto buf2 = in->next();
+
+  struct iovec iov[2];
+  iov[0].iov_base = const_cast<char *>(buf1.As<char>());
+  iov[0].iov_len = buf1.size();
+  iov[1].iov_base = const_cast<char *>(buf2.As<char>());
+  iov[1].iov_len = buf2.size();
+  out->Push<int64_t>(enc_untrusted_writev(fd, iov, 2));
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestReadv(void *context, MessageReader *in,
+                          MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 3);
+
+  int fd = in->next<int>();
+  size_t buf1_size = in->next<size_t>();
+  size_t buf2_size = in->next<size_t>();
+
+  std::unique_ptr<char[]> buf1(new char[buf1_size]);
+  std::unique_ptr<char[]> buf2(new char[buf2_size]);
+  struct iovec iov[2];
+  iov[0].iov_base = buf1.get();
+  iov[0].iov_len = buf1_size;
+  iov[1].iov_base = buf2.get();
+  iov[1].iov_len = buf2_size;
+  out->Push<int64_t>(enc_untrusted_readv(fd, iov, 2));
+  out->PushByCopy(Extent{buf1.get(), buf1_size});
+  out->PushByCopy(Extent{buf2.get(), buf2_size});
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestSendMmsg(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*in, 2);
+
+  // Sends each of the remaining extents as a datagram.
+  int sockfd = in->next<int>();
+  size_t vlen = in->size() - 1;
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<struct iovec> msg_iovs(vlen);
+  for (size_t i = 0; i < vlen; ++i) {
+    const auto datagram = in->next();
+    msg_iovs[i].iov_base = const_cast<char *>(datagram.As<char>());
+    msg_iovs[i].iov_len = datagram.size();
+    memset(&msgvec[i].msg_hdr, 0, sizeof(msgvec[i].msg_hdr));
+    msgvec[i].msg_hdr.msg_iov = &msg_iovs[i];
+    msgvec[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int result = enc_untrusted_sendmmsg(sockfd, msgvec.data(), vlen, 0);
+  out->Push<int>(result);
+  for (int i = 0; i < result; ++i) {
+    out->Push<unsigned int>(msgvec[i].msg_len);
+  }
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestRecvMmsg(void *context, MessageReader *in,
+                             MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 4);
+
+  int sockfd = in->next<int>();
+  size_t vlen = in->next<size_t>();
+  size_t buffer_size = in->next<size_t>();
+  int flags = in->next<int>();
+
+  // Receives each datagram into two buffers of |buffer_size| bytes.
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<struct iovec> msg_iovs(2 * vlen);
+  std::vector<std::unique_ptr<char[]>> buffers(2 * vlen);
+  for (size_t i = 0; i < vlen; ++i) {
+    for (size_t j = 2 * i; j < 2 * i + 2; ++j) {
+      buffers[j].reset(new char[buffer_size]);
+      msg_iovs[j].iov_base = buffers[j].get();
+      msg_iovs[j].iov_len = buffer_size;
+    }
+    memset(&msgvec[i].msg_hdr, 0, sizeof(msgvec[i].msg_hdr));
+    msgvec[i].msg_hdr.msg_iov = &msg_iovs[2 * i];
+    msgvec[i].msg_hdr.msg_iovlen = 2;
+  }
+
+  int result =
+      enc_untrusted_recvmmsg(sockfd, msgvec.data(), vlen, flags, nullptr);
+  out->Push<int>(result);
+  for (int i = 0; i < result; ++i) {
+    // Push the datagram reassembled from its buffers.
+    std::string datagram(buffers[2 * i].get(),
+                         std::min<size_t>(msgvec[i].msg_len, buffer_size));
+    if (msgvec[i].msg_len > buffer_size) {
+      datagram.append(buffers[2 * i + 1].get(),
+                      msgvec[i].msg_len - buffer_size);
+    }
+    out->PushByCopy(Extent{datagram.data(), datagram.size()});
+  }
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestTooManyIovecs(void *context, MessageReader *in,
+                                  MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+
+  int sockfd = in->next<int>();
+
+  // One more buffer than Linux takes in a single call (IOV_MAX).
+  constexpr size_t kTooManyIovecs = 1025;
+  char byte = 'x';
+  std::vector<struct iovec> iov(kTooManyIovecs, iovec{&byte, 1});
+
+  out->Push<int64_t>(enc_untrusted_writev(sockfd, iov.data(), iov.size()));
+  out->Push<int>(TokLinuxErrorNumber(errno));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov.data();
+  msg.msg_iovlen = iov.size();
+  out->Push<int64_t>(enc_untrusted_sendmsg(sockfd, &msg, /*flags=*/0));
+  out->Push<int>(TokLinuxErrorNumber(errno));
+
+  // A batch is cut short before the first message with too many buffers.
+  struct mmsghdr msgvec[2];
+  memset(msgvec, 0, sizeof(msgvec));
+  msgvec[0].msg_hdr.msg_iov = iov.data();
+  msgvec[0].msg_hdr.msg_iovlen = 1;
+  msgvec[1].msg_hdr = msg;
+  out->Push<int>(enc_untrusted_sendmmsg(sockfd, msgvec, 2, /*flags=*/0));
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus TestSlotRingPop(void *context, MessageReader *in,
+                                MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+
+  // The ring lies in untrusted memory, and is filled by the host, which sleeps
+  // and wakes through its own futex policy.
+  using Ring = SpscRing<int64_t, kTestSlotRingCapacity, UntrustedFutex>;
+  auto *ring = reinterpret_cast<Ring *>(in->next<uint64_t>());
+  if (!TrustedPrimitives::IsOutsideEnclave(ring, sizeof(*ring)) ||
+      ring->InstanceVersion() != Ring::TypeVersion()) {
+    return PrimitiveStatus{error::GoogleError::INVALID_ARGUMENT,
+                           "Unexpected slot ring"};
+  }
+
+  int64_t count = 0;
+  int64_t sum = 0;
+  int64_t value;
+  while (ring->Pop(&value)) {
+    ++count;
+    sum += value;
+  }
+  out->Push(count);
+  out->Push(sum);
 
   return primitives::PrimitiveStatus::OkStatus();
 }
@@ -1249,6 +1423,23 @@ extern "C" PrimitiveStatus asylo_enclave_init() {
   ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
       asylo::host_call::kTestFXattr,
       EntryHandler{asylo::host_call::TestFXattr}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestWritev,
+      EntryHandler{asylo::host_call::TestWritev}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestReadv, EntryHandler{asylo::host_call::TestReadv}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestSendMmsg,
+      EntryHandler{asylo::host_call::TestSendMmsg}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestRecvMmsg,
+      EntryHandler{asylo::host_call::TestRecvMmsg}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestTooManyIovecs,
+      EntryHandler{asylo::host_call::TestTooManyIovecs}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::host_call::kTestSlotRingPop,
+      EntryHandler{asylo::host_call::TestSlotRingPop}));
 
   return PrimitiveStatus::OkStatus();
 }
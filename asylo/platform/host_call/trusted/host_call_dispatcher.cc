@@ -66,6 +66,50 @@ primitives::PrimitiveStatus SystemCallDispatcher(const uint8_t* request_buffer,
   return primitives::PrimitiveStatus::OkStatus();
 }
 
+primitives::PrimitiveStatus SystemCallBatchDispatcher(
+    const primitives::Extent* requests, size_t count,
+    primitives::Extent* responses) {
+  if (count == 0 || requests == nullptr || responses == nullptr) {
+    return primitives::PrimitiveStatus{
+        error::GoogleError::FAILED_PRECONDITION,
+        "Empty or null batch provided. Need valid requests to dispatch the "
+        "host call."};
+  }
+
+  primitives::MessageWriter input;
+  for (size_t i = 0; i < count; ++i) {
+    input.PushByReference(requests[i]);
+  }
+  primitives::MessageReader output;
+  ASYLO_RETURN_IF_ERROR(primitives::TrustedPrimitives::UntrustedCall(
+      kSystemCallBatchHandler, &input, &output));
+
+  // The output should contain exactly one serialized response per request.
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(output, count);
+
+  for (size_t i = 0; i < count; ++i) {
+    responses[i] = primitives::Extent{nullptr, 0};
+  }
+  for (size_t i = 0; i < count; ++i) {
+    auto response = output.next();
+    uint8_t* response_buffer =
+        reinterpret_cast<uint8_t*>(malloc(response.size()));
+    if (!response_buffer) {
+      for (size_t j = 0; j < i; ++j) {
+        free(responses[j].data());
+        responses[j] = primitives::Extent{nullptr, 0};
+      }
+      return primitives::PrimitiveStatus{
+          error::GoogleError::RESOURCE_EXHAUSTED,
+          "Failed to malloc response buffer"};
+    }
+    memcpy(response_buffer, response.data(), response.size());
+    responses[i] = primitives::Extent{response_buffer, response.size()};
+  }
+
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
 primitives::PrimitiveStatus NonSystemCallDispatcher(
     uint64_t exit_selector, primitives::MessageWriter* input,
     primitives::MessageReader* output) {
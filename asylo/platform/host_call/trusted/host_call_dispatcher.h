@@ -23,6 +23,7 @@
 
 #include <cstdint>
 
+#include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/trusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
@@ -43,6 +44,16 @@ primitives::PrimitiveStatus SystemCallDispatcher(const uint8_t* request_buffer,
                                                  uint8_t** response_buffer,
                                                  size_t* response_size);
 
+// Provides the dispatcher used for making batches of system calls in a single
+// host call. This dispatcher is installed as a callback by the |system_call|
+// library. Takes in |count| serialized |requests| and provides |count|
+// serialized |responses| in the same order, each allocated with malloc().
+// Returns ok status when successful, otherwise a status containing the error
+// code and error message when serialization, dispatch or other errors occur.
+primitives::PrimitiveStatus SystemCallBatchDispatcher(
+    const primitives::Extent* requests, size_t count,
+    primitives::Extent* responses);
+
 // Provides a dispatcher to wrap the UntrustedCall function and perform basic
 // validations. Used for host calls which are not implemented using syscalls.
 primitives::PrimitiveStatus NonSystemCallDispatcher(
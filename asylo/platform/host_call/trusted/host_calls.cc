@@ -69,14 +69,45 @@ namespace {
 // getpwuid.
 struct passwd global_passwd;
 
-size_t CalculateTotalMessageSize(const struct msghdr *msg) {
+size_t CalculateTotalMessageSize(const struct iovec *iov, int iovcnt) {
   size_t total_message_size = 0;
-  for (int i = 0; i < msg->msg_iovlen; ++i) {
-    total_message_size += msg->msg_iov[i].iov_len;
+  for (int i = 0; i < iovcnt; ++i) {
+    total_message_size += iov[i].iov_len;
   }
   return total_message_size;
 }
 
+// The largest number of messages sendmmsg() and recvmmsg() transfer in one
+// call, as in Linux (UIO_MAXIOV).
+constexpr unsigned int kMaxMmsgBatchSize = 1024;
+
+// The largest number of buffers writev() and sendmsg() take in one call, as in
+// Linux (IOV_MAX). The host rejects messages with more.
+constexpr size_t kMaxIovecs = 1024;
+
+// Pushes the number of buffers in |iov| followed by each buffer, by reference.
+// The buffers are copied out of the enclave once, when |input| is serialized,
+// and the host gathers them from there.
+void PushIovecs(const struct iovec *iov, int iovcnt, MessageWriter *input) {
+  input->Push<uint64_t>(iovcnt);
+  for (int i = 0; i < iovcnt; ++i) {
+    input->PushByReference(Extent{iov[i].iov_base, iov[i].iov_len});
+  }
+}
+
+// Copies the bytes of |data| into the buffers of |iov| in order, up to their
+// total size.
+void ScatterToIovecs(Extent data, const struct iovec *iov, int iovcnt) {
+  size_t total_bytes = data.size();
+  size_t bytes_copied = 0;
+  for (int i = 0; i < iovcnt && bytes_copied < total_bytes; ++i) {
+    size_t bytes_to_copy =
+        std::min(iov[i].iov_len, total_bytes - bytes_copied);
+    memcpy(iov[i].iov_base, data.As<char>() + bytes_copied, bytes_to_copy);
+    bytes_copied += bytes_to_copy;
+  }
+}
+
 #define PASSWD_HOLDER_FIELD_LENGTH 1024
 
 // Struct for storing the buffers needed by struct passwd members.
@@ -762,93 +793,224 @@ int enc_untrusted_connect(int sockfd, const struct sockaddr *addr,
 }
 
 ssize_t enc_untrusted_sendmsg(int sockfd, const struct msghdr *msg, int flags) {
-  size_t total_message_size = CalculateTotalMessageSize(msg);
-  std::unique_ptr<char[]> msg_iov_buffer(new char[total_message_size]);
-  size_t copied_bytes = 0;
-  for (int i = 0; i < msg->msg_iovlen; ++i) {
-    memcpy(msg_iov_buffer.get() + copied_bytes, msg->msg_iov[i].iov_base,
-           msg->msg_iov[i].iov_len);
-    copied_bytes += msg->msg_iov[i].iov_len;
+  // Sent as a batch of one message, whose length is the number of characters
+  // sent.
+  struct mmsghdr mmsg;
+  mmsg.msg_hdr = *msg;
+  mmsg.msg_len = 0;
+  int result = enc_untrusted_sendmmsg(sockfd, &mmsg, 1, flags);
+  return result == 1 ? mmsg.msg_len : result;
+}
+
+ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
+  // Received as a batch of one message, whose length is the number of
+  // characters received.
+  struct mmsghdr mmsg;
+  mmsg.msg_hdr = *msg;
+  mmsg.msg_len = 0;
+  int result = enc_untrusted_recvmmsg(sockfd, &mmsg, 1, flags,
+                                      /*timeout=*/nullptr);
+  if (result != 1) {
+    return result;
+  }
+  *msg = mmsg.msg_hdr;
+  return mmsg.msg_len;
+}
+
+ssize_t enc_untrusted_writev(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0 || static_cast<size_t>(iovcnt) > kMaxIovecs) {
+    errno = EINVAL;
+    return -1;
   }
 
+  MessageWriter input;
+  input.Push(fd);
+  PushIovecs(iov, iovcnt, &input);
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kWritevHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_writev", 2);
+
+  ssize_t result = output.next<ssize_t>();
+  int klinux_errno = output.next<int>();
+  if (result == -1) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+  }
+  return result;
+}
+
+ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size_t total_buffer_size = CalculateTotalMessageSize(iov, iovcnt);
+  MessageWriter input;
+  input.Push(fd);
+  input.Push<uint64_t>(total_buffer_size);
+  MessageReader output;
+
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kReadvHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_readv", 2,
+                           /*match_exact_params=*/false);
+
+  ssize_t result = output.next<ssize_t>();
+  int klinux_errno = output.next<int>();
+  if (result == -1) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+    return -1;
+  }
+  if (result == 0) {
+    return 0;
+  }
+
+  if (output.size() != 3) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_readv: data missing from the response.");
+  }
+  Extent data = output.next();
+  if (static_cast<size_t>(result) > total_buffer_size ||
+      data.size() != static_cast<size_t>(result)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_readv: data in the response does not match the "
+        "result.");
+  }
+  ScatterToIovecs(data, iov, iovcnt);
+  return result;
+}
+
+int enc_untrusted_sendmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags) {
+  vlen = std::min(vlen, kMaxMmsgBatchSize);
+
+  // As in Linux, a message with too many buffers fails the call if it is the
+  // first one, and otherwise ends the batch before it.
+  for (unsigned int i = 0; i < vlen; ++i) {
+    if (msgvec[i].msg_hdr.msg_iovlen > kMaxIovecs) {
+      if (i == 0) {
+        errno = EMSGSIZE;
+        return -1;
+      }
+      vlen = i;
+    }
+  }
+
+  // The whole batch is sent in a single exit. Each message is pushed as its
+  // name, its buffers as pushed by PushIovecs(), its control data and its
+  // flags.
   MessageWriter input;
   input.Push(sockfd);
-  input.PushByReference(Extent{msg->msg_name, msg->msg_namelen});
-  input.PushByReference(Extent{msg_iov_buffer.get(), total_message_size});
-  input.PushByReference(Extent{msg->msg_control, msg->msg_controllen});
-  input.Push(msg->msg_flags);
+  input.Push<uint64_t>(vlen);
   input.Push(flags);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    const struct msghdr *msg = &msgvec[i].msg_hdr;
+    input.PushByReference(Extent{msg->msg_name, msg->msg_namelen});
+    PushIovecs(msg->msg_iov, msg->msg_iovlen, &input);
+    input.PushByReference(Extent{msg->msg_control, msg->msg_controllen});
+    input.Push(msg->msg_flags);
+  }
   MessageReader output;
 
   const auto status = NonSystemCallDispatcher(
       ::asylo::host_call::kSendMsgHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_sendmsg", 2);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_sendmmsg", 2,
+                           /*match_exact_params=*/false);
 
-  ssize_t result = output.next<ssize_t>();
+  int result = output.next<int>();
   int klinux_errno = output.next<int>();
-  // sendmsg() returns the number of characters sent. On error, -1 is returned,
+  // sendmmsg() returns the number of messages sent. On error, -1 is returned,
   // with errno set to indicate the cause of the error.
   if (result == -1) {
     errno = FromkLinuxErrorNumber(klinux_errno);
+    return -1;
+  }
+  if (result < 0 || static_cast<unsigned int>(result) > vlen ||
+      output.size() != 2 + static_cast<size_t>(result)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_sendmmsg: response does not match the messages sent.");
+  }
+  for (int i = 0; i < result; ++i) {
+    msgvec[i].msg_len = output.next<unsigned int>();
   }
   return result;
 }
 
-ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags) {
-  size_t total_buffer_size = CalculateTotalMessageSize(msg);
+int enc_untrusted_recvmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags,
+                           struct timespec *timeout) {
+  vlen = std::min(vlen, kMaxMmsgBatchSize);
 
+  // Each message is pushed as the sizes of its name, of its buffers and of its
+  // control data, which the host allocates.
   MessageWriter input;
   input.Push(sockfd);
-  input.Push<uint64_t>(msg->msg_namelen);
-  input.Push<uint64_t>(total_buffer_size);
-  input.Push<uint64_t>(msg->msg_controllen);
-  input.Push(msg->msg_flags);
+  input.Push<uint64_t>(vlen);
   input.Push(flags);
-
+  if (timeout) {
+    struct kLinux_timespec klinux_timeout;
+    TokLinuxtimespec(timeout, &klinux_timeout);
+    input.Push(klinux_timeout);
+  } else {
+    input.PushByReference(Extent{nullptr, 0});
+  }
+  for (unsigned int i = 0; i < vlen; ++i) {
+    const struct msghdr *msg = &msgvec[i].msg_hdr;
+    input.Push<uint64_t>(msg->msg_namelen);
+    input.Push<uint64_t>(
+        CalculateTotalMessageSize(msg->msg_iov, msg->msg_iovlen));
+    input.Push<uint64_t>(msg->msg_controllen);
+  }
   MessageReader output;
 
   const auto status = NonSystemCallDispatcher(
       ::asylo::host_call::kRecvMsgHandler, &input, &output);
-  CheckStatusAndParamCount(status, output, "enc_untrusted_recvmsg", 2,
+  CheckStatusAndParamCount(status, output, "enc_untrusted_recvmmsg", 2,
                            /*match_exact_params=*/false);
 
-  ssize_t result = output.next<ssize_t>();
+  int result = output.next<int>();
   int klinux_errno = output.next<int>();
-
-  // recvmsg() returns the number of characters received. On error, -1 is
+  // recvmmsg() returns the number of messages received. On error, -1 is
   // returned, with errno set to indicate the cause of the error.
   if (result == -1) {
     errno = FromkLinuxErrorNumber(klinux_errno);
-    return result;
+    return -1;
   }
 
-  auto msg_name_extent = output.next();
-  // The returned |msg_namelen| should not exceed the buffer size.
-  if (msg_name_extent.size() <= msg->msg_namelen) {
-    msg->msg_namelen = msg_name_extent.size();
+  // Each received message is returned as its length, its name, its data, its
+  // control data and its flags.
+  constexpr size_t kItemsPerMessage = 5;
+  if (result < 0 || static_cast<unsigned int>(result) > vlen ||
+      output.size() != 2 + kItemsPerMessage * result) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_recvmmsg: response does not match the messages "
+        "received.");
   }
-  memcpy(msg->msg_name, msg_name_extent.As<char>(), msg->msg_namelen);
+  for (int i = 0; i < result; ++i) {
+    struct msghdr *msg = &msgvec[i].msg_hdr;
+    msgvec[i].msg_len = output.next<unsigned int>();
 
-  // A single buffer is passed from the untrusted side, copy it into the
-  // scattered buffers inside the enclave.
-  auto msg_iov_extent = output.next();
-  size_t total_bytes = msg_iov_extent.size();
-  size_t bytes_copied = 0;
-  for (int i = 0; i < msg->msg_iovlen && bytes_copied < total_bytes; ++i) {
-    size_t bytes_to_copy =
-        std::min(msg->msg_iov[i].iov_len, total_bytes - bytes_copied);
-    memcpy(msg->msg_iov[i].iov_base, msg_iov_extent.As<char>() + bytes_copied,
-           bytes_to_copy);
-    bytes_copied += bytes_to_copy;
-  }
+    auto msg_name_extent = output.next();
+    // The returned |msg_namelen| should not exceed the buffer size.
+    if (msg_name_extent.size() <= msg->msg_namelen) {
+      msg->msg_namelen = msg_name_extent.size();
+    }
+    memcpy(msg->msg_name, msg_name_extent.As<char>(), msg->msg_namelen);
 
-  auto msg_control_extent = output.next();
-  // The returned |msg_controllen| should not exceed the buffer size.
-  if (msg_control_extent.size() <= msg->msg_controllen) {
-    msg->msg_controllen = msg_control_extent.size();
-  }
-  memcpy(msg->msg_control, msg_control_extent.As<char>(), msg->msg_controllen);
+    ScatterToIovecs(output.next(), msg->msg_iov, msg->msg_iovlen);
+
+    auto msg_control_extent = output.next();
+    // The returned |msg_controllen| should not exceed the buffer size.
+    if (msg_control_extent.size() <= msg->msg_controllen) {
+      msg->msg_controllen = msg_control_extent.size();
+    }
+    memcpy(msg->msg_control, msg_control_extent.As<char>(),
+           msg->msg_controllen);
 
+    msg->msg_flags = output.next<int>();
+  }
   return result;
 }
 
@@ -1420,27 +1582,49 @@ int enc_untrusted_epoll_wait(int epfd, struct epoll_event *events,
     errno = EINVAL;
     return -1;
   }
-  auto klinux_events =
-      absl::make_unique<struct klinux_epoll_event[]>(maxevents);
 
-  int result = EnsureInitializedAndDispatchSyscall(
-      asylo::system_call::kSYS_epoll_wait, epfd, klinux_events.get(), maxevents,
-      timeout);
+  MessageWriter input;
+  MessageReader output;
+  input.Push<int>(epfd);
+  input.Push<int>(maxevents);
+  input.Push<int>(timeout);
+  const auto status = NonSystemCallDispatcher(
+      ::asylo::host_call::kEpollWaitHandler, &input, &output);
+  CheckStatusAndParamCount(status, output, "enc_untrusted_epoll_wait", 2,
+                           /*match_exact_params=*/false);
 
-  // Only process epoll events if syscall was successful.
-  if (result == -1) {
-    // errno is already set by the system_call library at this point for a
-    // return value of -1.
-    return result;
+  int result = output.next<int>();
+  int klinux_errno = output.next<int>();
+  if (result < 0) {
+    errno = FromkLinuxErrorNumber(klinux_errno);
+    return -1;
   }
   if (result > maxevents) {
     TrustedPrimitives::BestEffortAbort(
         "enc_untrusted_epoll_wait: result found to be greater than maxevents "
         "supplied.");
   }
+  if (result == 0) {
+    return 0;
+  }
+
+  if (output.size() != 3) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_epoll_wait: events missing from the response.");
+  }
+  Extent klinux_events = output.next();
+  if (klinux_events.size() != result * sizeof(struct klinux_epoll_event)) {
+    TrustedPrimitives::BestEffortAbort(
+        "enc_untrusted_epoll_wait: events in the response do not match the "
+        "result.");
+  }
 
+  // Convert the events straight out of the response into the caller's buffer,
+  // rather than through an intermediate kernel-format array.
+  const auto *klinux_event =
+      reinterpret_cast<const struct klinux_epoll_event *>(klinux_events.data());
   for (int i = 0; i < result; i++) {
-    if (!FromkLinuxEpollEvent(&klinux_events.get()[i], &events[i])) {
+    if (!FromkLinuxEpollEvent(&klinux_event[i], &events[i])) {
       errno = EBADE;
       return -1;
     }
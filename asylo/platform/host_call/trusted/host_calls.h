@@ -31,6 +31,7 @@
 #include <sched.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <cstdarg>
 #include <cstddef>
@@ -55,6 +56,24 @@ int64_t EnsureInitializedAndDispatchSyscall(int sysno, Ts... args) {
   return enc_untrusted_syscall(sysno, args...);
 }
 
+// Ensures that the host call library is initialized, then dispatches the batch
+// of system calls in |entries| to enc_untrusted_syscall_batch.
+inline void EnsureInitializedAndDispatchSyscallBatch(
+    SystemCallBatchEntry *entries, size_t count) {
+  if (!enc_is_syscall_dispatcher_set()) {
+    enc_set_dispatch_syscall(asylo::host_call::SystemCallDispatcher);
+  }
+  if (!enc_is_syscall_batch_dispatcher_set()) {
+    enc_set_dispatch_syscall_batch(
+        asylo::host_call::SystemCallBatchDispatcher);
+  }
+  if (!enc_is_error_handler_set()) {
+    enc_set_error_handler(
+        asylo::primitives::TrustedPrimitives::BestEffortAbort);
+  }
+  enc_untrusted_syscall_batch(entries, count);
+}
+
 // Verifies the return status of the host call and checks if the expected number
 // of parameters are received on the MessageReader.
 void CheckStatusAndParamCount(const asylo::primitives::PrimitiveStatus &status,
@@ -169,6 +188,13 @@ void *enc_untrusted_realloc(void *ptr, size_t size);
 uint32_t enc_untrusted_sleep(uint32_t seconds);
 ssize_t enc_untrusted_sendmsg(int sockfd, const struct msghdr *msg, int flags);
 ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg, int flags);
+ssize_t enc_untrusted_writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt);
+int enc_untrusted_sendmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags);
+int enc_untrusted_recvmmsg(int sockfd, struct mmsghdr *msgvec,
+                           unsigned int vlen, int flags,
+                           struct timespec *timeout);
 int enc_untrusted_getsockname(int sockfd, struct sockaddr *addr,
                               socklen_t *addrlen);
 int enc_untrusted_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
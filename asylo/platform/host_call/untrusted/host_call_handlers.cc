@@ -23,20 +23,29 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netdb.h>
+#include <poll.h>
 #include <pwd.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <syslog.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <climits>
 #include <cstdint>
 #include <ctime>
+#include <utility>
+#include <vector>
 
 #include "asylo/platform/common/memory.h"
 #include "asylo/platform/host_call/serializer_functions.h"
 #include "asylo/platform/host_call/untrusted/host_call_handlers_util.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
+#include "asylo/platform/system_call/message.h"
 #include "asylo/platform/system_call/untrusted_invoke.h"
 #include "asylo/util/hex_util.h"
 #include "asylo/util/status_macros.h"
@@ -47,6 +56,38 @@ namespace {
 
 using primitives::Extent;
 
+// The number of bytes of inotify events that InotifyReadHandler() drains from
+// the host in one call, room for at least 64 events with the longest names.
+constexpr size_t kInotifyDrainSize =
+    64 * (sizeof(struct inotify_event) + NAME_MAX + 1);
+
+// An upper bound of buffer size for name/control to avoid allocating memory
+// for a non-initialized random size.
+constexpr size_t kMaxBufferSize = 1024;
+
+// Reads the buffers pushed by PushIovecs() in the enclave from |input| into
+// |iov|, which points directly into the message. Expects at least |trailing|
+// items to follow the buffers on |input|.
+Status NextIovecs(primitives::MessageReader *input, size_t trailing,
+                  std::vector<struct iovec> *iov) {
+  if (input->remaining() < 1 + trailing) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Too few items on the MessageReader.");
+  }
+  uint64_t iovcnt = input->next<uint64_t>();
+  if (iovcnt > IOV_MAX || input->remaining() < iovcnt + trailing) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Unexpected number of buffers on the MessageReader.");
+  }
+  iov->resize(iovcnt);
+  for (struct iovec &buffer : *iov) {
+    auto extent = input->next();
+    buffer.iov_base = extent.As<char>();
+    buffer.iov_len = extent.size();
+  }
+  return Status::OkStatus();
+}
+
 void untrusted_abort_handler(const char *message) {
   fputs(message, stderr);
   abort();
@@ -66,8 +107,45 @@ Status SystemCallHandler(const std::shared_ptr<primitives::Client> &client,
   if (!status.ok()) {
     return primitives::MakeStatus(status);
   }
-  output->PushByCopy(response);
-  free(response.data());
+  // The response is allocated with malloc() by UntrustedInvoke; hand it to
+  // |output| rather than copying it.
+  output->PushMallocated(response);
+
+  return Status::OkStatus();
+}
+
+Status SystemCallBatchHandler(const std::shared_ptr<primitives::Client> &client,
+                              void *context, primitives::MessageReader *input,
+                              primitives::MessageWriter *output) {
+  if (input->empty()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "At least one system call request expected on the "
+                  "MessageReader.");
+  }
+
+  // Validate the whole batch first so that a malformed request does not leave
+  // the batch partially executed.
+  std::vector<Extent> requests;
+  requests.reserve(input->size());
+  while (input->hasNext()) {
+    Extent request = input->next();
+    primitives::PrimitiveStatus status =
+        system_call::MessageReader(request).Validate();
+    if (!status.ok()) {
+      return primitives::MakeStatus(status);
+    }
+    requests.push_back(request);
+  }
+
+  for (Extent request : requests) {
+    Extent response;  // To be owned by |output|.
+    primitives::PrimitiveStatus status =
+        system_call::UntrustedInvoke(request, &response);
+    if (!status.ok()) {
+      return primitives::MakeStatus(status);
+    }
+    output->PushMallocated(response);
+  }
 
   return Status::OkStatus();
 }
@@ -131,88 +209,115 @@ Status SleepHandler(const std::shared_ptr<primitives::Client> &client,
 Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output) {
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 6);
-  struct msghdr msg;
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 3);
   int sockfd = input->next<int>();
+  uint64_t vlen = input->next<uint64_t>();
+  int flags = input->next<int>();
+  if (vlen > UIO_MAXIOV) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Too many messages on the MessageReader.");
+  }
 
-  auto msg_name_extent = input->next();
-  msg.msg_name = msg_name_extent.As<char>();
-  msg.msg_namelen = msg_name_extent.size();
-
-  auto msg_iov_extent = input->next();
-  // The message is serialized into a single buffer on the trusted side.
-  struct iovec msg_iov[1];
-  memset(msg_iov, 0, sizeof(*msg_iov));
-  msg_iov[0].iov_base = msg_iov_extent.As<char>();
-  msg_iov[0].iov_len = msg_iov_extent.size();
-  msg.msg_iov = msg_iov;
-  msg.msg_iovlen = 1;
-
-  auto msg_control_extent = input->next();
-  msg.msg_control = msg_control_extent.As<char>();
-  msg.msg_controllen = msg_control_extent.size();
-
-  msg.msg_flags = input->next<int>();
+  // The buffers of every message point into the deserialized message.
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<std::vector<struct iovec>> msg_iovs(vlen);
+  for (uint64_t i = 0; i < vlen; ++i) {
+    struct msghdr *msg = &msgvec[i].msg_hdr;
+    if (input->remaining() < 4) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Too few items on the MessageReader.");
+    }
+    auto msg_name_extent = input->next();
+    msg->msg_name = msg_name_extent.As<char>();
+    msg->msg_namelen = msg_name_extent.size();
+
+    ASYLO_RETURN_IF_ERROR(NextIovecs(input, /*trailing=*/2, &msg_iovs[i]));
+    msg->msg_iov = msg_iovs[i].data();
+    msg->msg_iovlen = msg_iovs[i].size();
+
+    auto msg_control_extent = input->next();
+    msg->msg_control = msg_control_extent.As<char>();
+    msg->msg_controllen = msg_control_extent.size();
+    msg->msg_flags = input->next<int>();
+  }
+  ASYLO_RETURN_IF_READER_HAS_NEXT(*input);
 
-  int flags = input->next<int>();
-  output->Push<int64_t>(sendmsg(sockfd, &msg, flags));  // Push return value.
-  output->Push<int>(errno);                             // Push errno.
+  int result = sendmmsg(sockfd, msgvec.data(), vlen, flags);
+  output->Push<int>(result);
+  output->Push<int>(errno);
+  for (int i = 0; i < result; ++i) {
+    output->Push<unsigned int>(msgvec[i].msg_len);
+  }
   return Status::OkStatus();
 }
 
 Status RecvMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output) {
-  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 6);
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 4);
   int sockfd = input->next<int>();
-
-  // An upper bound of buffer size for name/control to avoid allocating memory
-  // for a non-initialized random size.
-  constexpr size_t kMaxBufferSize = 1024;
-
-  struct msghdr msg;
-  msg.msg_namelen = input->next<uint64_t>();
-  std::unique_ptr<char[]> msg_name_buffer(nullptr);
-  if (msg.msg_namelen > 0 && msg.msg_namelen < kMaxBufferSize) {
-    msg_name_buffer.reset(new char[msg.msg_namelen]);
-  } else {
-    msg.msg_namelen = 0;
+  uint64_t vlen = input->next<uint64_t>();
+  int flags = input->next<int>();
+  auto timeout_extent = input->next();
+  if (vlen > UIO_MAXIOV || input->remaining() != 3 * vlen) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Unexpected number of messages on the MessageReader.");
   }
-  msg.msg_name = msg_name_buffer.get();
-
-  // Receive message in a single buffer, which will be copied into the scattered
-  // buffers once back inside the enclave.
-  msg.msg_iovlen = 1;
-  struct iovec msg_iov[1];
-  memset(msg_iov, 0, sizeof(*msg_iov));
-  msg_iov[0].iov_len = input->next<uint64_t>();
-  std::unique_ptr<char[]> msg_iov_buffer(nullptr);
-  if (msg_iov[0].iov_len > 0) {
-    msg_iov_buffer.reset(new char[msg_iov[0].iov_len]);
+  struct timespec timeout;
+  struct timespec *timeout_ptr = nullptr;
+  if (timeout_extent.size() == sizeof(timeout)) {
+    timeout = *timeout_extent.As<struct timespec>();
+    timeout_ptr = &timeout;
   }
-  msg_iov[0].iov_base = msg_iov_buffer.get();
-  msg.msg_iov = msg_iov;
 
-  msg.msg_controllen = input->next<uint64_t>();
-  std::unique_ptr<char[]> msg_control_buffer(nullptr);
-  if (msg.msg_controllen > 0 && msg.msg_controllen < kMaxBufferSize) {
-    msg_control_buffer.reset(new char[msg.msg_controllen]);
-  } else {
-    msg.msg_controllen = 0;
+  // Each message is received into a single buffer, which is scattered into the
+  // buffers of the caller once back inside the enclave.
+  std::vector<struct mmsghdr> msgvec(vlen);
+  std::vector<struct iovec> msg_iovs(vlen);
+  std::vector<std::unique_ptr<char[]>> msg_names(vlen);
+  std::vector<std::unique_ptr<char[]>> msg_buffers(vlen);
+  std::vector<std::unique_ptr<char[]>> msg_controls(vlen);
+  for (uint64_t i = 0; i < vlen; ++i) {
+    struct msghdr *msg = &msgvec[i].msg_hdr;
+    msg->msg_namelen = input->next<uint64_t>();
+    if (msg->msg_namelen > 0 && msg->msg_namelen < kMaxBufferSize) {
+      msg_names[i] = absl::make_unique<char[]>(msg->msg_namelen);
+    } else {
+      msg->msg_namelen = 0;
+    }
+    msg->msg_name = msg_names[i].get();
+
+    msg_iovs[i].iov_len = input->next<uint64_t>();
+    if (msg_iovs[i].iov_len > 0) {
+      msg_buffers[i] = absl::make_unique<char[]>(msg_iovs[i].iov_len);
+    }
+    msg_iovs[i].iov_base = msg_buffers[i].get();
+    msg->msg_iov = &msg_iovs[i];
+    msg->msg_iovlen = 1;
+
+    msg->msg_controllen = input->next<uint64_t>();
+    if (msg->msg_controllen > 0 && msg->msg_controllen < kMaxBufferSize) {
+      msg_controls[i] = absl::make_unique<char[]>(msg->msg_controllen);
+    } else {
+      msg->msg_controllen = 0;
+    }
+    msg->msg_control = msg_controls[i].get();
   }
-  msg.msg_control = msg_control_buffer.get();
-
-  msg.msg_flags = input->next<int>();
-  int flags = input->next<int>();
-
-  output->Push<int64_t>(recvmsg(sockfd, &msg, flags));  // Push return value.
-  output->Push<int>(errno);                             // Push errno.
-  output->PushByCopy(Extent{msg.msg_name, msg.msg_namelen});  // Push msg name.
-  output->PushByCopy(Extent{msg.msg_iov[0].iov_base,
-                            msg.msg_iov[0].iov_len});  // Push received msg.
-  output->PushByCopy(
-      Extent{msg.msg_control, msg.msg_controllen});  // Push control msg.
 
+  int result = recvmmsg(sockfd, msgvec.data(), vlen, flags, timeout_ptr);
+  output->Push<int>(result);
+  output->Push<int>(errno);
+  for (int i = 0; i < result; ++i) {
+    struct msghdr *msg = &msgvec[i].msg_hdr;
+    output->Push<unsigned int>(msgvec[i].msg_len);
+    output->PushByCopy(Extent{msg->msg_name, msg->msg_namelen});
+    // Hand over the buffer the message was received in.
+    output->PushByOwnership(
+        std::move(msg_buffers[i]),
+        std::min<size_t>(msgvec[i].msg_len, msg_iovs[i].iov_len));
+    output->PushByCopy(Extent{msg->msg_control, msg->msg_controllen});
+    output->Push<int>(msg->msg_flags);
+  }
   return Status::OkStatus();
 }
 
@@ -301,7 +406,7 @@ Status RecvFromHandler(const std::shared_ptr<primitives::Client> &client,
 
   output->Push<int>(ret);
   output->Push<int>(errno);
-  output->PushByCopy(Extent{buffer.get(), len});
+  output->PushByOwnership(std::move(buffer), len);
   output->Push<struct sockaddr_storage>(sock_addr);
 
   return Status::OkStatus();
@@ -528,12 +633,26 @@ Status InotifyReadHandler(const std::shared_ptr<primitives::Client> &client,
   int fd = input->next<int>();
   auto count = input->next<size_t>();
 
-  size_t buf_size =
-      std::max(sizeof(struct inotify_event) + NAME_MAX + 1, count);
+  // Drain as many pending events as fit in the buffer, so that the enclave can
+  // queue the ones beyond |count| for later reads instead of exiting again.
+  // Only the first read may block.
+  constexpr size_t kMaxEventSize = sizeof(struct inotify_event) + NAME_MAX + 1;
+  size_t buf_size = std::max({kMaxEventSize, count, kInotifyDrainSize});
   char *buf = static_cast<char *>(malloc(buf_size));
   asylo::MallocUniquePtr<char> buf_ptr(buf);
 
-  int bytes_read = read(fd, buf, buf_size);
+  ssize_t bytes_read = read(fd, buf, buf_size);
+  while (bytes_read > 0 && buf_size - bytes_read >= kMaxEventSize) {
+    struct pollfd pending = {fd, POLLIN, 0};
+    if (poll(&pending, 1, 0) != 1 || !(pending.revents & POLLIN)) {
+      break;
+    }
+    ssize_t more = read(fd, buf + bytes_read, buf_size - bytes_read);
+    if (more <= 0) {
+      break;
+    }
+    bytes_read += more;
+  }
   char *serialized_events = nullptr;
   size_t serialized_len = 0;
 
@@ -594,5 +713,72 @@ Status LocalLifetimeAllocHandler(
   return Status::OkStatus();
 }
 
+Status EpollWaitHandler(const std::shared_ptr<primitives::Client> &client,
+                        void *context, primitives::MessageReader *input,
+                        primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 3);
+  int epfd = input->next<int>();
+  int maxevents = input->next<int>();
+  int timeout = input->next<int>();
+
+  // Reject the same |maxevents| as the kernel before sizing the buffer by it.
+  if (maxevents <= 0 || maxevents > INT_MAX / sizeof(struct epoll_event)) {
+    output->Push<int>(-1);
+    output->Push<int>(EINVAL);
+    return Status::OkStatus();
+  }
+
+  size_t buffer_size = maxevents * sizeof(struct epoll_event);
+  auto buffer = absl::make_unique<char[]>(buffer_size);
+  int result = epoll_wait(
+      epfd, reinterpret_cast<struct epoll_event *>(buffer.get()), maxevents,
+      timeout);
+  output->Push<int>(result);
+  output->Push<int>(errno);
+  if (result > 0) {
+    // The events are returned as written by the kernel, so the enclave can
+    // convert them directly into the caller's buffer.
+    output->PushByOwnership(std::move(buffer),
+                            result * sizeof(struct epoll_event));
+  }
+  return Status::OkStatus();
+}
+
+Status WritevHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_TOO_FEW_READER_ARGUMENTS(*input, 2);
+  int fd = input->next<int>();
+  std::vector<struct iovec> iov;
+  ASYLO_RETURN_IF_ERROR(NextIovecs(input, /*trailing=*/0, &iov));
+  ASYLO_RETURN_IF_READER_HAS_NEXT(*input);
+
+  output->Push<int64_t>(writev(fd, iov.data(), iov.size()));
+  output->Push<int>(errno);
+  return Status::OkStatus();
+}
+
+Status ReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*input, 2);
+  int fd = input->next<int>();
+  uint64_t size = input->next<uint64_t>();
+
+  // The bytes are read into a single buffer, and scattered into the buffers of
+  // the caller once back inside the enclave.
+  std::unique_ptr<char[]> buffer;
+  if (size > 0) {
+    buffer = absl::make_unique<char[]>(size);
+  }
+  ssize_t result = read(fd, buffer.get(), size);
+  output->Push<int64_t>(result);
+  output->Push<int>(errno);
+  if (result > 0) {
+    output->PushByOwnership(std::move(buffer), result);
+  }
+  return Status::OkStatus();
+}
+
 }  // namespace host_call
 }  // namespace asylo
@@ -37,6 +37,17 @@ Status SystemCallHandler(const std::shared_ptr<primitives::Client> &client,
                          void *context, primitives::MessageReader *input,
                          primitives::MessageWriter *output);
 
+// Handler installed by the host to service a batch of system call requests in
+// a single exit. Expects one serialized system call request per extent on the
+// input MessageReader and pushes one serialized response per request, in
+// order, on the output MessageWriter. All requests are validated before any
+// of them is executed; the system calls are then executed in order, each
+// regardless of the result of the previous ones. Returns ok status on success,
+// otherwise an error if any request is malformed.
+Status SystemCallBatchHandler(const std::shared_ptr<primitives::Client> &client,
+                              void *context, primitives::MessageReader *input,
+                              primitives::MessageWriter *output);
+
 // isatty library call handler on the host; expects [int fd] and returns [int].
 Status IsAttyHandler(const std::shared_ptr<primitives::Client> &client,
                      void *context, primitives::MessageReader *input,
@@ -66,14 +77,21 @@ Status SleepHandler(const std::shared_ptr<primitives::Client> &client,
                     void *context, primitives::MessageReader *input,
                     primitives::MessageWriter *output);
 
-// sendmsg syscall handler on the host; expects [int sockfd, const struct msghdr
-// *msg, int flags] and returns [ssize_t].
+// sendmmsg syscall handler on the host, which also serves sendmsg as a batch of
+// one message; expects [int sockfd, uint64_t vlen, int flags] followed by the
+// name, buffers, control data and flags of each of the |vlen| messages, and
+// returns [int result, int errno] on the MessageWriter, followed by the length
+// of each of the |result| messages sent.
 Status SendMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output);
 
-// recvmsg syscall handler on the host; expects [int sockfd, struct msghdr *msg,
-// int flags] and returns [ssize_t].
+// recvmmsg syscall handler on the host, which also serves recvmsg as a batch of
+// one message; expects [int sockfd, uint64_t vlen, int flags, timeout] followed
+// by the sizes of the name, buffers and control data of each of the |vlen|
+// messages, and returns [int result, int errno] on the MessageWriter, followed
+// by the length, name, data, control data and flags of each of the |result|
+// messages received.
 Status RecvMsgHandler(const std::shared_ptr<primitives::Client> &client,
                       void *context, primitives::MessageReader *input,
                       primitives::MessageWriter *output);
@@ -236,6 +254,28 @@ Status LocalLifetimeAllocHandler(
     const std::shared_ptr<primitives::Client> &client, void *context,
     primitives::MessageReader *input, primitives::MessageWriter *output);
 
+// Handler for host call enc_untrusted_epoll_wait(). Expects [int epfd, int
+// maxevents, int timeout] and returns [int result, int errno] on the
+// MessageWriter, followed by the array of |result| kernel epoll_event structs
+// if |result| is positive.
+Status EpollWaitHandler(const std::shared_ptr<primitives::Client> &client,
+                        void *context, primitives::MessageReader *input,
+                        primitives::MessageWriter *output);
+
+// writev syscall handler on the host; expects [int fd, uint64_t iovcnt]
+// followed by |iovcnt| buffers, and returns [ssize_t result, int errno] on the
+// MessageWriter.
+Status WritevHandler(const std::shared_ptr<primitives::Client> &client,
+                     void *context, primitives::MessageReader *input,
+                     primitives::MessageWriter *output);
+
+// readv syscall handler on the host; expects [int fd, uint64_t size] and
+// returns [ssize_t result, int errno] on the MessageWriter, followed by the
+// |result| bytes read if |result| is positive.
+Status ReadvHandler(const std::shared_ptr<primitives::Client> &client,
+                    void *context, primitives::MessageReader *input,
+                    primitives::MessageWriter *output);
+
 }  // namespace host_call
 }  // namespace asylo
 
@@ -31,6 +31,10 @@ Status AddHostCallHandlersToExitCallProvider(
   ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
       kSystemCallHandler, primitives::ExitHandler{SystemCallHandler}));
 
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kSystemCallBatchHandler,
+      primitives::ExitHandler{SystemCallBatchHandler}));
+
   ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
       kIsAttyHandler, primitives::ExitHandler{IsAttyHandler}));
 
@@ -119,6 +123,15 @@ Status AddHostCallHandlersToExitCallProvider(
       kLocalLifetimeAllocHandler,
       primitives::ExitHandler{LocalLifetimeAllocHandler}));
 
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kEpollWaitHandler, primitives::ExitHandler{EpollWaitHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kWritevHandler, primitives::ExitHandler{WritevHandler}));
+
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kReadvHandler, primitives::ExitHandler{ReadvHandler}));
+
   return Status::OkStatus();
 }
 
@@ -18,9 +18,16 @@
 
 #include "asylo/platform/host_call/untrusted/host_call_handlers.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
 #include <sys/syscall.h>
+#include <unistd.h>
 
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <functional>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -134,6 +141,89 @@ TEST(HostCallHandlersTest, SyscallHandlerInvalidRequestTest) {
   EXPECT_THAT(output, IsEmpty());
 }
 
+// Serializes a request for |sysno| with |request_params| and pushes a copy of
+// it onto |params|.
+void PushRequest(
+    int sysno,
+    const std::array<uint64_t, system_call::kParameterMax> &request_params,
+    MessageWriter *params) {
+  primitives::Extent request;  // To be allocated by Serialize.
+  ASSERT_THAT(primitives::MakeStatus(system_call::SerializeRequest(
+                  sysno, request_params, &request)),
+              IsOk());
+  params->PushByCopy(request);
+  free(request.data());
+}
+
+TEST(HostCallHandlersTest, SyscallBatchHandlerEmptyMessageTest) {
+  MessageReader empty_input;
+  MessageWriter empty_output;
+  EXPECT_THAT(
+      SystemCallBatchHandler(nullptr, nullptr, &empty_input, &empty_output),
+      StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(empty_output, IsEmpty());
+}
+
+// Invokes a batch host call with a succeeding and a failing request, and
+// verifies that each gets its own response, and the failing one its errno.
+TEST(HostCallHandlersTest, SyscallBatchHandlerValidRequestsTest) {
+  std::array<uint64_t, system_call::kParameterMax> getpid_params = {};
+  std::array<uint64_t, system_call::kParameterMax> close_params = {};
+  close_params[0] = static_cast<uint64_t>(-1);
+  MessageReader input;
+  FillInput(
+      [&](MessageWriter *params) {
+        PushRequest(SYS_getpid, getpid_params, params);
+        PushRequest(SYS_close, close_params, params);
+      },
+      &input);
+  MessageWriter output;
+  ASSERT_THAT(SystemCallBatchHandler(nullptr, nullptr, &input, &output),
+              IsOk());
+  VerifyOutput(
+      [&](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(2));
+        uint64_t result;
+        uint64_t error_number;
+        ASYLO_ASSERT_OK(primitives::MakeStatus(system_call::DeserializeResponse(
+            SYS_getpid, getpid_params, results->next(), &result,
+            &error_number)));
+        EXPECT_EQ(result, getpid());
+        ASYLO_ASSERT_OK(primitives::MakeStatus(system_call::DeserializeResponse(
+            SYS_close, close_params, results->next(), &result,
+            &error_number)));
+        EXPECT_EQ(static_cast<int64_t>(result), -1);
+        EXPECT_EQ(error_number, EBADF);
+      },
+      &output);
+}
+
+// Invokes a batch host call whose second request is malformed, and verifies
+// that the batch is rejected before the valid first request is executed.
+TEST(HostCallHandlersTest, SyscallBatchHandlerMalformedRequestTest) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::array<uint64_t, system_call::kParameterMax> close_params = {};
+  close_params[0] = fds[0];
+  const char garbage[] = "not a system call request";
+  MessageReader input;
+  FillInput(
+      [&](MessageWriter *params) {
+        PushRequest(SYS_close, close_params, params);
+        params->PushByCopy(primitives::Extent{garbage, sizeof(garbage)});
+      },
+      &input);
+  MessageWriter output;
+  EXPECT_THAT(SystemCallBatchHandler(nullptr, nullptr, &input, &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(output, IsEmpty());
+
+  // The close() request ran only if its descriptor is gone.
+  EXPECT_NE(fcntl(fds[0], F_GETFD), -1);
+  close(fds[0]);
+  close(fds[1]);
+}
+
 // Invokes an IsAtty hostcall for an invalid request. It tests that the correct
 // error is returned for an empty input or for an input with more than one item.
 TEST(HostCallHandlersTest, IsAttyIncorrectSizeTest) {
@@ -206,6 +296,118 @@ TEST(HostCallHandlersTest, USleepValidRequestTest) {
       &output);
 }
 
+// Invokes a SendMsg hostcall with a batch of two datagrams, and verifies that
+// both are sent in one call and that the length of each is returned.
+TEST(HostCallHandlersTest, SendMsgSendsBatchTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), 0);
+  const std::string first = "first";
+  const std::string second = "second datagram";
+
+  MessageReader input;
+  FillInput(
+      [&](MessageWriter *params) {
+        params->Push(fds[0]);
+        params->Push<uint64_t>(2);  // vlen.
+        params->Push(0);            // flags.
+        for (const std::string *data : {&first, &second}) {
+          params->PushByCopy(primitives::Extent{nullptr, 0});  // msg_name.
+          params->Push<uint64_t>(2);                           // iovcnt.
+          params->PushByCopy(primitives::Extent{data->data(), 3});
+          params->PushByCopy(
+              primitives::Extent{data->data() + 3, data->size() - 3});
+          params->PushByCopy(primitives::Extent{nullptr, 0});  // control.
+          params->Push(0);                                     // msg_flags.
+        }
+      },
+      &input);
+  MessageWriter output;
+  ASSERT_THAT(SendMsgHandler(nullptr, nullptr, &input, &output), IsOk());
+  VerifyOutput(
+      [&](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(4));
+        EXPECT_EQ(results->next<int>(), 2);
+        results->next<int>();  // Skip errno.
+        EXPECT_EQ(results->next<unsigned int>(), first.size());
+        EXPECT_EQ(results->next<unsigned int>(), second.size());
+      },
+      &output);
+
+  char buffer[64];
+  ASSERT_EQ(recv(fds[1], buffer, sizeof(buffer), 0), first.size());
+  EXPECT_EQ(std::string(buffer, first.size()), first);
+  ASSERT_EQ(recv(fds[1], buffer, sizeof(buffer), 0), second.size());
+  EXPECT_EQ(std::string(buffer, second.size()), second);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// Invokes a SendMsg hostcall for a batch that is missing the items of its
+// last message, and verifies that it is rejected.
+TEST(HostCallHandlersTest, SendMsgIncorrectSizeTest) {
+  MessageReader input;
+  FillInput(
+      [](MessageWriter *params) {
+        params->Push(0);
+        params->Push<uint64_t>(2);
+        params->Push(0);
+        params->PushByCopy(primitives::Extent{nullptr, 0});
+        params->Push<uint64_t>(0);
+        params->PushByCopy(primitives::Extent{nullptr, 0});
+        params->Push(0);
+      },
+      &input);
+  MessageWriter output;
+  EXPECT_THAT(SendMsgHandler(nullptr, nullptr, &input, &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_THAT(output, IsEmpty());
+}
+
+// Invokes a RecvMsg hostcall for up to three datagrams while two are queued,
+// and verifies that both are returned from one call.
+TEST(HostCallHandlersTest, RecvMsgReceivesBatchTest) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), 0);
+  const std::string first = "first";
+  const std::string second = "second datagram";
+  ASSERT_EQ(send(fds[1], first.data(), first.size(), 0), first.size());
+  ASSERT_EQ(send(fds[1], second.data(), second.size(), 0), second.size());
+
+  MessageReader input;
+  FillInput(
+      [&](MessageWriter *params) {
+        params->Push(fds[0]);
+        params->Push<uint64_t>(3);        // vlen.
+        params->Push<int>(MSG_DONTWAIT);  // flags.
+        params->PushByCopy(primitives::Extent{nullptr, 0});  // timeout.
+        for (int i = 0; i < 3; ++i) {
+          params->Push<uint64_t>(0);   // msg_namelen.
+          params->Push<uint64_t>(64);  // Total size of the buffers.
+          params->Push<uint64_t>(0);   // msg_controllen.
+        }
+      },
+      &input);
+  MessageWriter output;
+  ASSERT_THAT(RecvMsgHandler(nullptr, nullptr, &input, &output), IsOk());
+  VerifyOutput(
+      [&](MessageReader *results) {
+        ASSERT_THAT(*results, SizeIs(12));
+        EXPECT_EQ(results->next<int>(), 2);
+        results->next<int>();  // Skip errno.
+        for (const std::string *data : {&first, &second}) {
+          EXPECT_EQ(results->next<unsigned int>(), data->size());
+          EXPECT_THAT(results->next(), SizeIs(0));  // msg_name.
+          auto received = results->next();
+          EXPECT_EQ(std::string(received.As<char>(), received.size()), *data);
+          EXPECT_THAT(results->next(), SizeIs(0));  // msg_control.
+          EXPECT_EQ(results->next<int>(), 0);       // msg_flags.
+        }
+      },
+      &output);
+  close(fds[0]);
+  close(fds[1]);
+}
+
 }  // namespace
 
 }  // namespace host_call
@@ -17,6 +17,7 @@
  */
 
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <chrono>
 #include <thread>
@@ -289,5 +290,157 @@ TEST_F(EpollTest, LevelTriggeredBehavior) { LevelEdgeBehaviorTest(false); }
 
 TEST_F(EpollTest, EdgeTriggeredBehavior) { LevelEdgeBehaviorTest(true); }
 
+// An eventfd is held in trusted memory inside an enclave, so this checks that
+// epoll reports trusted streams alongside host file descriptors.
+TEST_F(EpollTest, EventFdAlongsidePipe) {
+  InitializePipes();
+  int epfd = epoll_create(1);
+  ASSERT_NE(epfd, -1);
+  int event_fd = eventfd(0, 0);
+  ASSERT_NE(event_fd, -1);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = event_fd;
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, event_fd, &ev), -1);
+  ev.data.fd = fd_pairs_[0][kRead];
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, fd_pairs_[0][kRead], &ev), -1);
+
+  struct epoll_event events[2];
+  EXPECT_EQ(epoll_wait(epfd, events, 2, 0), 0);
+
+  uint64_t add = 1;
+  ASSERT_EQ(write(event_fd, &add, sizeof(add)), sizeof(add));
+  ASSERT_EQ(epoll_wait(epfd, events, 2, 0), 1);
+  EXPECT_EQ(events[0].data.fd, event_fd);
+  EXPECT_TRUE(events[0].events & EPOLLIN);
+
+  ASSERT_THAT(WriteData(fd_pairs_[0][kWrite], kTestString), IsOk());
+  ASSERT_EQ(epoll_wait(epfd, events, 2, 0), 2);
+  absl::flat_hash_set<int> ready_fds = {events[0].data.fd, events[1].data.fd};
+  EXPECT_EQ(ready_fds,
+            absl::flat_hash_set<int>({event_fd, fd_pairs_[0][kRead]}));
+
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_DEL, event_fd, nullptr), -1);
+  ASSERT_EQ(epoll_wait(epfd, events, 2, 0), 1);
+  EXPECT_EQ(events[0].data.fd, fd_pairs_[0][kRead]);
+
+  ASSERT_EQ(close(event_fd), 0);
+  ASSERT_EQ(close(epfd), 0);
+  ClosePipes();
+}
+
+TEST_F(EpollTest, EventFdWriteWakesWaiter) {
+  InitializePipes();
+  int epfd = epoll_create(1);
+  ASSERT_NE(epfd, -1);
+  int event_fd = eventfd(0, 0);
+  ASSERT_NE(event_fd, -1);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = event_fd;
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, event_fd, &ev), -1);
+  ev.data.fd = fd_pairs_[0][kRead];
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, fd_pairs_[0][kRead], &ev), -1);
+
+  std::thread writer([event_fd] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t add = 1;
+    EXPECT_EQ(write(event_fd, &add, sizeof(add)), sizeof(add));
+  });
+  struct epoll_event events[2];
+  EXPECT_EQ(epoll_wait(epfd, events, 2, 10000), 1);
+  EXPECT_EQ(events[0].data.fd, event_fd);
+  writer.join();
+
+  ASSERT_EQ(close(event_fd), 0);
+  ASSERT_EQ(close(epfd), 0);
+  ClosePipes();
+}
+
+// Closing a file descriptor removes it from epoll instances, so its number may
+// be added again once it is reused.
+TEST_F(EpollTest, ReusedFdCanBeAddedAgain) {
+  int epfd = epoll_create(1);
+  ASSERT_NE(epfd, -1);
+  int closed_fds[2];
+  ASSERT_EQ(pipe(closed_fds), 0);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = closed_fds[kRead];
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, closed_fds[kRead], &ev), -1);
+  ASSERT_EQ(close(closed_fds[kRead]), 0);
+  ASSERT_EQ(close(closed_fds[kWrite]), 0);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ev.data.fd = fds[kRead];
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[kRead], &ev), -1);
+  EXPECT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[kRead], &ev), -1);
+  EXPECT_EQ(errno, EEXIST);
+
+  ASSERT_EQ(write(fds[kWrite], kTestString, strlen(kTestString)),
+            strlen(kTestString));
+  struct epoll_event events[2];
+  ASSERT_EQ(epoll_wait(epfd, events, 2, 0), 1);
+  EXPECT_EQ(events[0].data.fd, fds[kRead]);
+
+  ASSERT_EQ(close(fds[kRead]), 0);
+  ASSERT_EQ(close(fds[kWrite]), 0);
+  ASSERT_EQ(close(epfd), 0);
+}
+
+// Once its last eventfd is removed, an epoll instance waits on the host only.
+// This checks that notifications of trusted streams waited on elsewhere do not
+// end such a wait before its timeout.
+TEST_F(EpollTest, RemovedEventFdDoesNotEndHostWait) {
+  InitializePipes();
+  int epfd = epoll_create(1);
+  ASSERT_NE(epfd, -1);
+  int removed_fd = eventfd(0, 0);
+  ASSERT_NE(removed_fd, -1);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = removed_fd;
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, removed_fd, &ev), -1);
+  ev.data.fd = fd_pairs_[0][kRead];
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_ADD, fd_pairs_[0][kRead], &ev), -1);
+  struct epoll_event events[2];
+  ASSERT_EQ(epoll_wait(epfd, events, 2, 0), 0);
+  ASSERT_NE(epoll_ctl(epfd, EPOLL_CTL_DEL, removed_fd, nullptr), -1);
+
+  // Another thread waits on an eventfd of its own, which a third one signals
+  // while this thread waits on |epfd|.
+  int other_epfd = epoll_create(1);
+  ASSERT_NE(other_epfd, -1);
+  int other_fd = eventfd(0, 0);
+  ASSERT_NE(other_fd, -1);
+  ev.data.fd = other_fd;
+  ASSERT_NE(epoll_ctl(other_epfd, EPOLL_CTL_ADD, other_fd, &ev), -1);
+  std::thread waiter([other_epfd] {
+    struct epoll_event event;
+    EXPECT_EQ(epoll_wait(other_epfd, &event, 1, 10000), 1);
+  });
+  std::thread writer([other_fd] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t add = 1;
+    EXPECT_EQ(write(other_fd, &add, sizeof(add)), sizeof(add));
+  });
+
+  constexpr int kTimeoutMs = 300;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(epoll_wait(epfd, events, 2, kTimeoutMs), 0);
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(kTimeoutMs));
+  writer.join();
+  waiter.join();
+
+  ASSERT_EQ(close(other_fd), 0);
+  ASSERT_EQ(close(other_epfd), 0);
+  ASSERT_EQ(close(removed_fd), 0);
+  ASSERT_EQ(close(epfd), 0);
+  ClosePipes();
+}
+
 }  // namespace
 }  // namespace asylo
@@ -16,6 +16,7 @@
  *
  */
 
+#include <poll.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
@@ -196,5 +197,35 @@ TEST_F(EventFdTest, MaxCounterNonBlock) {
   EXPECT_EQ(errno, EAGAIN);
 }
 
+TEST_F(EventFdTest, PollAlongsidePipe) {
+  InitializeEventFd(false, 0);
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+
+  struct pollfd fds[2] = {{event_fd_, POLLIN, 0}, {pipe_fds[0], POLLIN, 0}};
+  EXPECT_EQ(poll(fds, 2, 0), 0);
+
+  // A write to the eventfd from another thread ends the wait on both the
+  // eventfd and the pipe.
+  std::thread writer([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Write(1);
+  });
+  ASSERT_EQ(poll(fds, 2, 10000), 1);
+  writer.join();
+  EXPECT_TRUE(fds[0].revents & POLLIN);
+  EXPECT_EQ(fds[1].revents, 0);
+
+  EXPECT_EQ(Read(), 1);
+  char byte = 0;
+  ASSERT_EQ(write(pipe_fds[1], &byte, 1), 1);
+  ASSERT_EQ(poll(fds, 2, 0), 1);
+  EXPECT_EQ(fds[0].revents, 0);
+  EXPECT_TRUE(fds[1].revents & POLLIN);
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
 }  // namespace
 }  // namespace asylo
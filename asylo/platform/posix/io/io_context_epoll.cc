@@ -19,72 +19,391 @@
 
 #include <errno.h>
 #include <openssl/rand.h>
+#include <poll.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <chrono>
+
 #include "absl/memory/memory.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/posix/io/wait_event.h"
 
 namespace asylo {
 namespace io {
 
+namespace {
+
+constexpr uint64_t kSlotIndexMask = 0xffffffff;
+
+// The pairs of epoll(7) and poll(2) events with the same meaning.
+constexpr struct {
+  uint32_t epoll_event;
+  short poll_event;
+} kEventPairs[] = {
+    {EPOLLIN, POLLIN},   {EPOLLPRI, POLLPRI},   {EPOLLOUT, POLLOUT},
+    {EPOLLERR, POLLERR}, {EPOLLHUP, POLLHUP},   {EPOLLRDHUP, POLLRDHUP},
+};
+
+short ToPollEvents(uint32_t epoll_events) {
+  short poll_events = 0;
+  for (const auto &pair : kEventPairs) {
+    if (epoll_events & pair.epoll_event) {
+      poll_events |= pair.poll_event;
+    }
+  }
+  return poll_events;
+}
+
+uint32_t FromPollEvents(short poll_events) {
+  uint32_t epoll_events = 0;
+  for (const auto &pair : kEventPairs) {
+    if (poll_events & pair.poll_event) {
+      epoll_events |= pair.epoll_event;
+    }
+  }
+  return epoll_events;
+}
+
+}  // namespace
+
+uint64_t IOContextEpoll::AllocateSlot(uint64_t data) {
+  uint32_t nonce = 0;
+  while (nonce == 0) {
+    if (RAND_bytes(reinterpret_cast<uint8_t *>(&nonce), sizeof(nonce)) != 1) {
+      return 0;
+    }
+  }
+
+  uint32_t index;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    if (slots_.size() > kSlotIndexMask) {
+      return 0;
+    }
+    index = slots_.size();
+    slots_.emplace_back();
+  }
+  uint64_t key = (static_cast<uint64_t>(nonce) << 32) | index;
+  slots_[index] = {key, data};
+  return key;
+}
+
+void IOContextEpoll::ReleaseSlot(uint32_t index) {
+  slots_[index].key = 0;
+  free_slots_.push_back(index);
+}
+
 int IOContextEpoll::EpollCtl(int op, int hostfd, struct epoll_event *event) {
-  struct epoll_event event_copy;
+  if (op != EPOLL_CTL_ADD && op != EPOLL_CTL_MOD && op != EPOLL_CTL_DEL) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (!event && op != EPOLL_CTL_DEL) {
+    errno = EFAULT;
+    return -1;
+  }
+
+  struct epoll_event event_copy = {};
   if (event) {
     event_copy.events = event->events;
   }
+
+  absl::MutexLock lock(&mutex_);
+  auto it = fd_to_slot_.find(hostfd);
   if (op == EPOLL_CTL_ADD) {
-    uint64_t key = 0;
-    do {
-      if (RAND_bytes(reinterpret_cast<uint8_t *>(&key),
-                     sizeof(uint64_t)) != 1) {
-        errno = EBADE;
-        return -1;
-      }
-    } while (key_to_data.find(key) != key_to_data.end());
-    key_to_data[key] = event->data.u64;
-    fd_to_key[hostfd] = key;
-    event_copy.data.u64 = key;
-  } else if (op == EPOLL_CTL_MOD) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
-      errno = ENOENT;
+    // A registration of |hostfd| may be left over from a descriptor that has
+    // since been closed, which removed it from the host epoll instance, and
+    // whose number was reused. Only the host knows, so it decides whether the
+    // descriptor is already registered.
+    uint64_t key = AllocateSlot(event->data.u64);
+    if (key == 0) {
+      errno = EBADE;
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
-    key_to_data[key] = event->data.u64;
+    uint32_t index = key & kSlotIndexMask;
     event_copy.data.u64 = key;
-  } else if (op == EPOLL_CTL_DEL) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
-      errno = ENOENT;
+    int ret = enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+    if (ret == -1) {
+      ReleaseSlot(index);
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
-    event_copy.data.u64 = key;
-    fd_to_key.erase(hostfd);
-    key_to_data.erase(key);
+    if (it != fd_to_slot_.end()) {
+      ReleaseSlot(it->second);
+      it->second = index;
+    } else {
+      fd_to_slot_[hostfd] = index;
+    }
+    return ret;
+  }
+
+  if (it == fd_to_slot_.end()) {
+    errno = ENOENT;
+    return -1;
+  }
+  uint32_t index = it->second;
+  event_copy.data.u64 = slots_[index].key;
+  int ret = enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+  if (op == EPOLL_CTL_MOD) {
+    if (ret != -1) {
+      slots_[index].data = event->data.u64;
+    }
   } else {
+    // The registration is dropped even if the host call fails, since the host
+    // only fails to remove descriptors that it no longer tracks.
+    fd_to_slot_.erase(it);
+    ReleaseSlot(index);
+  }
+  return ret;
+}
+
+int IOContextEpoll::EpollCtlTrusted(int op, int fd,
+                                    const std::shared_ptr<IOContext> &stream,
+                                    struct epoll_event *event) {
+  if (op != EPOLL_CTL_ADD && op != EPOLL_CTL_MOD && op != EPOLL_CTL_DEL) {
+    errno = EINVAL;
     return -1;
   }
-  return enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+  if (!event && op != EPOLL_CTL_DEL) {
+    errno = EFAULT;
+    return -1;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  auto it = trusted_.find(fd);
+  // A registration for another stream that has since been closed, and whose
+  // file descriptor was reused, no longer exists.
+  if (it != trusted_.end() && it->second.stream.lock() != stream) {
+    trusted_.erase(it);
+    it = trusted_.end();
+    UnregisterWakeupIfUnused();
+  }
+  switch (op) {
+    case EPOLL_CTL_ADD:
+      if (it != trusted_.end()) {
+        errno = EEXIST;
+        return -1;
+      }
+      trusted_[fd] = {stream, event->events, event->data.u64, 0, false};
+      break;
+    case EPOLL_CTL_MOD:
+      if (it == trusted_.end()) {
+        errno = ENOENT;
+        return -1;
+      }
+      it->second = {stream, event->events, event->data.u64, 0, false};
+      break;
+    default:
+      if (it == trusted_.end()) {
+        errno = ENOENT;
+        return -1;
+      }
+      trusted_.erase(it);
+      UnregisterWakeupIfUnused();
+      break;
+  }
+  // Wake waiters so that they check the new interest list.
+  TrustedReadinessEvent().Notify();
+  return 0;
 }
 
 int IOContextEpoll::EpollWait(struct epoll_event *events, int maxevents,
                               int timeout) {
-  int ret = enc_untrusted_epoll_wait(host_fd_, events, maxevents, timeout);
-  if (ret == -1) {
-    // errno is set in enc_untrusted_epoll_wait.
+  if (maxevents <= 0) {
+    errno = EINVAL;
     return -1;
   }
-  // Convert the random bits in the data field back to the original data using
-  // the key_to_data map.
-  for (int i = 0; i < ret; ++i) {
+  bool has_trusted_streams;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    has_trusted_streams = !trusted_.empty();
+  }
+  return has_trusted_streams
+             ? WaitWithTrustedStreams(events, maxevents, timeout)
+             : WaitOnHost(events, maxevents, timeout);
+}
+
+int IOContextEpoll::WaitOnHost(struct epoll_event *events, int maxevents,
+                               int timeout) {
+  const auto start = std::chrono::steady_clock::now();
+  int remaining_ms = timeout;
+  while (true) {
+    int ret =
+        enc_untrusted_epoll_wait(host_fd_, events, maxevents, remaining_ms);
+    if (ret == -1) {
+      // errno is set in enc_untrusted_epoll_wait.
+      return -1;
+    }
+
+    bool woken = false;
+    int delivered = TranslateHostEvents(events, ret, &woken);
+    if (woken) {
+      TrustedReadinessEvent().DrainHostWakeup();
+    }
+
+    // Only the timeout ends a wait without events. The host may also report
+    // stale events, and the wakeup file descriptor if a trusted stream was
+    // registered or changed since EpollWait() checked for them.
+    if (delivered != 0 || ret == 0) {
+      return delivered;
+    }
+    if (timeout >= 0) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+      remaining_ms =
+          std::max<int64_t>(0, static_cast<int64_t>(timeout) - elapsed.count());
+      if (remaining_ms == 0) {
+        return 0;
+      }
+    }
+    bool has_trusted_streams;
+    {
+      absl::ReaderMutexLock lock(&mutex_);
+      has_trusted_streams = !trusted_.empty();
+    }
+    if (has_trusted_streams) {
+      return WaitWithTrustedStreams(events, maxevents, remaining_ms);
+    }
+  }
+}
+
+int IOContextEpoll::WaitWithTrustedStreams(struct epoll_event *events,
+                                           int maxevents, int timeout) {
+  const auto start = std::chrono::steady_clock::now();
+  WaitEvent &readiness = TrustedReadinessEvent();
+
+  // Register as a waiter before checking the trusted streams, so that a change
+  // in their readiness after the check ends the host wait below.
+  int wakeup_fd = readiness.PrepareHostWait();
+  if (wakeup_fd >= 0) {
+    absl::MutexLock lock(&mutex_);
+    if (wakeup_fd_ < 0 && !trusted_.empty()) {
+      struct epoll_event wakeup_event = {};
+      wakeup_event.events = EPOLLIN;
+      wakeup_event.data.u64 = 0;
+      if (enc_untrusted_epoll_ctl(host_fd_, EPOLL_CTL_ADD, wakeup_fd,
+                                  &wakeup_event) == 0) {
+        wakeup_fd_ = wakeup_fd;
+      }
+    }
+  }
+
+  while (true) {
+    int ready = CollectTrustedEvents(events, maxevents);
+
+    int remaining_ms = -1;
+    if (timeout >= 0) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+      remaining_ms =
+          std::max<int64_t>(0, static_cast<int64_t>(timeout) - elapsed.count());
+    }
+
+    if (ready < maxevents) {
+      // The host wait is bounded, since a notification can be drained by
+      // another waiter before this one reaches the host.
+      int host_timeout = kHostWaitSliceMs;
+      if (ready > 0 || remaining_ms == 0) {
+        host_timeout = 0;
+      } else if (remaining_ms > 0) {
+        host_timeout = std::min(remaining_ms, kHostWaitSliceMs);
+      }
+      int ret = enc_untrusted_epoll_wait(host_fd_, events + ready,
+                                         maxevents - ready, host_timeout);
+      if (ret == -1) {
+        readiness.FinishHostWait();
+        return -1;
+      }
+      bool woken = false;
+      int delivered = TranslateHostEvents(events + ready, ret, &woken);
+      if (delivered == -1) {
+        readiness.FinishHostWait();
+        return -1;
+      }
+      if (woken) {
+        readiness.DrainHostWakeup();
+      }
+      ready += delivered;
+    }
+
+    if (ready > 0 || remaining_ms == 0) {
+      readiness.FinishHostWait();
+      return ready;
+    }
+  }
+}
+
+int IOContextEpoll::CollectTrustedEvents(struct epoll_event *events,
+                                         int maxevents) {
+  absl::MutexLock lock(&mutex_);
+  int count = 0;
+  for (auto it = trusted_.begin(); it != trusted_.end() && count < maxevents;) {
+    std::shared_ptr<IOContext> stream = it->second.stream.lock();
+    if (!stream) {
+      it = trusted_.erase(it);
+      UnregisterWakeupIfUnused();
+      continue;
+    }
+    TrustedRegistration &registration = (it++)->second;
+    if (registration.disabled) {
+      continue;
+    }
+    uint32_t ready = FromPollEvents(
+        stream->GetReadyEvents(ToPollEvents(registration.events)));
+    if (registration.events & EPOLLET) {
+      uint32_t rising = ready & ~registration.reported;
+      registration.reported = ready;
+      ready = rising;
+    }
+    if (ready == 0) {
+      continue;
+    }
+    if (registration.events & EPOLLONESHOT) {
+      registration.disabled = true;
+    }
+    events[count].events = ready;
+    events[count].data.u64 = registration.data;
+    ++count;
+  }
+  return count;
+}
+
+void IOContextEpoll::UnregisterWakeupIfUnused() {
+  if (!trusted_.empty() || wakeup_fd_ < 0) {
+    return;
+  }
+  enc_untrusted_epoll_ctl(host_fd_, EPOLL_CTL_DEL, wakeup_fd_, nullptr);
+  wakeup_fd_ = -1;
+}
+
+int IOContextEpoll::TranslateHostEvents(struct epoll_event *events, int count,
+                                        bool *woken) {
+  // Convert each key in the data field back to the original data, compacting
+  // out events for registrations removed since the host reported them.
+  absl::ReaderMutexLock lock(&mutex_);
+  int delivered = 0;
+  for (int i = 0; i < count; ++i) {
     uint64_t key = events[i].data.u64;
-    if (key_to_data.find(key) == key_to_data.end()) {
+    if (key == 0) {
+      *woken = *woken || wakeup_fd_ >= 0;
+      continue;
+    }
+    uint64_t index = key & kSlotIndexMask;
+    if (index >= slots_.size()) {
       errno = EBADE;
       return -1;
     }
-    events[i].data.u64 = key_to_data[key];
+    const Slot &slot = slots_[index];
+    if (slot.key != key) {
+      continue;
+    }
+    events[delivered].events = events[i].events;
+    events[delivered].data.u64 = slot.data;
+    ++delivered;
   }
-  return ret;
+  return delivered;
 }
 
 int IOContextEpoll::GetHostFileDescriptor() { return host_fd_; }
@@ -19,8 +19,13 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 #define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
@@ -32,6 +37,8 @@ class IOContextEpoll : public IOManager::IOContext {
   // It's important to note that adding dup'd file descriptors here won't work
   // the same as it would in POSIX.
   int EpollCtl(int op, int hostfd, struct epoll_event *event) override;
+  int EpollCtlTrusted(int op, int fd, const std::shared_ptr<IOContext> &stream,
+                      struct epoll_event *event) override;
   int EpollWait(struct epoll_event *events, int maxevents,
                 int timeout) override;
   int GetHostFileDescriptor() override;
@@ -40,12 +47,92 @@ class IOContextEpoll : public IOManager::IOContext {
   int Close();
 
  private:
+  // A registration of a host file descriptor with the epoll instance.
+  //
+  // The host is never shown the user data of a registration. Instead, it is
+  // given a key whose low 32 bits are the index of the registration's slot in
+  // |slots_| and whose high 32 bits are random, so that an event returned by
+  // the host is translated back to user data with a single bounds-checked
+  // lookup, and keys for reused slots are not confused with stale ones.
+  struct Slot {
+    // The key given to the host, or zero if the slot is free.
+    uint64_t key;
+
+    // The user data registered for the file descriptor.
+    uint64_t data;
+  };
+
+  // A registration of a stream held in trusted memory. The host cannot watch
+  // such streams, so EpollWait() checks their readiness inside the enclave.
+  struct TrustedRegistration {
+    // The registered stream. A registration whose stream has been closed is
+    // dropped, as epoll(7) drops closed files.
+    std::weak_ptr<IOContext> stream;
+
+    // The events and user data given to epoll_ctl(2).
+    uint32_t events;
+    uint64_t data;
+
+    // The events last reported for an edge-triggered registration. Edges are
+    // approximated by changes in the stream's readiness.
+    uint32_t reported;
+
+    // Set once a one-shot registration has reported an event, until it is
+    // re-armed with EPOLL_CTL_MOD.
+    bool disabled;
+  };
+
+  // Waits for events on the host's epoll instance only.
+  int WaitOnHost(struct epoll_event *events, int maxevents, int timeout);
+
+  // Waits for events on both the trusted registrations and the host's epoll
+  // instance. The host wait is ended early by TrustedReadinessEvent().
+  int WaitWithTrustedStreams(struct epoll_event *events, int maxevents,
+                             int timeout);
+
+  // Stores up to |maxevents| events of ready trusted registrations in
+  // |events|, returning their number.
+  int CollectTrustedEvents(struct epoll_event *events, int maxevents)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Translates the |count| events returned by the host in |events| back to
+  // the user data of their registrations, compacting out stale events.
+  // Returns the number of events left, or -1 on failure. Sets |*woken| if the
+  // host reported the wakeup file descriptor of TrustedReadinessEvent().
+  int TranslateHostEvents(struct epoll_event *events, int count, bool *woken)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Removes the wakeup file descriptor of TrustedReadinessEvent() from the
+  // host's epoll instance once there are no trusted registrations left, so
+  // that notifications meant for other waiters do not end host-only waits.
+  void UnregisterWakeupIfUnused() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Allocates a slot holding |data|, returning its key or zero on failure.
+  uint64_t AllocateSlot(uint64_t data) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Releases the slot at |index|.
+  void ReleaseSlot(uint32_t index) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  std::unordered_map<uint64_t, uint64_t> key_to_data;
-  // Manages a mapping from the host file descriptor to a random key to enable
-  // updates to the above map durring deletions/modifications.
-  std::unordered_map<int, uint64_t> fd_to_key;
+
+  // Held exclusively by EpollCtl() across its host call, so that the slot
+  // table always agrees with the host's interest list, and shared by
+  // EpollWait() while translating events.
+  absl::Mutex mutex_;
+  std::vector<Slot> slots_ ABSL_GUARDED_BY(mutex_);
+  std::vector<uint32_t> free_slots_ ABSL_GUARDED_BY(mutex_);
+
+  // Maps each registered host file descriptor to the index of its slot.
+  std::unordered_map<int, uint32_t> fd_to_slot_ ABSL_GUARDED_BY(mutex_);
+
+  // Registrations of streams held in trusted memory, by enclave file
+  // descriptor.
+  std::unordered_map<int, TrustedRegistration> trusted_ ABSL_GUARDED_BY(mutex_);
+
+  // The wakeup file descriptor of TrustedReadinessEvent() registered with the
+  // host's epoll instance under key zero, which no slot uses, or -1.
+  int wakeup_fd_ ABSL_GUARDED_BY(mutex_) = -1;
 };
 
 }  // namespace io
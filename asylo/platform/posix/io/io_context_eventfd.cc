@@ -17,6 +17,10 @@
  */
 #include "asylo/platform/posix/io/io_context_eventfd.h"
 
+#include <poll.h>
+
+#include "asylo/platform/posix/io/wait_event.h"
+
 constexpr uint64_t kMaxCounter = 0xfffffffffffffffe;
 constexpr ssize_t kCounterBufSize = sizeof(uint64_t);
 
@@ -43,6 +47,7 @@ ssize_t IOContextEventFd::Read(void *buf, size_t count) {
     *reinterpret_cast<uint64_t *>(buf) = counter_;
     counter_ = 0;
   }
+  TrustedReadinessEvent().Notify();
   return kCounterBufSize;
 }
 
@@ -65,6 +70,9 @@ ssize_t IOContextEventFd::Write(const void *buf, size_t count) {
     counter_mutex_.Await(absl::Condition(&ready));
   }
   counter_ += add;
+  if (add > 0) {
+    TrustedReadinessEvent().Notify();
+  }
   return kCounterBufSize;
 }
 
@@ -72,5 +80,17 @@ int IOContextEventFd::Close() {
   return 0;
 }
 
+int IOContextEventFd::GetReadyEvents(short events) {
+  absl::MutexLock counter_mutex_lock(&counter_mutex_);
+  int ready = 0;
+  if (counter_ > 0) {
+    ready |= events & (POLLIN | POLLRDNORM);
+  }
+  if (counter_ < kMaxCounter) {
+    ready |= events & (POLLOUT | POLLWRNORM);
+  }
+  return ready;
+}
+
 }  // namespace io
 }  // namespace asylo
@@ -48,6 +48,7 @@ class IOContextEventFd : public IOManager::IOContext {
   ssize_t Read(void *buf, size_t count) override;
   ssize_t Write(const void *buf, size_t count) override;
   int Close() override;
+  int GetReadyEvents(short events) override;
 
  private:
   // Host file descriptor implementing this stream.
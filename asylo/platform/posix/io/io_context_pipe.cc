@@ -0,0 +1,231 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/io_context_pipe.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace asylo {
+namespace io {
+
+constexpr size_t PipeBuffer::kCapacity;
+
+ssize_t PipeBuffer::Read(void *buf, size_t count, bool nonblock) {
+  if (count == 0) {
+    return 0;
+  }
+
+  absl::MutexLock lock(&read_mutex_);
+  uint8_t *bytes = static_cast<uint8_t *>(buf);
+  while (true) {
+    // Check for a closed write end before reading, so that data written just
+    // before the write end was closed is still returned.
+    bool write_end_closed = ring_.is_closed_for_write();
+    size_t bytes_read = ring_.TryRead(bytes, count);
+    if (bytes_read > 0) {
+      writable_.Notify();
+      TrustedReadinessEvent().Notify();
+      return bytes_read;
+    }
+    if (write_end_closed) {
+      return 0;
+    }
+    if (nonblock) {
+      errno = EAGAIN;
+      return -1;
+    }
+    readable_.Await(
+        [this] { return !ring_.empty() || ring_.is_closed_for_write(); });
+  }
+}
+
+ssize_t PipeBuffer::Write(const void *buf, size_t count, bool nonblock) {
+  if (count == 0) {
+    return 0;
+  }
+
+  absl::MutexLock lock(&write_mutex_);
+  if (ring_.is_closed_for_read()) {
+    errno = EPIPE;
+    return -1;
+  }
+
+  // Non-blocking writes of at most PIPE_BUF bytes either write all of their
+  // data or none of it.
+  if (nonblock && count <= PIPE_BUF && ring_.available() < count) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  const uint8_t *bytes = static_cast<const uint8_t *>(buf);
+  size_t written = 0;
+  while (written < count) {
+    if (ring_.is_closed_for_read()) {
+      break;
+    }
+    size_t bytes_written = ring_.TryWrite(bytes + written, count - written);
+    if (bytes_written > 0) {
+      written += bytes_written;
+      readable_.Notify();
+      TrustedReadinessEvent().Notify();
+      continue;
+    }
+    if (nonblock) {
+      break;
+    }
+    writable_.Await(
+        [this] { return !ring_.full() || ring_.is_closed_for_read(); });
+  }
+
+  if (written == 0) {
+    errno = ring_.is_closed_for_read() ? EPIPE : EAGAIN;
+    return -1;
+  }
+  return written;
+}
+
+void PipeBuffer::CloseReadEnd() {
+  ring_.close_for_read();
+  writable_.Notify();
+  TrustedReadinessEvent().Notify();
+}
+
+void PipeBuffer::CloseWriteEnd() {
+  ring_.close_for_write();
+  readable_.Notify();
+  TrustedReadinessEvent().Notify();
+}
+
+int PipeBuffer::ReadEndReadyEvents(short events) {
+  int ready = 0;
+  if (!ring_.empty()) {
+    ready |= events & (POLLIN | POLLRDNORM);
+  }
+  if (ring_.is_closed_for_write()) {
+    ready |= POLLHUP;
+  }
+  return ready;
+}
+
+int PipeBuffer::WriteEndReadyEvents(short events) {
+  if (ring_.is_closed_for_read()) {
+    return POLLERR;
+  }
+  // As on Linux, a pipe is writable once a PIPE_BUF-sized write would not
+  // block.
+  if (ring_.available() >= PIPE_BUF) {
+    return events & (POLLOUT | POLLWRNORM);
+  }
+  return 0;
+}
+
+void IOContextPipe::Create(int flags, std::unique_ptr<IOContextPipe> *read_end,
+                           std::unique_ptr<IOContextPipe> *write_end) {
+  auto buffer = std::make_shared<PipeBuffer>();
+  read_end->reset(new IOContextPipe(buffer, /*is_read_end=*/true, flags));
+  write_end->reset(new IOContextPipe(buffer, /*is_read_end=*/false, flags));
+}
+
+IOContextPipe::IOContextPipe(std::shared_ptr<PipeBuffer> buffer,
+                             bool is_read_end, int flags)
+    : buffer_(std::move(buffer)),
+      is_read_end_(is_read_end),
+      status_flags_((is_read_end ? O_RDONLY : O_WRONLY) | (flags & O_NONBLOCK)),
+      fd_flags_((flags & O_CLOEXEC) ? FD_CLOEXEC : 0) {}
+
+ssize_t IOContextPipe::Read(void *buf, size_t count) {
+  if (!is_read_end_) {
+    errno = EBADF;
+    return -1;
+  }
+  return buffer_->Read(buf, count, status_flags_.load() & O_NONBLOCK);
+}
+
+ssize_t IOContextPipe::Write(const void *buf, size_t count) {
+  if (is_read_end_) {
+    errno = EBADF;
+    return -1;
+  }
+  return buffer_->Write(buf, count, status_flags_.load() & O_NONBLOCK);
+}
+
+int IOContextPipe::Close() {
+  if (is_read_end_) {
+    buffer_->CloseReadEnd();
+  } else {
+    buffer_->CloseWriteEnd();
+  }
+  return 0;
+}
+
+int IOContextPipe::FCntl(int cmd, int64_t arg) {
+  switch (cmd) {
+    case F_GETFD:
+      return fd_flags_.load();
+    case F_SETFD:
+      fd_flags_ = arg & FD_CLOEXEC;
+      return 0;
+    case F_GETFL:
+      return status_flags_.load();
+    case F_SETFL:
+      status_flags_ = (status_flags_.load() & O_ACCMODE) | (arg & O_NONBLOCK);
+      return 0;
+    case F_GETPIPE_SZ:
+      return PipeBuffer::kCapacity;
+    case F_SETPIPE_SZ:
+      // The capacity is fixed, so only requests it already satisfies succeed.
+      if (arg < 0 || static_cast<uint64_t>(arg) > PipeBuffer::kCapacity) {
+        errno = EPERM;
+        return -1;
+      }
+      return PipeBuffer::kCapacity;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+}
+
+int IOContextPipe::FStat(struct stat *stat_buffer) {
+  memset(stat_buffer, 0, sizeof(*stat_buffer));
+  stat_buffer->st_mode = S_IFIFO | S_IRUSR | S_IWUSR;
+  stat_buffer->st_nlink = 1;
+  stat_buffer->st_blksize = PIPE_BUF;
+  return 0;
+}
+
+int IOContextPipe::Isatty() {
+  errno = ENOTTY;
+  return 0;
+}
+
+int IOContextPipe::GetReadyEvents(short events) {
+  return is_read_end_ ? buffer_->ReadEndReadyEvents(events)
+                      : buffer_->WriteEndReadyEvents(events);
+}
+
+}  // namespace io
+}  // namespace asylo
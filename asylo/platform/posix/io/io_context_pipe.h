@@ -0,0 +1,110 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+#define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+
+#include <atomic>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/common/ring_buffer.h"
+#include "asylo/platform/posix/io/io_manager.h"
+#include "asylo/platform/posix/io/wait_event.h"
+
+namespace asylo {
+namespace io {
+
+// The buffer shared by the two ends of a pipe held in trusted memory.
+//
+// RingBuffer supports a single reader and a single writer, so each end
+// serializes its callers with a mutex. Serializing writers also makes every
+// write atomic with respect to other writers, which is stronger than the
+// PIPE_BUF guarantee of pipe(7).
+class PipeBuffer {
+ public:
+  // The capacity of the pipe in bytes, matching the Linux default.
+  static constexpr size_t kCapacity = 64 * 1024;
+
+  PipeBuffer() = default;
+
+  PipeBuffer(const PipeBuffer &) = delete;
+  PipeBuffer &operator=(const PipeBuffer &) = delete;
+
+  // Implements read(2) on the read end of the pipe.
+  ssize_t Read(void *buf, size_t count, bool nonblock);
+
+  // Implements write(2) on the write end of the pipe.
+  ssize_t Write(const void *buf, size_t count, bool nonblock);
+
+  // Marks an end of the pipe as closed and wakes any threads blocked on the
+  // other end.
+  void CloseReadEnd();
+  void CloseWriteEnd();
+
+  // Returns the poll(2) events, out of |events|, for which the read or write
+  // end of the pipe is ready.
+  int ReadEndReadyEvents(short events);
+  int WriteEndReadyEvents(short events);
+
+ private:
+  RingBuffer<kCapacity> ring_;
+
+  // Serialize readers and writers, respectively.
+  absl::Mutex read_mutex_;
+  absl::Mutex write_mutex_;
+
+  // Notified when data is written or the write end is closed.
+  WaitEvent readable_;
+
+  // Notified when data is read or the read end is closed.
+  WaitEvent writable_;
+};
+
+// IOContext implementation of one end of a pipe held in trusted memory. Data
+// written to the pipe never leaves the enclave, and reads and writes do not
+// exit to the host unless they block.
+class IOContextPipe : public IOManager::IOContext {
+ public:
+  // Creates the read and write ends of a new pipe, stored in |read_end| and
+  // |write_end|. |flags| is a bitwise-or of O_CLOEXEC and O_NONBLOCK.
+  static void Create(int flags, std::unique_ptr<IOContextPipe> *read_end,
+                     std::unique_ptr<IOContextPipe> *write_end);
+
+  ssize_t Read(void *buf, size_t count) override;
+  ssize_t Write(const void *buf, size_t count) override;
+  int Close() override;
+  int FCntl(int cmd, int64_t arg) override;
+  int FStat(struct stat *stat_buffer) override;
+  int Isatty() override;
+  int GetReadyEvents(short events) override;
+
+ private:
+  IOContextPipe(std::shared_ptr<PipeBuffer> buffer, bool is_read_end,
+                int flags);
+
+  std::shared_ptr<PipeBuffer> buffer_;
+  const bool is_read_end_;
+  std::atomic<int> status_flags_;
+  std::atomic<int> fd_flags_;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
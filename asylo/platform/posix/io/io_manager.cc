@@ -21,10 +21,14 @@
 #include <fcntl.h>
 #include <poll.h>
 
+#include <algorithm>
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "absl/algorithm/container.h"
 #include "absl/strings/str_cat.h"
@@ -33,8 +37,10 @@
 #include "asylo/platform/posix/io/io_context_epoll.h"
 #include "asylo/platform/posix/io/io_context_eventfd.h"
 #include "asylo/platform/posix/io/io_context_inotify.h"
+#include "asylo/platform/posix/io/io_context_pipe.h"
 #include "asylo/platform/posix/io/native_paths.h"
 #include "asylo/platform/posix/io/util.h"
+#include "asylo/platform/posix/io/wait_event.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/statusor.h"
 
@@ -269,6 +275,9 @@ int IOManager::Dup2(int oldfd, int newfd) {
 }
 
 int IOManager::Pipe(int pipefd[2], int flags) {
+  if (flags & O_SECURE) {
+    return TrustedPipe(pipefd, flags & ~O_SECURE);
+  }
   int res = enc_untrusted_pipe2(pipefd, flags);
   if (res != -1) {
     pipefd[0] = RegisterHostFileDescriptor(pipefd[0]);
@@ -281,6 +290,34 @@ int IOManager::Pipe(int pipefd[2], int flags) {
   return res;
 }
 
+int IOManager::TrustedPipe(int pipefd[2], int flags) {
+  if (flags & ~(O_CLOEXEC | O_NONBLOCK)) {
+    errno = EINVAL;
+    return -1;
+  }
+  std::unique_ptr<IOContextPipe> read_end;
+  std::unique_ptr<IOContextPipe> write_end;
+  IOContextPipe::Create(flags, &read_end, &write_end);
+
+  absl::WriterMutexLock lock(&fd_table_lock_);
+  int read_fd = fd_table_.Insert(read_end.get());
+  if (read_fd < 0) {
+    errno = EMFILE;
+    return -1;
+  }
+  read_end.release();
+  int write_fd = fd_table_.Insert(write_end.get());
+  if (write_fd < 0) {
+    CloseFileDescriptor(read_fd);
+    errno = EMFILE;
+    return -1;
+  }
+  write_end.release();
+  pipefd[0] = read_fd;
+  pipefd[1] = write_fd;
+  return 0;
+}
+
 int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
                       fd_set *exceptfds, struct timeval *timeout) {
   if (nfds < 0) {
@@ -288,6 +325,26 @@ int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
     return -1;
   }
 
+  // The host cannot select on streams held in trusted memory, so if any are
+  // present, select(2) is implemented in terms of poll(2).
+  bool has_trusted_contexts = false;
+  {
+    absl::ReaderMutexLock lock(&fd_table_lock_);
+    for (int fd = 0; fd < nfds && !has_trusted_contexts; ++fd) {
+      if ((readfds && FD_ISSET(fd, readfds)) ||
+          (writefds && FD_ISSET(fd, writefds)) ||
+          (exceptfds && FD_ISSET(fd, exceptfds))) {
+        std::shared_ptr<IOContext> context = fd_table_.Get(fd);
+        has_trusted_contexts = context &&
+                               context->GetHostFileDescriptor() < 0 &&
+                               context->GetReadyEvents(0) >= 0;
+      }
+    }
+  }
+  if (has_trusted_contexts) {
+    return SelectWithPoll(nfds, readfds, writefds, exceptfds, timeout);
+  }
+
   // Translate the fd_sets into host file descriptors.
   fd_set host_readfds, host_writefds, host_exceptfds;
   FD_ZERO(&host_readfds);
@@ -383,8 +440,76 @@ int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
   return ret;
 }
 
+int IOManager::SelectWithPoll(int nfds, fd_set *readfds, fd_set *writefds,
+                              fd_set *exceptfds, struct timeval *timeout) {
+  std::vector<struct pollfd> poll_fds;
+  for (int fd = 0; fd < nfds; ++fd) {
+    short events = 0;
+    if (readfds && FD_ISSET(fd, readfds)) events |= POLLIN;
+    if (writefds && FD_ISSET(fd, writefds)) events |= POLLOUT;
+    if (exceptfds && FD_ISSET(fd, exceptfds)) events |= POLLPRI;
+    if (events != 0) {
+      poll_fds.push_back({fd, events, 0});
+    }
+  }
+
+  int timeout_ms = -1;
+  if (timeout) {
+    if (timeout->tv_sec < 0 || timeout->tv_usec < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    // Round up so that a non-zero timeout never becomes a non-blocking poll,
+    // and clamp timeouts too long for poll() to the longest it takes.
+    constexpr int64_t kMaxTimeoutMs = std::numeric_limits<int>::max();
+    int64_t tv_sec = timeout->tv_sec;
+    int64_t total_ms =
+        tv_sec >= kMaxTimeoutMs / 1000
+            ? kMaxTimeoutMs
+            : tv_sec * 1000 + (int64_t{timeout->tv_usec} + 999) / 1000;
+    timeout_ms = static_cast<int>(std::min(total_ms, kMaxTimeoutMs));
+  }
+
+  int ret = Poll(poll_fds.data(), poll_fds.size(), timeout_ms);
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (readfds) {
+    FD_ZERO(readfds);
+  }
+  if (writefds) {
+    FD_ZERO(writefds);
+  }
+  if (exceptfds) {
+    FD_ZERO(exceptfds);
+  }
+  int ready = 0;
+  for (const struct pollfd &poll_fd : poll_fds) {
+    if (readfds && (poll_fd.events & POLLIN) &&
+        (poll_fd.revents & (POLLIN | POLLRDNORM | POLLHUP | POLLERR))) {
+      FD_SET(poll_fd.fd, readfds);
+      ++ready;
+    }
+    if (writefds && (poll_fd.events & POLLOUT) &&
+        (poll_fd.revents & (POLLOUT | POLLWRNORM | POLLERR))) {
+      FD_SET(poll_fd.fd, writefds);
+      ++ready;
+    }
+    if (exceptfds && (poll_fd.events & POLLPRI) &&
+        (poll_fd.revents & POLLPRI)) {
+      FD_SET(poll_fd.fd, exceptfds);
+      ++ready;
+    }
+  }
+  return ready;
+}
+
 int IOManager::Poll(struct pollfd *fds, nfds_t nfds, int timeout) {
   std::vector<int> enclave_fd(nfds);
+  // Streams held in trusted memory, at the same indices as in |fds|. Left
+  // empty if there are none.
+  std::vector<std::shared_ptr<IOContext>> trusted_contexts;
   {
     absl::ReaderMutexLock lock(&fd_table_lock_);
     for (int i = 0; i < nfds; ++i) {
@@ -392,18 +517,118 @@ int IOManager::Poll(struct pollfd *fds, nfds_t nfds, int timeout) {
       std::shared_ptr<IOContext> context = fd_table_.Get(enclave_fd[i]);
       if (context) {
         fds[i].fd = context->GetHostFileDescriptor();
+        if (fds[i].fd < 0 && context->GetReadyEvents(0) >= 0) {
+          trusted_contexts.resize(nfds);
+          trusted_contexts[i] = std::move(context);
+        }
       } else {
         fds[i].fd = -1;
       }
     }
   }
-  int ret = enc_untrusted_poll(fds, nfds, timeout);
+  int ret = trusted_contexts.empty()
+                ? enc_untrusted_poll(fds, nfds, timeout)
+                : PollWithTrustedContexts(fds, nfds, timeout, trusted_contexts);
   for (int i = 0; i < nfds; ++i) {
     fds[i].fd = enclave_fd[i];
   }
   return ret;
 }
 
+int IOManager::PollWithTrustedContexts(
+    struct pollfd *fds, nfds_t nfds, int timeout,
+    const std::vector<std::shared_ptr<IOContext>> &trusted_contexts) {
+  bool has_host_fds = false;
+  for (int i = 0; i < nfds; ++i) {
+    fds[i].revents = 0;
+    has_host_fds = has_host_fds || fds[i].fd >= 0;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  WaitEvent &readiness = TrustedReadinessEvent();
+
+  // When host file descriptors are present, the wait happens on the host, so
+  // the host file descriptor that |readiness| makes readable on notification
+  // is polled along with them, at the end of |host_fds|.
+  std::vector<struct pollfd> host_fds;
+  if (has_host_fds) {
+    host_fds.assign(fds, fds + nfds);
+    host_fds.push_back({readiness.PrepareHostWait(), POLLIN, 0});
+  }
+
+  std::vector<short> trusted_revents(nfds);
+  while (true) {
+    // Register as a waiter before checking the trusted streams, so that a
+    // change in their readiness after the check wakes the wait below.
+    int32_t token = has_host_fds ? 0 : readiness.Prepare();
+    int trusted_ready = 0;
+    for (int i = 0; i < nfds; ++i) {
+      if (trusted_contexts[i]) {
+        trusted_revents[i] = trusted_contexts[i]->GetReadyEvents(fds[i].events);
+        if (trusted_revents[i] != 0) {
+          ++trusted_ready;
+        }
+      }
+    }
+
+    int remaining_ms = -1;
+    if (timeout >= 0) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+      remaining_ms =
+          std::max<int64_t>(0, static_cast<int64_t>(timeout) - elapsed.count());
+    }
+    bool done = trusted_ready > 0 || remaining_ms == 0;
+
+    int host_ready = 0;
+    if (has_host_fds) {
+      // A notification of |readiness| ends the host wait early. The wait is
+      // still bounded, since a notification can be drained by another waiter
+      // before this one reaches the host.
+      int host_timeout = kHostWaitSliceMs;
+      if (done) {
+        host_timeout = 0;
+      } else if (remaining_ms > 0) {
+        host_timeout = std::min(remaining_ms, kHostWaitSliceMs);
+      }
+      int ret = enc_untrusted_poll(host_fds.data(), host_fds.size(),
+                                   host_timeout);
+      if (ret < 0) {
+        readiness.FinishHostWait();
+        return -1;
+      }
+      if (host_fds.back().revents != 0) {
+        readiness.DrainHostWakeup();
+        --ret;
+      }
+      host_ready = ret;
+      done = done || host_ready > 0;
+    }
+
+    if (done) {
+      if (has_host_fds) {
+        readiness.FinishHostWait();
+      } else {
+        readiness.Cancel();
+      }
+      for (int i = 0; i < nfds; ++i) {
+        if (trusted_contexts[i]) {
+          fds[i].revents = trusted_revents[i];
+        } else if (has_host_fds) {
+          fds[i].revents = host_fds[i].revents;
+        }
+      }
+      return host_ready + trusted_ready;
+    }
+
+    if (!has_host_fds) {
+      readiness.Wait(token, remaining_ms > 0
+                                ? static_cast<uint64_t>(remaining_ms) * 1000
+                                : 0);
+    }
+  }
+}
+
 int IOManager::EpollCreate(int size) {
   if (size < 1) {
     errno = EINVAL;
@@ -431,6 +656,12 @@ int IOManager::EpollCtl(int epfd, int op, int fd, struct epoll_event *event) {
     context = fd_table_.Get(fd);
   }
   int hostfd = context ? context->GetHostFileDescriptor() : -1;
+  if (hostfd == -1 && context && context->GetReadyEvents(0) >= 0) {
+    return CallWithContext(epfd, [op, fd, &context, event](
+                                     std::shared_ptr<IOContext> epoll_context) {
+      return epoll_context->EpollCtlTrusted(op, fd, context, event);
+    });
+  }
   if (hostfd == -1) {
     errno = EBADF;
     return -1;
@@ -973,6 +1204,14 @@ ssize_t IOManager::PRead(int fd, void *buf, size_t count, off_t offset) {
       });
 }
 
+ssize_t IOManager::PWrite(int fd, const void *buf, size_t count,
+                          off_t offset) {
+  return CallWithContext(
+      fd, [buf, count, offset](std::shared_ptr<IOContext> context) {
+        return context->PWrite(buf, count, offset);
+      });
+}
+
 mode_t IOManager::Umask(mode_t mask) { return enc_untrusted_umask(mask); }
 
 int IOManager::GetRLimit(int resource, struct rlimit *rlim) {
@@ -1109,6 +1348,22 @@ ssize_t IOManager::RecvMsg(int sockfd, struct msghdr *msg, int flags) {
                          });
 }
 
+int IOManager::SendMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                        int flags) {
+  return CallWithContext(
+      sockfd, [msgvec, vlen, flags](std::shared_ptr<IOContext> context) {
+        return context->SendMmsg(msgvec, vlen, flags);
+      });
+}
+
+int IOManager::RecvMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                        int flags, struct timespec *timeout) {
+  return CallWithContext(sockfd, [msgvec, vlen, flags, timeout](
+                                     std::shared_ptr<IOContext> context) {
+    return context->RecvMmsg(msgvec, vlen, flags, timeout);
+  });
+}
+
 int IOManager::GetSockName(int sockfd, struct sockaddr *addr,
                            socklen_t *addrlen) {
   return CallWithContext(sockfd,
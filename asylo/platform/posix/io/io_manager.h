@@ -38,6 +38,7 @@
 #include <memory>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
@@ -144,6 +145,11 @@ class IOManager {
       return -1;
     }
 
+    virtual ssize_t PWrite(const void *buf, size_t count, off_t offset) {
+      errno = ENOSYS;
+      return -1;
+    }
+
     virtual ssize_t FGetXattr(const char *name, void *value, size_t size) {
       errno = ENOSYS;
       return -1;
@@ -212,6 +218,18 @@ class IOManager {
       return -1;
     }
 
+    virtual int SendMmsg(struct mmsghdr *msgvec, unsigned int vlen,
+                         int flags) {
+      errno = ENOSYS;
+      return -1;
+    }
+
+    virtual int RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                         struct timespec *timeout) {
+      errno = ENOSYS;
+      return -1;
+    }
+
     virtual int GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
       errno = ENOSYS;
       return -1;
@@ -228,6 +246,16 @@ class IOManager {
       return -1;
     }
 
+    // Adds, modifies or removes the registration of |stream|, a stream held in
+    // trusted memory at enclave file descriptor |fd|, with this epoll
+    // instance. The readiness of such streams is checked inside the enclave.
+    virtual int EpollCtlTrusted(int op, int fd,
+                                const std::shared_ptr<IOContext> &stream,
+                                struct epoll_event *event) {
+      errno = EINVAL;
+      return -1;
+    }
+
     virtual int EpollWait(struct epoll_event *events, int maxevents,
                           int timeout) {
       // EINVAL since file descriptors do not by defualt support epoll behavior.
@@ -253,7 +281,15 @@ class IOManager {
 
     virtual int GetHostFileDescriptor() { return -1; }
 
+    // Returns the subset of the poll(2) |events| for which the stream is
+    // ready, along with POLLERR or POLLHUP if either applies. Streams whose
+    // state is held entirely in trusted memory implement this so that they can
+    // be polled without the host. The default of -1 indicates that readiness
+    // is tracked by the host file descriptor.
+    virtual int GetReadyEvents(short events) { return -1; }
+
    private:
+    friend class IOContextEpoll;
     friend class IOManager;
     friend class NativePathHandler;
   };
@@ -556,8 +592,10 @@ class IOManager {
   // combination of O_CLOEXEC, O_DIRECT, and O_NONBLOCK. The array |pipefd| is
   // used to return two file descriptors referring to the ends of the pipe.
   // |pipefd[0]| refers to the read end while |pipefd[1]| refers to the write
-  // end.
-  virtual int Pipe(int pipefd[2], int flags);
+  // end. If |flags| includes O_SECURE, the pipe is held in trusted memory and
+  // its data never leaves the enclave; such pipes do not support O_DIRECT and
+  // cannot be shared with the host or with forked enclaves.
+  virtual int Pipe(int pipefd[2], int flags) ABSL_LOCKS_EXCLUDED(fd_table_lock_);
 
   // Reads up to |count| bytes from the stream into |buf|, returning the number
   // of bytes read on success or -1 on error.
@@ -651,6 +689,9 @@ class IOManager {
   // Implements pread(2).
   virtual ssize_t PRead(int fd, void *buf, size_t count, off_t offset);
 
+  // Implements pwrite(2).
+  virtual ssize_t PWrite(int fd, const void *buf, size_t count, off_t offset);
+
   // Implements umask(2).
   virtual mode_t Umask(mode_t mask);
 
@@ -736,6 +777,14 @@ class IOManager {
   // Implements recvmsg(2).
   virtual ssize_t RecvMsg(int sockfd, struct msghdr *msg, int flags);
 
+  // Implements sendmmsg(2).
+  virtual int SendMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                       int flags);
+
+  // Implements recvmmsg(2).
+  virtual int RecvMmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+                       int flags, struct timespec *timeout);
+
   // Implements getsockname(2).
   virtual int GetSockName(int sockfd, struct sockaddr *addr,
                           socklen_t *addrlen);
@@ -803,6 +852,22 @@ class IOManager {
   // for obtaining |fd_table_lock_|.
   int CloseFileDescriptor(int fd) ABSL_EXCLUSIVE_LOCKS_REQUIRED(fd_table_lock_);
 
+  // Creates a pipe held in trusted memory. Implements Pipe() for O_SECURE.
+  int TrustedPipe(int pipefd[2], int flags) ABSL_LOCKS_EXCLUDED(fd_table_lock_);
+
+  // Implements select(2) in terms of poll(2), for file descriptor sets that
+  // include streams held in trusted memory.
+  int SelectWithPoll(int nfds, fd_set *readfds, fd_set *writefds,
+                     fd_set *exceptfds, struct timeval *timeout)
+      ABSL_LOCKS_EXCLUDED(fd_table_lock_);
+
+  // Implements poll(2) over |fds| once they have been translated to host file
+  // descriptors, where |trusted_contexts| holds the streams held in trusted
+  // memory at their indices in |fds|.
+  int PollWithTrustedContexts(
+      struct pollfd *fds, nfds_t nfds, int timeout,
+      const std::vector<std::shared_ptr<IOContext>> &trusted_contexts);
+
   // Fetches the VirtualFileHandler associated with a given path, or
   // nullptr if no entry is found.
   VirtualPathHandler *HandlerForPath(absl::string_view path) const;
@@ -89,62 +89,22 @@ int IOContextNative::FLock(int operation) {
   return enc_untrusted_flock(host_fd_, operation);
 }
 
-void IOContextNative::FillIov(const char *buf, int size,
-                              const struct iovec *iov, int iovcnt) {
-  size_t bytes_left = size;
-  for (int i = 0; i < iovcnt; ++i) {
-    if (bytes_left == 0) {
-      break;
-    }
-    int bytes_to_copy = std::min(bytes_left, iov[i].iov_len);
-    memcpy(iov[i].iov_base, buf, bytes_to_copy);
-    buf += bytes_to_copy;
-    bytes_left -= bytes_to_copy;
-  }
-}
-
 ssize_t IOContextNative::Writev(const struct iovec *iov, int iovcnt) {
-  if (iovcnt <= 0) {
-    errno = EINVAL;
-    return -1;
-  }
-
-  size_t total_size = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    total_size += iov[i].iov_len;
-  }
-  std::unique_ptr<char[]> trusted_buf(new char[total_size]);
-  size_t copied_bytes = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    memcpy(trusted_buf.get() + copied_bytes, iov[i].iov_base, iov[i].iov_len);
-    copied_bytes += iov[i].iov_len;
-  }
-
-  return enc_untrusted_write(host_fd_, trusted_buf.get(), total_size);
+  return enc_untrusted_writev(host_fd_, iov, iovcnt);
 }
 
 ssize_t IOContextNative::Readv(const struct iovec *iov, int iovcnt) {
-  if (iovcnt <= 0) {
-    errno = EINVAL;
-    return -1;
-  }
-
-  size_t total_size = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    total_size += iov[i].iov_len;
-  }
-  std::unique_ptr<char[]> trusted_buf(new char[total_size]);
-
-  ssize_t ret = enc_untrusted_read(host_fd_, trusted_buf.get(), total_size);
-  FillIov(trusted_buf.get(), ret, iov, iovcnt);
-
-  return ret;
+  return enc_untrusted_readv(host_fd_, iov, iovcnt);
 }
 
 ssize_t IOContextNative::PRead(void *buf, size_t count, off_t offset) {
   return enc_untrusted_pread64(host_fd_, buf, count, offset);
 }
 
+ssize_t IOContextNative::PWrite(const void *buf, size_t count, off_t offset) {
+  return enc_untrusted_pwrite64(host_fd_, buf, count, offset);
+}
+
 int IOContextNative::SetSockOpt(int level, int option_name,
                                 const void *option_value,
                                 socklen_t option_len) {
@@ -189,6 +149,16 @@ ssize_t IOContextNative::RecvMsg(struct msghdr *msg, int flags) {
   return enc_untrusted_recvmsg(host_fd_, msg, flags);
 }
 
+int IOContextNative::SendMmsg(struct mmsghdr *msgvec, unsigned int vlen,
+                              int flags) {
+  return enc_untrusted_sendmmsg(host_fd_, msgvec, vlen, flags);
+}
+
+int IOContextNative::RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen,
+                              int flags, struct timespec *timeout) {
+  return enc_untrusted_recvmmsg(host_fd_, msgvec, vlen, flags, timeout);
+}
+
 int IOContextNative::GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
   return enc_untrusted_getsockname(host_fd_, addr, addrlen);
 }
@@ -52,6 +52,7 @@ class IOContextNative : public IOManager::IOContext {
   ssize_t Writev(const struct iovec *iov, int iovcnt) override;
   ssize_t Readv(const struct iovec *iov, int iovcnt) override;
   ssize_t PRead(void *buf, size_t count, off_t offset) override;
+  ssize_t PWrite(const void *buf, size_t count, off_t offset) override;
   int SetSockOpt(int level, int option_name, const void *option_value,
                  socklen_t option_len) override;
   int Connect(const struct sockaddr *addr, socklen_t addrlen) override;
@@ -64,6 +65,9 @@ class IOContextNative : public IOManager::IOContext {
   int Listen(int backlog) override;
   ssize_t SendMsg(const struct msghdr *msg, int flags) override;
   ssize_t RecvMsg(struct msghdr *msg, int flags) override;
+  int SendMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags) override;
+  int RecvMmsg(struct mmsghdr *msgvec, unsigned int vlen, int flags,
+               struct timespec *timeout) override;
   int GetSockName(struct sockaddr *addr, socklen_t *addrlen) override;
   int GetPeerName(struct sockaddr *addr, socklen_t *addrlen) override;
   ssize_t RecvFrom(void *buf, size_t len, int flags, struct sockaddr *src_addr,
@@ -73,7 +77,6 @@ class IOContextNative : public IOManager::IOContext {
  private:
   // Host file descriptor implementing this stream.
   int host_fd_;
-  void FillIov(const char *buf, int size, const struct iovec *iov, int iovcnt);
 };
 
 // VirtualPathHandler implementation handling paths to be forwarded to the host.
@@ -46,11 +46,29 @@ ssize_t IOContextSecure::Write(const void *buf, size_t count) {
   return platform::storage::secure_write(host_fd_, buf, count);
 }
 
+ssize_t IOContextSecure::PRead(void *buf, size_t count, off_t offset) {
+  return platform::storage::secure_pread(host_fd_, buf, count, offset);
+}
+
+ssize_t IOContextSecure::PWrite(const void *buf, size_t count, off_t offset) {
+  return platform::storage::secure_pwrite(host_fd_, buf, count, offset);
+}
+
+ssize_t IOContextSecure::Readv(const struct iovec *iov, int iovcnt) {
+  return platform::storage::secure_readv(host_fd_, iov, iovcnt);
+}
+
+ssize_t IOContextSecure::Writev(const struct iovec *iov, int iovcnt) {
+  return platform::storage::secure_writev(host_fd_, iov, iovcnt);
+}
+
 int IOContextSecure::LSeek(off_t offset, int whence) {
   return platform::storage::secure_lseek(host_fd_, offset, whence);
 }
 
-int IOContextSecure::FSync() { return enc_untrusted_fsync(host_fd_); }
+int IOContextSecure::FSync() {
+  return platform::storage::secure_fsync(host_fd_);
+}
 
 int IOContextSecure::FStat(struct stat *st) {
   return platform::storage::secure_fstat(host_fd_, st);
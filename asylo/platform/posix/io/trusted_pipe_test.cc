@@ -0,0 +1,206 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Tests pipes held in trusted memory, which are created by passing O_SECURE to
+// pipe2().
+
+// For pipe2().
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif  // _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+
+class TrustedPipeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    int pipe_fds[2];
+    ASSERT_THAT(pipe2(pipe_fds, O_SECURE | O_NONBLOCK), Eq(0));
+    read_fd_ = pipe_fds[0];
+    write_fd_ = pipe_fds[1];
+  }
+
+  void TearDown() override {
+    close(read_fd_);
+    close(write_fd_);
+  }
+
+  int read_fd_;
+  int write_fd_;
+};
+
+TEST_F(TrustedPipeTest, PipeFdsAreFifos) {
+  struct stat statbuf;
+  ASSERT_THAT(fstat(read_fd_, &statbuf), Eq(0));
+  EXPECT_TRUE(S_ISFIFO(statbuf.st_mode));
+  ASSERT_THAT(fstat(write_fd_, &statbuf), Eq(0));
+  EXPECT_TRUE(S_ISFIFO(statbuf.st_mode));
+}
+
+TEST_F(TrustedPipeTest, RejectsUnsupportedFlags) {
+  int pipe_fds[2];
+  EXPECT_THAT(pipe2(pipe_fds, O_SECURE | O_DIRECT), Eq(-1));
+  EXPECT_THAT(errno, Eq(EINVAL));
+}
+
+TEST_F(TrustedPipeTest, ReadsWhatWasWritten) {
+  const char kMessage[] = "trusted";
+  ASSERT_THAT(write(write_fd_, kMessage, sizeof(kMessage)),
+              Eq(sizeof(kMessage)));
+  char buffer[sizeof(kMessage) * 2];
+  ASSERT_THAT(read(read_fd_, buffer, sizeof(buffer)), Eq(sizeof(kMessage)));
+  EXPECT_STREQ(buffer, kMessage);
+}
+
+TEST_F(TrustedPipeTest, WrongEndFails) {
+  char byte = 0;
+  EXPECT_THAT(read(write_fd_, &byte, 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EBADF));
+  EXPECT_THAT(write(read_fd_, &byte, 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EBADF));
+}
+
+TEST_F(TrustedPipeTest, NonblockingReadOfEmptyPipeFails) {
+  char byte;
+  EXPECT_THAT(read(read_fd_, &byte, 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EAGAIN));
+}
+
+TEST_F(TrustedPipeTest, NonblockingWriteToFullPipeFails) {
+  int capacity = fcntl(write_fd_, F_GETPIPE_SZ);
+  ASSERT_GT(capacity, 0);
+  std::vector<uint8_t> data(capacity + 1);
+  EXPECT_THAT(write(write_fd_, data.data(), data.size()), Eq(capacity));
+  EXPECT_THAT(write(write_fd_, data.data(), 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EAGAIN));
+}
+
+TEST_F(TrustedPipeTest, ClosedWriteEndGivesEof) {
+  char byte = 'x';
+  ASSERT_THAT(write(write_fd_, &byte, 1), Eq(1));
+  ASSERT_THAT(close(write_fd_), Eq(0));
+  write_fd_ = -1;
+  EXPECT_THAT(read(read_fd_, &byte, 1), Eq(1));
+  EXPECT_THAT(read(read_fd_, &byte, 1), Eq(0));
+}
+
+TEST_F(TrustedPipeTest, ClosedReadEndGivesEpipe) {
+  ASSERT_THAT(close(read_fd_), Eq(0));
+  read_fd_ = -1;
+  char byte = 'x';
+  EXPECT_THAT(write(write_fd_, &byte, 1), Eq(-1));
+  EXPECT_THAT(errno, Eq(EPIPE));
+}
+
+TEST_F(TrustedPipeTest, BlockingTransferBetweenThreads) {
+  ASSERT_THAT(fcntl(read_fd_, F_SETFL, 0), Eq(0));
+  ASSERT_THAT(fcntl(write_fd_, F_SETFL, 0), Eq(0));
+
+  // Larger than the pipe, so that both ends block.
+  std::vector<uint8_t> data(fcntl(write_fd_, F_GETPIPE_SZ) * 4);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 31);
+  }
+
+  std::thread writer([this, &data] {
+    EXPECT_THAT(write(write_fd_, data.data(), data.size()), Eq(data.size()));
+    EXPECT_THAT(close(write_fd_), Eq(0));
+  });
+
+  std::vector<uint8_t> received;
+  uint8_t buffer[1000];
+  ssize_t bytes_read;
+  while ((bytes_read = read(read_fd_, buffer, sizeof(buffer))) > 0) {
+    received.insert(received.end(), buffer, buffer + bytes_read);
+  }
+  writer.join();
+  write_fd_ = -1;
+
+  EXPECT_THAT(bytes_read, Eq(0));
+  EXPECT_THAT(received, Eq(data));
+}
+
+TEST_F(TrustedPipeTest, PollReportsReadiness) {
+  struct pollfd fds[2] = {{read_fd_, POLLIN, 0}, {write_fd_, POLLOUT, 0}};
+  EXPECT_THAT(poll(fds, 2, 0), Eq(1));
+  EXPECT_THAT(fds[0].revents, Eq(0));
+  EXPECT_THAT(fds[1].revents, Eq(POLLOUT));
+
+  char byte = 'x';
+  ASSERT_THAT(write(write_fd_, &byte, 1), Eq(1));
+  EXPECT_THAT(poll(fds, 2, 0), Eq(2));
+  EXPECT_THAT(fds[0].revents, Eq(POLLIN));
+  EXPECT_THAT(fds[0].fd, Eq(read_fd_));
+}
+
+TEST_F(TrustedPipeTest, PollWakesOnWrite) {
+  std::thread writer([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    char byte = 'x';
+    EXPECT_THAT(write(write_fd_, &byte, 1), Eq(1));
+  });
+
+  struct pollfd fds[1] = {{read_fd_, POLLIN, 0}};
+  EXPECT_THAT(poll(fds, 1, -1), Eq(1));
+  EXPECT_THAT(fds[0].revents, Eq(POLLIN));
+  writer.join();
+}
+
+TEST_F(TrustedPipeTest, PollTimesOut) {
+  struct pollfd fds[1] = {{read_fd_, POLLIN, 0}};
+  EXPECT_THAT(poll(fds, 1, 10), Eq(0));
+  EXPECT_THAT(fds[0].revents, Eq(0));
+}
+
+TEST_F(TrustedPipeTest, SelectReportsReadiness) {
+  char byte = 'x';
+  ASSERT_THAT(write(write_fd_, &byte, 1), Eq(1));
+
+  fd_set readfds, writefds;
+  FD_ZERO(&readfds);
+  FD_ZERO(&writefds);
+  FD_SET(read_fd_, &readfds);
+  FD_SET(write_fd_, &writefds);
+  struct timeval timeout = {0, 0};
+  int nfds = std::max(read_fd_, write_fd_) + 1;
+  EXPECT_THAT(select(nfds, &readfds, &writefds, nullptr, &timeout), Eq(2));
+  EXPECT_TRUE(FD_ISSET(read_fd_, &readfds));
+  EXPECT_TRUE(FD_ISSET(write_fd_, &writefds));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/wait_event.h"
+
+#include <fcntl.h>
+
+#include <climits>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+
+namespace asylo {
+namespace io {
+
+constexpr int WaitEvent::kSpinIterations;
+
+WaitEvent::WaitEvent()
+    : waiters_(0),
+      generation_(0),
+      queue_(enc_untrusted_create_wait_queue()),
+      host_waiters_(0),
+      host_wakeup_pending_(false),
+      host_wakeup_fds_{{-1}, {-1}} {
+  if (queue_) {
+    enc_untrusted_wait_queue_set_value(queue_, 0);
+  }
+}
+
+WaitEvent::~WaitEvent() {
+  if (queue_) {
+    enc_untrusted_destroy_wait_queue(queue_);
+  }
+  for (std::atomic<int> &fd : host_wakeup_fds_) {
+    if (fd.load() >= 0) {
+      enc_untrusted_close(fd.load());
+    }
+  }
+}
+
+int32_t WaitEvent::Prepare() {
+  waiters_.fetch_add(1);
+  return generation_.load();
+}
+
+void WaitEvent::Cancel() { waiters_.fetch_sub(1); }
+
+void WaitEvent::Wait(int32_t token, uint64_t timeout_microsec) {
+  // Returns immediately if a Notify() has already published a newer
+  // generation to the futex word. Without a futex word, waiters degrade to
+  // spinning.
+  if (queue_) {
+    enc_untrusted_thread_wait_value(queue_, token, timeout_microsec);
+  }
+  waiters_.fetch_sub(1);
+}
+
+void WaitEvent::Notify() {
+  // A waiter registers itself before checking its condition, and the notifier
+  // changes the condition before checking for waiters, so at least one side
+  // observes the other.
+  if (host_waiters_.load() > 0 && host_wakeup_fds_[1].load() >= 0 &&
+      !host_wakeup_pending_.exchange(true)) {
+    char byte = 0;
+    enc_untrusted_write(host_wakeup_fds_[1].load(), &byte, sizeof(byte));
+  }
+  if (waiters_.load() == 0 || !queue_) {
+    return;
+  }
+  absl::MutexLock lock(&notify_mutex_);
+  int32_t generation = generation_.fetch_add(1) + 1;
+  enc_untrusted_wait_queue_set_value(queue_, generation);
+  enc_untrusted_notify(queue_, INT_MAX);
+}
+
+int WaitEvent::PrepareHostWait() {
+  host_waiters_.fetch_add(1);
+  int read_fd = host_wakeup_fds_[0].load();
+  if (read_fd >= 0) {
+    return read_fd;
+  }
+  absl::MutexLock lock(&host_wakeup_mutex_);
+  read_fd = host_wakeup_fds_[0].load();
+  if (read_fd < 0) {
+    int fds[2];
+    if (enc_untrusted_pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+      return -1;
+    }
+    host_wakeup_fds_[1].store(fds[1]);
+    host_wakeup_fds_[0].store(fds[0]);
+    read_fd = fds[0];
+  }
+  return read_fd;
+}
+
+void WaitEvent::FinishHostWait() { host_waiters_.fetch_sub(1); }
+
+void WaitEvent::DrainHostWakeup() {
+  absl::MutexLock lock(&host_wakeup_mutex_);
+  char buf[64];
+  while (enc_untrusted_read(host_wakeup_fds_[0].load(), buf, sizeof(buf)) ==
+         sizeof(buf)) {
+  }
+  // Cleared only after reading, so that a concurrent Notify() is either
+  // drained here or writes a fresh byte. A notifier that set the flag before
+  // the read is covered by the caller re-checking its condition.
+  host_wakeup_pending_.store(false);
+}
+
+WaitEvent &TrustedReadinessEvent() {
+  static WaitEvent *event = new WaitEvent;
+  return *event;
+}
+
+}  // namespace io
+}  // namespace asylo
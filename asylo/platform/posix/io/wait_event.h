@@ -0,0 +1,155 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_WAIT_EVENT_H_
+#define ASYLO_PLATFORM_POSIX_IO_WAIT_EVENT_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+
+namespace asylo {
+namespace io {
+
+// The longest time, in milliseconds, that a host waiter of a WaitEvent (see
+// WaitEvent::PrepareHostWait()) waits on the host before re-checking its
+// condition.
+constexpr int kHostWaitSliceMs = 10;
+
+// An event that enclave threads can block on while waiting for a condition on
+// state held in trusted memory to change.
+//
+// Waiters first spin inside the enclave, and only then exit to sleep on a futex
+// word in untrusted memory. Notifiers exit the enclave only when there are
+// sleeping waiters, so signaling an event nobody waits on is free of host
+// calls. The futex word only ever carries a generation counter; the condition
+// itself is always re-checked in trusted memory, so a host that tampers with
+// the word can at worst cause spurious wakeups or stalls.
+class WaitEvent {
+ public:
+  WaitEvent();
+
+  // Releases the futex word and the host wakeup pipe. There must be no waiters
+  // left.
+  ~WaitEvent();
+
+  WaitEvent(const WaitEvent &) = delete;
+  WaitEvent &operator=(const WaitEvent &) = delete;
+
+  // Registers the calling thread as a waiter and returns a token to pass to
+  // Wait(). The caller must check its condition after calling Prepare() and
+  // then call either Wait() or Cancel().
+  int32_t Prepare();
+
+  // Unregisters a waiter registered by Prepare() without blocking.
+  void Cancel();
+
+  // Blocks until Notify() has been called since the Prepare() call that
+  // returned |token|, or until |timeout_microsec| microseconds have elapsed. A
+  // |timeout_microsec| of zero waits indefinitely. May return spuriously.
+  // Unregisters the waiter registered by Prepare().
+  void Wait(int32_t token, uint64_t timeout_microsec = 0);
+
+  // Wakes all threads blocked in Wait(), and all threads waiting on the host
+  // after PrepareHostWait().
+  void Notify();
+
+  // Registers the calling thread as a waiter that blocks on the host, such as
+  // in poll(2) or epoll_wait(2) over host file descriptors, rather than in
+  // Wait(). Returns a host file descriptor that becomes readable when Notify()
+  // is called, for the caller to wait on alongside its own, or -1 if none
+  // could be created. The caller must check its condition after calling
+  // PrepareHostWait() and call FinishHostWait() once it stops waiting, whether
+  // or not a file descriptor was returned.
+  //
+  // All host waiters share the file descriptor, and the first to see it
+  // readable drains it, so a waiter that starts waiting just after another
+  // drains it can miss a notification. Host waiters must therefore bound their
+  // waits and re-check their condition.
+  int PrepareHostWait();
+
+  // Unregisters a waiter registered by PrepareHostWait().
+  void FinishHostWait();
+
+  // Drains the file descriptor returned by PrepareHostWait() after a host
+  // waiter has seen it readable, so that it only becomes readable again on the
+  // next Notify().
+  void DrainHostWakeup();
+
+  // Blocks until |ready| returns true, spinning briefly before sleeping.
+  template <typename Predicate>
+  void Await(Predicate ready) {
+    for (int i = 0; i < kSpinIterations; ++i) {
+      if (ready()) {
+        return;
+      }
+      enc_pause();
+    }
+    while (true) {
+      int32_t token = Prepare();
+      if (ready()) {
+        Cancel();
+        return;
+      }
+      Wait(token);
+    }
+  }
+
+ private:
+  // The number of times Await() checks its condition before sleeping.
+  static constexpr int kSpinIterations = 1000;
+
+  // Number of threads between Prepare() and the end of Wait() or Cancel().
+  std::atomic<int32_t> waiters_;
+
+  // Incremented by every Notify() that observes a waiter.
+  std::atomic<int32_t> generation_;
+
+  // Orders updates of |queue_| so that it never goes back to a stale
+  // generation.
+  absl::Mutex notify_mutex_;
+
+  // Futex word in untrusted memory mirroring |generation_|.
+  int32_t *const queue_;
+
+  // Number of threads between PrepareHostWait() and FinishHostWait().
+  std::atomic<int32_t> host_waiters_;
+
+  // Whether a byte has been written to |host_wakeup_fds_| since it was last
+  // drained. Limits notifications to one host call per drain.
+  std::atomic<bool> host_wakeup_pending_;
+
+  // Guards the creation of |host_wakeup_fds_| and draining of its read end.
+  absl::Mutex host_wakeup_mutex_;
+
+  // Non-blocking host pipe written by Notify() when there are host waiters, or
+  // -1 until the first call to PrepareHostWait().
+  std::atomic<int> host_wakeup_fds_[2];
+};
+
+// Returns the event notified whenever the readiness of a stream held in trusted
+// memory changes. Used to wake poll(2) and select(2) callers waiting on such
+// streams.
+WaitEvent &TrustedReadinessEvent();
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_WAIT_EVENT_H_
@@ -41,6 +41,12 @@ uint8_t *switched_heap_next = nullptr;
 // requested size is larger than the remaining size.
 size_t switched_heap_remaining = 0;
 
+// The hooks installed while the heap is not switched, or nullptr to use the
+// newlib allocator.
+void *(*normal_malloc_hook)(size_t, void *) = nullptr;
+void *(*normal_realloc_hook)(void *, size_t, void *) = nullptr;
+void (*normal_free_hook)(void *, void *) = nullptr;
+
 // Allocate memory on an address space provided by the user.
 // This function is not thread-safe. This should only be used by fork during
 // snapshotting/restoring while other threads are not allowed to enter the
@@ -95,8 +101,21 @@ void heap_switch(void *base, size_t size) {
   } else {
     switched_heap_next = nullptr;
     switched_heap_remaining = 0;
-    set_malloc_hook(/*hook=*/nullptr, /*pool=*/nullptr);
-    set_realloc_hook(/*hook=*/nullptr, /*pool=*/nullptr);
-    set_free_hook(/*hook=*/nullptr, /*pool=*/nullptr);
+    set_malloc_hook(normal_malloc_hook, /*pool=*/nullptr);
+    set_realloc_hook(normal_realloc_hook, /*pool=*/nullptr);
+    set_free_hook(normal_free_hook, /*pool=*/nullptr);
+  }
+}
+
+void set_normal_heap_hooks(void *(*malloc_hook)(size_t, void *),
+                           void *(*realloc_hook)(void *, size_t, void *),
+                           void (*free_hook)(void *, void *)) {
+  normal_malloc_hook = malloc_hook;
+  normal_realloc_hook = realloc_hook;
+  normal_free_hook = free_hook;
+  if (!switched_heap_next) {
+    set_malloc_hook(normal_malloc_hook, /*pool=*/nullptr);
+    set_realloc_hook(normal_realloc_hook, /*pool=*/nullptr);
+    set_free_hook(normal_free_hook, /*pool=*/nullptr);
   }
 }
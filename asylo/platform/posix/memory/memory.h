@@ -40,6 +40,14 @@ size_t GetSwitchedHeapRemaining();
 // enclave.
 void heap_switch(void *base, size_t size);
 
+// Sets the malloc, realloc and free hooks used on the normal heap. They are
+// installed immediately, unless the heap is switched, and whenever heap_switch
+// switches back to the normal heap. Passing nullptr hooks restores the newlib
+// allocator. This function is not thread-safe.
+void set_normal_heap_hooks(void *(*malloc_hook)(size_t, void *),
+                           void *(*realloc_hook)(void *, size_t, void *),
+                           void (*free_hook)(void *, void *));
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,393 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/memory/thread_caching_allocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "asylo/platform/primitives/trusted_runtime.h"
+#include "asylo/util/lock_guard.h"
+
+namespace asylo {
+namespace {
+
+// Adds |delta| to a counter which is only written by one thread at a time.
+template <typename T>
+void AddToCounter(std::atomic<T> *counter, T delta) {
+  counter->store(counter->load(std::memory_order_relaxed) + delta,
+                 std::memory_order_relaxed);
+}
+
+// Returns the index of the arena table slot at which probing for the arena
+// based at |base| starts.
+size_t ArenaSlot(uintptr_t base, size_t table_size) {
+  uint64_t key = base >> ThreadCachingAllocator::kArenaShift;
+  return (key * 0x9e3779b97f4a7c15ull) % table_size;
+}
+
+}  // namespace
+
+constexpr size_t ThreadCachingAllocator::kAlignment;
+constexpr size_t ThreadCachingAllocator::kMaxSmallSize;
+constexpr int ThreadCachingAllocator::kNumClasses;
+constexpr size_t ThreadCachingAllocator::kSpanSize;
+constexpr int ThreadCachingAllocator::kArenaShift;
+constexpr size_t ThreadCachingAllocator::kArenaSize;
+constexpr size_t ThreadCachingAllocator::kSpansPerArena;
+constexpr size_t ThreadCachingAllocator::kMaxArenas;
+constexpr size_t ThreadCachingAllocator::kMaxThreadCaches;
+
+int ThreadCachingAllocator::SizeClass(size_t size) {
+  if (size <= 128) {
+    return size == 0 ? 0 : static_cast<int>((size - 1) / 16);
+  }
+  // |size| is in (2^k, 2^(k+1)], which is divided into four classes.
+  int k = 63 - __builtin_clzll(size - 1);
+  size_t step = size_t{1} << (k - 2);
+  return 8 + (k - 7) * 4 +
+         static_cast<int>((size - (size_t{1} << k) - 1) / step);
+}
+
+size_t ThreadCachingAllocator::ClassSize(int size_class) {
+  if (size_class < 8) {
+    return 16 * (size_class + 1);
+  }
+  int k = 7 + (size_class - 8) / 4;
+  int quarter = (size_class - 8) % 4 + 1;
+  return (size_t{1} << k) + quarter * (size_t{1} << (k - 2));
+}
+
+size_t ThreadCachingAllocator::BatchSize(int size_class) {
+  return std::min<size_t>(
+      32, std::max<size_t>(2, 16 * 1024 / ClassSize(size_class)));
+}
+
+void *ThreadCachingAllocator::Allocate(size_t size) {
+  if (size > kMaxSmallSize) {
+    fallback_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return backend_.allocate(size);
+  }
+  int size_class = SizeClass(size);
+  ThreadCache *cache = GetThreadCache();
+  if (cache == nullptr) {
+    FreeObject *object = nullptr;
+    if (Refill(size_class, 1, &object) == 0) {
+      fallback_allocations_.fetch_add(1, std::memory_order_relaxed);
+      return backend_.allocate(size);
+    }
+    uncached_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return object;
+  }
+
+  ThreadCache::FreeList &list = cache->lists[size_class];
+  if (list.head != nullptr) {
+    AddToCounter<uint64_t>(&cache->hits, 1);
+  } else {
+    list.length = Refill(size_class, BatchSize(size_class), &list.head);
+    if (list.length == 0) {
+      fallback_allocations_.fetch_add(1, std::memory_order_relaxed);
+      return backend_.allocate(size);
+    }
+    AddToCounter(&cache->free_bytes, list.length * ClassSize(size_class));
+  }
+  FreeObject *object = list.head;
+  list.head = object->next;
+  --list.length;
+  AddToCounter<uint64_t>(&cache->allocations, 1);
+  AddToCounter(&cache->free_bytes, -ClassSize(size_class));
+  return object;
+}
+
+void ThreadCachingAllocator::Deallocate(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  const Arena *arena = FindArena(ptr);
+  if (arena == nullptr) {
+    backend_.deallocate(ptr);
+    return;
+  }
+  size_t span = (reinterpret_cast<uintptr_t>(ptr) -
+                 arena->base.load(std::memory_order_relaxed)) /
+                kSpanSize;
+  int size_class =
+      arena->span_classes[span].load(std::memory_order_relaxed) - 1;
+  FreeObject *object = static_cast<FreeObject *>(ptr);
+
+  ThreadCache *cache = GetThreadCache();
+  if (cache == nullptr) {
+    object->next = nullptr;
+    Release(size_class, object, object, 1);
+    uncached_frees_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ThreadCache::FreeList &list = cache->lists[size_class];
+  object->next = list.head;
+  list.head = object;
+  ++list.length;
+  AddToCounter<uint64_t>(&cache->frees, 1);
+  AddToCounter(&cache->free_bytes, ClassSize(size_class));
+
+  // Return a batch to the central free list once the thread has freed enough
+  // objects that it is unlikely to allocate them again soon.
+  size_t batch = BatchSize(size_class);
+  if (list.length > 2 * batch) {
+    FreeObject *head = list.head;
+    FreeObject *tail = head;
+    for (size_t i = 1; i < batch; ++i) {
+      tail = tail->next;
+    }
+    list.head = tail->next;
+    list.length -= batch;
+    AddToCounter(&cache->free_bytes, -batch * ClassSize(size_class));
+    Release(size_class, head, tail, batch);
+  }
+}
+
+void *ThreadCachingAllocator::Reallocate(void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return Allocate(size);
+  }
+  if (size == 0) {
+    Deallocate(ptr);
+    return nullptr;
+  }
+  if (!Owns(ptr)) {
+    return backend_.reallocate(ptr, size);
+  }
+  size_t usable_size = UsableSize(ptr);
+  if (size <= usable_size && SizeClass(size) == SizeClass(usable_size)) {
+    return ptr;
+  }
+  void *result = Allocate(size);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  memcpy(result, ptr, std::min(size, usable_size));
+  Deallocate(ptr);
+  return result;
+}
+
+bool ThreadCachingAllocator::Owns(const void *ptr) const {
+  return ptr != nullptr && FindArena(ptr) != nullptr;
+}
+
+size_t ThreadCachingAllocator::UsableSize(const void *ptr) const {
+  const Arena *arena = FindArena(ptr);
+  size_t span = (reinterpret_cast<uintptr_t>(ptr) -
+                 arena->base.load(std::memory_order_relaxed)) /
+                kSpanSize;
+  return ClassSize(arena->span_classes[span].load(std::memory_order_relaxed) -
+                   1);
+}
+
+void ThreadCachingAllocator::FlushThreadCache() {
+  ThreadCache *cache = GetThreadCache();
+  if (cache == nullptr) {
+    return;
+  }
+  for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+    ThreadCache::FreeList &list = cache->lists[size_class];
+    if (list.head == nullptr) {
+      continue;
+    }
+    FreeObject *tail = list.head;
+    while (tail->next != nullptr) {
+      tail = tail->next;
+    }
+    Release(size_class, list.head, tail, list.length);
+    list.head = nullptr;
+    list.length = 0;
+  }
+  cache->free_bytes.store(0, std::memory_order_relaxed);
+}
+
+AllocatorStats ThreadCachingAllocator::Stats() const {
+  AllocatorStats stats;
+  stats.small_allocations =
+      uncached_allocations_.load(std::memory_order_relaxed);
+  stats.small_frees = uncached_frees_.load(std::memory_order_relaxed);
+  for (const ThreadCache &cache : caches_) {
+    if (cache.owner.load(std::memory_order_relaxed) == kInvalidThread) {
+      continue;
+    }
+    ++stats.thread_caches;
+    stats.small_allocations += cache.allocations.load(std::memory_order_relaxed);
+    stats.small_frees += cache.frees.load(std::memory_order_relaxed);
+    stats.thread_cache_hits += cache.hits.load(std::memory_order_relaxed);
+    stats.thread_cache_free_bytes +=
+        cache.free_bytes.load(std::memory_order_relaxed);
+  }
+  for (const CentralFreeList &central : central_) {
+    stats.central_transfers += central.transfers.load(std::memory_order_relaxed);
+    stats.central_free_bytes +=
+        central.free_bytes.load(std::memory_order_relaxed);
+  }
+  stats.fallback_allocations =
+      fallback_allocations_.load(std::memory_order_relaxed);
+  stats.arena_bytes = arena_count_.load(std::memory_order_relaxed) * kArenaSize;
+  stats.span_bytes = span_count_.load(std::memory_order_relaxed) * kSpanSize;
+  return stats;
+}
+
+ThreadCachingAllocator::ThreadCache *ThreadCachingAllocator::GetThreadCache() {
+  // The cache last used by the calling thread, and the allocator whose caches
+  // were last found to be all claimed by other threads. Both are checked
+  // against the allocator and the thread's identity, since thread-local storage
+  // is shared by every allocator and may outlive an enclave thread.
+  static thread_local ThreadCache *last_cache = nullptr;
+  static thread_local const ThreadCachingAllocator *exhausted = nullptr;
+
+  const uint64_t self = enc_thread_self();
+  ThreadCache *cache = last_cache;
+  if (cache >= caches_ && cache < caches_ + kMaxThreadCaches &&
+      cache->owner.load(std::memory_order_relaxed) == self) {
+    return cache;
+  }
+  if (exhausted == this) {
+    return nullptr;
+  }
+
+  for (ThreadCache &candidate : caches_) {
+    if (candidate.owner.load(std::memory_order_relaxed) == self) {
+      last_cache = &candidate;
+      return last_cache;
+    }
+  }
+  for (ThreadCache &candidate : caches_) {
+    uint64_t unclaimed = kInvalidThread;
+    if (candidate.owner.compare_exchange_strong(unclaimed, self,
+                                                std::memory_order_acquire)) {
+      last_cache = &candidate;
+      return last_cache;
+    }
+  }
+  exhausted = this;
+  return nullptr;
+}
+
+const ThreadCachingAllocator::Arena *ThreadCachingAllocator::FindArena(
+    const void *ptr) const {
+  const uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(kArenaSize - 1);
+  const size_t table_size = sizeof(arenas_) / sizeof(arenas_[0]);
+  size_t slot = ArenaSlot(base, table_size);
+  for (size_t probes = 0; probes < table_size; ++probes) {
+    uintptr_t entry = arenas_[slot].base.load(std::memory_order_acquire);
+    if (entry == base) {
+      return &arenas_[slot];
+    }
+    if (entry == 0) {
+      return nullptr;
+    }
+    slot = (slot + 1) % table_size;
+  }
+  return nullptr;
+}
+
+size_t ThreadCachingAllocator::Refill(int size_class, size_t count,
+                                      FreeObject **list) {
+  CentralFreeList *central = &central_[size_class];
+  LockGuard<TrustedSpinLock> lock(&central->lock);
+  if (central->head == nullptr && !CarveSpan(size_class, central)) {
+    return 0;
+  }
+  FreeObject *head = central->head;
+  FreeObject *tail = head;
+  size_t moved = 1;
+  while (moved < count && tail->next != nullptr) {
+    tail = tail->next;
+    ++moved;
+  }
+  central->head = tail->next;
+  central->length -= moved;
+  tail->next = nullptr;
+  *list = head;
+  AddToCounter<uint64_t>(&central->transfers, 1);
+  AddToCounter(&central->free_bytes, -moved * ClassSize(size_class));
+  return moved;
+}
+
+void ThreadCachingAllocator::Release(int size_class, FreeObject *head,
+                                     FreeObject *tail, size_t count) {
+  CentralFreeList *central = &central_[size_class];
+  LockGuard<TrustedSpinLock> lock(&central->lock);
+  tail->next = central->head;
+  central->head = head;
+  central->length += count;
+  AddToCounter<uint64_t>(&central->transfers, 1);
+  AddToCounter(&central->free_bytes, count * ClassSize(size_class));
+}
+
+bool ThreadCachingAllocator::CarveSpan(int size_class,
+                                       CentralFreeList *central) {
+  char *span = static_cast<char *>(AllocateSpan(size_class));
+  if (span == nullptr) {
+    return false;
+  }
+  size_t size = ClassSize(size_class);
+  size_t count = kSpanSize / size;
+  for (size_t i = 0; i + 1 < count; ++i) {
+    reinterpret_cast<FreeObject *>(span + i * size)->next =
+        reinterpret_cast<FreeObject *>(span + (i + 1) * size);
+  }
+  reinterpret_cast<FreeObject *>(span + (count - 1) * size)->next =
+      central->head;
+  central->head = reinterpret_cast<FreeObject *>(span);
+  central->length += count;
+  AddToCounter(&central->free_bytes, count * size);
+  return true;
+}
+
+void *ThreadCachingAllocator::AllocateSpan(int size_class) {
+  LockGuard<TrustedSpinLock> lock(&page_heap_lock_);
+  if (current_arena_ == nullptr || next_span_ == kSpansPerArena) {
+    if (arena_count_.load(std::memory_order_relaxed) >= kMaxArenas) {
+      return nullptr;
+    }
+    void *memory = backend_.allocate_aligned(kArenaSize, kArenaSize);
+    if (memory == nullptr) {
+      return nullptr;
+    }
+    current_arena_ = RegisterArena(reinterpret_cast<uintptr_t>(memory));
+    next_span_ = 0;
+  }
+  size_t span = next_span_++;
+  current_arena_->span_classes[span].store(size_class + 1,
+                                           std::memory_order_relaxed);
+  AddToCounter<size_t>(&span_count_, 1);
+  return reinterpret_cast<void *>(
+      current_arena_->base.load(std::memory_order_relaxed) + span * kSpanSize);
+}
+
+ThreadCachingAllocator::Arena *ThreadCachingAllocator::RegisterArena(
+    uintptr_t base) {
+  // The table has twice as many slots as there are arenas, so an empty slot is
+  // always found.
+  const size_t table_size = sizeof(arenas_) / sizeof(arenas_[0]);
+  size_t slot = ArenaSlot(base, table_size);
+  while (arenas_[slot].base.load(std::memory_order_relaxed) != 0) {
+    slot = (slot + 1) % table_size;
+  }
+  arenas_[slot].base.store(base, std::memory_order_release);
+  AddToCounter<size_t>(&arena_count_, 1);
+  return &arenas_[slot];
+}
+
+}  // namespace asylo
@@ -0,0 +1,246 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_ALLOCATOR_H_
+#define ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/platform/core/trusted_spin_lock.h"
+
+namespace asylo {
+
+// Totals reported by a ThreadCachingAllocator.
+struct AllocatorStats {
+  // The number of allocations and frees served by the size classes.
+  uint64_t small_allocations = 0;
+  uint64_t small_frees = 0;
+
+  // The number of small allocations served from the calling thread's cache
+  // without taking a lock.
+  uint64_t thread_cache_hits = 0;
+
+  // The number of batches moved between thread caches and the central free
+  // lists.
+  uint64_t central_transfers = 0;
+
+  // The number of allocations passed to the fallback allocator, because they
+  // were too large for any size class or the arenas were exhausted.
+  uint64_t fallback_allocations = 0;
+
+  // The bytes obtained from the page allocator for arenas, and the bytes of
+  // arenas carved into spans of objects.
+  size_t arena_bytes = 0;
+  size_t span_bytes = 0;
+
+  // The bytes of free objects held in thread caches and central free lists.
+  size_t thread_cache_free_bytes = 0;
+  size_t central_free_bytes = 0;
+
+  // The number of thread caches claimed by threads.
+  size_t thread_caches = 0;
+};
+
+// A malloc implementation which serves small allocations from per-thread caches
+// of fixed size classes, so that the common allocation and free paths take no
+// lock.
+//
+// Each thread cache holds a free list per size class. An empty list is refilled
+// with a batch of objects from the central free list of its class, and a list
+// that grows past twice the batch size returns a batch to it. Central free
+// lists are refilled by carving spans of kSpanSize bytes out of arenas of
+// kArenaSize bytes obtained from the page allocator, and each central list has
+// its own lock, so that threads only contend when they use the same class at
+// the same time. Spans stay with their size class once carved.
+//
+// Allocations larger than kMaxSmallSize, and frees and reallocations of memory
+// the allocator does not own, are passed to the fallback allocator. This allows
+// the allocator to be installed while memory allocated by the fallback
+// allocator is still live.
+//
+// A thread's cache is identified by enc_thread_self(), so a cache is kept by an
+// enclave thread across entries and is inherited by the next thread to use the
+// same thread identity. Threads beyond kMaxThreadCaches use the central free
+// lists directly.
+//
+// The allocator is constant-initialized and has a trivial destructor, so a
+// global instance is usable before and after static constructors run.
+class ThreadCachingAllocator {
+ public:
+  // The functions through which the allocator obtains memory.
+  struct Backend {
+    // Allocates |size| bytes aligned to |alignment|. Arenas are never freed.
+    void *(*allocate_aligned)(size_t alignment, size_t size);
+
+    // The fallback allocator.
+    void *(*allocate)(size_t size);
+    void *(*reallocate)(void *ptr, size_t size);
+    void (*deallocate)(void *ptr);
+  };
+
+  // Size classes are multiples of 16 bytes up to 128 bytes, followed by four
+  // classes per power of two up to kMaxSmallSize.
+  static constexpr size_t kAlignment = 16;
+  static constexpr size_t kMaxSmallSize = 32 * 1024;
+  static constexpr int kNumClasses = 8 + 4 * 8;
+
+  static constexpr size_t kSpanSize = 64 * 1024;
+  static constexpr int kArenaShift = 20;
+  static constexpr size_t kArenaSize = size_t{1} << kArenaShift;
+  static constexpr size_t kSpansPerArena = kArenaSize / kSpanSize;
+
+  // The maximum number of arenas, which bounds the memory held in size classes
+  // to kMaxArenas * kArenaSize bytes. Small allocations are passed to the
+  // fallback allocator once the limit is reached.
+  static constexpr size_t kMaxArenas = 1024;
+
+  static constexpr size_t kMaxThreadCaches = 64;
+
+  constexpr explicit ThreadCachingAllocator(Backend backend)
+      : backend_(backend) {}
+
+  ThreadCachingAllocator(const ThreadCachingAllocator &other) = delete;
+  ThreadCachingAllocator &operator=(const ThreadCachingAllocator &other) =
+      delete;
+
+  // Allocates, frees and reallocates memory with the semantics of malloc, free
+  // and realloc. Allocate(0) returns a unique pointer, and Reallocate(ptr, 0)
+  // frees |ptr| and returns nullptr.
+  void *Allocate(size_t size);
+  void Deallocate(void *ptr);
+  void *Reallocate(void *ptr, size_t size);
+
+  // Returns true if |ptr| points into an object of one of the size classes.
+  bool Owns(const void *ptr) const;
+
+  // Returns the number of bytes usable at |ptr|, which must be owned by the
+  // allocator.
+  size_t UsableSize(const void *ptr) const;
+
+  // Returns the free objects in the calling thread's cache to the central free
+  // lists.
+  void FlushThreadCache();
+
+  // Returns the current totals of the allocator.
+  AllocatorStats Stats() const;
+
+  // Returns the size class of an allocation of |size| bytes, which must be at
+  // most kMaxSmallSize, and the size of the objects of |size_class|.
+  static int SizeClass(size_t size);
+  static size_t ClassSize(int size_class);
+
+  // Returns the number of objects moved between a thread cache and the central
+  // free list of |size_class| at a time.
+  static size_t BatchSize(int size_class);
+
+ private:
+  // A free object, linked through its first word.
+  struct FreeObject {
+    FreeObject *next;
+  };
+
+  struct ThreadCache {
+    struct FreeList {
+      FreeObject *head = nullptr;
+      size_t length = 0;
+    };
+
+    // The enc_thread_self() value of the thread which claimed the cache, or
+    // kInvalidThread. Only the owner reads or writes the rest of the cache,
+    // except for the counters, which are read by Stats().
+    std::atomic<uint64_t> owner{0};
+    FreeList lists[kNumClasses];
+
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<size_t> free_bytes{0};
+  };
+
+  struct alignas(kCacheLineSize) CentralFreeList {
+    TrustedSpinLock lock{/*is_recursive=*/false};
+    FreeObject *head = nullptr;
+    size_t length = 0;
+    std::atomic<uint64_t> transfers{0};
+    std::atomic<size_t> free_bytes{0};
+  };
+
+  // An arena and the size classes of its spans. Entries of the arena table are
+  // published by storing |base| and never change afterwards.
+  struct Arena {
+    std::atomic<uintptr_t> base{0};
+    std::atomic<uint8_t> span_classes[kSpansPerArena] = {};
+  };
+
+  // Returns the calling thread's cache, claiming one if necessary, or nullptr
+  // if every cache is claimed by another thread.
+  ThreadCache *GetThreadCache();
+
+  // Returns the arena containing |ptr|, or nullptr if it is not in an arena.
+  const Arena *FindArena(const void *ptr) const;
+
+  // Moves up to |count| objects of |size_class| from its central free list to
+  // |list|, carving a new span if the central list is empty. Returns the number
+  // of objects moved.
+  size_t Refill(int size_class, size_t count, FreeObject **list);
+
+  // Returns the |count| objects in the list from |head| to |tail| to the
+  // central free list of |size_class|.
+  void Release(int size_class, FreeObject *head, FreeObject *tail,
+               size_t count);
+
+  // Carves a new span into objects of |size_class| and pushes them onto its
+  // central free list, which must be locked. Returns false if no memory is
+  // available.
+  bool CarveSpan(int size_class, CentralFreeList *central);
+
+  // Returns the base address of a span assigned to |size_class|, or nullptr.
+  void *AllocateSpan(int size_class);
+
+  // Inserts |base| into the arena table and returns its entry. Must be called
+  // with |page_heap_lock_| held and fewer than kMaxArenas arenas registered.
+  Arena *RegisterArena(uintptr_t base);
+
+  const Backend backend_;
+
+  CentralFreeList central_[kNumClasses];
+
+  // Guards the current arena and the arena table insertions.
+  TrustedSpinLock page_heap_lock_{/*is_recursive=*/false};
+  Arena *current_arena_ = nullptr;
+  size_t next_span_ = 0;
+  std::atomic<size_t> arena_count_{0};
+  std::atomic<size_t> span_count_{0};
+  std::atomic<uint64_t> fallback_allocations_{0};
+
+  // Allocations and frees by threads without a cache.
+  std::atomic<uint64_t> uncached_allocations_{0};
+  std::atomic<uint64_t> uncached_frees_{0};
+
+  // An open-addressed hash table of arenas, keyed by base address.
+  Arena arenas_[2 * kMaxArenas];
+
+  ThreadCache caches_[kMaxThreadCaches];
+  std::atomic<size_t> cache_count_{0};
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_ALLOCATOR_H_
@@ -0,0 +1,209 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/memory/thread_caching_allocator.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Le;
+
+void *AllocateAligned(size_t alignment, size_t size) {
+  void *ptr = nullptr;
+  return posix_memalign(&ptr, alignment, size) == 0 ? ptr : nullptr;
+}
+
+const ThreadCachingAllocator::Backend kBackend = {AllocateAligned, malloc,
+                                                  realloc, free};
+
+class ThreadCachingAllocatorTest : public ::testing::Test {
+ protected:
+  ThreadCachingAllocatorTest()
+      : allocator_(new ThreadCachingAllocator(kBackend)) {}
+
+  // Arenas are never freed, so the allocator is leaked along with them.
+  ~ThreadCachingAllocatorTest() override { allocator_.release(); }
+
+  std::unique_ptr<ThreadCachingAllocator> allocator_;
+};
+
+TEST(ThreadCachingAllocatorSizeClassTest, ClassesCoverEverySmallSize) {
+  int previous_class = 0;
+  for (size_t size = 1; size <= ThreadCachingAllocator::kMaxSmallSize;
+       ++size) {
+    int size_class = ThreadCachingAllocator::SizeClass(size);
+    ASSERT_THAT(size_class, Ge(previous_class));
+    ASSERT_THAT(size_class, Le(previous_class + 1));
+    ASSERT_THAT(ThreadCachingAllocator::ClassSize(size_class), Ge(size));
+    if (size_class > 0) {
+      ASSERT_THAT(ThreadCachingAllocator::ClassSize(size_class - 1),
+                  testing::Lt(size));
+    }
+    ASSERT_THAT(ThreadCachingAllocator::ClassSize(size_class) %
+                    ThreadCachingAllocator::kAlignment,
+                Eq(0));
+    previous_class = size_class;
+  }
+  EXPECT_THAT(previous_class, Eq(ThreadCachingAllocator::kNumClasses - 1));
+}
+
+TEST_F(ThreadCachingAllocatorTest, AllocatesAlignedDistinctObjects) {
+  std::vector<void *> objects;
+  for (size_t size = 0; size <= 4096; size += 7) {
+    void *object = allocator_->Allocate(size);
+    ASSERT_NE(object, nullptr);
+    EXPECT_THAT(reinterpret_cast<uintptr_t>(object) %
+                    ThreadCachingAllocator::kAlignment,
+                Eq(0));
+    EXPECT_TRUE(allocator_->Owns(object));
+    EXPECT_THAT(allocator_->UsableSize(object), Ge(size));
+    memset(object, 0xa5, size);
+    objects.push_back(object);
+  }
+  std::sort(objects.begin(), objects.end());
+  EXPECT_TRUE(std::adjacent_find(objects.begin(), objects.end()) ==
+              objects.end());
+  for (void *object : objects) {
+    allocator_->Deallocate(object);
+  }
+
+  AllocatorStats stats = allocator_->Stats();
+  EXPECT_THAT(stats.small_allocations, Eq(objects.size()));
+  EXPECT_THAT(stats.small_frees, Eq(objects.size()));
+  EXPECT_THAT(stats.thread_caches, Eq(1));
+  EXPECT_THAT(stats.arena_bytes, Gt(0));
+}
+
+TEST_F(ThreadCachingAllocatorTest, ReusesFreedObjectsFromThreadCache) {
+  void *first = allocator_->Allocate(64);
+  allocator_->Deallocate(first);
+  uint64_t hits = allocator_->Stats().thread_cache_hits;
+  EXPECT_THAT(allocator_->Allocate(64), Eq(first));
+  EXPECT_THAT(allocator_->Stats().thread_cache_hits, Eq(hits + 1));
+}
+
+TEST_F(ThreadCachingAllocatorTest, PassesLargeAndForeignMemoryToFallback) {
+  void *large = allocator_->Allocate(ThreadCachingAllocator::kMaxSmallSize + 1);
+  ASSERT_NE(large, nullptr);
+  EXPECT_FALSE(allocator_->Owns(large));
+  EXPECT_THAT(allocator_->Stats().fallback_allocations, Eq(1));
+  allocator_->Deallocate(large);
+
+  void *foreign = malloc(32);
+  memset(foreign, 1, 32);
+  foreign = allocator_->Reallocate(foreign, 64);
+  ASSERT_NE(foreign, nullptr);
+  EXPECT_FALSE(allocator_->Owns(foreign));
+  EXPECT_THAT(static_cast<char *>(foreign)[31], Eq(1));
+  allocator_->Deallocate(foreign);
+}
+
+TEST_F(ThreadCachingAllocatorTest, ReallocatePreservesContents) {
+  char *buffer = static_cast<char *>(allocator_->Reallocate(nullptr, 10));
+  ASSERT_NE(buffer, nullptr);
+  memcpy(buffer, "0123456789", 10);
+
+  // Growth within the size class keeps the object in place.
+  EXPECT_THAT(allocator_->Reallocate(buffer, 16), Eq(buffer));
+
+  for (size_t size : {100, 1000, 50000, 20}) {
+    buffer = static_cast<char *>(allocator_->Reallocate(buffer, size));
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_THAT(memcmp(buffer, "0123456789", 10), Eq(0));
+  }
+  EXPECT_THAT(allocator_->Reallocate(buffer, 0), Eq(nullptr));
+}
+
+TEST_F(ThreadCachingAllocatorTest, FlushReturnsCachedObjectsToCentralLists) {
+  std::vector<void *> objects;
+  for (int i = 0; i < 10; ++i) {
+    objects.push_back(allocator_->Allocate(256));
+  }
+  for (void *object : objects) {
+    allocator_->Deallocate(object);
+  }
+  EXPECT_THAT(allocator_->Stats().thread_cache_free_bytes, Gt(0));
+
+  // Every object of the carved span is free again, and 256 divides the span
+  // size, so the central free list holds the whole span.
+  allocator_->FlushThreadCache();
+  AllocatorStats stats = allocator_->Stats();
+  EXPECT_THAT(stats.thread_cache_free_bytes, Eq(0));
+  EXPECT_THAT(stats.central_free_bytes, Eq(stats.span_bytes));
+}
+
+TEST_F(ThreadCachingAllocatorTest, ObjectsMoveBetweenThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kObjects = 2000;
+
+  // Each thread allocates objects which the next thread frees.
+  std::vector<std::vector<void *>> objects(kThreads);
+  std::vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this, i, &objects] {
+      for (int j = 0; j < kObjects; ++j) {
+        size_t size = 8 + (i * kObjects + j) % 2000;
+        auto *object = static_cast<uint8_t *>(allocator_->Allocate(size));
+        ASSERT_NE(object, nullptr);
+        memset(object, i, size);
+        objects[i].push_back(object);
+      }
+      allocator_->FlushThreadCache();
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+  threads.clear();
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this, i, &objects] {
+      for (void *object : objects[(i + 1) % kThreads]) {
+        EXPECT_THAT(*static_cast<uint8_t *>(object), Eq((i + 1) % kThreads));
+        allocator_->Deallocate(object);
+      }
+      allocator_->FlushThreadCache();
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  AllocatorStats stats = allocator_->Stats();
+  EXPECT_THAT(stats.small_allocations, Eq(kThreads * kObjects));
+  EXPECT_THAT(stats.small_frees, Eq(kThreads * kObjects));
+  EXPECT_THAT(stats.thread_cache_free_bytes, Eq(0));
+  EXPECT_THAT(stats.central_free_bytes, Le(stats.span_bytes));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/memory/thread_caching_malloc.h"
+
+#include <malloc.h>
+#include <reent.h>
+#include <stdlib.h>
+
+#include "asylo/platform/posix/memory/memory.h"
+
+namespace asylo {
+namespace {
+
+void *NewlibAllocateAligned(size_t alignment, size_t size) {
+  return _memalign_r(_REENT, alignment, size);
+}
+
+void *NewlibAllocate(size_t size) { return _malloc_r(_REENT, size); }
+
+void *NewlibReallocate(void *ptr, size_t size) {
+  return _realloc_r(_REENT, ptr, size);
+}
+
+void NewlibDeallocate(void *ptr) { _free_r(_REENT, ptr); }
+
+// The global allocator, which is constant-initialized so that it may be used
+// before static constructors run.
+ThreadCachingAllocator global_allocator({NewlibAllocateAligned, NewlibAllocate,
+                                         NewlibReallocate, NewlibDeallocate});
+
+bool enabled = false;
+
+void *MallocHook(size_t size, void *pool) {
+  return global_allocator.Allocate(size);
+}
+
+void *ReallocHook(void *ptr, size_t size, void *pool) {
+  return global_allocator.Reallocate(ptr, size);
+}
+
+void FreeHook(void *ptr, void *pool) { global_allocator.Deallocate(ptr); }
+
+}  // namespace
+
+ThreadCachingAllocator::Backend NewlibAllocatorBackend() {
+  return {NewlibAllocateAligned, NewlibAllocate, NewlibReallocate,
+          NewlibDeallocate};
+}
+
+void EnableThreadCachingMalloc() {
+  enabled = true;
+  set_normal_heap_hooks(&MallocHook, &ReallocHook, &FreeHook);
+}
+
+bool ThreadCachingMallocEnabled() { return enabled; }
+
+AllocatorStats GetThreadCachingMallocStats() {
+  return global_allocator.Stats();
+}
+
+}  // namespace asylo
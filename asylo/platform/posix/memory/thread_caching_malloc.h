@@ -0,0 +1,47 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_MALLOC_H_
+#define ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_MALLOC_H_
+
+#include "asylo/platform/posix/memory/thread_caching_allocator.h"
+
+namespace asylo {
+
+// Returns a backend which obtains arenas from, and falls back to, the newlib
+// allocator.
+ThreadCachingAllocator::Backend NewlibAllocatorBackend();
+
+// Routes malloc, realloc and free through a global ThreadCachingAllocator
+// backed by the newlib allocator. Memory allocated before the call may be freed
+// or reallocated afterwards. calloc, memalign and posix_memalign continue to
+// use the newlib allocator, so malloc_usable_size must not be called on memory
+// returned by malloc or realloc. The allocator stays installed across
+// heap_switch, and cannot be uninstalled once memory has been allocated from
+// it. This function is not thread-safe.
+void EnableThreadCachingMalloc();
+
+// Returns true if EnableThreadCachingMalloc has been called.
+bool ThreadCachingMallocEnabled();
+
+// Returns the totals of the global ThreadCachingAllocator.
+AllocatorStats GetThreadCachingMallocStats();
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_MEMORY_THREAD_CACHING_MALLOC_H_
@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <cstring>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/posix/memory/memory.h"
+#include "asylo/platform/posix/memory/thread_caching_allocator.h"
+#include "asylo/platform/posix/memory/thread_caching_malloc.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Gt;
+
+// The number of objects each benchmark thread keeps allocated, and the sizes it
+// cycles through.
+constexpr int kLiveObjects = 64;
+constexpr size_t kSizes[] = {16, 24, 48, 64, 96, 128, 200, 256, 512, 1024};
+constexpr int kNumSizes = sizeof(kSizes) / sizeof(kSizes[0]);
+
+// Repeatedly frees the oldest of kLiveObjects objects and allocates a new one
+// in its place, through |allocate| and |deallocate|.
+template <typename Allocate, typename Deallocate>
+void RunMallocBenchmark(benchmark::State &state, Allocate allocate,
+                        Deallocate deallocate) {
+  void *objects[kLiveObjects] = {};
+  int next = state.thread_index;
+  for (auto _ : state) {
+    int slot = next % kLiveObjects;
+    deallocate(objects[slot]);
+    objects[slot] = allocate(kSizes[next % kNumSizes]);
+    benchmark::DoNotOptimize(objects[slot]);
+    ++next;
+  }
+  for (void *object : objects) {
+    deallocate(object);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Allocates through malloc and free, which are served by the newlib allocator
+// unless thread-caching malloc is enabled.
+void BM_NewlibMalloc(benchmark::State &state) {
+  RunMallocBenchmark(state, malloc, free);
+}
+BENCHMARK(BM_NewlibMalloc)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_ThreadCachingMalloc(benchmark::State &state) {
+  static ThreadCachingAllocator *allocator =
+      new ThreadCachingAllocator(NewlibAllocatorBackend());
+  RunMallocBenchmark(
+      state, [](size_t size) { return allocator->Allocate(size); },
+      [](void *ptr) { allocator->Deallocate(ptr); });
+}
+BENCHMARK(BM_ThreadCachingMalloc)->ThreadRange(1, 8)->UseRealTime();
+
+// Enables thread-caching malloc for the rest of the enclave's lifetime, so it
+// runs after the benchmarks.
+TEST(ThreadCachingMallocTest, ServesMallocAcrossHeapSwitch) {
+  void *newlib_object = malloc(100);
+  ASSERT_NE(newlib_object, nullptr);
+
+  EnableThreadCachingMalloc();
+  EXPECT_TRUE(ThreadCachingMallocEnabled());
+  AllocatorStats before = GetThreadCachingMallocStats();
+
+  // Memory allocated by newlib may still be reallocated and freed.
+  newlib_object = realloc(newlib_object, 200);
+  ASSERT_NE(newlib_object, nullptr);
+  free(newlib_object);
+
+  std::unique_ptr<int> object(new int(1));
+  AllocatorStats after = GetThreadCachingMallocStats();
+  EXPECT_THAT(after.small_allocations, Gt(before.small_allocations));
+
+  // The switched heap takes over while it is active, and the thread-caching
+  // allocator is restored afterwards.
+  alignas(16) char switched_heap[64];
+  heap_switch(switched_heap, sizeof(switched_heap));
+  void *switched_object = malloc(16);
+  heap_switch(nullptr, 0);
+  EXPECT_THAT(switched_object, Eq(static_cast<void *>(switched_heap)));
+
+  before = GetThreadCachingMallocStats();
+  object.reset(new int(2));
+  after = GetThreadCachingMallocStats();
+  EXPECT_THAT(after.small_allocations, Eq(before.small_allocations + 1));
+}
+
+}  // namespace
+}  // namespace asylo
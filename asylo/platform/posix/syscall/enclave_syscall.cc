@@ -200,6 +200,9 @@ int64_t EnclaveSyscallWithDeps(int sysno, uint64_t* args, size_t nargs,
     case asylo::system_call::kSYS_pread64:
       return io_manager->PRead(args[0], reinterpret_cast<void*>(args[1]),
                                args[2], args[3]);
+    case asylo::system_call::kSYS_pwrite64:
+      return io_manager->PWrite(args[0], reinterpret_cast<const void*>(args[1]),
+                                args[2], args[3]);
     case asylo::system_call::kSYS_umask:
       return io_manager->Umask(args[0]);
     case asylo::system_call::kSYS_getrlimit:
@@ -239,6 +242,13 @@ int64_t EnclaveSyscallWithDeps(int sysno, uint64_t* args, size_t nargs,
     case asylo::system_call::kSYS_recvmsg:
       return io_manager->RecvMsg(args[0], reinterpret_cast<msghdr*>(args[1]),
                                  args[2]);
+    case asylo::system_call::kSYS_sendmmsg:
+      return io_manager->SendMmsg(
+          args[0], reinterpret_cast<mmsghdr*>(args[1]), args[2], args[3]);
+    case asylo::system_call::kSYS_recvmmsg:
+      return io_manager->RecvMmsg(
+          args[0], reinterpret_cast<mmsghdr*>(args[1]), args[2], args[3],
+          reinterpret_cast<timespec*>(args[4]));
     case asylo::system_call::kSYS_getsockname:
       return io_manager->GetSockName(args[0],
                                      reinterpret_cast<sockaddr*>(args[1]),
@@ -139,6 +139,14 @@ class MockIOManager : public asylo::io::IOManager {
               (int sockfd, const struct msghdr* msg, int flags), (override));
   MOCK_METHOD(ssize_t, RecvMsg, (int sockfd, struct msghdr* msg, int flags),
               (override));
+  MOCK_METHOD(int, SendMmsg,
+              (int sockfd, struct mmsghdr* msgvec, unsigned int vlen,
+               int flags),
+              (override));
+  MOCK_METHOD(int, RecvMmsg,
+              (int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags,
+               struct timespec* timeout),
+              (override));
   MOCK_METHOD(int, GetSockName,
               (int sockfd, struct sockaddr* addr, socklen_t* addrlen),
               (override));
@@ -1062,6 +1070,42 @@ TEST_F(EnclaveSyscallTest, EnclaveSyscallRecvMsg) {
                                        3, helper, io_manager));
 }
 
+TEST_F(EnclaveSyscallTest, EnclaveSyscallSendMmsg) {
+  int sockfd = 0;
+  struct mmsghdr* msgvec = nullptr;
+  unsigned int vlen = 3;
+  int flags = 2;
+
+  uint64_t args[] = {static_cast<uint64_t>(sockfd),
+                     reinterpret_cast<uint64_t>(msgvec),
+                     static_cast<uint64_t>(vlen), static_cast<uint64_t>(flags)};
+
+  EXPECT_CALL(*io_manager, SendMmsg(sockfd, msgvec, vlen, flags))
+      .WillOnce(Return(85));
+
+  EXPECT_EQ(85, EnclaveSyscallWithDeps(asylo::system_call::kSYS_sendmmsg, args,
+                                       4, helper, io_manager));
+}
+
+TEST_F(EnclaveSyscallTest, EnclaveSyscallRecvMmsg) {
+  int sockfd = 0;
+  struct mmsghdr* msgvec = nullptr;
+  unsigned int vlen = 3;
+  int flags = 2;
+  struct timespec* timeout = nullptr;
+
+  uint64_t args[] = {static_cast<uint64_t>(sockfd),
+                     reinterpret_cast<uint64_t>(msgvec),
+                     static_cast<uint64_t>(vlen), static_cast<uint64_t>(flags),
+                     reinterpret_cast<uint64_t>(timeout)};
+
+  EXPECT_CALL(*io_manager, RecvMmsg(sockfd, msgvec, vlen, flags, timeout))
+      .WillOnce(Return(86));
+
+  EXPECT_EQ(86, EnclaveSyscallWithDeps(asylo::system_call::kSYS_recvmmsg, args,
+                                       5, helper, io_manager));
+}
+
 TEST_F(EnclaveSyscallTest, EnclaveSyscallGetSockName) {
   int sockfd = 0;
   struct sockaddr* addr = nullptr;
@@ -1182,6 +1182,16 @@ TEST_F(SyscallsTest, PRead) {
       IsOk());
 }
 
+// Tests pwrite() by writing a message to a file at an offset past what was
+// written by write(), then checking that the file offset has not moved and
+// that the file holds both messages.
+TEST_F(SyscallsTest, PWrite) {
+  EXPECT_THAT(
+      RunSyscallInsideEnclave(
+          "pwrite", absl::GetFlag(FLAGS_test_tmpdir) + "/pwrite", nullptr),
+      IsOk());
+}
+
 // Tests rmdir(). Calls mkdir() to create a directory, then calls rmdir() inside
 // the enclave to remove it. Verifies the directory is deleted outside the
 // enclave.
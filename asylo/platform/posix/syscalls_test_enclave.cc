@@ -161,6 +161,8 @@ class SyscallsEnclave : public EnclaveTestCase {
       return RunLinkTest(test_input.path_name());
     } else if (test_input.test_target() == "pread") {
       return RunPReadTest(test_input.path_name());
+    } else if (test_input.test_target() == "pwrite") {
+      return RunPWriteTest(test_input.path_name());
     } else if (test_input.test_target() == "rmdir") {
       return RunRmDirTest(test_input.path_name());
     } else if (test_input.test_target() == "sysconf(_SC_NPROCESSORS_CONF)") {
@@ -1526,6 +1528,42 @@ class SyscallsEnclave : public EnclaveTestCase {
     return Status::OkStatus();
   }
 
+  Status RunPWriteTest(const std::string &path) {
+    int fd;
+    ASYLO_ASSIGN_OR_RETURN(fd, OpenFile(path, O_CREAT | O_RDWR, 0644));
+    platform::storage::FdCloser fd_closer(fd);
+    const std::string message1 = "First pwrite message";
+    const std::string message2 = "Second pwrite message";
+    const std::string message = message1 + message2;
+    ssize_t rc = write(fd, message1.c_str(), message1.size());
+    if (rc != message1.size()) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Bytes written to file does not match message size");
+    }
+
+    ssize_t bytes_written =
+        pwrite(fd, message2.c_str(), message2.size(), message1.size());
+    if (bytes_written != message2.size()) {
+      return Status(
+          error::GoogleError::INTERNAL,
+          absl::StrCat("pwrite returns: ", bytes_written,
+                       " does not match message size: ", message2.size()));
+    }
+    if (lseek(fd, 0, SEEK_CUR) != message1.size()) {
+      return Status(error::GoogleError::INTERNAL,
+                    "pwrite moved the file offset");
+    }
+
+    std::vector<char> buf(message.size());
+    if (pread(fd, buf.data(), message.size(), 0) != message.size() ||
+        !std::equal(buf.begin(), buf.end(), message.begin())) {
+      return Status(error::GoogleError::INTERNAL,
+                    "File content does not match the messages written");
+    }
+
+    return Status::OkStatus();
+  }
+
   Status RunRmDirTest(const std::string &path) {
     if (path.empty()) {
       return Status(error::GoogleError::INVALID_ARGUMENT, "File path not set");
@@ -264,6 +264,10 @@ ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
   return IOManager::GetInstance().PRead(fd, buf, count, offset);
 }
 
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return IOManager::GetInstance().PWrite(fd, buf, count, offset);
+}
+
 // The functions below are prefixed with |enclave_|, as they are plumbed in from
 // newlib.
 int enclave_getpid() {
@@ -35,6 +35,7 @@
 #include "asylo/platform/primitives/primitive_status.h"
 #include "asylo/platform/primitives/primitives.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/host_buffer_pool.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/primitives/util/status_conversions.h"
 #include "asylo/util/status.h"
@@ -59,18 +60,19 @@ PrimitiveStatus dlopen_asylo_exit_call(uint64_t untrusted_selector,
     free(const_cast<void *>(input));
   }
   if (status.ok()) {
-    *output_size = out.MessageSize();
-    if (*output_size > 0) {
-      *output = malloc(*output_size);
-      out.Serialize(*output);
-    }
+    *output = HostBufferPool::Serialize(out, output_size);
   }
   return status;
 }
 
 void *dlopen_asylo_local_alloc_handler(size_t size) { return malloc(size); }
 
-void dlopen_asylo_local_free_handler(void *ptr) { return free(ptr); }
+void dlopen_asylo_local_free_handler(void *ptr) {
+  // Exit call output may have been allocated from the host thread's pool.
+  if (!HostBufferPool::Release(ptr)) {
+    free(ptr);
+  }
+}
 
 inline size_t RoundUpToPageBoundary(size_t size) {
   const size_t kPageSize = getpagesize();
@@ -18,15 +18,20 @@
 
 #include "asylo/platform/primitives/remote/communicator.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <queue>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "asylo/util/logging.h"
 #include "include/grpcpp/support/status.h"
@@ -113,8 +118,26 @@ class Communicator::ThreadActivityWorkQueue {
     CHECK(worker_thread_);
   }
 
+  // Pops the oldest queued message, or returns nullptr if there is none.
+  CommunicationMessagePtr TryDequeueMessage() {
+    auto locked_message_queue = wrapped_messages_queue_.Lock();
+    if (locked_message_queue->queue.empty()) {
+      return nullptr;
+    }
+    CommunicationMessagePtr wrapped_message =
+        std::move(locked_message_queue->queue.front());
+    locked_message_queue->queue.pop();
+    return wrapped_message;
+  }
+
   Thread::Id GetHostThreadId() const { return host_thread_id_; }
 
+  // Rebinds the queue of a pooled worker to the host thread whose call chain
+  // it is about to run.
+  void SetHostThreadId(Thread::Id host_thread_id) {
+    host_thread_id_ = host_thread_id;
+  }
+
   void SignalExit() { wrapped_messages_queue_.Lock()->is_exiting = true; }
 
   explicit ThreadActivityWorkQueue(Thread::Id host_thread_id)
@@ -173,8 +196,9 @@ class Communicator::ThreadActivityWorkQueue {
   };
   MutexGuarded<WrappedMessageQueue> wrapped_messages_queue_;
 
-  // Host thread id (for host side it matches the current thread).
-  const Thread::Id host_thread_id_;
+  // Host thread id (for host side it matches the current thread). Changes
+  // only for the queues of pooled workers, between invocations.
+  Thread::Id host_thread_id_;
 
   // On target: thread that processes requests coming from invocation_thread_id.
   // On host: nullptr (requests, if any, are processed by the application
@@ -182,6 +206,151 @@ class Communicator::ThreadActivityWorkQueue {
   std::unique_ptr<Thread> worker_thread_;
 };
 
+// Runs invocations that are not nested in another invocation on a fixed set of
+// worker threads. While a worker runs an invocation, it is bound to the host
+// thread that made it: nested requests from that host thread, and responses
+// to the worker's own nested calls, are queued to the worker just as they
+// would be to a dedicated thread. The binding is released once the invocation
+// has returned.
+class Communicator::WorkerPool {
+ public:
+  WorkerPool(Communicator *communicator, const WorkerPoolConfig &config)
+      : communicator_(communicator),
+        queue_depth_(config.queue_depth),
+        state_(State()) {
+    state_.Lock()->stats.pool_size = config.pool_size;
+    for (size_t i = 0; i < config.pool_size; ++i) {
+      queues_.emplace_back(absl::make_unique<ThreadActivityWorkQueue>(
+          /*host_thread_id=*/Thread::Id()));
+    }
+    for (const auto &queue : queues_) {
+      ThreadActivityWorkQueue *const worker_queue = queue.get();
+      workers_.emplace_back(absl::make_unique<Thread>(
+          [this, worker_queue] { WorkerLoop(worker_queue); }));
+    }
+  }
+
+  ~WorkerPool() {
+    state_.Lock()->is_exiting = true;
+    for (const auto &queue : queues_) {
+      queue->SignalExit();
+    }
+    for (const auto &worker : workers_) {
+      worker->Join();
+    }
+  }
+
+  WorkerPool(const WorkerPool &other) = delete;
+  WorkerPool &operator=(const WorkerPool &other) = delete;
+
+  // Takes |*wrapped_message| for a worker and returns true, unless it must be
+  // handled by a dedicated thread: because its host thread already has one, or
+  // because the queue is full.
+  bool Dispatch(CommunicationMessagePtr *wrapped_message) {
+    const Thread::Id invocation_thread_id =
+        (*wrapped_message)->invocation_thread_id();
+    auto locked_state = state_.Lock();
+    auto it = locked_state->bindings.find(invocation_thread_id);
+    if (it != locked_state->bindings.end()) {
+      // Part of a call chain running on a worker. Requests, unlike responses
+      // to the worker's own nested calls, are invocations the worker runs.
+      Status message_status;
+      if ((*wrapped_message)->has_status()) {
+        message_status.RestoreFrom((*wrapped_message)->status());
+      }
+      if (message_status.Is(error::GoogleError::UNKNOWN)) {
+        ++locked_state->stats.dispatched;
+      }
+      CHECK(it->second->QueueMessage(std::move(*wrapped_message)).ok());
+      return true;
+    }
+    if (ThreadActivityWorkQueue::map()->ReaderLock()->contains(
+            invocation_thread_id)) {
+      return false;
+    }
+    if (locked_state->pending.size() >= queue_depth_) {
+      ++locked_state->stats.overflowed;
+      return false;
+    }
+    locked_state->pending.push_back(
+        PendingMessage{std::move(*wrapped_message), absl::Now()});
+    return true;
+  }
+
+  WorkerPoolStats GetStats() const {
+    auto locked_state = state_.ReaderLock();
+    WorkerPoolStats stats = locked_state->stats;
+    stats.queued = locked_state->pending.size();
+    return stats;
+  }
+
+ private:
+  struct PendingMessage {
+    CommunicationMessagePtr wrapped_message;
+    absl::Time queued_at;
+  };
+
+  struct State {
+    // Requests waiting for a free worker, oldest first.
+    std::deque<PendingMessage> pending;
+
+    // Queues of the workers currently running a call chain, by the host
+    // thread that made the outermost call.
+    absl::flat_hash_map<Thread::Id, ThreadActivityWorkQueue *> bindings;
+
+    bool is_exiting = false;
+    WorkerPoolStats stats;
+  };
+
+  // Runs pending requests on the current thread, whose queue is |queue|, until
+  // the pool is destroyed.
+  void WorkerLoop(ThreadActivityWorkQueue *queue) {
+    CHECK(!current_thread_context_);
+    current_thread_context_ = queue;
+    Cleanup reset_context([] { current_thread_context_ = nullptr; });
+    for (;;) {
+      CommunicationMessagePtr wrapped_message;
+      Thread::Id invocation_thread_id;
+      {
+        auto locked_state = state_.LockWhen([](const State &state) {
+          return state.is_exiting || !state.pending.empty();
+        });
+        if (locked_state->is_exiting) {
+          return;
+        }
+        PendingMessage pending = std::move(locked_state->pending.front());
+        locked_state->pending.pop_front();
+        const absl::Duration delay = absl::Now() - pending.queued_at;
+        WorkerPoolStats *const stats = &locked_state->stats;
+        ++stats->dispatched;
+        stats->total_queueing_delay += delay;
+        stats->max_queueing_delay = std::max(stats->max_queueing_delay, delay);
+        wrapped_message = std::move(pending.wrapped_message);
+        invocation_thread_id = wrapped_message->invocation_thread_id();
+        queue->SetHostThreadId(invocation_thread_id);
+        locked_state->bindings.emplace(invocation_thread_id, queue);
+      }
+      while (wrapped_message) {
+        communicator_->service_->StartInvocation(std::move(wrapped_message));
+        // The host thread may have sent its next request after receiving the
+        // response but before the binding is released, in which case the
+        // request was queued here. Run such requests before releasing it.
+        auto locked_state = state_.Lock();
+        wrapped_message = queue->TryDequeueMessage();
+        if (!wrapped_message) {
+          locked_state->bindings.erase(invocation_thread_id);
+        }
+      }
+    }
+  }
+
+  Communicator *const communicator_;
+  const size_t queue_depth_;
+  MutexGuarded<State> state_;
+  std::vector<std::unique_ptr<ThreadActivityWorkQueue>> queues_;
+  std::vector<std::unique_ptr<Thread>> workers_;
+};
+
 StatusOr<Communicator::ThreadActivityWorkQueue *>
 Communicator::LocateOrCreateThreadActivityWorkQueue(
     Thread::Id invocation_thread_id) {
@@ -253,6 +422,8 @@ void Communicator::QueueMessageForThread(
   if (is_host()) {
     CHECK_NE(invocation_thread_id, Thread::this_thread_id())
         << "Cannot assign action to the current thread";
+  } else if (worker_pool_ && worker_pool_->Dispatch(&wrapped_message)) {
+    return;
   }
   const auto thread_context_result =
       LocateOrCreateThreadActivityWorkQueue(invocation_thread_id);
@@ -291,6 +462,13 @@ Status Communicator::Connect(const RemoteProxyConfig &config,
                              absl::string_view remote_address) {
   // Create gRPC stub for writing.
   ASYLO_RETURN_IF_ERROR(CreateStub(config, remote_address));
+  if (!is_host() && config.HasWorkerPoolConfig() && !worker_pool_) {
+    const WorkerPoolConfig pool_config =
+        config.GetWorkerPoolConfig().ValueOrDie();
+    if (pool_config.pool_size > 0) {
+      worker_pool_ = absl::make_unique<WorkerPool>(this, pool_config);
+    }
+  }
   // Success.
   is_client_ready_.store(true);
   return Status::OkStatus();
@@ -318,6 +496,16 @@ Communicator::~Communicator() {
       return;
     }
   }
+  if (worker_pool_) {
+    const WorkerPoolStats stats = worker_pool_->GetStats();
+    LOG(INFO) << "Worker pool of " << stats.pool_size << " ran "
+              << stats.dispatched << " invocations, "
+              << stats.overflowed << " overflowed; queueing delay total "
+              << stats.total_queueing_delay << ", max "
+              << stats.max_queueing_delay;
+    // Joins the workers.
+    worker_pool_.reset();
+  }
   // For target Communicator or the last active Communicator in host: signal
   // created threads that they need to terminate (when thread contexts are
   // destructed on target, they will wait for termination to happen).
@@ -415,6 +603,14 @@ Status Communicator::SendCommunication(const CommunicationMessage &message) {
 
 int Communicator::server_port() const { return service_->server_port(); }
 
+absl::optional<Communicator::WorkerPoolStats>
+Communicator::GetWorkerPoolStats() const {
+  if (!worker_pool_) {
+    return absl::nullopt;
+  }
+  return worker_pool_->GetStats();
+}
+
 Status Communicator::IsMessageValid(const CommunicationMessage &message) {
   if (!message.has_request_sequence_number()) {
     return Status{error::GoogleError::FAILED_PRECONDITION,
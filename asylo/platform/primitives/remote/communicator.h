@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -112,6 +113,27 @@ class Communicator {
   using CommunicationMessagePtr =
       std::unique_ptr<CommunicationMessage, WrappedMessageDeleter>;
 
+  // Statistics of the target-side worker pool (see
+  // RemoteProxyConfig::EnableWorkerPool).
+  struct WorkerPoolStats {
+    // The number of worker threads.
+    size_t pool_size = 0;
+
+    // The number of invocations run by a worker, including those queued
+    // directly to a worker already running their call chain, and the number
+    // that found the queue full and were given a dedicated thread instead.
+    uint64_t dispatched = 0;
+    uint64_t overflowed = 0;
+
+    // The number of invocations currently waiting for a free worker.
+    size_t queued = 0;
+
+    // The total and the longest time that invocations waited for a free
+    // worker.
+    absl::Duration total_queueing_delay;
+    absl::Duration max_queueing_delay;
+  };
+
   explicit Communicator(bool is_host);
   ~Communicator();
 
@@ -128,6 +150,7 @@ class Communicator {
 
   // Connects gRPC client to the gRPC server with 'remote_address' using
   // 'channel_creds' channel credentials and 'channel_args' channel arguments.
+  // On the target side, also starts the worker pool if 'config' has one.
   // Returns OK or error status, if connection failed.
   ASYLO_MUST_USE_RESULT Status Connect(const RemoteProxyConfig &config,
                                        absl::string_view remote_address);
@@ -203,6 +226,10 @@ class Communicator {
   // Returns port assigned when creating the server.
   int server_port() const;
 
+  // Returns the statistics of the worker pool, or nullopt if the communicator
+  // has no worker pool.
+  absl::optional<WorkerPoolStats> GetWorkerPoolStats() const;
+
   // Accessor to the last time received from the host (valid only
   // on target Communicator, has no use on the host one).
   absl::optional<int64_t> last_host_time_nanos() const {
@@ -217,6 +244,9 @@ class Communicator {
   // QueueMessageForThread. A new queue is added whenever the first Invoke call
   // takes place on a specific host thread.
   class ThreadActivityWorkQueue;
+  // A pool of target threads that run invocations which are not nested in
+  // another invocation, in place of a worker thread per host thread.
+  class WorkerPool;
 
   // Sends |message| (request or response) to the counterpart Communicator.
   Status SendCommunication(const CommunicationMessage &message);
@@ -264,6 +294,10 @@ class Communicator {
   std::unique_ptr<ClientImpl> client_;
   std::unique_ptr<ServiceImpl> service_;
 
+  // Target-side only: worker pool, if enabled by the config passed to
+  // Connect().
+  std::unique_ptr<WorkerPool> worker_pool_;
+
   // Flags indicating whether server and client are ready.
   // Set to false by constructor, switched to true when server and client are
   // connected (respectively), reset to false by either Disconnect call or
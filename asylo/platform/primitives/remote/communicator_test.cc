@@ -64,8 +64,10 @@ using ::opencensus::stats::ViewData;
 using ::opencensus::stats::ViewDescriptor;
 using ::testing::Eq;
 using ::testing::Field;
+using ::testing::Ge;
 using ::testing::InSequence;
 using ::testing::IsEmpty;
+using ::testing::Le;
 using ::testing::Lt;
 using ::testing::MockFunction;
 using ::testing::Not;
@@ -159,6 +161,10 @@ class CommunicatorTestFixture : public ::testing::Test {
   // Runs host-side action. Must be overridden.
   virtual void RunAction(Communicator *communicator) = 0;
 
+  // Adjusts the target-side config before the target connects, defaults to
+  // leaving it unchanged.
+  virtual void ConfigureTarget(RemoteProxyConfig *config) {}
+
   // Runs the host or target side of the test, expecting fds_ socketpair
   // to be set for the cross-process communication.
   // Creates Communicator, starts its server, exchanges ports with counterpart,
@@ -207,6 +213,7 @@ class CommunicatorTestFixture : public ::testing::Test {
           << strerror(errno);
 
       RemoteProxyConfig proxy_config(std::move(connection_config));
+      ConfigureTarget(&proxy_config);
 
       // Establish connection to the host server.
       ASYLO_ASSERT_OK(communicator->Connect(
@@ -674,6 +681,107 @@ class DuplexNestedMultithreadedInvokesTest : public CommunicatorTestFixture {
   }
 };
 
+class WorkerPoolInvokesTest : public CommunicatorTestFixture {
+ public:
+  WorkerPoolInvokesTest()
+      : thread_set_((absl::flat_hash_set<std::thread::id>())) {}
+
+ private:
+  const uint64_t kDataSelector = 1234;
+  const uint64_t kCountSelector = 4321;
+  const int64_t kThreads = 64;
+  const int64_t kTotalMessages = 16;
+  const size_t kPoolSize = 4;
+
+  void ConfigureTarget(RemoteProxyConfig *config) override {
+    config->EnableWorkerPool(kPoolSize,
+                             /*queue_depth=*/kThreads * kTotalMessages);
+  }
+
+  void SetTargetHandler(ServerHandlerMock *handler,
+                        Communicator *communicator) override {
+    EXPECT_CALL(*handler,
+                Call(Pointee(Field(&Communicator::Invocation::selector,
+                                   Eq(kDataSelector)))))
+        .Times(kThreads * kTotalMessages)
+        .WillRepeatedly(
+            [this](std::unique_ptr<Communicator::Invocation> invocation) {
+              thread_set_.Lock()->insert(std::this_thread::get_id());
+              // Produce no output.
+            });
+    EXPECT_CALL(*handler,
+                Call(Pointee(Field(&Communicator::Invocation::selector,
+                                   Eq(kCountSelector)))))
+        .WillOnce([this, communicator](
+                      std::unique_ptr<Communicator::Invocation> invocation) {
+          // Every invocation, including this one, ran on a pooled worker.
+          const auto stats = communicator->GetWorkerPoolStats();
+          ASSERT_TRUE(stats.has_value());
+          EXPECT_THAT(stats->pool_size, Eq(kPoolSize));
+          EXPECT_THAT(stats->dispatched, Eq(kThreads * kTotalMessages + 1));
+          EXPECT_THAT(stats->overflowed, Eq(0));
+          EXPECT_THAT(stats->max_queueing_delay, Ge(absl::ZeroDuration()));
+          invocation->writer.Push<int64_t>(thread_set_.ReaderLock()->size());
+        });
+  }
+
+  void RunAction(Communicator *communicator) override {
+    std::vector<Thread> threads;
+    for (int64_t thread_index = 0; thread_index < kThreads; ++thread_index) {
+      threads.emplace_back([this, communicator] {
+        const auto current_thread_id = Thread::this_thread_id();
+        for (int64_t i = 0; i < kTotalMessages; ++i) {
+          communicator->Invoke(
+              kDataSelector,
+              [](Communicator::Invocation *invocation) {
+                // No input.
+              },
+              [current_thread_id](
+                  std::unique_ptr<Communicator::Invocation> invocation) {
+                ASYLO_ASSERT_OK(invocation->status);
+                ASSERT_THAT(invocation->invocation_thread_id,
+                            Eq(current_thread_id));
+              });
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.Join();
+    }
+    threads.clear();
+
+    // All host threads were served by no more threads than the pool has.
+    communicator->Invoke(
+        kCountSelector,
+        [](Communicator::Invocation *invocation) {
+          // No input.
+        },
+        [this](std::unique_ptr<Communicator::Invocation> invocation) {
+          ASYLO_ASSERT_OK(invocation->status);
+          ASSERT_THAT(invocation->reader, SizeIs(1));
+          const int64_t target_threads = invocation->reader.next<int64_t>();
+          EXPECT_THAT(target_threads, Ge(1));
+          EXPECT_THAT(target_threads, Le(static_cast<int64_t>(kPoolSize)));
+        });
+  }
+
+  MutexGuarded<absl::flat_hash_set<std::thread::id>> thread_set_;
+};
+
+// Runs the nested calls of DuplexNestedMultithreadedInvokesTest with fewer
+// pooled workers than there are host threads, so that reentrant call chains
+// must stay bound to their workers while other chains wait in the queue.
+class WorkerPoolDuplexNestedInvokesTest
+    : public DuplexNestedMultithreadedInvokesTest {
+ public:
+  WorkerPoolDuplexNestedInvokesTest() = default;
+
+ private:
+  void ConfigureTarget(RemoteProxyConfig *config) override {
+    config->EnableWorkerPool(/*pool_size=*/2, /*queue_depth=*/64);
+  }
+};
+
 class UnknownSelectorTest : public CommunicatorTestFixture {
  public:
   UnknownSelectorTest() = default;
@@ -770,6 +878,8 @@ void RegisterAllTests() {
   CommunicatorTestFixture::Register<MultithreadedInvokesAndCheckBackTest>();
   CommunicatorTestFixture::Register<MultithreadedWithThreadLocalStorageTest>();
   CommunicatorTestFixture::Register<DuplexNestedMultithreadedInvokesTest>();
+  CommunicatorTestFixture::Register<WorkerPoolInvokesTest>();
+  CommunicatorTestFixture::Register<WorkerPoolDuplexNestedInvokesTest>();
   CommunicatorTestFixture::Register<UnknownSelectorTest>();
   CommunicatorTestFixture::Register<OpenCensusClientTest>();
 }
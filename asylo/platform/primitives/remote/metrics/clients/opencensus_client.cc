@@ -23,8 +23,11 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "asylo/platform/primitives/remote/metrics/clients/opencensus_client_config.h"
 #include "asylo/platform/primitives/remote/metrics/clients/proc_system_service_client.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
+#include "asylo/util/logging.h"
 #include "asylo/util/path.h"
 #include "asylo/util/status_macros.h"
 #include "asylo/util/thread.h"
@@ -80,6 +83,9 @@ std::unique_ptr<OpenCensusClient> OpenCensusClient::Create(
   client->RegisterRssSLimView();
   client->RegisterGuestTimeView();
   client->RegisterChildrenGuestTimeView();
+  if (config.record_exit_metrics) {
+    client->RegisterExitCallViews();
+  }
 
   // Start the census.
   client->StartCensus();
@@ -108,6 +114,8 @@ std::unique_ptr<OpenCensusClient> OpenCensusClient::Create(
         &OpenCensusClient::RecordChildrenGuestTime,
     });
 
+    bool record_exit_metrics = config_.record_exit_metrics;
+
     // Do not hold a lock on record_ so that StopCensus can set it to false.
     while (*record_.ReaderLock()) {
       auto response_or_request = proc_client_->GetProcStat();
@@ -121,6 +129,17 @@ std::unique_ptr<OpenCensusClient> OpenCensusClient::Create(
         ((this)->*(recorder))(response_or_request.ValueOrDie());
       }
 
+      if (record_exit_metrics) {
+        auto exit_metrics_or_error = proc_client_->GetExitMetrics();
+        if (exit_metrics_or_error.ok()) {
+          RecordExitMetrics(exit_metrics_or_error.ValueOrDie());
+        } else {
+          // Exit call metrics are optional; keep recording the process's.
+          LOG(ERROR) << exit_metrics_or_error.status();
+          record_exit_metrics = false;
+        }
+      }
+
       absl::SleepFor(config_.granularity);
     }
   });
@@ -210,11 +229,46 @@ void OpenCensusClient::RecordChildrenGuestTime(
          {{MethodKey(), absl::StrCat("OpenCensusClient::", __func__)}});
 }
 
+void OpenCensusClient::RecordExitMetrics(
+    const ExitMetricsResponse &response) const {
+  for (const auto &metrics : response.selectors()) {
+    RecordExitCall("selector/", metrics);
+  }
+  for (const auto &metrics : response.system_calls()) {
+    RecordExitCall("syscall/", metrics);
+  }
+}
+
+void OpenCensusClient::RecordExitCall(absl::string_view prefix,
+                                      const ExitCallMetrics &metrics) const {
+  ExitCallStats stats;
+  stats.count = metrics.count();
+  stats.latency_buckets.resize(ExitMetrics::kLatencyBuckets);
+  for (const auto &bucket : metrics.latency_buckets()) {
+    stats.latency_buckets[ExitMetrics::BucketIndex(bucket.lower_bound_ns())] +=
+        bucket.count();
+  }
+  Record({{ExitCountMeasure(), metrics.count()},
+          {ExitErrorsMeasure(), metrics.errors()},
+          {ExitBytesInMeasure(), metrics.bytes_in()},
+          {ExitBytesOutMeasure(), metrics.bytes_out()},
+          {ExitLatencyP50Measure(),
+           absl::ToInt64Nanoseconds(stats.PercentileLatency(0.5))},
+          {ExitLatencyP99Measure(),
+           absl::ToInt64Nanoseconds(stats.PercentileLatency(0.99))}},
+         {{ExitCallKey(), absl::StrCat(prefix, metrics.name())}});
+}
+
 TagKey OpenCensusClient::MethodKey() const {
   static const auto key = TagKey::Register("method");
   return key;
 }
 
+TagKey OpenCensusClient::ExitCallKey() const {
+  static const auto key = TagKey::Register("exit_call");
+  return key;
+}
+
 MeasureInt64 OpenCensusClient::MinorFaultsMeasure() const {
   static const auto measure = MeasureInt64::Register(
       kMinorFaultsMeasureName, kMinorFaultsMeasureDescription, units::kCount);
@@ -302,6 +356,45 @@ MeasureInt64 OpenCensusClient::ChildrenGuestTimeMeasure() const {
   return measure;
 }
 
+MeasureInt64 OpenCensusClient::ExitCountMeasure() const {
+  static const auto measure = MeasureInt64::Register(
+      kExitCountMeasureName, kExitCountMeasureDescription, units::kCount);
+  return measure;
+}
+
+MeasureInt64 OpenCensusClient::ExitErrorsMeasure() const {
+  static const auto measure = MeasureInt64::Register(
+      kExitErrorsMeasureName, kExitErrorsMeasureDescription, units::kCount);
+  return measure;
+}
+
+MeasureInt64 OpenCensusClient::ExitBytesInMeasure() const {
+  static const auto measure = MeasureInt64::Register(
+      kExitBytesInMeasureName, kExitBytesInMeasureDescription, units::kBytes);
+  return measure;
+}
+
+MeasureInt64 OpenCensusClient::ExitBytesOutMeasure() const {
+  static const auto measure =
+      MeasureInt64::Register(kExitBytesOutMeasureName,
+                             kExitBytesOutMeasureDescription, units::kBytes);
+  return measure;
+}
+
+MeasureInt64 OpenCensusClient::ExitLatencyP50Measure() const {
+  static const auto measure = MeasureInt64::Register(
+      kExitLatencyP50MeasureName, kExitLatencyP50MeasureDescription,
+      units::kNanoseconds);
+  return measure;
+}
+
+MeasureInt64 OpenCensusClient::ExitLatencyP99Measure() const {
+  static const auto measure = MeasureInt64::Register(
+      kExitLatencyP99MeasureName, kExitLatencyP99MeasureDescription,
+      units::kNanoseconds);
+  return measure;
+}
+
 void OpenCensusClient::RegisterView(
     ViewDescriptor *view_descriptor, const absl::string_view measure_name,
     const absl::string_view measure_description) {
@@ -387,5 +480,44 @@ void OpenCensusClient::RegisterChildrenGuestTimeView() {
                kChildrenGuestTimeMeasureDescription);
 }
 
+void OpenCensusClient::RegisterExitCallView(
+    ViewDescriptor *view_descriptor, const absl::string_view measure_name,
+    const absl::string_view measure_description) {
+  *view_descriptor =
+      ViewDescriptor()
+          .set_name(asylo::JoinPath(config_.view_name_root, measure_name))
+          .set_description(measure_description)
+          .set_measure(measure_name)
+          .set_aggregation(opencensus::stats::Aggregation::LastValue())
+          .add_column(ExitCallKey());
+  view_descriptor->RegisterForExport();
+}
+
+void OpenCensusClient::RegisterExitCallViews() {
+  // Register the measures before the views that refer to them.
+  ExitCountMeasure();
+  ExitErrorsMeasure();
+  ExitBytesInMeasure();
+  ExitBytesOutMeasure();
+  ExitLatencyP50Measure();
+  ExitLatencyP99Measure();
+
+  RegisterExitCallView(&exit_count_view_descriptor_, kExitCountMeasureName,
+                       kExitCountMeasureDescription);
+  RegisterExitCallView(&exit_errors_view_descriptor_, kExitErrorsMeasureName,
+                       kExitErrorsMeasureDescription);
+  RegisterExitCallView(&exit_bytes_in_view_descriptor_,
+                       kExitBytesInMeasureName, kExitBytesInMeasureDescription);
+  RegisterExitCallView(&exit_bytes_out_view_descriptor_,
+                       kExitBytesOutMeasureName,
+                       kExitBytesOutMeasureDescription);
+  RegisterExitCallView(&exit_latency_p50_view_descriptor_,
+                       kExitLatencyP50MeasureName,
+                       kExitLatencyP50MeasureDescription);
+  RegisterExitCallView(&exit_latency_p99_view_descriptor_,
+                       kExitLatencyP99MeasureName,
+                       kExitLatencyP99MeasureDescription);
+}
+
 }  // namespace primitives
 }  // namespace asylo
@@ -36,6 +36,7 @@ namespace units {
 ABSL_CONST_INIT static const absl::string_view kCount = "1";
 ABSL_CONST_INIT static const absl::string_view kBytes = "Bytes";
 ABSL_CONST_INIT static const absl::string_view kTicks = "Clock Ticks";
+ABSL_CONST_INIT static const absl::string_view kNanoseconds = "ns";
 
 }  // namespace units
 
@@ -62,6 +63,7 @@ class OpenCensusClient {
 
   // Tag Keys
   ::opencensus::tags::TagKey MethodKey() const;
+  ::opencensus::tags::TagKey ExitCallKey() const;
 
   // Measure metric generation
   ::opencensus::stats::MeasureInt64 MinorFaultsMeasure() const;
@@ -78,6 +80,12 @@ class OpenCensusClient {
   ::opencensus::stats::MeasureInt64 RssSLimMeasure() const;
   ::opencensus::stats::MeasureInt64 GuestTimeMeasure() const;
   ::opencensus::stats::MeasureInt64 ChildrenGuestTimeMeasure() const;
+  ::opencensus::stats::MeasureInt64 ExitCountMeasure() const;
+  ::opencensus::stats::MeasureInt64 ExitErrorsMeasure() const;
+  ::opencensus::stats::MeasureInt64 ExitBytesInMeasure() const;
+  ::opencensus::stats::MeasureInt64 ExitBytesOutMeasure() const;
+  ::opencensus::stats::MeasureInt64 ExitLatencyP50Measure() const;
+  ::opencensus::stats::MeasureInt64 ExitLatencyP99Measure() const;
 
   // Measure view registration
   void RegisterView(::opencensus::stats::ViewDescriptor *view_descriptor,
@@ -99,6 +107,13 @@ class OpenCensusClient {
   void RegisterGuestTimeView();
   void RegisterChildrenGuestTimeView();
 
+  // Exit call views are broken down by exit call, not by method.
+  void RegisterExitCallView(
+      ::opencensus::stats::ViewDescriptor *view_descriptor,
+      const absl::string_view measure_name,
+      const absl::string_view measure_description);
+  void RegisterExitCallViews();
+
   // Record metrics
   typedef void (OpenCensusClient::*Recorder)(const ProcStatResponse &) const;
   void RecordMinorFaults(const ProcStatResponse &response) const;
@@ -116,6 +131,11 @@ class OpenCensusClient {
   void RecordGuestTime(const ProcStatResponse &response) const;
   void RecordChildrenGuestTime(const ProcStatResponse &response) const;
 
+  // Records the totals of every selector and system call in |response|.
+  void RecordExitMetrics(const ExitMetricsResponse &response) const;
+  void RecordExitCall(absl::string_view prefix,
+                      const ExitCallMetrics &metrics) const;
+
   // Measure names
   const absl::string_view kMinorFaultsMeasureName = "proc/stat/minflt";
   const absl::string_view kChildrenMinorFaultsMeasureName = "proc/stat/cminflt";
@@ -132,6 +152,12 @@ class OpenCensusClient {
   const absl::string_view kGuestTimeMeasureName = "proc/stat/guesttime";
   const absl::string_view kChildrenGuestTimeMeasureName =
       "proc/stat/cguesttime";
+  const absl::string_view kExitCountMeasureName = "exit/count";
+  const absl::string_view kExitErrorsMeasureName = "exit/errors";
+  const absl::string_view kExitBytesInMeasureName = "exit/bytes_in";
+  const absl::string_view kExitBytesOutMeasureName = "exit/bytes_out";
+  const absl::string_view kExitLatencyP50MeasureName = "exit/latency_p50";
+  const absl::string_view kExitLatencyP99MeasureName = "exit/latency_p99";
 
   // Measure descriptions
   const absl::string_view kMinorFaultsMeasureDescription =
@@ -169,6 +195,18 @@ class OpenCensusClient {
       "Guest time of the process. Reported in clock ticks.";
   const absl::string_view kChildrenGuestTimeMeasureDescription =
       "Guest time of the process' children. Reported in clock ticks.";
+  const absl::string_view kExitCountMeasureDescription =
+      "The number of exit calls the enclave has made.";
+  const absl::string_view kExitErrorsMeasureDescription =
+      "The number of exit calls the enclave has made that failed.";
+  const absl::string_view kExitBytesInMeasureDescription =
+      "The number of bytes the enclave has passed to exit calls.";
+  const absl::string_view kExitBytesOutMeasureDescription =
+      "The number of bytes exit calls have returned to the enclave.";
+  const absl::string_view kExitLatencyP50MeasureDescription =
+      "The median latency of exit calls. Reported in nanoseconds.";
+  const absl::string_view kExitLatencyP99MeasureDescription =
+      "The 99th percentile latency of exit calls. Reported in nanoseconds.";
 
   // View descriptors
   ::opencensus::stats::ViewDescriptor minor_faults_view_descriptor_;
@@ -185,6 +223,12 @@ class OpenCensusClient {
   ::opencensus::stats::ViewDescriptor rss_slim_view_descriptor_;
   ::opencensus::stats::ViewDescriptor guest_time_view_descriptor_;
   ::opencensus::stats::ViewDescriptor children_guest_time_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_count_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_errors_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_bytes_in_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_bytes_out_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_latency_p50_view_descriptor_;
+  ::opencensus::stats::ViewDescriptor exit_latency_p99_view_descriptor_;
 
   // ProcSystemServiceClient for gathering metrics.
   const std::unique_ptr<ProcSystemServiceClient> proc_client_;
@@ -27,6 +27,10 @@
 struct OpenCensusClientConfig {
   absl::Duration granularity;
   std::string view_name_root;
+
+  // Whether to also record the enclave's exit call metrics. The server must
+  // then be constructed with an ExitMetrics.
+  bool record_exit_metrics = false;
 };
 
 #endif  // ASYLO_PLATFORM_PRIMITIVES_REMOTE_METRICS_CLIENTS_OPENCENSUS_CLIENT_CONFIG_H_
@@ -46,6 +46,20 @@ ProcSystemServiceClient::ProcSystemServiceClient(
   return response;
 }
 
+::asylo::StatusOr<ExitMetricsResponse> ProcSystemServiceClient::GetExitMetrics()
+    const {
+  ExitMetricsRequest request;
+  ExitMetricsResponse response;
+  ::grpc::ClientContext context;
+
+  auto status = stub_->GetExitMetrics(&context, request, &response);
+  if (!status.ok()) {
+    return ::asylo::Status(static_cast<error::GoogleError>(status.error_code()),
+                           std::string(status.error_message()));
+  }
+  return response;
+}
+
 ProcSystemServiceClient::ProcSystemServiceClient(
     const std::shared_ptr<::grpc::Channel> &channel)
     : stub_(std::make_shared<ProcSystemService::Stub>(channel)) {}
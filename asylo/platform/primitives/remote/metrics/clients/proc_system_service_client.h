@@ -41,6 +41,8 @@ class ProcSystemServiceClient {
 
   ::asylo::StatusOr<ProcStatResponse> GetProcStat() const;
 
+  ::asylo::StatusOr<ExitMetricsResponse> GetExitMetrics() const;
+
  private:
   const std::shared_ptr<ProcSystemService::StubInterface> stub_;
 };
@@ -91,6 +91,33 @@ TEST(ProcSystemServiceClientTestNoFixture, HandlesGetProcStatError) {
               Eq(::asylo::Status(error::GoogleError::UNKNOWN, "BadError")));
 }
 
+TEST(ProcSystemServiceClientTestNoFixture, ReturnsExitMetrics) {
+  ExitMetricsResponse expected;
+  auto *selector = expected.add_selectors();
+  selector->set_id(88);
+  selector->set_count(3);
+  auto mock_stub = std::make_shared<MockProcSystemServiceStub>();
+  EXPECT_CALL(*mock_stub, GetExitMetrics)
+      .WillOnce(DoAll(SetArgPointee<2>(expected), Return(::grpc::Status::OK)));
+  ProcSystemServiceClient proc_client(mock_stub);
+
+  ExitMetricsResponse response;
+  ASYLO_ASSERT_OK_AND_ASSIGN(response, proc_client.GetExitMetrics());
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST(ProcSystemServiceClientTestNoFixture, HandlesGetExitMetricsError) {
+  auto mock_stub = std::make_shared<MockProcSystemServiceStub>();
+  EXPECT_CALL(*mock_stub, GetExitMetrics)
+      .WillOnce(Return(::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION,
+                                      "Not recorded")));
+  ProcSystemServiceClient proc_client(mock_stub);
+
+  EXPECT_THAT(proc_client.GetExitMetrics().status(),
+              Eq(::asylo::Status(error::GoogleError::FAILED_PRECONDITION,
+                                 "Not recorded")));
+}
+
 }  // namespace
 }  // namespace primitives
 }  // namespace asylo
@@ -18,10 +18,14 @@
 
 #include "asylo/platform/primitives/remote/metrics/proc_system_service.h"
 
+#include <functional>
+#include <map>
+
 #include "absl/memory/memory.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.grpc.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system_parser.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
 #include "include/grpc/support/time.h"
@@ -42,6 +46,47 @@ namespace primitives {
   return ::grpc::Status::OK;
 }
 
+namespace {
+
+// Adds one ExitCallMetrics message to |output| per entry of |stats|.
+template <typename Key>
+void AddExitCallMetrics(
+    const std::map<Key, ExitCallStats> &stats,
+    const std::function<std::string(Key)> &name,
+    ::google::protobuf::RepeatedPtrField<ExitCallMetrics> *output) {
+  for (const auto &entry : stats) {
+    auto *stats_proto = output->Add();
+    stats_proto->set_id(entry.first);
+    stats_proto->set_name(name(entry.first));
+    stats_proto->set_count(entry.second.count);
+    stats_proto->set_errors(entry.second.errors);
+    stats_proto->set_bytes_in(entry.second.bytes_in);
+    stats_proto->set_bytes_out(entry.second.bytes_out);
+    stats_proto->set_total_latency_ns(entry.second.total_latency_ns);
+    for (size_t i = 0; i < entry.second.latency_buckets.size(); ++i) {
+      if (entry.second.latency_buckets[i] == 0) {
+        continue;
+      }
+      auto *bucket = stats_proto->add_latency_buckets();
+      bucket->set_lower_bound_ns(ExitCallStats::BucketLowerBound(i));
+      bucket->set_count(entry.second.latency_buckets[i]);
+    }
+  }
+}
+
+}  // namespace
+
+::grpc::Status ProcSystemServiceImpl::GetExitMetrics(
+    grpc::ServerContext *context, const ExitMetricsRequest *request,
+    ExitMetricsResponse *response) {
+  auto status = BuildExitMetricsResponse(response);
+  if (!status.ok()) {
+    return ::grpc::Status(static_cast<::grpc::StatusCode>(status.error_code()),
+                          std::string(status.error_message()));
+  }
+  return ::grpc::Status::OK;
+}
+
 std::unique_ptr<ProcSystemParser>
 ProcSystemServiceImpl::CreateProcSystemParser() const {
   return absl::make_unique<ProcSystemParser>();
@@ -108,5 +153,19 @@ ProcSystemServiceImpl::CreateProcSystemParser() const {
   return ::asylo::Status::OkStatus();
 }
 
+::asylo::Status ProcSystemServiceImpl::BuildExitMetricsResponse(
+    ExitMetricsResponse *response) const {
+  if (!exit_metrics_) {
+    return ::asylo::Status(error::GoogleError::FAILED_PRECONDITION,
+                           "Exit call metrics are not recorded");
+  }
+  ExitMetricsSnapshot snapshot = exit_metrics_->Snapshot();
+  AddExitCallMetrics<uint64_t>(snapshot.selectors, ExitMetrics::SelectorName,
+                             response->mutable_selectors());
+  AddExitCallMetrics<int>(snapshot.system_calls, ExitMetrics::SystemCallName,
+                        response->mutable_system_calls());
+  return ::asylo::Status::OkStatus();
+}
+
 }  // namespace primitives
 }  // namespace asylo
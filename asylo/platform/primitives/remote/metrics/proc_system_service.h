@@ -19,9 +19,12 @@
 #ifndef ASYLO_PLATFORM_PRIMITIVES_REMOTE_METRICS_PROC_SYSTEM_SERVICE_H_
 #define ASYLO_PLATFORM_PRIMITIVES_REMOTE_METRICS_PROC_SYSTEM_SERVICE_H_
 
+#include <memory>
+
 #include "asylo/platform/primitives/remote/metrics/proc_system.grpc.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system.pb.h"
 #include "asylo/platform/primitives/remote/metrics/proc_system_parser.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/util/status.h"
 #include "include/grpc/support/time.h"
 #include "include/grpcpp/support/status.h"
@@ -33,6 +36,15 @@ class ProcSystemServiceImpl : public ProcSystemService::Service {
  public:
   explicit ProcSystemServiceImpl(pid_t pid)
       : proc_system_parser_(CreateProcSystemParser()), pid_(pid) {}
+
+  // Constructs a service which also reports the exit call metrics recorded in
+  // |exit_metrics|.
+  ProcSystemServiceImpl(pid_t pid,
+                        std::shared_ptr<const ExitMetrics> exit_metrics)
+      : proc_system_parser_(CreateProcSystemParser()),
+        pid_(pid),
+        exit_metrics_(std::move(exit_metrics)) {}
+
   ProcSystemServiceImpl(const ProcSystemServiceImpl &other) = delete;
   ProcSystemServiceImpl &operator=(const ProcSystemServiceImpl &other) = delete;
 
@@ -40,6 +52,12 @@ class ProcSystemServiceImpl : public ProcSystemService::Service {
                              const ProcStatRequest *request,
                              ProcStatResponse *response) override;
 
+  // Fails with FAILED_PRECONDITION if the service was constructed without an
+  // ExitMetrics.
+  ::grpc::Status GetExitMetrics(::grpc::ServerContext *context,
+                                const ExitMetricsRequest *request,
+                                ExitMetricsResponse *response) override;
+
  protected:
   ProcSystemServiceImpl(std::unique_ptr<ProcSystemParser> proc_system_parser,
                         pid_t pid)
@@ -50,8 +68,12 @@ class ProcSystemServiceImpl : public ProcSystemService::Service {
 
   ::asylo::Status BuildProcStatResponse(ProcStatResponse *response) const;
 
+  ::asylo::Status BuildExitMetricsResponse(
+      ExitMetricsResponse *response) const;
+
   std::unique_ptr<ProcSystemParser> proc_system_parser_;
   const pid_t pid_;
+  const std::shared_ptr<const ExitMetrics> exit_metrics_;
 };
 
 }  // namespace primitives
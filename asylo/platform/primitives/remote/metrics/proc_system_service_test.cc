@@ -23,8 +23,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "asylo/platform/primitives/remote/metrics/mocks/mock_proc_system_parser.h"
 #include "asylo/platform/primitives/remote/metrics/mocks/mock_proc_system_service.h"
+#include "asylo/platform/primitives/util/exit_metrics.h"
 #include "asylo/test/util/status_matchers.h"
 
 namespace asylo {
@@ -37,6 +39,7 @@ using ::testing::Gt;
 using ::testing::IsEmpty;
 using ::testing::Not;
 using ::testing::Return;
+using ::testing::SizeIs;
 
 class ProcSystemServiceTest : public ::testing::Test {
  protected:
@@ -187,6 +190,44 @@ TEST_F(ProcSystemServiceTest, ResponseIsSuccessfulParse) {
               Eq(comparison_parser->kExpectedExitCode));
 }
 
+TEST_F(ProcSystemServiceTest, ExitMetricsRequireExitMetrics) {
+  ProcSystemServiceImpl proc_system_service(getpid());
+  ExitMetricsRequest request;
+  ExitMetricsResponse response;
+  EXPECT_THAT(Status(proc_system_service.GetExitMetrics(&context_, &request,
+                                                        &response)),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+}
+
+TEST_F(ProcSystemServiceTest, ReportsExitMetrics) {
+  auto exit_metrics = std::make_shared<ExitMetrics>();
+  exit_metrics->Record(ExitMetrics::kSystemCallSelector, 0, 100, 200,
+                       absl::Microseconds(3), true);
+  exit_metrics->Record(ExitMetrics::kSystemCallSelector, 0, 100, 200,
+                       absl::Microseconds(3), false);
+  ProcSystemServiceImpl proc_system_service(getpid(), exit_metrics);
+
+  ExitMetricsRequest request;
+  ExitMetricsResponse response;
+  ASYLO_ASSERT_OK(Status(
+      proc_system_service.GetExitMetrics(&context_, &request, &response)));
+
+  ASSERT_THAT(response.selectors(), SizeIs(1));
+  const ExitCallMetrics &selector = response.selectors(0);
+  EXPECT_THAT(selector.id(), Eq(ExitMetrics::kSystemCallSelector));
+  EXPECT_THAT(selector.count(), Eq(2));
+  EXPECT_THAT(selector.errors(), Eq(1));
+  EXPECT_THAT(selector.bytes_in(), Eq(200));
+  EXPECT_THAT(selector.bytes_out(), Eq(400));
+  ASSERT_THAT(selector.latency_buckets(), SizeIs(1));
+  EXPECT_THAT(selector.latency_buckets(0).count(), Eq(2));
+
+  ASSERT_THAT(response.system_calls(), SizeIs(1));
+  EXPECT_THAT(response.system_calls(0).id(), Eq(0));
+  EXPECT_THAT(response.system_calls(0).name(),
+              Eq(ExitMetrics::SystemCallName(0)));
+}
+
 }  // namespace
 }  // namespace primitives
 }  // namespace asylo
@@ -18,6 +18,8 @@
 
 #include "asylo/platform/primitives/remote/util/remote_proxy_lib.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 #include <utility>
 
@@ -41,6 +43,15 @@
 ABSL_FLAG(std::string, host_address, "[::]:8888",
           "Address that remote enclave calls back to the host");
 
+ABSL_FLAG(int32_t, worker_pool_size, 0,
+          "Number of threads running calls from host threads that are not "
+          "nested in another call; 0 runs each host thread's calls on a "
+          "thread of its own");
+
+ABSL_FLAG(int32_t, worker_queue_depth, 64,
+          "Number of calls that may wait for a free worker before a call is "
+          "given a thread of its own");
+
 using ::asylo::EnclaveLoadConfig;
 using ::asylo::ProcessMainWrapper;
 using ::asylo::RemoteProxyServerConfig;
@@ -85,6 +96,11 @@ int main(int argc, char **argv) {
     LOG(ERROR) << config_or_request.status();
     return -1;
   }
+  if (absl::GetFlag(FLAGS_worker_pool_size) > 0) {
+    config_or_request.ValueOrDie()->EnableWorkerPool(
+        absl::GetFlag(FLAGS_worker_pool_size),
+        std::max(0, absl::GetFlag(FLAGS_worker_queue_depth)));
+  }
 
   const auto run_status =
       ProcessMainWrapper<RemoteEnclaveProxyServer>::RunUntilTerminated(
@@ -44,6 +44,7 @@
 #include "asylo/platform/primitives/sgx/signal_dispatcher.h"
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/host_buffer_pool.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/platform/storage/utils/fd_closer.h"
 #include "asylo/platform/system_call/type_conversions/types_functions.h"
@@ -490,16 +491,20 @@ int ocall_dispatch_untrusted_call(uint64_t selector, void *buffer) {
   const auto status =
       ::asylo::primitives::Client::ExitCallback(selector, &in, &out);
   if (status.ok()) {
-    sgx_params->output_size = out.MessageSize();
-    if (sgx_params->output_size > 0) {
-      sgx_params->output = malloc(sgx_params->output_size);
-      out.Serialize(sgx_params->output);
-    }
+    size_t output_size = 0;
+    sgx_params->output =
+        ::asylo::primitives::HostBufferPool::Serialize(out, &output_size);
+    sgx_params->output_size = output_size;
   }
   return status.error_code();
 }
 
-void ocall_untrusted_local_free(void *buffer) { free(buffer); }
+void ocall_untrusted_local_free(void *buffer) {
+  // Exit call output may have been allocated from the host thread's pool.
+  if (!::asylo::primitives::HostBufferPool::Release(buffer)) {
+    free(buffer);
+  }
+}
 
 uint32_t ocall_enc_untrusted_qe_get_target_info(
     sgx_target_info_t *qe_target_info) {
@@ -0,0 +1,184 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+// A primitives enclave whose entry points measure the cost of the enclave
+// transitions themselves. Entry points which exit the enclave repeat the exit
+// the number of times requested by the caller, so that a single entry is
+// amortized over many exits.
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/test/benchmark_selectors.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/primitives/trusted_runtime.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/status_macros.h"
+
+using ::asylo::primitives::EntryHandler;
+using ::asylo::primitives::PrimitiveStatus;
+using ::asylo::primitives::TrustedPrimitives;
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+PrimitiveStatus Empty(void *context, MessageReader *in, MessageWriter *out) {
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus Echo(void *context, MessageReader *in, MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  out->PushByCopy(in->next());
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus EmptyExits(void *context, MessageReader *in,
+                           MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  const uint64_t count = in->next<uint64_t>();
+  for (uint64_t i = 0; i < count; ++i) {
+    MessageWriter exit_input;
+    MessageReader exit_output;
+    ASYLO_RETURN_IF_ERROR(TrustedPrimitives::UntrustedCall(
+        kEmptyUntrustedSelector, &exit_input, &exit_output));
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus Getpid(void *context, MessageReader *in, MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 1);
+  const uint64_t count = in->next<uint64_t>();
+  for (uint64_t i = 0; i < count; ++i) {
+    if (enc_untrusted_getpid() <= 0) {
+      return {error::GoogleError::INTERNAL, "enc_untrusted_getpid failed"};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus Read4K(void *context, MessageReader *in, MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  const int fd = in->next<int>();
+  const uint64_t count = in->next<uint64_t>();
+  char buffer[kBenchmarkIoSize];
+  for (uint64_t i = 0; i < count; ++i) {
+    if (enc_untrusted_read(fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+      return {error::GoogleError::INTERNAL, "enc_untrusted_read failed"};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus Write4K(void *context, MessageReader *in, MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  const int fd = in->next<int>();
+  const uint64_t count = in->next<uint64_t>();
+  char buffer[kBenchmarkIoSize] = {};
+  for (uint64_t i = 0; i < count; ++i) {
+    if (enc_untrusted_write(fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+      return {error::GoogleError::INTERNAL, "enc_untrusted_write failed"};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus SendDatagrams(void *context, MessageReader *in,
+                              MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  const int fd = in->next<int>();
+  const uint64_t count = in->next<uint64_t>();
+  char datagram[kDatagramSize] = {};
+  struct iovec iov = {datagram, sizeof(datagram)};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (enc_untrusted_sendmsg(fd, &msg, 0) != sizeof(datagram)) {
+      return {error::GoogleError::INTERNAL, "enc_untrusted_sendmsg failed"};
+    }
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+PrimitiveStatus SendDatagramBatches(void *context, MessageReader *in,
+                                    MessageWriter *out) {
+  ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(*in, 2);
+  const int fd = in->next<int>();
+  const uint64_t count = in->next<uint64_t>();
+  char datagram[kDatagramSize] = {};
+  struct iovec iov = {datagram, sizeof(datagram)};
+  struct mmsghdr msgvec[kDatagramBatchSize] = {};
+  for (struct mmsghdr &mmsg : msgvec) {
+    mmsg.msg_hdr.msg_iov = &iov;
+    mmsg.msg_hdr.msg_iovlen = 1;
+  }
+  uint64_t sent = 0;
+  while (sent < count) {
+    unsigned int vlen = std::min<uint64_t>(count - sent, kDatagramBatchSize);
+    int result = enc_untrusted_sendmmsg(fd, msgvec, vlen, 0);
+    if (result <= 0) {
+      return {error::GoogleError::INTERNAL, "enc_untrusted_sendmmsg failed"};
+    }
+    sent += result;
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
+
+// Implements the required enclave initialization function.
+extern "C" PrimitiveStatus asylo_enclave_init() {
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kEmptySelector,
+      EntryHandler{asylo::primitives::Empty}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kEchoSelector, EntryHandler{asylo::primitives::Echo}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kEmptyExitsSelector,
+      EntryHandler{asylo::primitives::EmptyExits}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kGetpidSelector,
+      EntryHandler{asylo::primitives::Getpid}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kRead4KSelector,
+      EntryHandler{asylo::primitives::Read4K}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kWrite4KSelector,
+      EntryHandler{asylo::primitives::Write4K}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kSendDatagramsSelector,
+      EntryHandler{asylo::primitives::SendDatagrams}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      asylo::primitives::kSendDatagramBatchesSelector,
+      EntryHandler{asylo::primitives::SendDatagramBatches}));
+  return PrimitiveStatus::OkStatus();
+}
+
+// Implements the required enclave finalization function.
+extern "C" PrimitiveStatus asylo_enclave_fini() {
+  return PrimitiveStatus::OkStatus();
+}
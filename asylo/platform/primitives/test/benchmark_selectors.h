@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
+
+#include <cstdint>
+
+#include "asylo/platform/primitives/primitives.h"
+
+namespace asylo {
+namespace primitives {
+
+// Entry points registered by the benchmark enclave.
+//
+// Returns immediately.
+constexpr uint64_t kEmptySelector = kSelectorUser + 1;
+// Returns a copy of its single input.
+constexpr uint64_t kEchoSelector = kSelectorUser + 2;
+// Makes the number of empty exit calls given by its input to
+// kEmptyUntrustedSelector.
+constexpr uint64_t kEmptyExitsSelector = kSelectorUser + 3;
+// Calls enc_untrusted_getpid() the number of times given by its input.
+constexpr uint64_t kGetpidSelector = kSelectorUser + 4;
+// Reads or writes 4 KiB through enc_untrusted_read() or enc_untrusted_write()
+// the number of times given by its second input, from or to the host file
+// descriptor given by its first input.
+constexpr uint64_t kRead4KSelector = kSelectorUser + 5;
+constexpr uint64_t kWrite4KSelector = kSelectorUser + 6;
+// Sends the number of kDatagramSize datagrams given by its second input on the
+// host socket given by its first input, either one per enc_untrusted_sendmsg()
+// or kDatagramBatchSize per enc_untrusted_sendmmsg().
+constexpr uint64_t kSendDatagramsSelector = kSelectorUser + 7;
+constexpr uint64_t kSendDatagramBatchesSelector = kSelectorUser + 8;
+
+// Exit points registered by untrusted code.
+//
+// Returns immediately.
+constexpr uint64_t kEmptyUntrustedSelector = kSelectorUser + 1;
+
+// The size of the buffers read and written by kRead4KSelector and
+// kWrite4KSelector.
+constexpr size_t kBenchmarkIoSize = 4096;
+
+// The size of the datagrams sent by kSendDatagramsSelector and
+// kSendDatagramBatchesSelector, and the number of datagrams sent by each exit
+// of the latter.
+constexpr size_t kDatagramSize = 64;
+constexpr size_t kDatagramBatchSize = 16;
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_TEST_BENCHMARK_SELECTORS_H_
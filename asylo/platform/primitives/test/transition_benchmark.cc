@@ -0,0 +1,236 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+// Measures the cost of enclave entries and exits on the backend returned by
+// TestBackend::Get(), so that backends can be compared with each other and
+// against earlier versions of themselves. Pass --benchmark_format=json for
+// machine-readable output.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "asylo/platform/host_call/untrusted/host_call_handlers_initializer.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/test/benchmark_selectors.h"
+#include "asylo/platform/primitives/test/test_backend.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+
+ABSL_FLAG(int, max_threads, 8,
+          "The largest number of threads to run the multithreaded benchmarks "
+          "with");
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// The number of exits made by each entry of the exit benchmarks.
+constexpr uint64_t kExitsPerEntry = 64;
+
+// The enclave under test, shared by all benchmark threads.
+std::shared_ptr<Client> *enclave_client = nullptr;
+
+// Host file descriptors read from and written to by the enclave.
+int zero_fd = -1;
+int null_fd = -1;
+
+// A UDP socket connected to |receiver_fd|, which is never read from, so that
+// datagrams sent by the enclave are dropped once its buffer is full.
+int sender_fd = -1;
+int receiver_fd = -1;
+
+Status EmptyExitHandler(std::shared_ptr<Client> client, void *context,
+                        MessageReader *input, MessageWriter *output) {
+  return Status::OkStatus();
+}
+
+// Makes an empty entry into the enclave for every iteration.
+void BM_EmptyEntry(benchmark::State &state) {
+  for (auto _ : state) {
+    MessageWriter input;
+    MessageReader output;
+    Status status =
+        (*enclave_client)->EnclaveCall(kEmptySelector, &input, &output);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+}
+
+// Enters the enclave with a payload of state.range(0) bytes for every
+// iteration, which the enclave copies back out.
+void BM_EntryPayload(benchmark::State &state) {
+  const std::vector<char> payload(state.range(0), 'x');
+  for (auto _ : state) {
+    MessageWriter input;
+    input.PushByReference(Extent{payload.data(), payload.size()});
+    MessageReader output;
+    Status status =
+        (*enclave_client)->EnclaveCall(kEchoSelector, &input, &output);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(output.next().data());
+  }
+  // The payload crosses the enclave boundary twice.
+  state.SetBytesProcessed(2 * state.iterations() * payload.size());
+}
+
+// Enters the enclave with |selector|, which exits the enclave kExitsPerEntry
+// times, so that each iteration measures a single exit round trip. If |fd| is
+// not null, the descriptor it points to is passed ahead of the exit count. The
+// datagram selectors send kExitsPerEntry datagrams instead, so that each
+// iteration measures a datagram.
+void BM_Exits(benchmark::State &state, uint64_t selector, const int *fd) {
+  while (state.KeepRunningBatch(kExitsPerEntry)) {
+    MessageWriter input;
+    if (fd != nullptr) {
+      input.Push(*fd);
+    }
+    input.Push(kExitsPerEntry);
+    MessageReader output;
+    Status status = (*enclave_client)->EnclaveCall(selector, &input, &output);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      break;
+    }
+  }
+  if (selector == kRead4KSelector || selector == kWrite4KSelector) {
+    state.SetBytesProcessed(state.iterations() * kBenchmarkIoSize);
+  }
+  if (selector == kSendDatagramsSelector ||
+      selector == kSendDatagramBatchesSelector) {
+    state.SetItemsProcessed(state.iterations());
+  }
+}
+
+// Registers the benchmarks, running the empty round trips and host calls with
+// 1 to |max_threads| threads.
+void RegisterBenchmarks(int max_threads) {
+  benchmark::RegisterBenchmark("BM_EmptyEntry", BM_EmptyEntry)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_EntryPayload", BM_EntryPayload)
+      ->Arg(0)
+      ->RangeMultiplier(16)
+      ->Range(1, 1 << 20);
+  benchmark::RegisterBenchmark("BM_EmptyExit", BM_Exits, kEmptyExitsSelector,
+                               nullptr)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_Getpid", BM_Exits, kGetpidSelector, nullptr)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_Read4K", BM_Exits, kRead4KSelector,
+                               &zero_fd)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_Write4K", BM_Exits, kWrite4KSelector,
+                               &null_fd)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_SendDatagram", BM_Exits,
+                               kSendDatagramsSelector, &sender_fd)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_SendDatagramBatch", BM_Exits,
+                               kSendDatagramBatchesSelector, &sender_fd)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+}
+
+// Opens |receiver_fd| on an ephemeral loopback port and connects |sender_fd|
+// to it.
+void OpenDatagramSockets() {
+  receiver_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sender_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  CHECK_GE(receiver_fd, 0);
+  CHECK_GE(sender_fd, 0);
+
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addr_len = sizeof(addr);
+  CHECK_EQ(bind(receiver_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)),
+           0);
+  CHECK_EQ(getsockname(receiver_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                       &addr_len),
+           0);
+  CHECK_EQ(connect(sender_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                   sizeof(addr)),
+           0);
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  using asylo::primitives::enclave_client;
+
+  // Consumes the --benchmark_* flags, leaving the enclave_binary flag of the
+  // test backend to absl.
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+
+  enclave_client = new std::shared_ptr<asylo::primitives::Client>(
+      asylo::primitives::test::TestBackend::Get()->LoadTestEnclaveOrDie(
+          /*enclave_name=*/"transition_benchmark_enclave"));
+  ASYLO_CHECK_OK(asylo::host_call::AddHostCallHandlersToExitCallProvider(
+      (*enclave_client)->exit_call_provider()));
+  ASYLO_CHECK_OK(
+      (*enclave_client)
+          ->exit_call_provider()
+          ->RegisterExitHandler(
+              asylo::primitives::kEmptyUntrustedSelector,
+              asylo::primitives::ExitHandler{
+                  asylo::primitives::EmptyExitHandler}));
+
+  asylo::primitives::zero_fd = open("/dev/zero", O_RDONLY);
+  asylo::primitives::null_fd = open("/dev/null", O_WRONLY);
+  CHECK_GE(asylo::primitives::zero_fd, 0);
+  CHECK_GE(asylo::primitives::null_fd, 0);
+  asylo::primitives::OpenDatagramSockets();
+
+  asylo::primitives::RegisterBenchmarks(absl::GetFlag(FLAGS_max_threads));
+  benchmark::RunSpecifiedBenchmarks();
+
+  close(asylo::primitives::zero_fd);
+  close(asylo::primitives::null_fd);
+  close(asylo::primitives::sender_fd);
+  close(asylo::primitives::receiver_fd);
+  ASYLO_CHECK_OK((*enclave_client)->Destroy());
+  return 0;
+}
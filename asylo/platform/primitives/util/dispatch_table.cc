@@ -19,6 +19,7 @@
 #include "asylo/platform/primitives/util/dispatch_table.h"
 
 #include <memory>
+#include <utility>
 
 #include "absl/types/optional.h"
 #include "asylo/platform/primitives/util/message.h"
@@ -31,13 +32,16 @@ namespace primitives {
 Status DispatchTable::RegisterExitHandler(uint64_t untrusted_selector,
                                           const ExitHandler &handler) {
   // Ensure no handler is installed for untrusted_selector.
-  auto locked_exit_table = exit_table_.Lock();
-  if (locked_exit_table->count(untrusted_selector)) {
-    return {error::GoogleError::ALREADY_EXISTS,
-            "Invalid selector in RegisterExitHandler."};
-  }
-  locked_exit_table->emplace(untrusted_selector, handler);
-  return Status::OkStatus();
+  Status status = Status::OkStatus();
+  exit_table_.Update(
+      [untrusted_selector, &handler,
+       &status](std::unordered_map<uint64_t, ExitHandler> *exit_table) {
+        if (!exit_table->emplace(untrusted_selector, handler).second) {
+          status = {error::GoogleError::ALREADY_EXISTS,
+                    "Invalid selector in RegisterExitHandler."};
+        }
+      });
+  return status;
 }
 
 Status DispatchTable::PerformUnknownExit(uint64_t untrusted_selector,
@@ -53,9 +57,9 @@ Status DispatchTable::PerformExit(uint64_t untrusted_selector,
                                   Client *client) {
   absl::optional<ExitHandler> handler;
   {
-    auto locked_exit_table = exit_table_.ReaderLock();
-    auto it = locked_exit_table->find(untrusted_selector);
-    if (it != locked_exit_table->end()) {
+    auto exit_table = exit_table_.Read();
+    auto it = exit_table->find(untrusted_selector);
+    if (it != exit_table->end()) {
       handler = it->second;
     }
   }
@@ -73,8 +77,10 @@ Status DispatchTable::InvokeExitHandler(uint64_t untrusted_selector,
   if (exit_hook_factory_) {
     auto hook = exit_hook_factory_->CreateExitHook();
     ASYLO_RETURN_IF_ERROR(hook->PreExit(untrusted_selector));
-    return hook->PostExit(
-        PerformExit(untrusted_selector, input, output, client));
+    hook->InspectInput(input);
+    Status result = PerformExit(untrusted_selector, input, output, client);
+    hook->InspectOutput(output);
+    return hook->PostExit(std::move(result));
   } else {
     return PerformExit(untrusted_selector, input, output, client);
   }
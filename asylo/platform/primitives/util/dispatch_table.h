@@ -24,7 +24,7 @@
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/message.h"
 #include "asylo/util/asylo_macros.h"
-#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/read_mostly.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -43,6 +43,16 @@ class DispatchTable : public Client::ExitCallProvider {
     // returned back to the enclave.
     virtual Status PreExit(uint64_t untrusted_selector) = 0;
 
+    // InspectInput is called with the input to the exit call after PreExit
+    // succeeds, before the exit call is made. |input| may be nullptr. The
+    // default implementation does nothing.
+    virtual void InspectInput(const MessageReader *input) {}
+
+    // InspectOutput is called with the output of the exit call after that call
+    // is made, before PostExit. |output| may be nullptr. The default
+    // implementation does nothing.
+    virtual void InspectOutput(const MessageWriter *output) {}
+
     // PostExit is called with the result of the external exit call,
     // after that call is made (but before returning to the
     // enclave). PostExit returns a status as well, which will be
@@ -99,7 +109,10 @@ class DispatchTable : public Client::ExitCallProvider {
   // DispatchTable is used in trusted primitives layer where system calls might
   // not be available; avoid using absl based containers which may perform
   // system calls.
-  MutexGuarded<std::unordered_map<uint64_t, ExitHandler>> exit_table_;
+  //
+  // Handlers are registered once and looked up on every exit call, so lookups
+  // read a snapshot of the table without locking.
+  ReadMostly<std::unordered_map<uint64_t, ExitHandler>> exit_table_;
   const std::unique_ptr<ExitHookFactory> exit_hook_factory_;
 };
 
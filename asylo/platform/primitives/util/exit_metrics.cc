@@ -0,0 +1,319 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/exit_metrics.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/system_call/message.h"
+#include "asylo/platform/system_call/metadata.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// Returns the number of the system call carried by |input|, an exit call to
+// ExitMetrics::kSystemCallSelector, or -1 if it does not carry one.
+int SystemCallNumber(const MessageReader &input) {
+  if (input.size() != 1) {
+    return -1;
+  }
+  Extent request = input.extent(0);
+  if (request.size() < sizeof(system_call::MessageHeader)) {
+    return -1;
+  }
+  system_call::MessageReader reader(request);
+  if (reader.header()->magic != system_call::kMessageMagic ||
+      !reader.is_request()) {
+    return -1;
+  }
+  return reader.sysno();
+}
+
+// A hook which records a single exit call in an ExitMetrics.
+class ExitMetricsHook : public DispatchTable::ExitHook {
+ public:
+  explicit ExitMetricsHook(ExitMetrics *metrics) : metrics_(metrics) {}
+
+  Status PreExit(uint64_t untrusted_selector) override {
+    untrusted_selector_ = untrusted_selector;
+    start_ = absl::Now();
+    return Status::OkStatus();
+  }
+
+  void InspectInput(const MessageReader *input) override {
+    if (input == nullptr) {
+      return;
+    }
+    bytes_in_ = input->MessageSize();
+    if (untrusted_selector_ == ExitMetrics::kSystemCallSelector) {
+      system_call_ = SystemCallNumber(*input);
+    }
+  }
+
+  void InspectOutput(const MessageWriter *output) override {
+    if (output != nullptr) {
+      bytes_out_ = output->MessageSize();
+    }
+  }
+
+  Status PostExit(Status result) override {
+    metrics_->Record(untrusted_selector_, system_call_, bytes_in_, bytes_out_,
+                     absl::Now() - start_, result.ok());
+    return result;
+  }
+
+ private:
+  ExitMetrics *const metrics_;
+  uint64_t untrusted_selector_ = 0;
+  int system_call_ = -1;
+  size_t bytes_in_ = 0;
+  size_t bytes_out_ = 0;
+  absl::Time start_;
+};
+
+// Appends one table row per entry of |stats| to |output|, slowest in total
+// first.
+template <typename Key>
+void AppendRows(const std::map<Key, ExitCallStats> &stats,
+                const std::function<std::string(Key)> &name,
+                std::string *output) {
+  std::vector<std::pair<Key, const ExitCallStats *>> rows;
+  for (const auto &entry : stats) {
+    rows.emplace_back(entry.first, &entry.second);
+  }
+  std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+    return a.second->total_latency_ns > b.second->total_latency_ns;
+  });
+  for (const auto &row : rows) {
+    const ExitCallStats &stats = *row.second;
+    absl::StrAppendFormat(
+        output, "%-24s %10d %8d %12d %12d %12s %12s %12s %12s\n",
+        name(row.first), stats.count, stats.errors, stats.bytes_in,
+        stats.bytes_out, absl::FormatDuration(stats.MeanLatency()),
+        absl::FormatDuration(stats.PercentileLatency(0.5)),
+        absl::FormatDuration(stats.PercentileLatency(0.99)),
+        absl::FormatDuration(absl::Nanoseconds(stats.total_latency_ns)));
+  }
+}
+
+}  // namespace
+
+constexpr uint64_t ExitMetrics::kSystemCallSelector;
+constexpr uint64_t ExitMetrics::kMaxSelector;
+constexpr int ExitMetrics::kMaxSystemCall;
+constexpr int ExitMetrics::kSubBucketBits;
+constexpr size_t ExitMetrics::kSubBuckets;
+constexpr int ExitMetrics::kMaxLatencyBits;
+constexpr size_t ExitMetrics::kLatencyBuckets;
+constexpr size_t ExitMetrics::kShards;
+
+uint64_t ExitCallStats::BucketLowerBound(size_t index) {
+  constexpr int kBits = ExitMetrics::kSubBucketBits;
+  constexpr size_t kSubBuckets = ExitMetrics::kSubBuckets;
+  if (index < kSubBuckets) {
+    return index;
+  }
+  int shift = (index >> kBits) - 1;
+  return (kSubBuckets + (index & (kSubBuckets - 1))) << shift;
+}
+
+absl::Duration ExitCallStats::MeanLatency() const {
+  if (count == 0) {
+    return absl::ZeroDuration();
+  }
+  return absl::Nanoseconds(total_latency_ns / count);
+}
+
+absl::Duration ExitCallStats::PercentileLatency(double fraction) const {
+  uint64_t rank = std::max<uint64_t>(1, fraction * count);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < latency_buckets.size(); ++i) {
+    seen += latency_buckets[i];
+    if (seen >= rank) {
+      return absl::Nanoseconds(BucketLowerBound(i + 1));
+    }
+  }
+  return absl::ZeroDuration();
+}
+
+std::string ExitMetricsSnapshot::ToString() const {
+  const std::string header = absl::StrFormat(
+      "%-24s %10s %8s %12s %12s %12s %12s %12s %12s\n", "", "count", "errors",
+      "bytes in", "bytes out", "mean", "p50", "p99", "total");
+  std::string output = absl::StrCat("Exit calls by selector:\n", header);
+  AppendRows<uint64_t>(selectors, ExitMetrics::SelectorName, &output);
+  absl::StrAppend(&output, "\nHost system calls:\n", header);
+  AppendRows<int>(system_calls, ExitMetrics::SystemCallName, &output);
+  return output;
+}
+
+ExitMetrics::ExitMetrics() : shards_(new Shard[kShards]) {}
+
+ExitMetrics::~ExitMetrics() {
+  for (size_t i = 0; i < kShards; ++i) {
+    for (auto &slot : shards_[i].selectors) {
+      delete slot.load(std::memory_order_relaxed);
+    }
+    for (auto &slot : shards_[i].system_calls) {
+      delete slot.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t ExitMetrics::BucketIndex(uint64_t latency_ns) {
+  if (latency_ns < kSubBuckets) {
+    return latency_ns;
+  }
+  int high_bit = 63 - __builtin_clzll(latency_ns);
+  if (high_bit >= kMaxLatencyBits) {
+    return kLatencyBuckets - 1;
+  }
+  int shift = high_bit - kSubBucketBits;
+  size_t sub_bucket = (latency_ns >> shift) & (kSubBuckets - 1);
+  return ((shift + 1) << kSubBucketBits) + sub_bucket;
+}
+
+std::string ExitMetrics::SelectorName(uint64_t selector) {
+  if (selector >= kMaxSelector) {
+    return "other";
+  }
+  return absl::StrCat("selector_", selector);
+}
+
+std::string ExitMetrics::SystemCallName(int sysno) {
+  if (sysno >= kMaxSystemCall) {
+    return "other";
+  }
+  system_call::SystemCallDescriptor descriptor(sysno);
+  if (!descriptor.is_valid()) {
+    return absl::StrCat("syscall_", sysno);
+  }
+  return std::string(descriptor.name());
+}
+
+void ExitMetrics::Record(uint64_t selector, int system_call, size_t bytes_in,
+                         size_t bytes_out, absl::Duration latency, bool ok) {
+  Shard *shard = ThreadShard();
+  uint64_t latency_ns = std::max<int64_t>(0, absl::ToInt64Nanoseconds(latency));
+  Add(GetOrCreate(&shard->selectors[std::min(selector, kMaxSelector)]),
+      bytes_in, bytes_out, latency_ns, ok);
+  if (system_call >= 0) {
+    Add(GetOrCreate(
+            &shard->system_calls[std::min(system_call, kMaxSystemCall)]),
+        bytes_in, bytes_out, latency_ns, ok);
+  }
+}
+
+ExitMetricsSnapshot ExitMetrics::Snapshot() const {
+  ExitMetricsSnapshot snapshot;
+  for (size_t i = 0; i < kShards; ++i) {
+    const Shard &shard = shards_[i];
+    for (uint64_t selector = 0; selector <= kMaxSelector; ++selector) {
+      const Counters *counters =
+          shard.selectors[selector].load(std::memory_order_acquire);
+      if (counters != nullptr) {
+        Accumulate(*counters, &snapshot.selectors[selector]);
+      }
+    }
+    for (int sysno = 0; sysno <= kMaxSystemCall; ++sysno) {
+      const Counters *counters =
+          shard.system_calls[sysno].load(std::memory_order_acquire);
+      if (counters != nullptr) {
+        Accumulate(*counters, &snapshot.system_calls[sysno]);
+      }
+    }
+  }
+  return snapshot;
+}
+
+ExitMetrics::Counters *ExitMetrics::GetOrCreate(
+    std::atomic<Counters *> *slot) {
+  Counters *counters = slot->load(std::memory_order_acquire);
+  if (counters != nullptr) {
+    return counters;
+  }
+  auto created = absl::make_unique<Counters>();
+  if (slot->compare_exchange_strong(counters, created.get(),
+                                    std::memory_order_acq_rel)) {
+    return created.release();
+  }
+  // Another thread sharing the shard installed counters first.
+  return counters;
+}
+
+void ExitMetrics::Add(Counters *counters, size_t bytes_in, size_t bytes_out,
+                      uint64_t latency_ns, bool ok) {
+  counters->count.fetch_add(1, std::memory_order_relaxed);
+  if (!ok) {
+    counters->errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  counters->bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+  counters->bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+  counters->total_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+  counters->latency_buckets[BucketIndex(latency_ns)].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+void ExitMetrics::Accumulate(const Counters &counters, ExitCallStats *stats) {
+  stats->count += counters.count.load(std::memory_order_relaxed);
+  stats->errors += counters.errors.load(std::memory_order_relaxed);
+  stats->bytes_in += counters.bytes_in.load(std::memory_order_relaxed);
+  stats->bytes_out += counters.bytes_out.load(std::memory_order_relaxed);
+  stats->total_latency_ns +=
+      counters.total_latency_ns.load(std::memory_order_relaxed);
+  stats->latency_buckets.resize(kLatencyBuckets);
+  for (size_t i = 0; i < kLatencyBuckets; ++i) {
+    stats->latency_buckets[i] +=
+        counters.latency_buckets[i].load(std::memory_order_relaxed);
+  }
+}
+
+ExitMetrics::Shard *ExitMetrics::ThreadShard() {
+  // Threads are spread over the shards in the order they first record an exit
+  // call, so that up to kShards threads never share counters.
+  static std::atomic<size_t> next_shard(0);
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return &shards_[shard];
+}
+
+ExitMetricsHookFactory::ExitMetricsHookFactory(
+    std::shared_ptr<ExitMetrics> metrics)
+    : metrics_(std::move(metrics)) {}
+
+std::unique_ptr<DispatchTable::ExitHook>
+ExitMetricsHookFactory::CreateExitHook() {
+  return absl::make_unique<ExitMetricsHook>(metrics_.get());
+}
+
+MetricsDispatchTable::MetricsDispatchTable(std::shared_ptr<ExitMetrics> metrics)
+    : DispatchTable(
+          absl::make_unique<ExitMetricsHookFactory>(std::move(metrics))) {}
+
+}  // namespace primitives
+}  // namespace asylo
@@ -0,0 +1,179 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "asylo/platform/primitives/primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+
+namespace asylo {
+namespace primitives {
+
+// Totals recorded for the exit calls made with one selector, or for the system
+// calls with one number.
+struct ExitCallStats {
+  // Returns the lower bound, in nanoseconds, of the latencies counted in
+  // |latency_buckets[index]|.
+  static uint64_t BucketLowerBound(size_t index);
+
+  // Returns the mean latency of the recorded exit calls.
+  absl::Duration MeanLatency() const;
+
+  // Returns the latency within which |fraction| of the recorded exit calls
+  // completed, rounded up to the end of its histogram bucket.
+  absl::Duration PercentileLatency(double fraction) const;
+
+  uint64_t count = 0;
+  uint64_t errors = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  uint64_t total_latency_ns = 0;
+
+  // The number of exit calls whose latency fell in each bucket of an HDR-style
+  // histogram. Each power-of-two range of nanoseconds is divided into
+  // ExitMetrics::kSubBuckets equal buckets, so a latency is known to within
+  // 1/kSubBuckets of its value.
+  std::vector<uint64_t> latency_buckets;
+};
+
+// A point-in-time copy of the totals held by an ExitMetrics.
+struct ExitMetricsSnapshot {
+  // Returns a human-readable table of the totals, with the slowest selectors
+  // and system calls first.
+  std::string ToString() const;
+
+  // Totals by exit selector.
+  std::map<uint64_t, ExitCallStats> selectors;
+
+  // Totals of the exit calls to |kSystemCallSelector| by system call number.
+  std::map<int, ExitCallStats> system_calls;
+};
+
+// Records the count, bytes in and out, and latency of exit calls, by selector
+// and, for host system calls, by system call number.
+//
+// Recording is lock-free: each thread records into one of kShards shards of
+// atomic counters, and the shards are only summed when a snapshot is taken.
+class ExitMetrics {
+ public:
+  // The selector whose exit calls carry a single serialized system call.
+  static constexpr uint64_t kSystemCallSelector = kSelectorHostCall;
+
+  // Exit calls with selectors, or system calls with numbers, at or above these
+  // limits are recorded together under the limit.
+  static constexpr uint64_t kMaxSelector = 512;
+  static constexpr int kMaxSystemCall = 512;
+
+  // The number of histogram buckets per power of two, and in total. Latencies
+  // beyond the last bucket are recorded in the last bucket.
+  static constexpr int kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  static constexpr int kMaxLatencyBits = 40;
+  static constexpr size_t kLatencyBuckets =
+      (kMaxLatencyBits - kSubBucketBits + 1) * kSubBuckets;
+
+  static constexpr size_t kShards = 16;
+
+  ExitMetrics();
+  ~ExitMetrics();
+
+  ExitMetrics(const ExitMetrics &other) = delete;
+  ExitMetrics &operator=(const ExitMetrics &other) = delete;
+
+  // Records an exit call with |selector|. |system_call| is the number of the
+  // system call it made, or -1 if it did not carry a system call.
+  void Record(uint64_t selector, int system_call, size_t bytes_in,
+              size_t bytes_out, absl::Duration latency, bool ok);
+
+  // Returns the totals recorded so far.
+  ExitMetricsSnapshot Snapshot() const;
+
+  // Returns the histogram bucket for a latency of |latency_ns| nanoseconds.
+  static size_t BucketIndex(uint64_t latency_ns);
+
+  // Returns the names under which |selector| and system call |sysno| are
+  // reported.
+  static std::string SelectorName(uint64_t selector);
+  static std::string SystemCallName(int sysno);
+
+ private:
+  // The counters for one selector or system call within one shard.
+  struct Counters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> total_latency_ns{0};
+    std::atomic<uint64_t> latency_buckets[kLatencyBuckets] = {};
+  };
+
+  // The counters of one shard. Counters are allocated the first time their
+  // selector or system call is recorded in the shard.
+  struct alignas(64) Shard {
+    std::atomic<Counters *> selectors[kMaxSelector + 1] = {};
+    std::atomic<Counters *> system_calls[kMaxSystemCall + 1] = {};
+  };
+
+  // Returns the counters in |slot|, allocating them if necessary.
+  static Counters *GetOrCreate(std::atomic<Counters *> *slot);
+
+  // Adds one exit call to |counters|.
+  static void Add(Counters *counters, size_t bytes_in, size_t bytes_out,
+                  uint64_t latency_ns, bool ok);
+
+  // Adds |counters| to |stats|.
+  static void Accumulate(const Counters &counters, ExitCallStats *stats);
+
+  // Returns the shard of the calling thread.
+  Shard *ThreadShard();
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// A hook factory which records every exit call in an ExitMetrics.
+class ExitMetricsHookFactory : public DispatchTable::ExitHookFactory {
+ public:
+  explicit ExitMetricsHookFactory(std::shared_ptr<ExitMetrics> metrics);
+
+  std::unique_ptr<DispatchTable::ExitHook> CreateExitHook() override;
+
+ private:
+  const std::shared_ptr<ExitMetrics> metrics_;
+};
+
+// A variation of DispatchTable that records metrics of its exit calls in
+// |metrics|.
+class MetricsDispatchTable : public DispatchTable {
+ public:
+  explicit MetricsDispatchTable(std::shared_ptr<ExitMetrics> metrics);
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_EXIT_METRICS_H_
@@ -0,0 +1,235 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/exit_metrics.h"
+
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "asylo/platform/primitives/extent.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/message.h"
+#include "asylo/platform/system_call/serialize.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+using ::testing::Le;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+constexpr uint64_t kSelector = kSelectorUser + 1;
+constexpr char kOutput[] = "output";
+
+class MetricsEnclaveClient : public Client {
+ public:
+  explicit MetricsEnclaveClient(std::shared_ptr<ExitMetrics> metrics)
+      : Client(/*name=*/"metrics_enclave",
+               absl::make_unique<MetricsDispatchTable>(std::move(metrics))) {}
+
+  // Virtual methods not used in this test.
+  bool IsClosed() const override { return false; }
+  Status Destroy() override { return Status::OkStatus(); }
+  Status EnclaveCallInternal(uint64_t selector, MessageWriter *in,
+                             MessageReader *out) override {
+    return Status::OkStatus();
+  }
+};
+
+// Returns a MessageReader holding the extents of |writer|, as an exit handler
+// receives them.
+MessageReader ReaderFor(const MessageWriter &writer) {
+  std::vector<char> buffer(writer.MessageSize());
+  writer.Serialize(buffer.data());
+  MessageReader reader;
+  reader.Deserialize(buffer.data(), buffer.size());
+  return reader;
+}
+
+class ExitMetricsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    metrics_ = std::make_shared<ExitMetrics>();
+    client_ = std::make_shared<MetricsEnclaveClient>(metrics_);
+  }
+
+  Status Invoke(uint64_t selector, MessageReader *input,
+                MessageWriter *output) {
+    return client_->exit_call_provider()->InvokeExitHandler(
+        selector, input, output, client_.get());
+  }
+
+  std::shared_ptr<ExitMetrics> metrics_;
+  std::shared_ptr<MetricsEnclaveClient> client_;
+};
+
+TEST_F(ExitMetricsTest, RecordsCountAndBytesBySelector) {
+  ASYLO_ASSERT_OK(client_->exit_call_provider()->RegisterExitHandler(
+      kSelector, ExitHandler{[](std::shared_ptr<Client> client, void *context,
+                                MessageReader *input, MessageWriter *output) {
+        output->PushString(kOutput);
+        return Status::OkStatus();
+      }}));
+
+  MessageWriter input_writer;
+  input_writer.PushString("input data");
+  for (int i = 0; i < 3; ++i) {
+    MessageReader input = ReaderFor(input_writer);
+    MessageWriter output;
+    ASYLO_ASSERT_OK(Invoke(kSelector, &input, &output));
+  }
+
+  ExitMetricsSnapshot snapshot = metrics_->Snapshot();
+  ASSERT_THAT(snapshot.selectors.count(kSelector), Eq(1));
+  const ExitCallStats &stats = snapshot.selectors[kSelector];
+  EXPECT_THAT(stats.count, Eq(3));
+  EXPECT_THAT(stats.errors, Eq(0));
+  EXPECT_THAT(stats.bytes_in, Eq(3 * input_writer.MessageSize()));
+  EXPECT_THAT(stats.bytes_out, Eq(3 * (sizeof(uint64_t) + sizeof(kOutput))));
+  EXPECT_THAT(stats.latency_buckets, SizeIs(ExitMetrics::kLatencyBuckets));
+  EXPECT_TRUE(snapshot.system_calls.empty());
+}
+
+TEST_F(ExitMetricsTest, RecordsFailedAndUnknownExits) {
+  MessageWriter output;
+  EXPECT_THAT(Invoke(kSelector, nullptr, &output),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+
+  ExitMetricsSnapshot snapshot = metrics_->Snapshot();
+  EXPECT_THAT(snapshot.selectors[kSelector].count, Eq(1));
+  EXPECT_THAT(snapshot.selectors[kSelector].errors, Eq(1));
+  EXPECT_THAT(snapshot.selectors[kSelector].bytes_in, Eq(0));
+}
+
+TEST_F(ExitMetricsTest, RecordsHostSystemCallsByNumber) {
+  ASYLO_ASSERT_OK(client_->exit_call_provider()->RegisterExitHandler(
+      ExitMetrics::kSystemCallSelector,
+      ExitHandler{[](std::shared_ptr<Client> client, void *context,
+                     MessageReader *input, MessageWriter *output) {
+        return Status::OkStatus();
+      }}));
+
+  Extent request;
+  ASSERT_TRUE(
+      system_call::SerializeRequest(SYS_getpid, {}, &request).ok());
+  MessageWriter input_writer;
+  input_writer.PushByCopy(request);
+  free(request.data());
+
+  MessageReader input = ReaderFor(input_writer);
+  MessageWriter output;
+  ASYLO_ASSERT_OK(Invoke(ExitMetrics::kSystemCallSelector, &input, &output));
+
+  ExitMetricsSnapshot snapshot = metrics_->Snapshot();
+  EXPECT_THAT(snapshot.selectors[ExitMetrics::kSystemCallSelector].count,
+              Eq(1));
+  ASSERT_THAT(snapshot.system_calls.count(SYS_getpid), Eq(1));
+  EXPECT_THAT(snapshot.system_calls[SYS_getpid].count, Eq(1));
+  EXPECT_THAT(snapshot.system_calls[SYS_getpid].bytes_in,
+              Eq(input_writer.MessageSize()));
+  EXPECT_THAT(snapshot.ToString(), HasSubstr("getpid"));
+}
+
+TEST_F(ExitMetricsTest, AggregatesLargeSelectors) {
+  metrics_->Record(ExitMetrics::kMaxSelector + 100, -1, 0, 0,
+                   absl::Microseconds(1), true);
+  ExitMetricsSnapshot snapshot = metrics_->Snapshot();
+  EXPECT_THAT(snapshot.selectors[ExitMetrics::kMaxSelector].count, Eq(1));
+  EXPECT_THAT(snapshot.ToString(), HasSubstr("other"));
+}
+
+TEST_F(ExitMetricsTest, SumsShardsOfAllThreads) {
+  constexpr int kThreads = 32;
+  constexpr int kExitsPerThread = 1000;
+  std::vector<Thread> threads;
+  threads.reserve(kThreads);
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this] {
+      for (int j = 0; j < kExitsPerThread; ++j) {
+        metrics_->Record(kSelector, SYS_read, 10, 20, absl::Microseconds(5),
+                         true);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  ExitMetricsSnapshot snapshot = metrics_->Snapshot();
+  const ExitCallStats &stats = snapshot.selectors[kSelector];
+  EXPECT_THAT(stats.count, Eq(kThreads * kExitsPerThread));
+  EXPECT_THAT(stats.bytes_in, Eq(10 * kThreads * kExitsPerThread));
+  EXPECT_THAT(stats.bytes_out, Eq(20 * kThreads * kExitsPerThread));
+  EXPECT_THAT(snapshot.system_calls[SYS_read].count,
+              Eq(kThreads * kExitsPerThread));
+  EXPECT_THAT(stats.MeanLatency(), Eq(absl::Microseconds(5)));
+}
+
+TEST_F(ExitMetricsTest, ReportsPercentiles) {
+  for (int i = 0; i < 90; ++i) {
+    metrics_->Record(kSelector, -1, 0, 0, absl::Microseconds(10), true);
+  }
+  for (int i = 0; i < 10; ++i) {
+    metrics_->Record(kSelector, -1, 0, 0, absl::Milliseconds(10), true);
+  }
+
+  const ExitCallStats stats = metrics_->Snapshot().selectors[kSelector];
+  absl::Duration p50 = stats.PercentileLatency(0.5);
+  EXPECT_THAT(p50, Ge(absl::Microseconds(10)));
+  EXPECT_THAT(p50, Lt(absl::Microseconds(10) * 9 / 8));
+  absl::Duration p99 = stats.PercentileLatency(0.99);
+  EXPECT_THAT(p99, Ge(absl::Milliseconds(10)));
+  EXPECT_THAT(p99, Lt(absl::Milliseconds(10) * 9 / 8));
+}
+
+TEST(ExitMetricsBucketTest, BucketsBoundTheirLatencies) {
+  for (uint64_t latency_ns = 0; latency_ns < (uint64_t{1} << 38);
+       latency_ns = latency_ns * 3 / 2 + 1) {
+    size_t index = ExitMetrics::BucketIndex(latency_ns);
+    ASSERT_THAT(index, Lt(ExitMetrics::kLatencyBuckets));
+    EXPECT_THAT(ExitCallStats::BucketLowerBound(index), Le(latency_ns));
+    EXPECT_THAT(ExitCallStats::BucketLowerBound(index + 1), Gt(latency_ns));
+    // Each bucket spans at most 1/kSubBuckets of its lower bound.
+    EXPECT_THAT(ExitCallStats::BucketLowerBound(index + 1) -
+                    ExitCallStats::BucketLowerBound(index),
+                Le(std::max<uint64_t>(1, ExitCallStats::BucketLowerBound(index) /
+                                             ExitMetrics::kSubBuckets)));
+  }
+  EXPECT_THAT(ExitMetrics::BucketIndex(~uint64_t{0}),
+              Eq(ExitMetrics::kLatencyBuckets - 1));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
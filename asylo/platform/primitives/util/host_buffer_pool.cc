@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/host_buffer_pool.h"
+
+#include <cstdlib>
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+// The pooled buffer owned by a single host thread.
+struct ThreadBuffer {
+  ~ThreadBuffer() { free(data); }
+
+  void *data = nullptr;
+  size_t capacity = 0;
+  bool in_use = false;
+};
+
+ThreadBuffer *GetThreadBuffer() {
+  static thread_local ThreadBuffer thread_buffer;
+  return &thread_buffer;
+}
+
+}  // namespace
+
+constexpr size_t HostBufferPool::kMaxPooledBufferSize;
+
+void *HostBufferPool::Acquire(size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  ThreadBuffer *thread_buffer = GetThreadBuffer();
+  if (thread_buffer->in_use || size > kMaxPooledBufferSize) {
+    return malloc(size);
+  }
+
+  if (size > thread_buffer->capacity) {
+    // Grow geometrically so that a thread settles on a single allocation.
+    size_t capacity = thread_buffer->capacity == 0 ? size
+                                                   : thread_buffer->capacity;
+    while (capacity < size) {
+      capacity *= 2;
+    }
+    if (capacity > kMaxPooledBufferSize) {
+      capacity = kMaxPooledBufferSize;
+    }
+    void *data = realloc(thread_buffer->data, capacity);
+    if (!data) {
+      return malloc(size);
+    }
+    thread_buffer->data = data;
+    thread_buffer->capacity = capacity;
+  }
+
+  thread_buffer->in_use = true;
+  return thread_buffer->data;
+}
+
+bool HostBufferPool::Release(void *buffer) {
+  ThreadBuffer *thread_buffer = GetThreadBuffer();
+  if (!buffer || buffer != thread_buffer->data) {
+    return false;
+  }
+  thread_buffer->in_use = false;
+  return true;
+}
+
+void *HostBufferPool::Serialize(const MessageWriter &writer, size_t *size) {
+  *size = writer.MessageSize();
+  if (*size == 0) {
+    return nullptr;
+  }
+  void *buffer = Acquire(*size);
+  if (!buffer) {
+    *size = 0;
+    return nullptr;
+  }
+  writer.Serialize(buffer);
+  return buffer;
+}
+
+}  // namespace primitives
+}  // namespace asylo
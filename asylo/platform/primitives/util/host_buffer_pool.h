@@ -0,0 +1,66 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_PRIMITIVES_UTIL_HOST_BUFFER_POOL_H_
+#define ASYLO_PLATFORM_PRIMITIVES_UTIL_HOST_BUFFER_POOL_H_
+
+#include <cstddef>
+
+#include "asylo/platform/primitives/util/message.h"
+
+namespace asylo {
+namespace primitives {
+
+// A per-thread pool of host memory used to return the serialized output of
+// exit calls to an enclave.
+//
+// Exit call output is consumed by the enclave on the same host thread, before
+// that thread can issue another exit, and is then released through the
+// backend's untrusted free handler. This makes a single reusable buffer per
+// thread sufficient for the common case, replacing a malloc() and free() pair
+// per exit. Buffers that are larger than kMaxPooledBufferSize, or that are
+// requested while the thread's pooled buffer is still in use, fall back to
+// malloc().
+//
+// Backends must route frees of buffers returned by Acquire() through
+// Release(), and call free() only if Release() returns false.
+class HostBufferPool {
+ public:
+  // The largest buffer retained by a thread's pool.
+  static constexpr size_t kMaxPooledBufferSize = 1 << 20;
+
+  // Returns a buffer of at least |size| bytes, which must be returned with
+  // Release(). Returns nullptr if |size| is zero or allocation fails.
+  static void *Acquire(size_t size);
+
+  // Returns |buffer| to the calling thread's pool. Returns true if |buffer| was
+  // pooled, in which case the caller must not free it. Returns false if
+  // |buffer| is not owned by the calling thread's pool.
+  static bool Release(void *buffer);
+
+  // Serializes |writer| into a buffer obtained from Acquire(), writing each
+  // extent directly into the buffer in a single pass. Stores the message size
+  // in |size| and returns the buffer, or nullptr and a |size| of zero if the
+  // message is empty or allocation fails.
+  static void *Serialize(const MessageWriter &writer, size_t *size);
+};
+
+}  // namespace primitives
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_PRIMITIVES_UTIL_HOST_BUFFER_POOL_H_
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/primitives/util/host_buffer_pool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/primitives/util/message.h"
+
+namespace asylo {
+namespace primitives {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::Ne;
+using ::testing::NotNull;
+using ::testing::StrEq;
+
+// Frees |buffer| the way a backend's untrusted free handler does.
+void FreeBuffer(void *buffer) {
+  if (!HostBufferPool::Release(buffer)) {
+    free(buffer);
+  }
+}
+
+TEST(HostBufferPoolTest, ZeroSizeReturnsNull) {
+  EXPECT_THAT(HostBufferPool::Acquire(0), IsNull());
+  EXPECT_FALSE(HostBufferPool::Release(nullptr));
+}
+
+TEST(HostBufferPoolTest, ReusesBufferAfterRelease) {
+  void *first = HostBufferPool::Acquire(64);
+  ASSERT_THAT(first, NotNull());
+  EXPECT_TRUE(HostBufferPool::Release(first));
+
+  void *second = HostBufferPool::Acquire(32);
+  EXPECT_THAT(second, Eq(first));
+  EXPECT_TRUE(HostBufferPool::Release(second));
+}
+
+TEST(HostBufferPoolTest, BufferInUseFallsBackToMalloc) {
+  void *pooled = HostBufferPool::Acquire(64);
+  void *unpooled = HostBufferPool::Acquire(64);
+  ASSERT_THAT(pooled, NotNull());
+  ASSERT_THAT(unpooled, NotNull());
+  EXPECT_THAT(unpooled, Ne(pooled));
+
+  EXPECT_FALSE(HostBufferPool::Release(unpooled));
+  free(unpooled);
+  EXPECT_TRUE(HostBufferPool::Release(pooled));
+}
+
+TEST(HostBufferPoolTest, OversizedBufferIsNotPooled) {
+  void *buffer = HostBufferPool::Acquire(HostBufferPool::kMaxPooledBufferSize +
+                                         1);
+  ASSERT_THAT(buffer, NotNull());
+  EXPECT_FALSE(HostBufferPool::Release(buffer));
+  free(buffer);
+}
+
+TEST(HostBufferPoolTest, BuffersArePerThread) {
+  void *main_buffer = HostBufferPool::Acquire(64);
+  ASSERT_THAT(main_buffer, NotNull());
+
+  std::thread other([main_buffer] {
+    // The other thread's pool does not own the main thread's buffer.
+    EXPECT_FALSE(HostBufferPool::Release(main_buffer));
+
+    void *buffer = HostBufferPool::Acquire(64);
+    EXPECT_THAT(buffer, Ne(main_buffer));
+    EXPECT_TRUE(HostBufferPool::Release(buffer));
+  });
+  other.join();
+
+  EXPECT_TRUE(HostBufferPool::Release(main_buffer));
+}
+
+TEST(HostBufferPoolTest, SerializeRoundTrip) {
+  const std::string large(4096, 'x');
+  MessageWriter writer;
+  writer.Push<int>(42);
+  writer.PushByReference(Extent{large.data(), large.size()});
+  writer.PushString("hello");
+
+  size_t size = 0;
+  void *buffer = HostBufferPool::Serialize(writer, &size);
+  ASSERT_THAT(buffer, NotNull());
+  EXPECT_THAT(size, Eq(writer.MessageSize()));
+
+  MessageReader reader;
+  reader.Deserialize(buffer, size);
+  FreeBuffer(buffer);
+
+  ASSERT_THAT(reader.size(), Eq(3));
+  EXPECT_THAT(reader.next<int>(), Eq(42));
+  Extent extent = reader.next();
+  EXPECT_THAT(std::string(extent.As<char>(), extent.size()), Eq(large));
+  EXPECT_THAT(reader.next().As<char>(), StrEq("hello"));
+}
+
+TEST(HostBufferPoolTest, SerializeEmptyMessage) {
+  MessageWriter writer;
+  size_t size = 1;
+  EXPECT_THAT(HostBufferPool::Serialize(writer, &size), IsNull());
+  EXPECT_THAT(size, Eq(0));
+}
+
+}  // namespace
+}  // namespace primitives
+}  // namespace asylo
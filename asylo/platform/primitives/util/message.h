@@ -24,6 +24,7 @@
 #include <sys/un.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <memory>
@@ -112,6 +113,22 @@ class MessageWriter {
     PushByReference(Extent{extent_data, extent.size()});
   }
 
+  // Pushes |size| bytes of |data| to the MessageWriter, taking ownership of
+  // |data| instead of copying it.
+  void PushByOwnership(std::unique_ptr<char[]> data, size_t size) {
+    PushByReference(Extent{data.get(), size});
+    copied_data_owner_.push_back(std::move(data));
+  }
+
+  // Pushes |extent|, whose data was allocated with malloc(), to the
+  // MessageWriter. The MessageWriter takes ownership of the data and releases
+  // it with free(). This avoids copying buffers produced by C interfaces, such
+  // as serialized system call responses.
+  void PushMallocated(Extent extent) {
+    PushByReference(extent);
+    malloced_data_owner_.emplace_back(extent.data());
+  }
+
   // Pushes non-pointer data types (eg. ints, structs) by value. Internally
   // performs a copy, since the input value could go out of scope after being
   // pushed.
@@ -171,8 +188,14 @@ class MessageWriter {
   }
 
  private:
+  // Deleter for data pushed with PushMallocated().
+  struct FreeDeleter {
+    void operator()(void *ptr) const { free(ptr); }
+  };
+
   std::vector<Extent> extents_;
   std::vector<std::unique_ptr<char[]>> copied_data_owner_;
+  std::vector<std::unique_ptr<void, FreeDeleter>> malloced_data_owner_;
 };
 
 // A message reader that consumes a serialized message and generates extents.
@@ -229,6 +252,22 @@ class MessageReader {
   // Returns the number of extents read.
   size_t size() const { return extents_.size(); }
 
+  // Returns the size of the serialized message the extents were read from.
+  size_t MessageSize() const {
+    size_t result = sizeof(uint64_t) * extents_.size();
+    for (const auto &extent : extents_) {
+      result += extent.second;
+    }
+    return result;
+  }
+
+  // Returns the extent at |index| without affecting the traversal. The extent
+  // remains owned by the MessageReader and its lifetime is the lifetime of the
+  // MessageReader.
+  Extent extent(size_t index) const {
+    return Extent{extents_[index].first.get(), extents_[index].second};
+  }
+
   // Returns the next extent in the MessageReader. The MessageReader may only be
   // traversed once. The returned extent remains owned by the MessageReader and
   // its lifetime is the lifetime of the MessageReader.
@@ -267,6 +306,9 @@ class MessageReader {
   // Returns if the reader traversal has reached the end.
   bool hasNext() const { return pos_ != size(); }
 
+  // Returns the number of items left to traverse.
+  size_t remaining() const { return size() - pos_; }
+
 #define ASYLO_RETURN_IF_INCORRECT_READER_ARGUMENTS(reader, expected_args) \
   do {                                                                    \
     if ((reader).size() != expected_args) {                               \
@@ -19,6 +19,8 @@
 #include "asylo/platform/primitives/util/message.h"
 
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 
 #include <gmock/gmock.h>
@@ -190,6 +192,31 @@ TEST(MessageTest, PushPopStrings) {
   EXPECT_THAT(reader.next().As<char>(), StrEq("moon"));
 }
 
+// Ensure buffers pushed by ownership transfer are serialized without being
+// copied at push time.
+TEST(MessageTest, PushByOwnership) {
+  auto owned = absl::make_unique<char[]>(6);
+  memcpy(owned.get(), "hello", 6);
+  const char *owned_data = owned.get();
+
+  char *malloced = static_cast<char *>(malloc(6));
+  memcpy(malloced, "world", 6);
+
+  MessageWriter writer;
+  writer.PushByOwnership(std::move(owned), 6);
+  writer.PushMallocated(Extent{malloced, 6});
+  EXPECT_THAT(writer, SizeIs(2));
+
+  // Mutating the buffers after they were pushed is reflected in the message.
+  malloced[0] = 'W';
+  EXPECT_THAT(owned_data, StrEq("hello"));
+
+  MessageReader reader = BuildMessageReader(writer);
+  ASSERT_THAT(reader, SizeIs(2));
+  EXPECT_THAT(reader.next().As<char>(), StrEq("hello"));
+  EXPECT_THAT(reader.next().As<char>(), StrEq("World"));
+}
+
 }  // namespace
 }  // namespace primitives
 }  // namespace asylo
@@ -22,16 +22,23 @@
 
 // IO syscall interface constants.
 #include <fcntl.h>
+#include <sys/stat.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <iterator>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "absl/synchronization/mutex.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/util/status.h"
 
 namespace asylo {
 namespace platform {
@@ -49,6 +56,17 @@ bool IsPathNameValid(const char *path_name) {
 
 bool is_transient_error(int err) { return (err == EAGAIN) || (err == EINTR); }
 
+// Identifies an integrity index of the current layout ("ASYLOIX1").
+constexpr uint64_t kIndexMagic = 0x3158494f4c595341;
+
+// Length of a leaf hash of the authenticated dictionary.
+constexpr size_t kLeafHashLength = 32;
+
+// Number of leaf hashes read from or written to an integrity index, and number
+// of blocks read when scanning a file, per host call.
+constexpr int64_t kIndexChunkLeaves = 32 * 1024;
+constexpr int64_t kScanChunkBlocks = 4 * 1024;
+
 // Returns -1 on failure, or min(|len|, bytes to EOF) on success.
 ssize_t read_all(int fd, void *buf, size_t len) {
   size_t bytes_to_read = len;
@@ -101,6 +119,35 @@ ssize_t write_all(int fd, const void *buf, size_t len) {
   return offset;
 }
 
+// Returns -1 on failure, or |len| on success. Writes at |file_offset| and
+// leaves the cursor of |fd| unchanged.
+ssize_t pwrite_all(int fd, const void *buf, size_t len, off_t file_offset) {
+  size_t bytes_to_write = len;
+  size_t offset = 0;
+
+  while (bytes_to_write > 0) {
+    ssize_t bytes_written;
+    do {
+      bytes_written = enc_untrusted_pwrite64(
+          fd, static_cast<const uint8_t *>(buf) + offset, bytes_to_write,
+          file_offset + offset);
+    } while ((bytes_written == -1) && is_transient_error(errno));
+    if (bytes_written == -1) {
+      return -1;
+    }
+
+    bytes_to_write -= bytes_written;
+    offset += bytes_written;
+  }
+
+  // Sanity check.
+  if (offset != len) {
+    return -1;
+  }
+
+  return offset;
+}
+
 // Returns offset to the plaintext buffer associated with the |block_index| of
 // a full block.
 const uint8_t *GetPlaintextBuffer(size_t first_partial_block_bytes_count,
@@ -141,9 +188,107 @@ using BlockView = ByteContainerView;
 using CiphertextView = ByteContainerView;
 using SecureBlockView = ByteContainerView;
 
+class AeadHandler::BlockStorage : public RandomAccessStorage {
+ public:
+  BlockStorage(const AeadHandler *handler, FileControl *file_ctrl)
+      : handler_(handler), file_ctrl_(file_ctrl) {}
+
+  StatusOr<size_t> Size() const override { return file_ctrl_->logical_size; }
+
+  // Reads and verifies a single block. Blocks past the end of the file on disk
+  // are read as zeros.
+  Status Read(void *buffer, off_t offset, size_t size) override {
+    file_ctrl_->mu.AssertHeld();
+    if (size != kBlockLength || offset % kBlockLength != 0) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Only single blocks can be read");
+    }
+
+    Block *block = static_cast<Block *>(buffer);
+    if (offset / kBlockLength >= file_ctrl_->ad->LeafCount()) {
+      memset(block->data(), 0, kBlockLength);
+      return Status::OkStatus();
+    }
+    if (!handler_->ReadFullBlock(*file_ctrl_, offset, block)) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("Failed to read a cached block, path=",
+                                 file_ctrl_->path));
+    }
+    return Status::OkStatus();
+  }
+
+  // Encrypts and writes a run of blocks with a single write, and updates the
+  // file digest.
+  Status Write(const void *buffer, off_t offset, size_t size) override {
+    file_ctrl_->mu.AssertHeld();
+    if (size % kBlockLength != 0 || offset % kBlockLength != 0) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Only whole blocks can be written");
+    }
+
+    const GcmCryptor *cryptor = handler_->GetGcmCryptor(*file_ctrl_);
+    if (!cryptor) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("No cryptor to write cached blocks, path=",
+                                 file_ctrl_->path));
+    }
+    int fd = enc_untrusted_open(file_ctrl_->path.c_str(), O_WRONLY);
+    if (fd == -1) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("Failed to open file to write cached blocks, "
+                                 "path=",
+                                 file_ctrl_->path));
+    }
+
+    FdCloser fd_closer(fd, &enc_untrusted_close);
+    if (handler_->EncryptAndPersistInternal(fd, buffer, size, file_ctrl_,
+                                            offset,
+                                            /*use_cursor=*/false) == -1 ||
+        !handler_->UpdateDigest(file_ctrl_, *cryptor) || !fd_closer.reset()) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("Failed to write cached blocks, path=",
+                                 file_ctrl_->path));
+    }
+    return Status::OkStatus();
+  }
+
+  // Blocks are written to the file synchronously by Write.
+  Status Sync() override { return Status::OkStatus(); }
+
+  Status Truncate(size_t size) override {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "Secure files cannot be truncated");
+  }
+
+ private:
+  const AeadHandler *const handler_;
+  FileControl *const file_ctrl_;
+};
+
 AeadHandler::AeadHandler()
     : offset_translator_(OffsetTranslator::Create(
-          sizeof(FileHeader), kBlockLength, kSecureBlockLength)) {}
+          sizeof(FileHeader), kBlockLength, kSecureBlockLength)),
+      block_cache_capacity_(0) {}
+
+void AeadHandler::FileControl::MarkLeavesDirty(int64_t first, int64_t last) {
+  // Leaves past the end of the index are written anyway.
+  last = std::min(last, indexed_leaves);
+  if (first >= last) {
+    return;
+  }
+
+  // Merge the range with those it overlaps or touches.
+  auto it = dirty_leaves.upper_bound(first);
+  if (it != dirty_leaves.begin() && std::prev(it)->second >= first) {
+    --it;
+    first = it->first;
+  }
+  while (it != dirty_leaves.end() && it->first <= last) {
+    last = std::max(last, it->second);
+    it = dirty_leaves.erase(it);
+  }
+  dirty_leaves.emplace(first, last);
+}
 
 bool AeadHandler::Deserialize(FileControl *file_ctrl) {
   if (!file_ctrl) {
@@ -194,36 +339,126 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
   // confirms validity of both the file size and the integrity metadata.
   const int64_t blocks_count =
       (file_header.file_size + kBlockLength - 1) / kBlockLength;
-  Tag tag;
-  for (int64_t block_index = 0; block_index < blocks_count; block_index++) {
-    off_t offset = enc_untrusted_lseek(fd, kBlockLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past block when collecting integrity metadata.";
+  if (blocks_count >= kMinIndexedBlocks &&
+      LoadIndex(file_header, blocks_count, file_ctrl)) {
+    if (VerifyRoot(file_header, *cryptor, file_ctrl)) {
+      VLOG(2) << "Pushed leaf hashes from the integrity index on "
+                 "initialization.";
+      file_ctrl->logical_size = file_header.file_size;
+      file_ctrl->file_hash = file_header.file_hash;
+      file_ctrl->index_stale = false;
+      file_ctrl->indexed_leaves = blocks_count;
+      return true;
+    }
+    LOG(WARNING) << "Integrity index does not match the file, scanning the "
+                    "file instead, path="
+                 << file_ctrl->path;
+    file_ctrl->ad = absl::make_unique<CTMMTAuthenticatedDictionary>();
+  }
+
+  if (!ScanBlocks(fd, blocks_count, file_ctrl)) {
+    return false;
+  }
+
+  VLOG(2) << "Pushed block auth tags on initialization.";
+
+  if (!VerifyRoot(file_header, *cryptor, file_ctrl)) {
+    LOG(ERROR) << "Failure validating integrity root for file "
+               << file_ctrl->path << ", current root: "
+               << absl::BytesToHexString(file_ctrl->ad->CurrentRoot());
+    return false;
+  }
+
+  file_ctrl->logical_size = file_header.file_size;
+  file_ctrl->file_hash = file_header.file_hash;
+  file_ctrl->index_stale = true;
+  return true;
+}
+
+bool AeadHandler::LoadIndex(const FileHeader &file_header,
+                            int64_t blocks_count,
+                            FileControl *file_ctrl) const {
+  file_ctrl->mu.AssertHeld();
+
+  const std::string index_path = file_ctrl->path + kIntegrityIndexSuffix;
+  int fd = enc_untrusted_open(index_path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    VLOG(2) << "No integrity index found, path=" << index_path;
+    return false;
+  }
+
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  IndexHeader index_header;
+  ssize_t bytes_read = read_all(fd, index_header.data(), sizeof(IndexHeader));
+  if (bytes_read != sizeof(IndexHeader) || index_header.magic != kIndexMagic ||
+      index_header.file_hash != file_header.file_hash ||
+      index_header.leaf_count != blocks_count) {
+    VLOG(2) << "Ignoring stale integrity index, path=" << index_path;
+    return false;
+  }
+
+  std::vector<uint8_t> buffer(std::min(blocks_count, kIndexChunkLeaves) *
+                              kLeafHashLength);
+  for (int64_t loaded = 0; loaded < blocks_count;) {
+    const int64_t chunk_leaves =
+        std::min(blocks_count - loaded, kIndexChunkLeaves);
+    const size_t chunk_bytes = chunk_leaves * kLeafHashLength;
+    bytes_read = read_all(fd, buffer.data(), chunk_bytes);
+    if (bytes_read != chunk_bytes) {
+      LOG(WARNING) << "Failed to read integrity index, path=" << index_path
+                   << ", bytes_read=" << bytes_read;
       return false;
     }
+    for (int64_t leaf = 0; leaf < chunk_leaves; leaf++) {
+      file_ctrl->ad->AddLeafHash(std::string(
+          reinterpret_cast<const char *>(buffer.data()) +
+              leaf * kLeafHashLength,
+          kLeafHashLength));
+    }
+    loaded += chunk_leaves;
+  }
 
-    bytes_read = read_all(fd, tag.data(), kTagLength);
-    if (bytes_read != kTagLength) {
+  return true;
+}
+
+bool AeadHandler::ScanBlocks(int fd, int64_t blocks_count,
+                             FileControl *file_ctrl) const {
+  file_ctrl->mu.AssertHeld();
+
+  // Read blocks sequentially in large chunks rather than seeking to each auth
+  // tag, so that the number of host calls does not grow with the block count.
+  std::vector<uint8_t> buffer(std::min(blocks_count, kScanChunkBlocks) *
+                              kSecureBlockLength);
+  for (int64_t scanned = 0; scanned < blocks_count;) {
+    const int64_t chunk_blocks =
+        std::min(blocks_count - scanned, kScanChunkBlocks);
+    const size_t chunk_bytes = chunk_blocks * kSecureBlockLength;
+    ssize_t bytes_read = read_all(fd, buffer.data(), chunk_bytes);
+    if (bytes_read != chunk_bytes) {
       LOG(ERROR) << "Failed to read integrity metadata, bytes_read="
                  << bytes_read;
       return false;
     }
 
-    std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
-    VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
-            << absl::BytesToHexString(tag_string);
-    file_ctrl->ad->AddLeaf(tag_string);
-
-    offset = enc_untrusted_lseek(fd, kTokenLength, SEEK_CUR);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek past token when collecting integrity metadata.";
-      return false;
+    for (int64_t block = 0; block < chunk_blocks; block++) {
+      std::string tag_string(reinterpret_cast<const char *>(buffer.data()) +
+                                 block * kSecureBlockLength + kBlockLength,
+                             kTagLength);
+      VLOG(2) << "Adding auth tag as leaf to rebuild Merkle tree: "
+              << absl::BytesToHexString(tag_string);
+      file_ctrl->ad->AddLeaf(tag_string);
     }
+    scanned += chunk_blocks;
   }
 
-  VLOG(2) << "Pushed block auth tags on initialization.";
+  return true;
+}
+
+bool AeadHandler::VerifyRoot(const FileHeader &file_header,
+                             const GcmCryptor &cryptor,
+                             FileControl *file_ctrl) const {
+  file_ctrl->mu.AssertHeld();
 
   // Prepare file data digest.
   DataDigest data_digest;
@@ -234,21 +469,114 @@ bool AeadHandler::Deserialize(FileControl *file_ctrl) {
 
   // Validate AD root and the file size.
   FileHash new_hash;
-  if (!cryptor->GetAuthTag(new_hash.data(), data_digest.data(),
-                           sizeof(DataDigest))) {
+  if (!cryptor.GetAuthTag(new_hash.data(), data_digest.data(),
+                          sizeof(DataDigest))) {
     LOG(ERROR) << "Failed to generate CMAC for integrity verification, root="
                << file_ctrl->ad->CurrentRoot();
     return false;
   }
 
-  if (new_hash != file_header.file_hash) {
-    LOG(ERROR) << "Failure validating integrity root for file "
-               << file_ctrl->path << ", current root: "
-               << absl::BytesToHexString(file_ctrl->ad->CurrentRoot());
+  return new_hash == file_header.file_hash;
+}
+
+bool AeadHandler::PersistIndex(FileControl *file_ctrl) const {
+  file_ctrl->mu.AssertHeld();
+
+  // An index that fails to be written in full no longer describes any state of
+  // the file, so the next attempt rewrites it from scratch.
+  const int64_t indexed_leaves = file_ctrl->indexed_leaves;
+  file_ctrl->indexed_leaves = 0;
+
+  const std::string index_path = file_ctrl->path + kIntegrityIndexSuffix;
+  int fd = -1;
+  if (indexed_leaves > 0) {
+    fd = enc_untrusted_open(index_path.c_str(), O_WRONLY);
+  }
+  const bool update = fd != -1;
+  if (!update) {
+    fd = enc_untrusted_open(index_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                            S_IRUSR | S_IWUSR);
+  }
+  if (fd == -1) {
+    LOG(ERROR) << "Failed to open integrity index for writing, path="
+               << index_path << ", errno = " << errno;
     return false;
   }
 
-  file_ctrl->logical_size = file_header.file_size;
+  FdCloser fd_closer(fd, &enc_untrusted_close);
+
+  const int64_t leaf_count = file_ctrl->ad->LeafCount();
+  std::vector<std::pair<int64_t, int64_t>> ranges;
+  if (update) {
+    ranges.assign(file_ctrl->dirty_leaves.begin(),
+                  file_ctrl->dirty_leaves.end());
+    ranges.emplace_back(indexed_leaves, leaf_count);
+  } else {
+    ranges.emplace_back(0, leaf_count);
+  }
+  for (const auto &range : ranges) {
+    if (!WriteLeafHashes(fd, range.first, range.second, *file_ctrl)) {
+      LOG(ERROR) << "Failed to write integrity index, path=" << index_path;
+      return false;
+    }
+  }
+
+  // The header is written last. Until then, the index does not match the file
+  // header, which was updated by the writes to the file, and is ignored.
+  IndexHeader index_header;
+  index_header.magic = kIndexMagic;
+  index_header.file_hash = file_ctrl->file_hash;
+  index_header.leaf_count = leaf_count;
+  ssize_t bytes_written =
+      pwrite_all(fd, index_header.data(), sizeof(IndexHeader), 0);
+  if (bytes_written != sizeof(IndexHeader)) {
+    LOG(ERROR) << "Failed to write integrity index header, path="
+               << index_path << ", bytes written = " << bytes_written;
+    return false;
+  }
+
+  if (!fd_closer.reset()) {
+    LOG(ERROR) << "Failed to close the integrity index, path=" << index_path;
+    return false;
+  }
+
+  file_ctrl->indexed_leaves = leaf_count;
+  file_ctrl->dirty_leaves.clear();
+  file_ctrl->index_stale = false;
+  return true;
+}
+
+bool AeadHandler::WriteLeafHashes(int fd, int64_t first, int64_t last,
+                                  const FileControl &file_ctrl) const {
+  file_ctrl.mu.AssertReaderHeld();
+
+  std::vector<uint8_t> buffer(
+      std::min(std::max<int64_t>(last - first, 0), kIndexChunkLeaves) *
+      kLeafHashLength);
+  for (int64_t persisted = first; persisted < last;) {
+    const int64_t chunk_leaves = std::min(last - persisted, kIndexChunkLeaves);
+    for (int64_t leaf = 0; leaf < chunk_leaves; leaf++) {
+      // Leaves of the authenticated dictionary are numbered from 1.
+      std::string leaf_hash = file_ctrl.ad->LeafHash(persisted + leaf + 1);
+      if (leaf_hash.size() != kLeafHashLength) {
+        LOG(ERROR) << "Unexpected size of leaf hash encountered, size="
+                   << leaf_hash.size();
+        return false;
+      }
+      std::copy_n(leaf_hash.data(), kLeafHashLength,
+                  buffer.data() + leaf * kLeafHashLength);
+    }
+    const size_t chunk_bytes = chunk_leaves * kLeafHashLength;
+    ssize_t bytes_written =
+        pwrite_all(fd, buffer.data(), chunk_bytes,
+                   sizeof(IndexHeader) + persisted * kLeafHashLength);
+    if (bytes_written != chunk_bytes) {
+      LOG(ERROR) << "Failed to write leaf hashes, bytes written = "
+                 << bytes_written;
+      return false;
+    }
+    persisted += chunk_leaves;
+  }
   return true;
 }
 
@@ -275,12 +603,21 @@ bool AeadHandler::InitializeFile(int fd, const char *path_name,
   VLOG(2) << "Initializing secure file, fd = " << fd
           << ", path_name = " << path_name;
   auto path_it = opened_files_.find(path_name);
-  std::shared_ptr<FileControl> file_ctrl =
-      (path_it == opened_files_.end())
-          ? std::make_shared<FileControl>(path_name, is_new_file)
-          : path_it->second;
+  std::shared_ptr<FileControl> file_ctrl;
+  if (path_it == opened_files_.end()) {
+    file_ctrl = std::make_shared<FileControl>(path_name, is_new_file);
+    if (block_cache_capacity_ > 0) {
+      file_ctrl->block_storage =
+          absl::make_unique<BlockStorage>(this, file_ctrl.get());
+      file_ctrl->block_cache = absl::make_unique<RecordStore<Block>>(
+          block_cache_capacity_, file_ctrl->block_storage.get());
+    }
+  } else {
+    file_ctrl = path_it->second;
+  }
   fmap_.emplace(fd, file_ctrl);
   opened_files_.emplace(path_name, file_ctrl);
+  ++file_ctrl->open_fds;
 
   return true;
 }
@@ -306,8 +643,31 @@ bool AeadHandler::RetrieveLogicalOffset(int fd, off_t *logical_offset) const {
   return true;
 }
 
+bool AeadHandler::SetLogicalOffset(int fd, off_t logical_offset) const {
+  off_t physical_offset = offset_translator_->LogicalToPhysical(logical_offset);
+  if (enc_untrusted_lseek(fd, physical_offset, SEEK_SET) == -1) {
+    LOG(ERROR) << "Failed to set cursor offset on descriptor: " << fd;
+    return false;
+  }
+
+  return true;
+}
+
+std::shared_ptr<AeadHandler::FileControl> AeadHandler::FindFileControl(
+    int fd) {
+  absl::MutexLock global_lock(&mu_);
+
+  auto entry = fmap_.find(fd);
+  if (entry == fmap_.end()) {
+    errno = ENOENT;
+    return nullptr;
+  }
+
+  return entry->second;
+}
+
 GcmCryptor *AeadHandler::GetGcmCryptor(const FileControl &file_ctrl) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (!file_ctrl.master_key) {
     LOG(ERROR) << "Master key has not been set, path = " << file_ctrl.path;
     return nullptr;
@@ -333,28 +693,101 @@ ssize_t AeadHandler::DecryptAndVerify(int fd, void *buf, size_t count) {
     return -1;
   }
 
-  std::shared_ptr<FileControl> file_ctrl;
+  std::shared_ptr<FileControl> file_ctrl = FindFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
+    return -1;
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+  ssize_t bytes_read = DecryptAndVerifyLocked(fd, buf, count, file_ctrl.get(),
+                                              logical_offset);
+
+  // Move cursor to the position of the end of the read range.
+  if (bytes_read > 0 && !SetLogicalOffset(fd, logical_offset + bytes_read)) {
+    return -1;
+  }
+
+  return bytes_read;
+}
+
+ssize_t AeadHandler::DecryptAndVerifyAt(int fd, void *buf, size_t count,
+                                        off_t logical_offset) {
+  if (!buf || logical_offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::shared_ptr<FileControl> file_ctrl = FindFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
+    return -1;
+  }
+
+  // Reads of a cached file update its cache, and so are serialized.
   {
-    absl::MutexLock global_lock(&mu_);
+    absl::ReaderMutexLock lock(&file_ctrl->mu);
+    if (!file_ctrl->block_cache) {
+      return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl,
+                                      logical_offset);
+    }
+  }
 
-    auto entry = fmap_.find(fd);
-    if (entry == fmap_.end()) {
-      LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
-      errno = ENOENT;
+  absl::MutexLock lock(&file_ctrl->mu);
+  return DecryptAndVerifyLocked(fd, buf, count, file_ctrl.get(),
+                                logical_offset);
+}
+
+ssize_t AeadHandler::DecryptAndVerifyLocked(int fd, void *buf, size_t count,
+                                            FileControl *file_ctrl,
+                                            off_t logical_offset) const {
+  file_ctrl->mu.AssertHeld();
+  if (!file_ctrl->block_cache) {
+    return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl,
+                                    logical_offset);
+  }
+
+  // Check for logical EOF, and do not read beyond it.
+  if (count == 0 || logical_offset >= file_ctrl->logical_size) {
+    return 0;
+  }
+  count = std::min<size_t>(count, file_ctrl->logical_size - logical_offset);
+
+  const off_t block_offset = logical_offset - logical_offset % kBlockLength;
+  if (logical_offset + count > block_offset + kBlockLength) {
+    // The blocks in the range are read from the file, which must hold the
+    // blocks modified in the cache.
+    Status status = file_ctrl->block_cache->Flush();
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to flush the block cache: " << status;
+      errno = EIO;
       return -1;
     }
+    return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl,
+                                    logical_offset);
+  }
 
-    file_ctrl = entry->second;
+  if (!GetGcmCryptor(*file_ctrl)) {
+    return -1;
   }
 
-  absl::MutexLock lock(&file_ctrl->mu);
-  return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl, logical_offset);
+  Block block;
+  Status status = file_ctrl->block_cache->Read(block_offset, &block);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read a block through the block cache: " << status;
+    errno = EIO;
+    return -1;
+  }
+
+  std::copy_n(block.data() + (logical_offset - block_offset), count,
+              static_cast<uint8_t *>(buf));
+  return count;
 }
 
 ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
                                               const FileControl &file_ctrl,
                                               off_t logical_offset) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (count == 0) {
     return 0;
   }
@@ -383,28 +816,19 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
       (full_inclusive_blocks_bytes_count / kBlockLength) * kSecureBlockLength;
   buffer.resize(physical_bytes_count);
 
-  // Move cursor to the first full block to read.
+  // Offset of the first full block to read.
   const off_t first_logical_block_offset =
       (first_partial_block_bytes_count > 0)
           ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
           : logical_offset;
   const off_t first_physical_block_offset =
       offset_translator_->LogicalToPhysical(first_logical_block_offset);
-  if (first_partial_block_bytes_count > 0) {
-    off_t offset =
-        enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the fist block offset when reading file data.";
-      return -1;
-    }
-  }
 
   // Perform the read. Read may have been requested beyond EOF - cannot require
   // that bytes_read is equal to physical_bytes_count. The read was not
   // requested at EOF - checked this above.
-  ssize_t bytes_read =
-      enc_untrusted_read(fd, buffer.data(), physical_bytes_count);
+  ssize_t bytes_read = enc_untrusted_pread64(
+      fd, buffer.data(), physical_bytes_count, first_physical_block_offset);
   if (bytes_read <= 0) {
     LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
     return -1;
@@ -418,25 +842,6 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     return -1;
   }
 
-  // Move cursor to the position of the end of the read range.
-  off_t new_cur_logical_offset = logical_offset + count;
-  if (bytes_read != physical_bytes_count) {
-    int64_t blocks_not_read =
-        (physical_bytes_count - bytes_read) / kSecureBlockLength;
-    if (last_partial_block_bytes_count > 0) {
-      new_cur_logical_offset -= last_partial_block_bytes_count;
-      blocks_not_read--;
-    }
-    new_cur_logical_offset -= blocks_not_read * kBlockLength;
-  }
-  const off_t new_cur_physical_offset =
-      offset_translator_->LogicalToPhysical(new_cur_logical_offset);
-  off_t offset = enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET);
-  if (offset == -1) {
-    LOG(ERROR) << "Failed lseek to the end of read range.";
-    return -1;
-  }
-
   GcmCryptor *cryptor = GetGcmCryptor(file_ctrl);
   if (!cryptor) {
     return -1;
@@ -560,11 +965,16 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
     return false;
   }
 
+  // The size of a file with blocks still in its block cache is recorded only up
+  // to the end of the blocks on disk, which the digest covers.
+  const size_t file_size = std::min<size_t>(
+      file_ctrl->logical_size, file_ctrl->ad->LeafCount() * kBlockLength);
+
   // Prepare file data digest.
   DataDigest data_digest;
   std::copy_n(reinterpret_cast<const uint8_t *>(root.data()), kRootHashLength,
               data_digest.data());
-  data_digest.file_size = file_ctrl->logical_size;
+  data_digest.file_size = file_size;
 
   FileHeader header;
   if (!cryptor.GetAuthTag(header.data(), data_digest.data(),
@@ -572,7 +982,7 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
     LOG(ERROR) << "Failed to generate CMAC, root = " << root;
     return false;
   }
-  header.file_size = file_ctrl->logical_size;
+  header.file_size = file_size;
 
   VLOG(2) << "Updating the digest for file: " << file_ctrl->path
           << ", root hash: " << absl::BytesToHexString(root);
@@ -589,12 +999,13 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
     return false;
   }
 
+  file_ctrl->file_hash = header.file_hash;
   return true;
 }
 
 bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
                                 off_t logical_offset, Block *block) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (logical_offset < 0 || logical_offset % kBlockLength != 0) {
     errno = EINVAL;
     return false;
@@ -609,17 +1020,10 @@ bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
 
   FdCloser fd_closer(fd, &enc_untrusted_close);
 
-  off_t physical_offset = offset_translator_->LogicalToPhysical(logical_offset);
-  off_t offset = enc_untrusted_lseek(fd, physical_offset, SEEK_SET);
-  if (offset == -1) {
-    LOG(ERROR) << "Failed lseek when reading a full block.";
-    return false;
-  }
-
   ssize_t bytes_read = DecryptAndVerifyInternal(fd, block->data(), kBlockLength,
                                                 file_ctrl, logical_offset);
   if (bytes_read == -1) {
-    return -1;
+    return false;
   }
 
   if (bytes_read < kBlockLength) {
@@ -629,6 +1033,24 @@ bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
   return true;
 }
 
+bool AeadHandler::ReadBlock(FileControl *file_ctrl, off_t logical_offset,
+                            Block *block) const {
+  file_ctrl->mu.AssertHeld();
+  if (!file_ctrl->block_cache ||
+      !file_ctrl->block_cache->IsCached(logical_offset)) {
+    return ReadFullBlock(*file_ctrl, logical_offset, block);
+  }
+
+  Status status = file_ctrl->block_cache->Read(logical_offset, block);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read a cached block: " << status;
+    errno = EIO;
+    return false;
+  }
+
+  return true;
+}
+
 ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   if (!buf) {
     errno = EINVAL;
@@ -640,18 +1062,32 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     return -1;
   }
 
-  std::shared_ptr<FileControl> file_ctrl;
-  {
-    absl::MutexLock global_lock(&mu_);
+  std::shared_ptr<FileControl> file_ctrl = FindFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
+    return -1;
+  }
 
-    auto entry = fmap_.find(fd);
-    if (entry == fmap_.end()) {
-      LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
-      errno = ENOENT;
-      return -1;
-    }
+  if (count == 0) {
+    return 0;
+  }
 
-    file_ctrl = entry->second;
+  absl::MutexLock lock(&file_ctrl->mu);
+  return EncryptAndPersistLocked(fd, buf, count, file_ctrl.get(),
+                                 logical_offset, /*use_cursor=*/true);
+}
+
+ssize_t AeadHandler::EncryptAndPersistAt(int fd, const void *buf, size_t count,
+                                         off_t logical_offset) {
+  if (!buf || logical_offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::shared_ptr<FileControl> file_ctrl = FindFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
+    return -1;
   }
 
   if (count == 0) {
@@ -659,6 +1095,89 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   }
 
   absl::MutexLock lock(&file_ctrl->mu);
+  return EncryptAndPersistLocked(fd, buf, count, file_ctrl.get(),
+                                 logical_offset, /*use_cursor=*/false);
+}
+
+ssize_t AeadHandler::EncryptAndPersistLocked(int fd, const void *buf,
+                                             size_t count,
+                                             FileControl *file_ctrl,
+                                             off_t logical_offset,
+                                             bool use_cursor) const {
+  file_ctrl->mu.AssertHeld();
+  GcmCryptor *cryptor = GetGcmCryptor(*file_ctrl);
+  if (!cryptor) {
+    return -1;
+  }
+
+  const off_t block_offset = logical_offset - logical_offset % kBlockLength;
+  const off_t end_offset = logical_offset + count;
+  if (file_ctrl->block_cache && end_offset <= block_offset + kBlockLength) {
+    // Modify the block in the cache. The file is written when the block is
+    // written back.
+    Block block;
+    Status status = file_ctrl->block_cache->Read(block_offset, &block);
+    if (status.ok()) {
+      std::copy_n(static_cast<const uint8_t *>(buf), count,
+                  block.data() + (logical_offset - block_offset));
+      status = file_ctrl->block_cache->Write(block_offset, block);
+    }
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to write a block through the block cache: "
+                 << status;
+      errno = EIO;
+      return -1;
+    }
+
+    file_ctrl->logical_size =
+        std::max<size_t>(file_ctrl->logical_size, end_offset);
+    if (use_cursor && !SetLogicalOffset(fd, end_offset)) {
+      return -1;
+    }
+    return count;
+  }
+
+  if (file_ctrl->block_cache) {
+    // The file must hold the blocks modified in the cache before any of its
+    // blocks are read or written directly.
+    Status status = file_ctrl->block_cache->Flush();
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to flush the block cache: " << status;
+      errno = EIO;
+      return -1;
+    }
+  }
+
+  if (EncryptAndPersistInternal(fd, buf, count, file_ctrl, logical_offset,
+                                use_cursor) == -1) {
+    return -1;
+  }
+
+  // Cached copies of the written blocks are superseded by the file.
+  if (file_ctrl->block_cache) {
+    for (off_t offset = block_offset; offset < end_offset;
+         offset += kBlockLength) {
+      file_ctrl->block_cache->Invalidate(offset);
+    }
+  }
+
+  // A write inside the file, which positional writes commonly are, must not
+  // shrink it.
+  file_ctrl->logical_size =
+      std::max<size_t>(file_ctrl->logical_size, end_offset);
+  if (!UpdateDigest(file_ctrl, *cryptor)) {
+    return -1;
+  }
+
+  return count;
+}
+
+ssize_t AeadHandler::EncryptAndPersistInternal(int fd, const void *buf,
+                                               size_t count,
+                                               FileControl *file_ctrl,
+                                               off_t logical_offset,
+                                               bool use_cursor) const {
+  file_ctrl->mu.AssertHeld();
 
   // Determine data breakdown into logical blocks.
   size_t first_partial_block_bytes_count;
@@ -671,8 +1190,8 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   // Bounce block for writing the first partial block in the range, if any.
   Block first_block;
   if (first_partial_block_bytes_count > 0) {
-    if (!ReadFullBlock(
-            *file_ctrl,
+    if (!ReadBlock(
+            file_ctrl,
             logical_offset + first_partial_block_bytes_count - kBlockLength,
             &first_block)) {
       LOG(ERROR)
@@ -689,9 +1208,9 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   // Bounce block for writing the last partial block in the range, if any.
   Block last_block;
   if (last_partial_block_bytes_count > 0) {
-    if (!ReadFullBlock(*file_ctrl,
-                       logical_offset + count - last_partial_block_bytes_count,
-                       &last_block)) {
+    if (!ReadBlock(file_ctrl,
+                   logical_offset + count - last_partial_block_bytes_count,
+                   &last_block)) {
       LOG(ERROR)
           << "failed to read the last misaligned block when writing, fd = "
           << fd;
@@ -791,7 +1310,7 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   }
 
   // Move cursor to the first full block to write.
-  if (first_partial_block_bytes_count > 0) {
+  if (use_cursor && first_partial_block_bytes_count > 0) {
     off_t offset =
         enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
     if (offset == -1) {
@@ -809,7 +1328,10 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   //    on error or when all data has been written, following the POSIX model -
   //    this may lead to "long" writes when "large" amount of data is written.
   // In this code optimize operation for full writes - i.e. the option #2.
-  ssize_t bytes_written = write_all(fd, buffer.data(), physical_bytes_count);
+  ssize_t bytes_written =
+      use_cursor ? write_all(fd, buffer.data(), physical_bytes_count)
+                 : pwrite_all(fd, buffer.data(), physical_bytes_count,
+                              first_physical_block_offset);
   if (bytes_written != physical_bytes_count) {
     LOG(ERROR) << "Failed to write encrypted data to file, path="
                << file_ctrl->path << ", bytes written = " << bytes_written;
@@ -817,7 +1339,7 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   }
 
   // Move cursor to the position of the end of the write range.
-  if (last_partial_block_bytes_count > 0) {
+  if (use_cursor && last_partial_block_bytes_count > 0) {
     off_t new_cur_logical_offset = logical_offset + count;
     off_t new_cur_physical_offset =
         offset_translator_->LogicalToPhysical(new_cur_logical_offset);
@@ -844,11 +1366,9 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     }
   }
 
-  file_ctrl->logical_size = logical_offset + count;
-
-  if (!UpdateDigest(file_ctrl.get(), *cryptor)) {
-    return -1;
-  }
+  file_ctrl->MarkLeavesDirty(start_block_to_write,
+                             start_block_to_write + tags.size());
+  file_ctrl->index_stale = true;
 
   VLOG(2) << "Wrote data to file, bytes_written = " << bytes_written;
 
@@ -856,33 +1376,108 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
 }
 
 bool AeadHandler::FinalizeFile(int fd) {
-  absl::MutexLock global_lock(&mu_);
+  std::shared_ptr<FileControl> file_ctrl;
+  {
+    absl::MutexLock global_lock(&mu_);
 
-  if (fd < 0) {
-    errno = EINVAL;
-    return false;
+    if (fd < 0) {
+      errno = EINVAL;
+      return false;
+    }
+
+    auto entry = fmap_.find(fd);
+    if (entry == fmap_.end()) {
+      LOG(ERROR) << "Attempt made to finalize uninitialized file, fd = " << fd;
+      errno = ENOENT;
+      return false;
+    }
+
+    // Do not need to wait until the file is no longer operated on - shared_ptr
+    // taken by the operator will keep file_ctrl alive and allow it to take and
+    // release the lock on its own schedule. Removal from the maps here will not
+    // impact that ability.
+
+    VLOG(2) << "Finalizing secure file, fd = " << fd
+            << ", pathname = " << entry->second->path;
+    file_ctrl = entry->second;
+    fmap_.erase(entry);
+    if (--file_ctrl->open_fds > 0) {
+      return true;
+    }
   }
 
-  auto entry = fmap_.find(fd);
-  if (entry == fmap_.end()) {
-    LOG(ERROR) << "Attempt made to finalize uninitialized file, fd = " << fd;
-    errno = ENOENT;
+  // Flush the blocks and persist the integrity index without holding the
+  // global lock, so that operations on other files are not blocked on the host
+  // IO. The file stays in |opened_files_| meanwhile, so that a concurrent open
+  // of the same path shares |file_ctrl| instead of reading the file from the
+  // host before it is written. Failing to persist the index only slows down
+  // the next open of the file.
+  bool flushed = true;
+  {
+    absl::MutexLock lock(&file_ctrl->mu);
+    if (file_ctrl->block_cache) {
+      Status status = file_ctrl->block_cache->Flush();
+      if (!status.ok()) {
+        LOG(ERROR) << "Failed to flush the block cache, path="
+                   << file_ctrl->path << ": " << status;
+        errno = EIO;
+        flushed = false;
+      }
+    }
+
+    if (file_ctrl->is_deserialized && file_ctrl->index_stale &&
+        file_ctrl->ad->LeafCount() >= kMinIndexedBlocks &&
+        !PersistIndex(file_ctrl.get())) {
+      LOG(WARNING) << "Failed to persist integrity index, path="
+                   << file_ctrl->path;
+    }
+  }
+
+  // Forget the file unless it has been opened again in the meantime, in which
+  // case the new descriptor keeps using |file_ctrl| and its block cache.
+  {
+    absl::MutexLock global_lock(&mu_);
+    if (file_ctrl->open_fds > 0) {
+      return flushed;
+    }
+    auto path_it = opened_files_.find(file_ctrl->path);
+    if (path_it != opened_files_.end() && path_it->second == file_ctrl) {
+      opened_files_.erase(path_it);
+    }
+  }
+
+  absl::MutexLock lock(&file_ctrl->mu);
+  file_ctrl->block_cache.reset();
+  return flushed;
+}
+
+bool AeadHandler::FlushFile(int fd) {
+  std::shared_ptr<FileControl> file_ctrl = FindFileControl(fd);
+  if (!file_ctrl) {
     return false;
   }
 
-  // Do not need to wait until the file is no longer operated on - shared_ptr
-  // taken by the operator will keep file_ctrl alive and allow it to take and
-  // release the lock on its own schedule. Removal from the maps here will not
-  // impact that ability.
+  absl::MutexLock lock(&file_ctrl->mu);
+  if (!file_ctrl->block_cache) {
+    return true;
+  }
 
-  VLOG(2) << "Finalizing secure file, fd = " << fd
-          << ", pathname = " << entry->second->path;
-  opened_files_.erase(entry->second->path);
-  fmap_.erase(entry);
+  Status status = file_ctrl->block_cache->Flush();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to flush the block cache, path=" << file_ctrl->path
+               << ": " << status;
+    errno = EIO;
+    return false;
+  }
 
   return true;
 }
 
+void AeadHandler::SetBlockCacheCapacity(size_t blocks) {
+  absl::MutexLock global_lock(&mu_);
+  block_cache_capacity_ = blocks;
+}
+
 // Note: questionable whether to allow setting the key only on newly opened
 // files, and only if not set yet - arguably, such intelligence may need to
 // reside outside of AeadHandler on the side of the IOCTL client. If not done
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -32,6 +33,8 @@
 #include "asylo/platform/storage/secure/authenticated_dictionary.h"
 #include "asylo/platform/storage/secure/ctmmt_authenticated_dictionary.h"
 #include "asylo/platform/storage/utils/offset_translator.h"
+#include "asylo/platform/storage/utils/random_access_storage.h"
+#include "asylo/platform/storage/utils/record_store.h"
 
 namespace asylo {
 namespace platform {
@@ -62,6 +65,17 @@ constexpr size_t kSecureBlockLength = kCipherBlockLength + kTokenLength;
 using FileHash = UnsafeBytes<kFileHashLength>;
 using FileDigest = UnsafeBytes<kRootHashLength>;
 
+// Suffix appended to the path of a secure file to name its integrity index - a
+// sidecar file holding the leaf hashes of the file's authenticated dictionary,
+// which lets the dictionary be rebuilt without scanning the file's blocks. An
+// index left behind when its file is removed or renamed is ignored, since it
+// is only used if it matches the file header and reproduces the root hash.
+constexpr char kIntegrityIndexSuffix[] = ".integrity_index";
+
+// Files with fewer blocks than this are not indexed, since scanning them on
+// open takes only a few host calls.
+constexpr int64_t kMinIndexedBlocks = 1024;
+
 // Authenticated Encryption with Associated Data (AEAD) handler class. Maintains
 // AEAD metadata for file data when a securely handled file is modified from the
 // enclave. Encapsulates operations on file's integrity metadata based on the
@@ -94,11 +108,33 @@ class AeadHandler {
   ssize_t EncryptAndPersist(int fd, const void *buf, size_t count)
       ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Similar to DecryptAndVerify, but reads from |logical_offset| and leaves the
+  // cursor associated with |fd| unchanged. Reads of the same file made through
+  // this method do not serialize with each other, only with writes.
+  ssize_t DecryptAndVerifyAt(int fd, void *buf, size_t count,
+                             off_t logical_offset) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Similar to EncryptAndPersist, but writes at |logical_offset| and leaves the
+  // cursor associated with |fd| unchanged.
+  ssize_t EncryptAndPersistAt(int fd, const void *buf, size_t count,
+                              off_t logical_offset) ABSL_LOCKS_EXCLUDED(mu_);
+
+  // Writes the blocks of a file modified in its block cache to disk, returns
+  // false on failure. Does not modify the state of the file descriptor.
+  bool FlushFile(int fd) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Frees resources used to assure integrity of an opened file, persists
   // integrity metadata to a designated location on disk, returns false on
   // failure. Does not modify the state of the file descriptor.
   bool FinalizeFile(int fd) ABSL_LOCKS_EXCLUDED(mu_);
 
+  // Sets the number of blocks of each subsequently opened file to cache in
+  // trusted memory. Reads and writes which fall within a single cached block
+  // are served without accessing the file; blocks modified in the cache are
+  // written to disk when evicted, or when the file is flushed or closed. Zero,
+  // the default, disables caching.
+  void SetBlockCacheCapacity(size_t blocks) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Sets the master key for a newly opened file.
   int SetMasterKey(int fd, const uint8_t *key_data, uint32_t key_length)
       ABSL_LOCKS_EXCLUDED(mu_);
@@ -122,6 +158,25 @@ class AeadHandler {
     uint8_t *data() { return file_hash.data(); }
   } ABSL_ATTRIBUTE_PACKED;
 
+  // Structure represents the integrity index header layout. The header is
+  // followed by |leaf_count| leaf hashes of the authenticated dictionary. The
+  // index is not trusted: the dictionary rebuilt from it must produce the root
+  // protected by the file header, and an index whose |file_hash| does not match
+  // the file header is ignored without being read.
+  struct IndexHeader {
+    // Identifies an integrity index of the current layout.
+    uint64_t magic;
+
+    // Hash of the DataDigest of the file when the index was written.
+    FileHash file_hash;
+
+    // Number of leaf hashes following the header.
+    uint64_t leaf_count;
+
+    // Returns the address of the IndexHeader instance.
+    uint8_t *data() { return reinterpret_cast<uint8_t *>(&magic); }
+  } ABSL_ATTRIBUTE_PACKED;
+
   // Structure represents the file data digest from which the file hash used for
   // integrity validation is calculated.
   struct DataDigest {
@@ -145,6 +200,36 @@ class AeadHandler {
     std::string zero_hash;
     std::unique_ptr<GcmCryptorKey> master_key;
 
+    // Hash of the DataDigest last written to or read from the file header.
+    FileHash file_hash;
+
+    // Whether the integrity index on disk, if any, does not describe the
+    // current state of the file.
+    bool index_stale;
+
+    // Number of leaf hashes in the integrity index on disk that are current,
+    // except for those in |dirty_leaves|, or zero if the index has to be
+    // rewritten in full.
+    int64_t indexed_leaves;
+
+    // Ranges of leaves below |indexed_leaves| updated since the integrity index
+    // was last written, as a map from the first leaf of each range to the leaf
+    // past its end. Leaves are numbered from 0.
+    std::map<int64_t, int64_t> dirty_leaves;
+
+    // Storage of the verified plaintext blocks of the file, which backs
+    // |block_cache|.
+    std::unique_ptr<RandomAccessStorage> block_storage;
+
+    // Cache of verified plaintext blocks keyed on their logical offsets, or
+    // nullptr if the file is not cached. Blocks past the end of the file on
+    // disk may be present only in the cache, until it is flushed.
+    std::unique_ptr<RecordStore<Block>> block_cache;
+
+    // Number of file descriptors open on the file. Guarded by the global
+    // AeadHandler mutex rather than |mu|.
+    int open_fds;
+
     // Mutex for protecting FileControl instance.
     absl::Mutex mu;
 
@@ -153,7 +238,10 @@ class AeadHandler {
           logical_size(0),
           is_new(is_new_file),
           is_deserialized(false),
-          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()) {
+          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()),
+          index_stale(true),
+          indexed_leaves(0),
+          open_fds(0) {
       UnsafeBytes<kTagLength> tag;
       memset(tag.data(), 0, kTagLength);
       std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
@@ -166,8 +254,16 @@ class AeadHandler {
     size_t physical_size() {
       return sizeof(FileHeader) + ad->LeafCount() * kSecureBlockLength;
     }
+
+    // Records that the leaves from |first| up to |last| have been updated, so
+    // that the next PersistIndex() rewrites them.
+    void MarkLeavesDirty(int64_t first, int64_t last);
   };
 
+  // RandomAccessStorage over the plaintext blocks of a file, through which its
+  // block cache reads and writes blocks.
+  class BlockStorage;
+
   AeadHandler();
   AeadHandler(AeadHandler const &) = delete;
   void operator=(AeadHandler const &) = delete;
@@ -176,10 +272,50 @@ class AeadHandler {
   bool Deserialize(FileControl *file_ctrl)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
+  // Rebuilds the authenticated dictionary from the integrity index of the file,
+  // which must hold |blocks_count| leaf hashes and match |file_header|. Returns
+  // false, leaving the dictionary partially built, if there is no such index.
+  bool LoadIndex(const FileHeader &file_header, int64_t blocks_count,
+                 FileControl *file_ctrl) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Rebuilds the authenticated dictionary from the auth tags of the first
+  // |blocks_count| blocks of the file, reading them sequentially from |fd|,
+  // which must be positioned at the first block. Returns false on failure.
+  bool ScanBlocks(int fd, int64_t blocks_count, FileControl *file_ctrl) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Returns true if the root of the authenticated dictionary and the file size
+  // in |file_header| hash to the file hash in |file_header|.
+  bool VerifyRoot(const FileHeader &file_header, const GcmCryptor &cryptor,
+                  FileControl *file_ctrl) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Writes the leaf hashes of the authenticated dictionary to the integrity
+  // index of the file. Only the leaves updated or appended since the index was
+  // last written are rewritten, unless the index has to be rewritten in full.
+  // Returns false on failure.
+  bool PersistIndex(FileControl *file_ctrl) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Writes the leaf hashes of the leaves from |first| up to |last| to their
+  // place in the integrity index open as |fd|. Returns false on failure.
+  bool WriteLeafHashes(int fd, int64_t first, int64_t last,
+                       const FileControl &file_ctrl) const
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
   // Retrieves logical cursor offset associated with a file descriptor |fd|.
   // Returns false on failure.
   bool RetrieveLogicalOffset(int fd, off_t *logical_offset) const;
 
+  // Moves the cursor associated with a file descriptor |fd| to
+  // |logical_offset|. Returns false on failure.
+  bool SetLogicalOffset(int fd, off_t logical_offset) const;
+
+  // Returns the file control of the file opened as |fd|, or nullptr, setting
+  // errno, if there is no such file.
+  std::shared_ptr<FileControl> FindFileControl(int fd) ABSL_LOCKS_EXCLUDED(mu_);
+
   // Updates digest of the file data in the secure file header.
   bool UpdateDigest(FileControl *file_ctrl, const GcmCryptor &cryptor) const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
@@ -187,21 +323,56 @@ class AeadHandler {
   // Returns an instance of GcmCryptor associated with a file, or nullptr if was
   // not able to retrieve. The caller does not own the instance.
   GcmCryptor *GetGcmCryptor(const FileControl &file_ctrl) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
 
-  // Similar to DecryptAndVerify, but is called by internal implementation, and
-  // as such does not take a file lock. The cursor associated with the file
-  // descriptor |fd| is expected to be at the position of |logical_offset|.
+  // Similar to DecryptAndVerifyAt, but is called by internal implementation,
+  // and as such does not take a file lock. Reads from |fd| with positional
+  // reads, so neither depends on nor moves the cursor associated with it.
   ssize_t DecryptAndVerifyInternal(int fd, void *buf, size_t count,
                                    const FileControl &file_ctrl,
                                    off_t logical_offset) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
+  // Similar to DecryptAndVerifyInternal, but serves reads within a single block
+  // from the block cache of the file, if it has one. Other reads flush the
+  // cache first.
+  ssize_t DecryptAndVerifyLocked(int fd, void *buf, size_t count,
+                                 FileControl *file_ctrl,
+                                 off_t logical_offset) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Similar to EncryptAndPersistInternal, but also updates the file size and
+  // digest. Writes within a single block are made to the block cache of the
+  // file, if it has one, and the file size is only updated on disk when the
+  // block is written back.
+  ssize_t EncryptAndPersistLocked(int fd, const void *buf, size_t count,
+                                  FileControl *file_ctrl, off_t logical_offset,
+                                  bool use_cursor) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
+
+  // Encrypts data and writes it to the file at |logical_offset|, updating the
+  // authenticated dictionary, but not the file size or digest. Is called by
+  // internal implementation, and as such does not take a file lock. If
+  // |use_cursor| is true, the cursor associated with |fd| is expected to be at
+  // the position of |logical_offset| and is left at the end of the written
+  // range; otherwise |fd| is written with positional writes and its cursor is
+  // left unchanged.
+  ssize_t EncryptAndPersistInternal(int fd, const void *buf, size_t count,
+                                    FileControl *file_ctrl,
+                                    off_t logical_offset, bool use_cursor) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
   // Reads a single full block of a file at a specified logical offset. Returns
   // false on failure.
   bool ReadFullBlock(const FileControl &file_ctrl, off_t logical_offset,
                      Block *block) const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      ABSL_SHARED_LOCKS_REQUIRED(file_ctrl.mu);
+
+  // Similar to ReadFullBlock, but reads the block from the block cache of the
+  // file if it is cached there.
+  bool ReadBlock(FileControl *file_ctrl, off_t logical_offset,
+                 Block *block) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
 
   // Map of file (data set) controls for opened files keyed on int identity of
   // files. Avoid using absl based containers which may perform system calls, as
@@ -220,6 +391,9 @@ class AeadHandler {
   // An instance that performs operations on untrusted file offset.
   std::unique_ptr<OffsetTranslator> offset_translator_;
 
+  // Number of blocks cached for each opened file.
+  size_t block_cache_capacity_ ABSL_GUARDED_BY(mu_);
+
   // Mutex for protecting map members of the class.
   absl::Mutex mu_;
 };
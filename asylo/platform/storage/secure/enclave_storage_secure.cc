@@ -25,6 +25,11 @@
 #include <fcntl.h>
 #include <stdarg.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
 #include "asylo/util/logging.h"
 #include "asylo/platform/host_call/trusted/host_calls.h"
 #include "asylo/platform/storage/secure/aead_handler.h"
@@ -83,6 +88,60 @@ ssize_t secure_write(int fd, const void *buf, size_t count) {
   return AeadHandler::GetInstance().EncryptAndPersist(fd, buf, count);
 }
 
+ssize_t secure_pread(int fd, void *buf, size_t count, off_t offset) {
+  return AeadHandler::GetInstance().DecryptAndVerifyAt(fd, buf, count, offset);
+}
+
+ssize_t secure_pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return AeadHandler::GetInstance().EncryptAndPersistAt(fd, buf, count,
+                                                        offset);
+}
+
+ssize_t secure_readv(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size_t total_size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total_size += iov[i].iov_len;
+  }
+  std::unique_ptr<char[]> buf(new char[total_size]);
+
+  ssize_t ret = secure_read(fd, buf.get(), total_size);
+  size_t bytes_left = ret > 0 ? ret : 0;
+  const char *data = buf.get();
+  for (int i = 0; i < iovcnt && bytes_left > 0; ++i) {
+    size_t bytes_to_copy = std::min(bytes_left, iov[i].iov_len);
+    memcpy(iov[i].iov_base, data, bytes_to_copy);
+    data += bytes_to_copy;
+    bytes_left -= bytes_to_copy;
+  }
+
+  return ret;
+}
+
+ssize_t secure_writev(int fd, const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size_t total_size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total_size += iov[i].iov_len;
+  }
+  std::unique_ptr<char[]> buf(new char[total_size]);
+  size_t copied_bytes = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    memcpy(buf.get() + copied_bytes, iov[i].iov_base, iov[i].iov_len);
+    copied_bytes += iov[i].iov_len;
+  }
+
+  return secure_write(fd, buf.get(), total_size);
+}
+
 int secure_close(int fd) {
   bool finalize_result = AeadHandler::GetInstance().FinalizeFile(fd);
   return (finalize_result && enc_untrusted_close(fd) == 0) ? 0 : -1;
@@ -131,6 +190,13 @@ off_t secure_lseek(int fd, off_t offset, int whence) {
   return offset_translator.PhysicalToLogical(physical_offset);
 }
 
+int secure_fsync(int fd) {
+  if (!AeadHandler::GetInstance().FlushFile(fd)) {
+    return -1;
+  }
+  return enc_untrusted_fsync(fd);
+}
+
 int secure_fstat(int fd, struct stat *st) {
   int ret = enc_untrusted_fstat(fd, st);
   if (ret == 0) {
@@ -26,6 +26,7 @@
 #include <sys/stat.h>
 // IO syscall interface types.
 #include <sys/types.h>
+#include <sys/uio.h>
 
 namespace asylo {
 namespace platform {
@@ -43,10 +44,25 @@ ssize_t secure_read(int fd, void *buf, size_t count);
 // responsibility to explicitly set file offset on error as the client desires.
 ssize_t secure_write(int fd, const void *buf, size_t count);
 
+// Reads at or writes to a logical |offset| without moving the file offset.
+// Concurrent secure_pread calls on the same file do not serialize with each
+// other.
+ssize_t secure_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t secure_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
+// The data of all of |iov| is read or written by a single secure_read or
+// secure_write.
+ssize_t secure_readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t secure_writev(int fd, const struct iovec *iov, int iovcnt);
+
 int secure_close(int fd);
 
 off_t secure_lseek(int fd, off_t offset, int whence);
 
+// Writes back the blocks of |fd| held in its block cache before syncing it to
+// the host storage device.
+int secure_fsync(int fd);
+
 // |st->st_size| will be set to logical file size on success.
 int secure_fstat(int fd, struct stat* st);
 
@@ -23,6 +23,10 @@
 
 #include <fcntl.h>
 #include <openssl/rand.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -37,6 +41,7 @@
 #include "asylo/test/util/test_flags.h"
 #include "asylo/util/cleansing_types.h"
 #include "asylo/util/status.h"
+#include "asylo/util/thread.h"
 
 namespace asylo {
 namespace {
@@ -46,12 +51,19 @@ using platform::storage::AeadHandler;
 using platform::storage::kBlockLength;
 using platform::storage::kCipherBlockLength;
 using platform::storage::kFileHashLength;
+using platform::storage::kIntegrityIndexSuffix;
+using platform::storage::kMinIndexedBlocks;
 using platform::storage::secure_close;
 using platform::storage::secure_fstat;
+using platform::storage::secure_fsync;
 using platform::storage::secure_lseek;
 using platform::storage::secure_open;
+using platform::storage::secure_pread;
+using platform::storage::secure_pwrite;
 using platform::storage::secure_read;
+using platform::storage::secure_readv;
 using platform::storage::secure_write;
+using platform::storage::secure_writev;
 using ::testing::Not;
 
 constexpr size_t kMaxTestBufLen = 1000;
@@ -61,12 +73,20 @@ class EnclaveStorageSecureTest : public ::testing::Test,
                                  public ::testing::WithParamInterface<size_t> {
  protected:
   void SetUp() override { PrepareTest(); }
+  void TearDown() override {
+    AeadHandler::GetInstance().SetBlockCacheCapacity(0);
+  }
   void PrepareTest();
   Status OpenWriteClose(off_t offset);
   Status OpenReadVerifyClose(off_t offset, size_t bytes_expected);
+  Status WriteIndexedFile();
+  Status ReadIndexedFile();
 
   const int64_t kFileHeaderLength = kFileHashLength + sizeof(size_t);
   const std::string &GetPath() const { return path_; }
+  std::string GetIndexPath() const {
+    return absl::StrCat(path_, kIntegrityIndexSuffix);
+  }
   const void *GetWriteBuffer() const {
     return reinterpret_cast<const void *>(write_buffer_);
   }
@@ -100,6 +120,7 @@ void EnclaveStorageSecureTest::PrepareTest() {
   // occasionally the test is executed on the same (virtual) machine.
   LOG(INFO) << "Cleaning up test file if present, path = " << path_;
   remove(path_.c_str());
+  remove(GetIndexPath().c_str());
 
   // Generate the test key.
   key_.resize(kKeyLength);
@@ -212,6 +233,56 @@ Status EnclaveStorageSecureTest::OpenReadVerifyClose(off_t offset,
   return Status::OkStatus();
 }
 
+// Writes a file large enough to be indexed, made of repetitions of the write
+// buffer.
+Status EnclaveStorageSecureTest::WriteIndexedFile() {
+  int fd = secure_open(GetPath().c_str(), O_WRONLY | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  if (fd < 0) {
+    return Status(error::GoogleError::INTERNAL, "Secure open failed.");
+  }
+  platform::storage::FdCloser fd_closer(fd, &secure_close);
+  if (EmulateSetKeyIoctl(fd) != 0) {
+    return Status(error::GoogleError::INTERNAL, "Set Master Key failed.");
+  }
+  const size_t file_length = kMinIndexedBlocks * kBlockLength;
+  for (size_t written = 0; written < file_length; written += test_buf_len_) {
+    if (secure_write(fd, GetWriteBuffer(), test_buf_len_) != test_buf_len_) {
+      return Status(error::GoogleError::INTERNAL, "Secure write failed.");
+    }
+  }
+  if (!fd_closer.reset()) {
+    return Status(error::GoogleError::INTERNAL, "Secure close failed.");
+  }
+  return Status::OkStatus();
+}
+
+// Reads and verifies a file written by WriteIndexedFile.
+Status EnclaveStorageSecureTest::ReadIndexedFile() {
+  int fd = secure_open(GetPath().c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Status(error::GoogleError::INTERNAL, "Secure open failed.");
+  }
+  platform::storage::FdCloser fd_closer(fd, &secure_close);
+  if (EmulateSetKeyIoctl(fd) != 0) {
+    return Status(error::GoogleError::INTERNAL, "Set master Key failed.");
+  }
+  const size_t file_length = kMinIndexedBlocks * kBlockLength;
+  for (size_t read = 0; read < file_length; read += test_buf_len_) {
+    if (secure_read(fd, GetReadBuffer(), test_buf_len_) != test_buf_len_) {
+      return Status(error::GoogleError::INTERNAL, "Secure read failed.");
+    }
+    if (memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_) != 0) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Bytes read different from bytes written.");
+    }
+  }
+  if (!fd_closer.reset()) {
+    return Status(error::GoogleError::INTERNAL, "Secure close failed.");
+  }
+  return Status::OkStatus();
+}
+
 //
 // Success cases.
 //
@@ -503,6 +574,311 @@ TEST_P(EnclaveStorageSecureTest, LseekEndSuccess) {
   EXPECT_EQ(secure_close(fd), 0);
 }
 
+TEST_P(EnclaveStorageSecureTest, PReadLeavesCursorSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Read from the middle of the first block, then past the EOF.
+  off_t offset = kBlockLength / 2;
+  EXPECT_EQ(secure_pread(fd, GetReadBuffer(), test_buf_len_, offset),
+            test_buf_len_ - offset);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_ - offset),
+            0);
+  EXPECT_EQ(secure_pread(fd, GetReadBuffer(), test_buf_len_, test_buf_len_),
+            0);
+  EXPECT_EQ(secure_pread(fd, GetReadBuffer(), test_buf_len_, -1), -1);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), 0);
+
+  // The cursor still reads from the start of the file.
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_), test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, PWriteInsideFileSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Overwrite a misaligned block-long range with zeros.
+  const off_t offset = kBlockLength / 2;
+  EXPECT_EQ(secure_pwrite(fd, GetZeroBuffer(), kBlockLength, offset),
+            kBlockLength);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  // The write did not shrink the file, and kept the data around the range.
+  const size_t file_size = std::max(test_buf_len_, offset + kBlockLength);
+  std::vector<char> expected(write_buffer_, write_buffer_ + test_buf_len_);
+  expected.resize(file_size);
+  std::fill_n(expected.begin() + offset, kBlockLength, 0);
+
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_END), file_size);
+  std::vector<char> actual(file_size);
+  EXPECT_EQ(secure_pread(fd, actual.data(), file_size, 0), file_size);
+  EXPECT_EQ(actual, expected);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ReadvWritevSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Split the data over iovecs that do not match the block boundaries.
+  const size_t first_length = test_buf_len_ / 2 + 16;
+  struct iovec write_iov[2];
+  write_iov[0].iov_base = const_cast<void *>(GetWriteBuffer());
+  write_iov[0].iov_len = first_length;
+  write_iov[1].iov_base =
+      const_cast<char *>(static_cast<const char *>(GetWriteBuffer())) +
+      first_length;
+  write_iov[1].iov_len = test_buf_len_ - first_length;
+  EXPECT_EQ(secure_writev(fd, write_iov, ABSL_ARRAYSIZE(write_iov)),
+            test_buf_len_);
+
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_SET), 0);
+  struct iovec read_iov[2];
+  read_iov[0].iov_base = GetReadBuffer();
+  read_iov[0].iov_len = first_length;
+  read_iov[1].iov_base = static_cast<char *>(GetReadBuffer()) + first_length;
+  read_iov[1].iov_len = test_buf_len_ - first_length;
+  EXPECT_EQ(secure_readv(fd, read_iov, ABSL_ARRAYSIZE(read_iov)),
+            test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+
+  EXPECT_EQ(secure_readv(fd, read_iov, 0), -1);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ConcurrentPReadSuccess) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Each thread reads a disjoint slice of the file through the same fd.
+  constexpr int kThreads = 4;
+  const size_t file_length = kMinIndexedBlocks * kBlockLength;
+  const size_t slice_length = file_length / kThreads;
+  std::vector<int> mismatches(kThreads, 0);
+  std::vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this, i, fd, slice_length, &mismatches] {
+      const char *data = static_cast<const char *>(GetWriteBuffer());
+      std::vector<char> buf(test_buf_len_);
+      for (size_t read = 0; read < slice_length; read += test_buf_len_) {
+        off_t offset = i * slice_length + read;
+        size_t count = std::min(test_buf_len_, slice_length - read);
+        if (secure_pread(fd, buf.data(), count, offset) != count) {
+          ++mismatches[i];
+          continue;
+        }
+        for (size_t j = 0; j < count; ++j) {
+          if (buf[j] != data[(offset + j) % test_buf_len_]) {
+            ++mismatches[i];
+            break;
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.Join();
+  }
+
+  EXPECT_EQ(mismatches, std::vector<int>(kThreads, 0));
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, IndexedFileReopenSuccess) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+
+  // Closing the file persisted its integrity index.
+  int fd = enc_untrusted_open(GetIndexPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0) << strerror(errno);
+  EXPECT_EQ(enc_untrusted_close(fd), 0);
+
+  EXPECT_THAT(ReadIndexedFile(), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, SmallFileNotIndexed) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  EXPECT_EQ(enc_untrusted_open(GetIndexPath().c_str(), O_RDONLY), -1);
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, CorruptIndexFallsBackToScan) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+
+  // Overwrite a leaf hash in the index. The file must still open and read
+  // correctly, since the index is only trusted if it reproduces the root.
+  int fd = enc_untrusted_open(GetIndexPath().c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_GT(enc_untrusted_lseek(fd, 256, SEEK_SET), 0);
+  EXPECT_GT(enc_untrusted_write(fd, kTamperData, ABSL_ARRAYSIZE(kTamperData)),
+            0);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+
+  EXPECT_THAT(ReadIndexedFile(), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, StaleIndexIgnoredAfterWrite) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+
+  // Keep a copy of the index before the file changes.
+  std::vector<char> stale_index(1 << 20);
+  int fd = enc_untrusted_open(GetIndexPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ssize_t stale_length =
+      enc_untrusted_read(fd, stale_index.data(), stale_index.size());
+  ASSERT_GT(stale_length, 0);
+  ASSERT_EQ(enc_untrusted_close(fd), 0);
+
+  ASSERT_THAT(OpenWriteClose(0), IsOk());
+
+  // Roll the index back. It no longer matches the file header and is ignored.
+  fd = enc_untrusted_open(GetIndexPath().c_str(), O_WRONLY | O_TRUNC);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(enc_untrusted_write(fd, stale_index.data(), stale_length),
+            stale_length);
+  ASSERT_EQ(enc_untrusted_close(fd), 0);
+
+  EXPECT_THAT(ReadIndexedFile(), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, IndexUpdatedInPlaceAfterWrite) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+
+  std::vector<char> old_index(1 << 20);
+  int fd = enc_untrusted_open(GetIndexPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ssize_t old_length =
+      enc_untrusted_read(fd, old_index.data(), old_index.size());
+  ASSERT_GT(old_length, 0);
+  ASSERT_EQ(enc_untrusted_close(fd), 0);
+
+  // Rewrite the first blocks. Only their leaf hashes and the header change;
+  // the leaves of the untouched second half of the file are left as they were.
+  ASSERT_THAT(OpenWriteClose(0), IsOk());
+
+  std::vector<char> new_index(old_index.size());
+  fd = enc_untrusted_open(GetIndexPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ssize_t new_length =
+      enc_untrusted_read(fd, new_index.data(), new_index.size());
+  ASSERT_EQ(enc_untrusted_close(fd), 0);
+  ASSERT_EQ(new_length, old_length);
+  EXPECT_NE(memcmp(old_index.data(), new_index.data(), old_length / 2), 0);
+  EXPECT_EQ(memcmp(old_index.data() + old_length / 2,
+                   new_index.data() + old_length / 2,
+                   old_length - old_length / 2),
+            0);
+
+  EXPECT_THAT(ReadIndexedFile(), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, CachedSmallWritesSuccess) {
+  AeadHandler::GetInstance().SetBlockCacheCapacity(4);
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Write the data in chunks smaller than a block, which are read back from
+  // the cache before any of them reach the file.
+  constexpr size_t kChunkLength = 16;
+  const char *data = static_cast<const char *>(GetWriteBuffer());
+  for (size_t written = 0; written < test_buf_len_; written += kChunkLength) {
+    ASSERT_EQ(secure_write(fd, data + written, kChunkLength), kChunkLength);
+  }
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_END), test_buf_len_);
+  char chunk[kChunkLength];
+  EXPECT_EQ(secure_pread(fd, chunk, kChunkLength, kBlockLength / 2),
+            kChunkLength);
+  EXPECT_EQ(memcmp(chunk, data + kBlockLength / 2, kChunkLength), 0);
+
+  EXPECT_EQ(secure_fsync(fd), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  // The file holds all of the data once closed.
+  AeadHandler::GetInstance().SetBlockCacheCapacity(0);
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, CachedFileSharedAcrossDescriptors) {
+  AeadHandler::GetInstance().SetBlockCacheCapacity(4);
+  int first_fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                             S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(first_fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(first_fd), 0);
+  int second_fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(second_fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(second_fd), 0);
+  ASSERT_EQ(secure_close(first_fd), 0);
+
+  // Closing one descriptor leaves the file open through the other, and
+  // descriptors opened later see the blocks it has not flushed yet.
+  ASSERT_EQ(secure_write(second_fd, GetWriteBuffer(), test_buf_len_),
+            test_buf_len_);
+  int third_fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(third_fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(third_fd), 0);
+  EXPECT_EQ(secure_read(third_fd, GetReadBuffer(), test_buf_len_),
+            test_buf_len_);
+  EXPECT_EQ(memcmp(GetWriteBuffer(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_close(third_fd), 0);
+  EXPECT_EQ(secure_close(second_fd), 0);
+
+  AeadHandler::GetInstance().SetBlockCacheCapacity(0);
+  EXPECT_THAT(OpenReadVerifyClose(0, test_buf_len_), IsOk());
+}
+
+TEST_P(EnclaveStorageSecureTest, CachedMultiBlockReadSuccess) {
+  AeadHandler::GetInstance().SetBlockCacheCapacity(2);
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Fill more blocks than the cache holds, one block-sized write at a time,
+  // then modify the middle of the first block.
+  constexpr int kBlocks = 5;
+  const char *data = static_cast<const char *>(GetWriteBuffer());
+  for (int i = 0; i < kBlocks; ++i) {
+    ASSERT_EQ(secure_write(fd, data, kBlockLength), kBlockLength);
+  }
+  EXPECT_EQ(secure_pwrite(fd, GetZeroBuffer(), 16, 32), 16);
+
+  std::vector<char> expected;
+  for (int i = 0; i < kBlocks; ++i) {
+    expected.insert(expected.end(), data, data + kBlockLength);
+  }
+  std::fill_n(expected.begin() + 32, 16, 0);
+
+  // A read spanning blocks sees both the evicted and the cached blocks.
+  std::vector<char> actual(expected.size());
+  EXPECT_EQ(secure_pread(fd, actual.data(), actual.size(), 0), actual.size());
+  EXPECT_EQ(actual, expected);
+  EXPECT_EQ(secure_close(fd), 0);
+
+  AeadHandler::GetInstance().SetBlockCacheCapacity(0);
+  fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  std::fill(actual.begin(), actual.end(), 1);
+  EXPECT_EQ(secure_pread(fd, actual.data(), actual.size(), 0), actual.size());
+  EXPECT_EQ(actual, expected);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
 //
 // Failure cases.
 //
@@ -567,6 +943,23 @@ TEST_P(EnclaveStorageSecureTest, ReadWriteTokensModified) {
               StatusIs(error::GoogleError::INTERNAL, "Secure read failed."));
 }
 
+TEST_P(EnclaveStorageSecureTest, IndexedFileAuthTagsModified) {
+  ASSERT_THAT(WriteIndexedFile(), IsOk());
+
+  // Modify an auth tag - form of tampering. The index still reproduces the
+  // root, so the tampering is detected when the block is read.
+  int fd = enc_untrusted_open(GetPath().c_str(), O_WRONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_GT(enc_untrusted_lseek(fd, kFileHeaderLength + kBlockLength, SEEK_SET),
+            0);
+  EXPECT_GT(enc_untrusted_write(fd, kTamperData, ABSL_ARRAYSIZE(kTamperData)),
+            0);
+  ASSERT_EQ(enc_untrusted_fsync(fd), 0) << strerror(errno);
+  ASSERT_EQ(enc_untrusted_close(fd), 0) << strerror(errno);
+  EXPECT_THAT(ReadIndexedFile(),
+              StatusIs(error::GoogleError::INTERNAL, "Secure read failed."));
+}
+
 TEST_P(EnclaveStorageSecureTest, FileTruncateAttack) {
   EXPECT_THAT(OpenWriteClose(0), IsOk());
 
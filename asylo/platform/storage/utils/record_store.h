@@ -23,6 +23,7 @@
 #include <iterator>
 #include <list>
 #include <type_traits>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "asylo/util/logging.h"
@@ -46,9 +47,10 @@ namespace asylo {
 // record along side other kinds of data.
 //
 // Read and write operations are performed via a fixed-size cache using a least-
-// recently-used eviction policy. The cache may be flushed to disk explicitly
-// via Flush(), and is automatically flushed when the RecordStore passes out of
-// scope.
+// recently-used eviction policy. Only records modified through the cache are
+// written back to storage. The cache may be flushed to disk explicitly via
+// Flush(), which writes each run of adjacent modified records with a single
+// write, and is automatically flushed when the RecordStore passes out of scope.
 //
 // This class is not thread-safe. It is the responsibility of the caller to
 // ensure that its methods are not called concurrently.
@@ -87,8 +89,34 @@ class RecordStore {
   // Flushes the cache to persistent storage and ensures the underlying storage
   // resource has been synchronized. Returns an error status on failure.
   ASYLO_MUST_USE_RESULT Status Flush() {
+    std::vector<NodeRef> dirty;
     for (auto it = cache_.begin(); it != cache_.end(); it++) {
-      ASYLO_RETURN_IF_ERROR(Commit(it));
+      if (it->dirty) {
+        dirty.push_back(it);
+      }
+    }
+    std::sort(dirty.begin(), dirty.end(), [](NodeRef a, NodeRef b) {
+      return a->offset < b->offset;
+    });
+
+    // Write runs of records which are adjacent in storage in ascending order.
+    std::vector<T> run;
+    for (auto begin = dirty.begin(); begin != dirty.end();) {
+      auto end = std::next(begin);
+      while (end != dirty.end() &&
+             (*end)->offset == (*std::prev(end))->offset + sizeof(T)) {
+        end++;
+      }
+      run.clear();
+      for (auto it = begin; it != end; it++) {
+        run.push_back((*it)->value);
+      }
+      ASYLO_RETURN_IF_ERROR(
+          io_->Write(run.data(), (*begin)->offset, run.size() * sizeof(T)));
+      for (auto it = begin; it != end; it++) {
+        (*it)->dirty = false;
+      }
+      begin = end;
     }
     ASYLO_RETURN_IF_ERROR(io_->Sync());
     return Status::OkStatus();
@@ -160,6 +188,20 @@ class RecordStore {
   // cache.
   bool IsCached(off_t offset) const { return index_.contains(offset); }
 
+  // Drops a record specified by its byte-offset from the cache without writing
+  // it back, so that the next Read() of the record reads it from storage. This
+  // is intended for records which have been overwritten in storage other than
+  // through this instance.
+  void Invalidate(off_t offset) {
+    auto it = index_.find(offset);
+    if (it == index_.end()) {
+      return;
+    }
+    cache_.erase(it->second);
+    index_.erase(it);
+    count_--;
+  }
+
  private:
   struct CacheEntry {
     off_t offset;  // Byte offset of this record.
@@ -170,8 +212,12 @@ class RecordStore {
   using NodeRef = typename std::list<CacheEntry>::iterator;
   using ConstNodeRef = typename std::list<CacheEntry>::const_iterator;
 
-  // Writes a cache entry to storage, returning an error status on failure.
+  // Writes a cache entry to storage if it has been modified, returning an error
+  // status on failure.
   ASYLO_MUST_USE_RESULT Status Commit(NodeRef entry) {
+    if (!entry->dirty) {
+      return Status::OkStatus();
+    }
     ASYLO_RETURN_IF_ERROR(io_->Write(&entry->value, entry->offset, sizeof(T)));
     entry->dirty = false;
     return Status::OkStatus();
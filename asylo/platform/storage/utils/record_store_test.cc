@@ -22,14 +22,44 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/platform/storage/utils/random_access_storage.h"
 #include "asylo/platform/storage/utils/record_store.h"
 #include "asylo/platform/storage/utils/test_utils.h"
 #include "asylo/platform/storage/utils/untrusted_file.h"
 #include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 namespace {
 
+// A storage resource which counts the writes made to an UntrustedFile.
+class CountingStorage : public RandomAccessStorage {
+ public:
+  explicit CountingStorage(UntrustedFile *file) : file_(file) {}
+
+  StatusOr<size_t> Size() const override { return file_->Size(); }
+
+  Status Read(void *buffer, off_t offset, size_t size) override {
+    return file_->Read(buffer, offset, size);
+  }
+
+  Status Write(const void *buffer, off_t offset, size_t size) override {
+    writes_++;
+    return file_->Write(buffer, offset, size);
+  }
+
+  Status Sync() override { return file_->Sync(); }
+
+  Status Truncate(size_t size) override { return file_->Truncate(size); }
+
+  int writes() const { return writes_; }
+
+ private:
+  UntrustedFile *file_;
+  int writes_ = 0;
+};
+
 // Ensure that reading and writing records through a RecordStore returns the
 // expected values.
 TEST(RecordStoreTest, WriteRead) {
@@ -119,5 +149,83 @@ TEST(RecordStoreTest, Flush) {
   }
 }
 
+// Ensure that Flush() writes each run of adjacent modified records at once.
+TEST(RecordStoreTest, FlushCoalescesAdjacentRecords) {
+  int fd = CreateEmptyTempFileOrDie("coalesce.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  CountingStorage storage(&file);
+
+  constexpr size_t kCapacity = 16;
+  RecordStore<size_t> records(kCapacity, &storage);
+
+  // Write records 0-7 and 10-11 out of order.
+  for (size_t i : {7, 3, 11, 0, 1, 2, 10, 6, 5, 4}) {
+    ASYLO_EXPECT_OK(records.Write(i * sizeof(size_t), i));
+  }
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(storage.writes(), 2);
+
+  for (size_t i : {0, 1, 2, 3, 4, 5, 6, 7, 10, 11}) {
+    size_t record;
+    ASYLO_EXPECT_OK(file.Read(&record, i * sizeof(size_t), sizeof(size_t)));
+    EXPECT_EQ(record, i);
+  }
+
+  // Flushing again has nothing to write.
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(storage.writes(), 2);
+}
+
+// Ensure that records which were only read are not written back.
+TEST(RecordStoreTest, CleanRecordsNotWrittenBack) {
+  int fd = CreateEmptyTempFileOrDie("clean.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+
+  constexpr size_t kCapacity = 4;
+  constexpr size_t kRecordCount = 16;
+  for (size_t i = 0; i < kRecordCount; i++) {
+    ASYLO_ASSERT_OK(file.Write(&i, i * sizeof(size_t), sizeof(size_t)));
+  }
+
+  CountingStorage storage(&file);
+  RecordStore<size_t> records(kCapacity, &storage);
+  for (size_t i = 0; i < kRecordCount; i++) {
+    size_t record;
+    ASYLO_EXPECT_OK(records.Read(i * sizeof(size_t), &record));
+    EXPECT_EQ(record, i);
+  }
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(storage.writes(), 0);
+}
+
+// Ensure that an invalidated record is dropped without being written back.
+TEST(RecordStoreTest, Invalidate) {
+  int fd = CreateEmptyTempFileOrDie("invalidate.tmp");
+  platform::storage::FdCloser closer(fd);
+  UntrustedFile file(fd);
+  CountingStorage storage(&file);
+
+  constexpr size_t kCapacity = 4;
+  RecordStore<size_t> records(kCapacity, &storage);
+
+  size_t on_disk = 1;
+  ASYLO_ASSERT_OK(file.Write(&on_disk, 0, sizeof(size_t)));
+  ASYLO_EXPECT_OK(records.Write(0, 2));
+  records.Invalidate(0);
+  EXPECT_FALSE(records.IsCached(0));
+
+  size_t record;
+  ASYLO_EXPECT_OK(records.Read(0, &record));
+  EXPECT_EQ(record, on_disk);
+  ASYLO_ASSERT_OK(records.Flush());
+  EXPECT_EQ(storage.writes(), 0);
+
+  // Invalidating a record which is not cached has no effect.
+  records.Invalidate(sizeof(size_t));
+  EXPECT_TRUE(records.IsCached(0));
+}
+
 }  // namespace
 }  // namespace asylo
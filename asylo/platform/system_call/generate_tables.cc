@@ -16,6 +16,7 @@
  *
  */
 
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <string>
@@ -23,10 +24,12 @@
 #include <type_traits>
 #include <vector>
 
+#include "absl/base/macros.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
 #include "asylo/platform/system_call/syscalls.inc"
 
 // This file implements a code generation tool built with a native Linux
@@ -339,7 +342,292 @@ void EmitParameterTable(std::ostream *os) {
   *os << "};\n";
 }
 
+// System calls on hot paths which get serializers specialized at build time, in
+// addition to the table-driven serializers shared by all system calls.
+const char *const kSpecializedSystemCalls[] = {
+    "read", "write", "pread64", "pwrite64", "sendto", "epoll_wait",
+};
+
+// Returns true if |desc| has |flag| among its flags.
+bool HasFlag(const ParameterDescription &desc, absl::string_view flag) {
+  for (absl::string_view item : absl::StrSplit(desc.flags, " | ")) {
+    if (item == flag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if parameters like |desc| are encoded in requests (for |is_in|)
+// or responses.
+bool IsEncoded(const ParameterDescription &desc, bool is_in) {
+  return HasFlag(desc, is_in ? "kIn" : "kOut");
+}
+
+// Returns a C++ expression for the encoding size of the parameter at |position|
+// of a system call, as computed by the generic MessageWriter from the
+// parameter list |parameters|. |allocated| is true if the pointer is known to
+// be non-null.
+std::string SizeExpression(const std::vector<ParameterDescription> &params,
+                           int position, bool allocated) {
+  const ParameterDescription &desc = params[position];
+  std::string value = absl::StrCat("parameters[", position, "]");
+  std::string size;
+  if (HasFlag(desc, "kFixed")) {
+    size = absl::StrCat(desc.size);
+  } else if (HasFlag(desc, "kString")) {
+    size = absl::StrCat("strlen(reinterpret_cast<const char *>(", value,
+                        ")) + 1");
+  } else if (HasFlag(desc, "kBounded")) {
+    size = absl::StrCat("parameters[", desc.size, "] * ", desc.element_size);
+  }
+  return allocated ? size : absl::StrCat(value, " ? ", size, " : 0");
+}
+
+// Returns true if the encoding size of every parameter of a system call
+// encoded in the direction given by |is_in| is known at build time.
+bool HasConstantSize(const std::vector<ParameterDescription> &params,
+                     bool is_in) {
+  for (const ParameterDescription &desc : params) {
+    if (IsEncoded(desc, is_in) && HasFlag(desc, "kPointer")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if any parameter of a system call is encoded in the direction
+// given by |is_in|.
+bool HasEncodedParameters(const std::vector<ParameterDescription> &params,
+                          bool is_in) {
+  for (const ParameterDescription &desc : params) {
+    if (IsEncoded(desc, is_in)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Emits the statements computing the size of a message for a system call and
+// declaring it as |message_size|.
+void EmitMessageSize(const std::vector<ParameterDescription> &params,
+                     bool is_in, bool allocated, std::ostream *os) {
+  std::vector<std::string> terms = {"sizeof(MessageHeader)"};
+  for (int i = 0; i < params.size(); i++) {
+    if (!IsEncoded(params[i], is_in)) {
+      continue;
+    }
+    if (HasFlag(params[i], "kPointer")) {
+      *os << absl::StreamFormat("  const size_t size_%d = %s;\n", i,
+                                SizeExpression(params, i, allocated));
+      terms.push_back(absl::StrCat("RoundUpToMultipleOf8(size_", i, ")"));
+    } else {
+      terms.push_back("sizeof(uint64_t)");
+    }
+  }
+  *os << absl::StreamFormat("  %s message_size = %s;\n",
+                            HasConstantSize(params, is_in) ? "constexpr size_t"
+                                                           : "const size_t",
+                            absl::StrJoin(terms, " + "));
+}
+
+// Emits the statements writing each parameter of a system call encoded in the
+// direction given by |is_in| into a message buffer.
+void EmitWriteParameters(const std::vector<ParameterDescription> &params,
+                         bool is_in, std::ostream *os) {
+  if (HasEncodedParameters(params, is_in)) {
+    *os << "  size_t offset = sizeof(MessageHeader);\n";
+  }
+  for (int i = 0; i < params.size(); i++) {
+    if (!IsEncoded(params[i], is_in)) {
+      continue;
+    }
+    if (HasFlag(params[i], "kPointer")) {
+      *os << absl::StreamFormat(
+          "  WriteBuffer(%d, parameters[%d], size_%d, buffer, &offset);\n", i, i,
+          i);
+    } else {
+      *os << absl::StreamFormat(
+          "  WriteScalar(%d, parameters[%d], buffer, &offset);\n", i, i);
+    }
+  }
+}
+
+// Exits with an error if a parameter of a specialized system call is encoded
+// in a way the specialized serializers do not reproduce.
+void CheckSpecializable(const std::string &syscall,
+                        const std::vector<ParameterDescription> &params) {
+  for (const ParameterDescription &desc : params) {
+    bool supported;
+    if (HasFlag(desc, "kPointer")) {
+      // Untyped pointers without a bound are copied as scalars, reading eight
+      // bytes through the pointer. Strings copied out of the kernel would need
+      // their size to be read from the response.
+      supported = !HasFlag(desc, "kScalar") &&
+                  !(HasFlag(desc, "kOut") && HasFlag(desc, "kString"));
+    } else {
+      supported = HasFlag(desc, "kScalar") && !HasFlag(desc, "kOut");
+    }
+    if (!supported) {
+      std::cerr << absl::StreamFormat(
+                       "Error: Parameter \"%s\" of system call \"%s\" cannot "
+                       "be handled by a specialized serializer.",
+                       desc.name, syscall)
+                << std::endl;
+      exit(1);
+    }
+  }
+}
+
+// Emits serializers specialized for the system call |sysno|. Each produces
+// exactly the messages of the generic serializers, but with the parameter
+// layout resolved at build time rather than read from the metadata tables.
+void EmitSpecializedSerializers(int sysno, std::ostream *os) {
+  const SystemCallDescription &syscall = SystemCallTable()->at(sysno);
+  const std::string &name = syscall.name;
+  std::vector<ParameterDescription> params;
+  for (int i = 0; i < syscall.parameter_count; i++) {
+    params.push_back(ParameterTable()->at(syscall.parameter_index + i));
+  }
+  CheckSpecializable(name, params);
+
+  // Request serializer.
+  *os << absl::StreamFormat(
+      "// Serializes a request for %s(2).\n"
+      "bool SerializeRequest_%s(const ParameterList &parameters,\n"
+      "    primitives::Extent *request) {\n",
+      name, name);
+  EmitMessageSize(params, /*is_in=*/true, /*allocated=*/false, os);
+  *os << absl::StreamFormat(
+      "  uint8_t *buffer = AllocateMessage(message_size, kSystemCallRequest, "
+      "%d, 0, 0);\n"
+      "  if (!buffer) {\n"
+      "    return false;\n"
+      "  }\n",
+      sysno);
+  EmitWriteParameters(params, /*is_in=*/true, os);
+  *os << "  *request = {buffer, message_size};\n"
+         "  return true;\n"
+         "}\n\n";
+
+  // Response serializer. Output buffers passed to the host kernel are always
+  // allocated by the caller.
+  *os << absl::StreamFormat(
+      "// Serializes a response for %s(2).\n"
+      "bool SerializeResponse_%s(uint64_t result, uint64_t error_number,\n"
+      "    const ParameterList &parameters, primitives::Extent *response) {\n",
+      name, name);
+  EmitMessageSize(params, /*is_in=*/false, /*allocated=*/false, os);
+  *os << absl::StreamFormat(
+      "  uint8_t *buffer = AllocateMessage(message_size, kSystemCallResponse, "
+      "%d, result, error_number);\n"
+      "  if (!buffer) {\n"
+      "    return false;\n"
+      "  }\n",
+      sysno);
+  EmitWriteParameters(params, /*is_in=*/false, os);
+  *os << "  *response = {buffer, message_size};\n"
+         "  return true;\n"
+         "}\n\n";
+
+  // Response deserializer. The size of each output parameter is computed from
+  // the trusted parameter list and must match the size in the response.
+  *os << absl::StreamFormat(
+      "// Deserializes a response for %s(2).\n"
+      "bool DeserializeResponse_%s(const ParameterList &parameters,\n"
+      "    primitives::Extent response, uint64_t *result,\n"
+      "    uint64_t *error_number) {\n"
+      "  const MessageHeader *header = ReadResponseHeader(response, %d);\n"
+      "  if (!header) {\n"
+      "    return false;\n"
+      "  }\n",
+      name, name, sysno);
+  if (HasEncodedParameters(params, /*is_in=*/false)) {
+    *os << "  size_t offset = sizeof(MessageHeader);\n";
+  }
+  for (int i = 0; i < params.size(); i++) {
+    const ParameterDescription &desc = params[i];
+    if (!IsEncoded(desc, /*is_in=*/false)) {
+      continue;
+    }
+    // The host allocates output-only buffers itself, but passes in-out buffers
+    // on from the request, where a null pointer is encoded as empty.
+    bool allocated = !HasFlag(desc, "kIn");
+    std::string size;
+    if (HasFlag(desc, "kBounded")) {
+      *os << absl::StreamFormat(
+          "  size_t size_%d;\n"
+          "  if (!BoundedSize(parameters[%d], %d, &size_%d)) {\n"
+          "    return false;\n"
+          "  }\n",
+          i, desc.size, desc.element_size, i);
+      size = absl::StrCat("size_", i);
+      if (!allocated) {
+        size = absl::StrCat("parameters[", i, "] ? ", size, " : 0");
+      }
+    } else {
+      size = SizeExpression(params, i, allocated);
+    }
+    *os << absl::StreamFormat(
+        "  if (!ReadBuffer(response, header, %d, %s, parameters[%d], "
+        "&offset)) {\n"
+        "    return false;\n"
+        "  }\n",
+        i, size, i);
+  }
+  *os << "  *result = header->result;\n"
+         "  *error_number = header->error_number;\n"
+         "  return true;\n"
+         "}\n\n";
+}
+
+// Emits serializers specialized for each of kSpecializedSystemCalls, and a
+// function looking them up by system call number.
+void EmitSpecializedSerializers(std::ostream *os) {
+  std::map<int, std::string> specialized;
+  for (const auto &entry : *SystemCallTable()) {
+    for (const char *name : kSpecializedSystemCalls) {
+      if (entry.second.name == name) {
+        specialized[entry.first] = name;
+      }
+    }
+  }
+  if (specialized.size() != ABSL_ARRAYSIZE(kSpecializedSystemCalls)) {
+    std::cerr << "Expected every specialized system call to be defined."
+              << std::endl;
+    exit(1);
+  }
+
+  for (const auto &entry : specialized) {
+    EmitSpecializedSerializers(entry.first, os);
+  }
+
+  *os << "const SpecializedSerializers *FindSpecializedSerializers(int sysno) "
+         "{\n"
+         "  switch (sysno) {\n";
+  for (const auto &entry : specialized) {
+    *os << absl::StreamFormat(
+        "    case %d: {\n"
+        "      static constexpr SpecializedSerializers kSerializers = {\n"
+        "          &SerializeRequest_%s, &SerializeResponse_%s,\n"
+        "          &DeserializeResponse_%s};\n"
+        "      return &kSerializers;\n"
+        "    }\n",
+        entry.first, entry.second, entry.second, entry.second);
+  }
+  *os << "    default:\n"
+         "      return nullptr;\n"
+         "  }\n"
+         "}\n";
+}
+
+// With no arguments, emits the system call metadata tables. With
+// "--serializers", emits the specialized serializers instead.
 int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--serializers") == 0) {
+    EmitSpecializedSerializers(&std::cout);
+    return 0;
+  }
   EmitSystemCallTable(&std::cout);
   std::cout << std::endl;
   EmitParameterTable(&std::cout);
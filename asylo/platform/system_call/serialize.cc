@@ -20,11 +20,16 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <numeric>
 
 #include "absl/strings/str_cat.h"
 #include "asylo/platform/system_call/message.h"
 #include "asylo/platform/system_call/metadata.h"
+#include "asylo/util/status_macros.h"
 
 namespace asylo {
 namespace system_call {
@@ -36,17 +41,140 @@ typename T::value_type Sum(const T &values) {
   return std::accumulate(values.begin(), values.end(),
                          static_cast<typename T::value_type>(0));
 }
+
+// Returns the smallest multiple of 8 greater than or equal to |value|.
+constexpr size_t RoundUpToMultipleOf8(size_t value) {
+  return value + (8 - value % 8) % 8;
+}
+
+primitives::PrimitiveStatus InvalidSysnoStatus(int sysno) {
+  return primitives::PrimitiveStatus{
+      error::GoogleError::INVALID_ARGUMENT,
+      absl::StrCat("Could not infer system call descriptor from the sysno (",
+                   sysno, ") provided.")};
+}
+
+primitives::PrimitiveStatus MalformedResponseStatus(int sysno) {
+  return primitives::PrimitiveStatus{
+      error::GoogleError::INVALID_ARGUMENT,
+      absl::StrCat("Malformed response for sysno ", sysno)};
+}
+
+// Serializers specialized for a single system call.
+struct SpecializedSerializers {
+  bool (*serialize_request)(const ParameterList &parameters,
+                            primitives::Extent *request);
+  bool (*serialize_response)(uint64_t result, uint64_t error_number,
+                             const ParameterList &parameters,
+                             primitives::Extent *response);
+  bool (*deserialize_response)(const ParameterList &parameters,
+                               primitives::Extent response, uint64_t *result,
+                               uint64_t *error_number);
+};
+
+// The helpers below are used by the generated specialized serializers, and
+// encode parameters exactly as MessageWriter does.
+
+// Allocates a message of |size| bytes and initializes its header. Offsets and
+// sizes of parameters absent from the message are zeroed.
+uint8_t *AllocateMessage(size_t size, MessageFlags flags, int sysno,
+                         uint64_t result, uint64_t error_number) {
+  auto *buffer = static_cast<uint8_t *>(malloc(size));
+  if (!buffer) {
+    return nullptr;
+  }
+  auto *header = reinterpret_cast<MessageHeader *>(buffer);
+  header->magic = kMessageMagic;
+  header->flags = flags;
+  header->sysno = sysno;
+  header->result = result;
+  header->error_number = error_number;
+  memset(header->offset, 0, sizeof(header->offset));
+  memset(header->size, 0, sizeof(header->size));
+  return buffer;
+}
+
+// Writes a scalar parameter at |index| with |value| at |*offset| in |buffer|,
+// and advances |*offset| past it.
+inline void WriteScalar(int index, uint64_t value, uint8_t *buffer,
+                        size_t *offset) {
+  auto *header = reinterpret_cast<MessageHeader *>(buffer);
+  memcpy(buffer + *offset, &value, sizeof(value));
+  header->offset[index] = *offset;
+  header->size[index] = sizeof(value);
+  *offset += sizeof(value);
+}
+
+// Copies |size| bytes from the pointer parameter at |index| with |value| to
+// |*offset| in |buffer|, and advances |*offset| past it. Padding is zeroed.
+inline void WriteBuffer(int index, uint64_t value, size_t size,
+                        uint8_t *buffer, size_t *offset) {
+  auto *header = reinterpret_cast<MessageHeader *>(buffer);
+  if (size > 0) {
+    memcpy(buffer + *offset, reinterpret_cast<const void *>(value), size);
+  }
+  size_t padded_size = RoundUpToMultipleOf8(size);
+  memset(buffer + *offset + size, 0, padded_size - size);
+  header->offset[index] = *offset;
+  header->size[index] = size;
+  *offset += padded_size;
+}
+
+// Returns the header of |response| if it is a well-formed response header for
+// |sysno|, or nullptr otherwise.
+inline const MessageHeader *ReadResponseHeader(primitives::Extent response,
+                                               int sysno) {
+  if (!response.data() || response.size() < sizeof(MessageHeader)) {
+    return nullptr;
+  }
+  const auto *header = response.As<MessageHeader>();
+  if (header->magic != kMessageMagic ||
+      header->flags != kSystemCallResponse ||
+      header->sysno != static_cast<uint32_t>(sysno)) {
+    return nullptr;
+  }
+  return header;
+}
+
+// Stores the size of a buffer of |count| elements of |element_size| bytes in
+// |size|. Returns false on overflow.
+inline bool BoundedSize(uint64_t count, size_t element_size, size_t *size) {
+  if (count > std::numeric_limits<size_t>::max() / element_size) {
+    return false;
+  }
+  *size = count * element_size;
+  return true;
+}
+
+// Checks that the parameter at |index| in |response| is at |*offset| and is
+// |size| bytes long, copies it into the buffer referenced by |value| if that is
+// not null, and advances |*offset| past it. Returns false if the parameter is
+// not where it is expected.
+inline bool ReadBuffer(primitives::Extent response, const MessageHeader *header,
+                       int index, size_t size, uint64_t value,
+                       size_t *offset) {
+  if (header->offset[index] != *offset || header->size[index] != size ||
+      *offset > response.size() || size > response.size() - *offset) {
+    return false;
+  }
+  if (void *destination = reinterpret_cast<void *>(value)) {
+    memcpy(destination, response.As<uint8_t>() + *offset, size);
+  }
+  *offset += RoundUpToMultipleOf8(size);
+  return true;
+}
+
+// Include the specialized serializers generated at build time. Defines
+// FindSpecializedSerializers().
+#include "asylo/platform/system_call/generated_serializers.inc"
+
 }  // namespace
 
-primitives::PrimitiveStatus SerializeRequest(
-    int sysno, const std::array<uint64_t, kParameterMax> &parameters,
-    primitives::Extent *request) {
+primitives::PrimitiveStatus GenericSerializeRequest(
+    int sysno, const ParameterList &parameters, primitives::Extent *request) {
   SystemCallDescriptor descriptor{sysno};
   if (!descriptor.is_valid()) {
-    return primitives::PrimitiveStatus{
-        error::GoogleError::INVALID_ARGUMENT,
-        absl::StrCat("Could not infer system call descriptor from the sysno (",
-                     sysno, ") provided.")};
+    return InvalidSysnoStatus(sysno);
   }
 
   auto writer = MessageWriter::RequestWriter(sysno, parameters);
@@ -58,17 +186,13 @@ primitives::PrimitiveStatus SerializeRequest(
   return primitives::PrimitiveStatus::OkStatus();
 }
 
-primitives::PrimitiveStatus SerializeResponse(
+primitives::PrimitiveStatus GenericSerializeResponse(
     int sysno, uint64_t result, uint64_t error_number,
-    const std::array<uint64_t, kParameterMax> &parameters,
-    primitives::Extent *response) {
+    const ParameterList &parameters, primitives::Extent *response) {
   SystemCallDescriptor descriptor{sysno};
 
   if (!descriptor.is_valid()) {
-    return primitives::PrimitiveStatus{
-        error::GoogleError::INVALID_ARGUMENT,
-        absl::StrCat("Could not infer system call descriptor from the sysno (",
-                     sysno, ") provided.")};
+    return InvalidSysnoStatus(sysno);
   }
 
   auto writer =
@@ -81,5 +205,94 @@ primitives::PrimitiveStatus SerializeResponse(
   return primitives::PrimitiveStatus::OkStatus();
 }
 
+primitives::PrimitiveStatus GenericDeserializeResponse(
+    int sysno, const ParameterList &parameters, primitives::Extent response,
+    uint64_t *result, uint64_t *error_number) {
+  if (!response.data()) {
+    return MalformedResponseStatus(sysno);
+  }
+
+  MessageReader reader(response);
+  ASYLO_RETURN_IF_ERROR(reader.Validate());
+  if (!reader.is_response() || reader.sysno() != sysno) {
+    return MalformedResponseStatus(sysno);
+  }
+
+  // Copy outputs back into pointer parameters.
+  SystemCallDescriptor descriptor{sysno};
+  for (int i = 0; i < kParameterMax; i++) {
+    ParameterDescriptor parameter = descriptor.parameter(i);
+    if (parameter.is_out()) {
+      size_t size;
+      if (parameter.is_fixed()) {
+        size = parameter.size();
+      } else {
+        size = parameters[parameter.size()] * parameter.element_size();
+      }
+      const void *src = reader.parameter_address(i);
+      void *dst = reinterpret_cast<void *>(parameters[i]);
+      if (dst != nullptr) {
+        memcpy(dst, src, size);
+      }
+    }
+  }
+
+  *result = reader.result();
+  *error_number = reader.error_number();
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+bool HasSpecializedSerializers(int sysno) {
+  return FindSpecializedSerializers(sysno) != nullptr;
+}
+
+primitives::PrimitiveStatus SerializeRequest(int sysno,
+                                             const ParameterList &parameters,
+                                             primitives::Extent *request) {
+  const SpecializedSerializers *serializers = FindSpecializedSerializers(sysno);
+  if (!serializers) {
+    return GenericSerializeRequest(sysno, parameters, request);
+  }
+  if (!serializers->serialize_request(parameters, request)) {
+    return primitives::PrimitiveStatus{error::GoogleError::RESOURCE_EXHAUSTED,
+                                       "Failed to allocate request"};
+  }
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+primitives::PrimitiveStatus SerializeResponse(int sysno, uint64_t result,
+                                              uint64_t error_number,
+                                              const ParameterList &parameters,
+                                              primitives::Extent *response) {
+  const SpecializedSerializers *serializers = FindSpecializedSerializers(sysno);
+  if (!serializers) {
+    return GenericSerializeResponse(sysno, result, error_number, parameters,
+                                    response);
+  }
+  if (!serializers->serialize_response(result, error_number, parameters,
+                                       response)) {
+    return primitives::PrimitiveStatus{error::GoogleError::RESOURCE_EXHAUSTED,
+                                       "Failed to allocate response"};
+  }
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
+primitives::PrimitiveStatus DeserializeResponse(int sysno,
+                                                const ParameterList &parameters,
+                                                primitives::Extent response,
+                                                uint64_t *result,
+                                                uint64_t *error_number) {
+  const SpecializedSerializers *serializers = FindSpecializedSerializers(sysno);
+  if (!serializers) {
+    return GenericDeserializeResponse(sysno, parameters, response, result,
+                                      error_number);
+  }
+  if (!serializers->deserialize_response(parameters, response, result,
+                                         error_number)) {
+    return MalformedResponseStatus(sysno);
+  }
+  return primitives::PrimitiveStatus::OkStatus();
+}
+
 }  // namespace system_call
 }  // namespace asylo
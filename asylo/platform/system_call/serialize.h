@@ -34,6 +34,10 @@ using ParameterList = std::array<uint64_t, kParameterMax>;
 // Serializes a system call request specified by a system call number and a list
 // of parameters into a buffer. On success, `request` is populated with a buffer
 // allocated by malloc and owned by the caller.
+//
+// System calls on hot paths are serialized by functions specialized for them
+// at build time. All other system calls are serialized by interpreting their
+// metadata at runtime. Both produce the same messages.
 primitives::PrimitiveStatus SerializeRequest(int sysno,
                                              const ParameterList &parameters,
                                              primitives::Extent *request);
@@ -46,6 +50,31 @@ primitives::PrimitiveStatus SerializeResponse(int sysno, uint64_t result,
                                               const ParameterList &parameters,
                                               primitives::Extent *response);
 
+// Deserializes a system call response for the request serialized from `sysno`
+// and `parameters`. Copies each output parameter in the response into the
+// buffer referenced by the corresponding pointer in `parameters`, and stores
+// the result and errno of the system call in `result` and `error_number`.
+// Returns an error if the response is malformed.
+primitives::PrimitiveStatus DeserializeResponse(int sysno,
+                                                const ParameterList &parameters,
+                                                primitives::Extent response,
+                                                uint64_t *result,
+                                                uint64_t *error_number);
+
+// Returns true if `sysno` has serializers specialized for it at build time.
+bool HasSpecializedSerializers(int sysno);
+
+// As above, but always interpret the system call metadata at runtime. Exposed
+// for testing and benchmarking the specialized serializers against.
+primitives::PrimitiveStatus GenericSerializeRequest(
+    int sysno, const ParameterList &parameters, primitives::Extent *request);
+primitives::PrimitiveStatus GenericSerializeResponse(
+    int sysno, uint64_t result, uint64_t error_number,
+    const ParameterList &parameters, primitives::Extent *response);
+primitives::PrimitiveStatus GenericDeserializeResponse(
+    int sysno, const ParameterList &parameters, primitives::Extent response,
+    uint64_t *result, uint64_t *error_number);
+
 }  // namespace system_call
 }  // namespace asylo
 
@@ -0,0 +1,132 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Compares the time per call of the serializers specialized for hot system
+// calls against the generic, metadata-driven serializers.
+
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+#include "asylo/platform/system_call/serialize.h"
+
+namespace asylo {
+namespace system_call {
+namespace {
+
+// Which serializers a benchmark exercises.
+enum class Path { kSpecialized, kGeneric };
+
+uint8_t data_buffer[4096];
+uint8_t address_buffer[16];
+struct epoll_event events[64];
+
+uint64_t AddressOf(void *buffer) { return reinterpret_cast<uint64_t>(buffer); }
+
+void BM_SerializeRequest(benchmark::State &state, Path path, int sysno,
+                         ParameterList parameters) {
+  for (auto _ : state) {
+    primitives::Extent request;
+    primitives::PrimitiveStatus status =
+        path == Path::kSpecialized
+            ? SerializeRequest(sysno, parameters, &request)
+            : GenericSerializeRequest(sysno, parameters, &request);
+    if (!status.ok()) {
+      state.SkipWithError(status.error_message());
+      break;
+    }
+    benchmark::DoNotOptimize(request.data());
+    free(request.data());
+  }
+}
+
+void BM_SerializeResponse(benchmark::State &state, Path path, int sysno,
+                          ParameterList parameters) {
+  for (auto _ : state) {
+    primitives::Extent response;
+    primitives::PrimitiveStatus status =
+        path == Path::kSpecialized
+            ? SerializeResponse(sysno, 0, 0, parameters, &response)
+            : GenericSerializeResponse(sysno, 0, 0, parameters, &response);
+    if (!status.ok()) {
+      state.SkipWithError(status.error_message());
+      break;
+    }
+    benchmark::DoNotOptimize(response.data());
+    free(response.data());
+  }
+}
+
+void BM_DeserializeResponse(benchmark::State &state, Path path, int sysno,
+                            ParameterList parameters) {
+  primitives::Extent response;
+  if (!GenericSerializeResponse(sysno, 0, 0, parameters, &response).ok()) {
+    state.SkipWithError("Failed to serialize response");
+    return;
+  }
+  for (auto _ : state) {
+    uint64_t result;
+    uint64_t error_number;
+    primitives::PrimitiveStatus status =
+        path == Path::kSpecialized
+            ? DeserializeResponse(sysno, parameters, response, &result,
+                                  &error_number)
+            : GenericDeserializeResponse(sysno, parameters, response, &result,
+                                         &error_number);
+    if (!status.ok()) {
+      state.SkipWithError(status.error_message());
+      break;
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  free(response.data());
+}
+
+// Registers a request, response, and deserialization benchmark for each path
+// of a system call.
+#define SERIALIZE_BENCHMARKS(name, sysno, ...)                              \
+  BENCHMARK_CAPTURE(BM_SerializeRequest, name##_specialized,                \
+                    Path::kSpecialized, sysno, ParameterList{__VA_ARGS__}); \
+  BENCHMARK_CAPTURE(BM_SerializeRequest, name##_generic, Path::kGeneric,    \
+                    sysno, ParameterList{__VA_ARGS__});                     \
+  BENCHMARK_CAPTURE(BM_SerializeResponse, name##_specialized,               \
+                    Path::kSpecialized, sysno, ParameterList{__VA_ARGS__}); \
+  BENCHMARK_CAPTURE(BM_SerializeResponse, name##_generic, Path::kGeneric,   \
+                    sysno, ParameterList{__VA_ARGS__});                     \
+  BENCHMARK_CAPTURE(BM_DeserializeResponse, name##_specialized,             \
+                    Path::kSpecialized, sysno, ParameterList{__VA_ARGS__}); \
+  BENCHMARK_CAPTURE(BM_DeserializeResponse, name##_generic, Path::kGeneric, \
+                    sysno, ParameterList{__VA_ARGS__})
+
+SERIALIZE_BENCHMARKS(read_64, SYS_read, 3, AddressOf(data_buffer), 64);
+SERIALIZE_BENCHMARKS(read_4096, SYS_read, 3, AddressOf(data_buffer), 4096);
+SERIALIZE_BENCHMARKS(write_64, SYS_write, 3, AddressOf(data_buffer), 64);
+SERIALIZE_BENCHMARKS(write_4096, SYS_write, 3, AddressOf(data_buffer), 4096);
+SERIALIZE_BENCHMARKS(pread64, SYS_pread64, 3, AddressOf(data_buffer), 512,
+                     4096);
+SERIALIZE_BENCHMARKS(sendto, SYS_sendto, 3, AddressOf(data_buffer), 512, 0,
+                     AddressOf(address_buffer), sizeof(address_buffer));
+SERIALIZE_BENCHMARKS(epoll_wait, SYS_epoll_wait, 5, AddressOf(events), 64,
+                     100);
+
+}  // namespace
+}  // namespace system_call
+}  // namespace asylo
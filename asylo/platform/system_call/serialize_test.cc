@@ -17,9 +17,19 @@
  */
 
 #include "asylo/platform/system_call/serialize.h"
+
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/strings/str_cat.h"
+#include "asylo/platform/system_call/message.h"
 
 namespace asylo {
 namespace system_call {
@@ -28,6 +38,73 @@ namespace {
 using testing::Eq;
 using testing::StrEq;
 
+// Deleter object for malloc() allocated buffers.
+struct MallocDeleter {
+  void operator()(uint8_t *buffer) { free(buffer); }
+};
+
+using MessagePtr = std::unique_ptr<uint8_t, MallocDeleter>;
+
+// Returns the address of |value| as a system call parameter.
+template <typename T>
+uint64_t AddressOf(T *value) {
+  return reinterpret_cast<uint64_t>(value);
+}
+
+// Checks that two serialized messages are valid and encode the same system
+// call, result, and parameter values.
+void ExpectSameMessage(primitives::Extent actual,
+                       primitives::Extent expected) {
+  MessageReader actual_reader(actual);
+  MessageReader expected_reader(expected);
+  ASSERT_TRUE(actual_reader.Validate().ok());
+  ASSERT_TRUE(expected_reader.Validate().ok());
+  EXPECT_THAT(actual.size(), Eq(expected.size()));
+  EXPECT_THAT(actual_reader.header()->flags,
+              Eq(expected_reader.header()->flags));
+  EXPECT_THAT(actual_reader.sysno(), Eq(expected_reader.sysno()));
+  if (expected_reader.is_response()) {
+    EXPECT_THAT(actual_reader.result(), Eq(expected_reader.result()));
+    EXPECT_THAT(actual_reader.error_number(),
+                Eq(expected_reader.error_number()));
+  }
+  for (int i = 0; i < kParameterMax; i++) {
+    ASSERT_THAT(actual_reader.parameter_is_used(i),
+                Eq(expected_reader.parameter_is_used(i)));
+    if (!expected_reader.parameter_is_used(i)) {
+      continue;
+    }
+    ASSERT_THAT(actual_reader.parameter_size(i),
+                Eq(expected_reader.parameter_size(i)));
+    EXPECT_THAT(memcmp(actual_reader.parameter_address(i),
+                       expected_reader.parameter_address(i),
+                       expected_reader.parameter_size(i)),
+                Eq(0));
+  }
+  EXPECT_THAT(FormatMessage(actual), StrEq(FormatMessage(expected)));
+}
+
+// Checks that the specialized and generic serializers produce the same request
+// and response messages for |sysno| with |parameters|.
+void ExpectSerializersAgree(int sysno, const ParameterList &parameters) {
+  ASSERT_TRUE(HasSpecializedSerializers(sysno));
+
+  primitives::Extent specialized;
+  primitives::Extent generic;
+  ASSERT_TRUE(SerializeRequest(sysno, parameters, &specialized).ok());
+  MessagePtr specialized_owner(specialized.As<uint8_t>());
+  ASSERT_TRUE(GenericSerializeRequest(sysno, parameters, &generic).ok());
+  MessagePtr generic_owner(generic.As<uint8_t>());
+  ExpectSameMessage(specialized, generic);
+
+  ASSERT_TRUE(SerializeResponse(sysno, 42, 0, parameters, &specialized).ok());
+  specialized_owner.reset(specialized.As<uint8_t>());
+  ASSERT_TRUE(
+      GenericSerializeResponse(sysno, 42, 0, parameters, &generic).ok());
+  generic_owner.reset(generic.As<uint8_t>());
+  ExpectSameMessage(specialized, generic);
+}
+
 TEST(SerializeTest, SerializeRequestInvalidSysnoTest) {
   const std::array<uint64_t, kParameterMax> parameters =
       std::array<uint64_t, 6>();
@@ -54,6 +131,109 @@ TEST(SerializeTest, SerializeResponseInvalidSysnoTest) {
                   10000, ") provided.")));
 }
 
+TEST(SerializeTest, HotSystemCallsAreSpecialized) {
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_read));
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_write));
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_pread64));
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_pwrite64));
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_sendto));
+  EXPECT_TRUE(HasSpecializedSerializers(SYS_epoll_wait));
+  EXPECT_FALSE(HasSpecializedSerializers(SYS_open));
+  EXPECT_FALSE(HasSpecializedSerializers(10000));
+}
+
+TEST(SerializeTest, SpecializedReadMatchesGeneric) {
+  char buffer[13] = "hello, world";
+  ExpectSerializersAgree(SYS_read, {3, AddressOf(buffer), sizeof(buffer)});
+  ExpectSerializersAgree(SYS_read, {3, 0, sizeof(buffer)});
+  ExpectSerializersAgree(SYS_pread64,
+                         {3, AddressOf(buffer), sizeof(buffer), 1024});
+}
+
+TEST(SerializeTest, SpecializedWriteMatchesGeneric) {
+  char buffer[] = "hello, world";
+  ExpectSerializersAgree(SYS_write, {3, AddressOf(buffer), sizeof(buffer)});
+  ExpectSerializersAgree(SYS_write, {3, AddressOf(buffer), 0});
+  ExpectSerializersAgree(SYS_pwrite64,
+                         {3, AddressOf(buffer), sizeof(buffer), 1024});
+}
+
+TEST(SerializeTest, SpecializedSendtoMatchesGeneric) {
+  char buffer[] = "datagram";
+  char address[] = "address";
+  ExpectSerializersAgree(SYS_sendto,
+                         {3, AddressOf(buffer), sizeof(buffer), 0,
+                          AddressOf(address), sizeof(address)});
+  ExpectSerializersAgree(SYS_sendto,
+                         {3, AddressOf(buffer), sizeof(buffer), 0, 0, 0});
+}
+
+TEST(SerializeTest, SpecializedEpollWaitMatchesGeneric) {
+  struct epoll_event events[4] = {};
+  events[1].events = EPOLLIN;
+  events[1].data.u64 = 7;
+  ExpectSerializersAgree(SYS_epoll_wait, {5, AddressOf(events), 4, 100});
+}
+
+TEST(SerializeTest, DeserializeResponseCopiesOutputs) {
+  char host_buffer[] = "from the host";
+  primitives::Extent response;
+  ASSERT_TRUE(GenericSerializeResponse(
+                  SYS_read, sizeof(host_buffer), 0,
+                  {3, AddressOf(host_buffer), sizeof(host_buffer)}, &response)
+                  .ok());
+  MessagePtr response_owner(response.As<uint8_t>());
+
+  char specialized_buffer[sizeof(host_buffer)] = {};
+  char generic_buffer[sizeof(host_buffer)] = {};
+  uint64_t result;
+  uint64_t error_number;
+  ASSERT_TRUE(DeserializeResponse(SYS_read,
+                                  {3, AddressOf(specialized_buffer),
+                                   sizeof(specialized_buffer)},
+                                  response, &result, &error_number)
+                  .ok());
+  EXPECT_THAT(result, Eq(sizeof(host_buffer)));
+  EXPECT_THAT(error_number, Eq(0));
+  EXPECT_THAT(specialized_buffer, StrEq(host_buffer));
+
+  ASSERT_TRUE(GenericDeserializeResponse(
+                  SYS_read,
+                  {3, AddressOf(generic_buffer), sizeof(generic_buffer)},
+                  response, &result, &error_number)
+                  .ok());
+  EXPECT_THAT(generic_buffer, StrEq(host_buffer));
+}
+
+TEST(SerializeTest, DeserializeResponseRejectsMalformedResponses) {
+  char host_buffer[16] = {};
+  primitives::Extent response;
+  ASSERT_TRUE(SerializeResponse(SYS_read, 16, 0,
+                                {3, AddressOf(host_buffer), 16}, &response)
+                  .ok());
+  MessagePtr response_owner(response.As<uint8_t>());
+
+  char buffer[32];
+  uint64_t result;
+  uint64_t error_number;
+
+  // The response holds fewer bytes than the caller asked for.
+  EXPECT_FALSE(DeserializeResponse(SYS_read, {3, AddressOf(buffer), 32},
+                                   response, &result, &error_number)
+                   .ok());
+
+  // The response is for a different system call.
+  EXPECT_FALSE(DeserializeResponse(SYS_pread64, {3, AddressOf(buffer), 16, 0},
+                                   response, &result, &error_number)
+                   .ok());
+
+  // The response is truncated.
+  primitives::Extent truncated{response.data(), response.size() - 8};
+  EXPECT_FALSE(DeserializeResponse(SYS_read, {3, AddressOf(buffer), 16},
+                                   truncated, &result, &error_number)
+                   .ok());
+}
+
 }  // namespace
 }  // namespace system_call
 }  // namespace asylo
@@ -20,10 +20,14 @@
 
 #include <errno.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdarg>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <memory>
+#include <vector>
 
 #include "asylo/platform/system_call/metadata.h"
 #include "asylo/platform/system_call/serialize.h"
@@ -40,20 +44,119 @@ struct MallocDeleter {
 void default_error_handler(const char *message) { abort(); }
 
 syscall_dispatch_callback global_syscall_callback = nullptr;
+syscall_batch_dispatch_callback global_syscall_batch_callback = nullptr;
 void (*error_handler)(const char *message) = nullptr;
 
+using ParameterArray =
+    std::array<uint64_t, asylo::system_call::kParameterMax>;
+
+static_assert(sizeof(SystemCallBatchEntry::parameters) ==
+                  sizeof(uint64_t) * asylo::system_call::kParameterMax,
+              "SystemCallBatchEntry must hold kParameterMax parameters");
+
+// Serializes a request for |sysno| with |parameters| into |request|, which is
+// allocated by malloc(). Aborts on failure.
+void SerializeRequestOrDie(int sysno, const ParameterArray &parameters,
+                           asylo::primitives::Extent *request) {
+  asylo::system_call::SystemCallDescriptor descriptor{sysno};
+  if (!descriptor.is_valid()) {
+    error_handler("system_call.cc: Invalid SystemCallDescriptor encountered.");
+  }
+
+  asylo::primitives::PrimitiveStatus status =
+      asylo::system_call::SerializeRequest(sysno, parameters, request);
+  if (!status.ok()) {
+    error_handler(
+        "system_call.cc: Encountered serialization error when serializing "
+        "syscall parameters.");
+  }
+}
+
+// Copies the output parameters in |response| back into the pointer parameters
+// of |parameters|, and returns the system call result. Stores the errno value
+// of a failed system call in |error_number|, or zero if the call succeeded.
+// Aborts if |response| is malformed.
+int64_t DecodeResponseOrDie(int sysno, const ParameterArray &parameters,
+                            asylo::primitives::Extent response,
+                            int *error_number) {
+  if (!response.data()) {
+    error_handler(
+        "system_call.cc: null response buffer received for the syscall.");
+  }
+
+  // Copy outputs back into pointer parameters.
+  uint64_t result;
+  uint64_t klinux_errno;
+  const asylo::primitives::PrimitiveStatus response_status =
+      asylo::system_call::DeserializeResponse(sysno, parameters, response,
+                                              &result, &klinux_errno);
+  if (!response_status.ok()) {
+    error_handler(
+        "system_call.cc: Error deserializing response buffer into response "
+        "reader.");
+  }
+
+  *error_number = 0;
+  if (static_cast<int64_t>(result) == -1) {
+    // Simply having a return value of -1 from a syscall is not a necessary
+    // condition that the syscall failed. Some syscalls can return -1 when
+    // successful (eg., lseek). The reliable way to check for syscall failure is
+    // to therefore check both return value and presence of a non-zero errno.
+    if (klinux_errno != 0) {
+      *error_number = FromkLinuxErrorNumber(static_cast<int>(klinux_errno));
+    }
+  }
+  return result;
+}
+
+// Dispatches the serialized |request| through the system call dispatch
+// callback and returns the malloc()-allocated response. Aborts on failure.
+asylo::primitives::Extent DispatchOrDie(asylo::primitives::Extent request) {
+  if (!enc_is_syscall_dispatcher_set()) {
+    error_handler("system_.cc: system call dispatcher not set.");
+  }
+
+  uint8_t *response_buffer;
+  size_t response_size;
+  asylo::primitives::PrimitiveStatus status =
+      global_syscall_callback(request.As<uint8_t>(), request.size(),
+                              &response_buffer, &response_size);
+  if (!status.ok()) {
+    error_handler(
+        "system_call.cc: Callback from syscall dispatcher was unsuccessful.");
+  }
+  return {response_buffer, response_size};
+}
+
+// Copies the parameters of |entry| into a ParameterArray.
+ParameterArray EntryParameters(const SystemCallBatchEntry &entry) {
+  ParameterArray parameters;
+  std::copy(std::begin(entry.parameters), std::end(entry.parameters),
+            parameters.begin());
+  return parameters;
+}
+
 }  // namespace
 
 extern "C" bool enc_is_syscall_dispatcher_set() {
   return global_syscall_callback != nullptr;
 }
 
+extern "C" bool enc_is_syscall_batch_dispatcher_set() {
+  return global_syscall_batch_callback != nullptr;
+}
+
 extern "C" bool enc_is_error_handler_set() { return error_handler != nullptr; }
 
 extern "C" void enc_set_dispatch_syscall(syscall_dispatch_callback callback) {
   global_syscall_callback = callback;
 }
 
+extern "C" void enc_set_dispatch_syscall_batch(
+    syscall_batch_dispatch_callback callback) {
+  global_syscall_batch_callback = callback;
+}
+
 extern "C" void enc_set_error_handler(
     void (*abort_handler)(const char *message)) {
   error_handler = abort_handler;
@@ -70,7 +173,7 @@ extern "C" int64_t enc_untrusted_syscall(int sysno, ...) {
   }
 
   // Collect the passed parameter list into an array.
-  std::array<uint64_t, asylo::system_call::kParameterMax> parameters;
+  ParameterArray parameters;
   va_list args;
   va_start(args, sysno);
   for (int i = 0; i < descriptor.parameter_count(); i++) {
@@ -80,76 +183,75 @@ extern "C" int64_t enc_untrusted_syscall(int sysno, ...) {
 
   // Allocate a buffer for the serialized request.
   asylo::primitives::Extent request;
-  asylo::primitives::PrimitiveStatus status;
-  status = asylo::system_call::SerializeRequest(sysno, parameters, &request);
-  if (!status.ok()) {
-    error_handler(
-        "system_call.cc: Encountered serialization error when serializing "
-        "syscall parameters.");
-  }
-
+  SerializeRequestOrDie(sysno, parameters, &request);
   std::unique_ptr<uint8_t, MallocDeleter> request_owner(request.As<uint8_t>());
 
   // Invoke the system call dispatch callback to execute the system call.
-  uint8_t *response_buffer;
-  size_t response_size;
+  asylo::primitives::Extent response = DispatchOrDie(request);
+  std::unique_ptr<uint8_t, MallocDeleter> response_owner(
+      response.As<uint8_t>());
 
-  if (!enc_is_syscall_dispatcher_set()) {
-    error_handler("system_.cc: system call dispatcher not set.");
-  }
-  status = global_syscall_callback(request.As<uint8_t>(), request.size(),
-                                   &response_buffer, &response_size);
-  if (!status.ok()) {
-    error_handler(
-        "system_call.cc: Callback from syscall dispatcher was unsuccessful.");
+  int error_number;
+  int64_t result =
+      DecodeResponseOrDie(sysno, parameters, response, &error_number);
+  if (error_number != 0) {
+    errno = error_number;
   }
+  return result;
+}
 
-  std::unique_ptr<uint8_t, MallocDeleter> response_owner(response_buffer);
-
-  if (!response_buffer) {
-    error_handler(
-        "system_call.cc: null response buffer received for the syscall.");
+extern "C" void enc_untrusted_syscall_batch(SystemCallBatchEntry *entries,
+                                            size_t count) {
+  if (!enc_is_error_handler_set()) {
+    enc_set_error_handler(default_error_handler);
   }
-
-  // Copy outputs back into pointer parameters.
-  auto response_reader =
-      asylo::system_call::MessageReader({response_buffer, response_size});
-  const asylo::primitives::PrimitiveStatus response_status =
-      response_reader.Validate();
-  if (!response_status.ok()) {
-    error_handler(
-        "system_call.cc: Error deserializing response buffer into response "
-        "reader.");
+  if (count == 0) {
+    return;
   }
 
-  for (int i = 0; i < asylo::system_call::kParameterMax; i++) {
-    asylo::system_call::ParameterDescriptor parameter = descriptor.parameter(i);
-    if (parameter.is_out()) {
-      size_t size;
-      if (parameter.is_fixed()) {
-        size = parameter.size();
-      } else {
-        size = parameters[parameter.size()] * parameter.element_size();
-      }
-      const void *src = response_reader.parameter_address(i);
-      void *dst = reinterpret_cast<void *>(parameters[i]);
-      if (dst != nullptr) {
-        memcpy(dst, src, size);
-      }
+  // Without a batch dispatcher, fall back to one exit per system call.
+  if (!enc_is_syscall_batch_dispatcher_set()) {
+    for (size_t i = 0; i < count; ++i) {
+      ParameterArray parameters = EntryParameters(entries[i]);
+      asylo::primitives::Extent request;
+      SerializeRequestOrDie(entries[i].sysno, parameters, &request);
+      std::unique_ptr<uint8_t, MallocDeleter> request_owner(
+          request.As<uint8_t>());
+      asylo::primitives::Extent response = DispatchOrDie(request);
+      std::unique_ptr<uint8_t, MallocDeleter> response_owner(
+          response.As<uint8_t>());
+      entries[i].result = DecodeResponseOrDie(
+          entries[i].sysno, parameters, response, &entries[i].error_number);
     }
+    return;
   }
 
-  uint64_t result = response_reader.header()->result;
-  if (static_cast<int64_t>(result) == -1) {
-    int klinux_errno = response_reader.header()->error_number;
+  std::vector<asylo::primitives::Extent> requests(count);
+  std::vector<std::unique_ptr<uint8_t, MallocDeleter>> request_owners;
+  request_owners.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    SerializeRequestOrDie(entries[i].sysno, EntryParameters(entries[i]),
+                          &requests[i]);
+    request_owners.emplace_back(requests[i].As<uint8_t>());
+  }
 
-    // Simply having a return value of -1 from a syscall is not a necessary
-    // condition that the syscall failed. Some syscalls can return -1 when
-    // successful (eg., lseek). The reliable way to check for syscall failure is
-    // to therefore check both return value and presence of a non-zero errno.
-    if (klinux_errno != 0) {
-      errno = FromkLinuxErrorNumber(klinux_errno);
-    }
+  std::vector<asylo::primitives::Extent> responses(count);
+  asylo::primitives::PrimitiveStatus status = global_syscall_batch_callback(
+      requests.data(), count, responses.data());
+  std::vector<std::unique_ptr<uint8_t, MallocDeleter>> response_owners;
+  response_owners.reserve(count);
+  for (asylo::primitives::Extent &response : responses) {
+    response_owners.emplace_back(response.As<uint8_t>());
+  }
+  if (!status.ok()) {
+    error_handler(
+        "system_call.cc: Callback from syscall batch dispatcher was "
+        "unsuccessful.");
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    entries[i].result =
+        DecodeResponseOrDie(entries[i].sysno, EntryParameters(entries[i]),
+                            responses[i], &entries[i].error_number);
   }
-  return result;
 }
@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "asylo/platform/primitives/extent.h"
 #include "asylo/platform/primitives/primitive_status.h"
 
 #ifdef __cplusplus
@@ -37,9 +38,39 @@ typedef asylo::primitives::PrimitiveStatus (*syscall_dispatch_callback)(
     const uint8_t *request_buffer, size_t request_size,
     uint8_t **response_buffer, size_t *response_size);
 
+// Callback type installed at runtime to dispatch a batch of system calls
+// across the enclave boundary in a single exit. `requests` designates `count`
+// serialized system call requests owned by the caller. On success, `responses`
+// is populated with `count` responses, in request order, each allocated by
+// malloc() on the trusted heap.
+typedef asylo::primitives::PrimitiveStatus (*syscall_batch_dispatch_callback)(
+    const asylo::primitives::Extent *requests, size_t count,
+    asylo::primitives::Extent *responses);
+
+// A single system call in a batch submitted to enc_untrusted_syscall_batch().
+struct SystemCallBatchEntry {
+  // The system call number, as passed to enc_untrusted_syscall().
+  int sysno;
+
+  // The system call arguments, as passed to enc_untrusted_syscall(). Only the
+  // first parameter_count() arguments of `sysno` are read.
+  uint64_t parameters[6];
+
+  // Set to the return value of the system call.
+  int64_t result;
+
+  // Set to the errno value of the system call if it failed, and to zero
+  // otherwise.
+  int error_number;
+};
+
 // Installs a callback as dispatch function for serialized system calls.
 void enc_set_dispatch_syscall(syscall_dispatch_callback callback);
 
+// Installs a callback as dispatch function for batches of serialized system
+// calls.
+void enc_set_dispatch_syscall_batch(syscall_batch_dispatch_callback callback);
+
 // Installs an error handler function that aborts with a message in case of a
 // failure.
 void enc_set_error_handler(void (*abort_handler)(const char *message));
@@ -51,10 +82,27 @@ bool enc_is_syscall_dispatcher_set();
 // Returns whether an error handler function has been registered.
 bool enc_is_error_handler_set();
 
+// Returns whether a dispatch function has been registered for making batches of
+// system calls.
+bool enc_is_syscall_batch_dispatcher_set();
+
 // Invokes a system call on the host via the installed system call dispatch
 // callback.
 int64_t enc_untrusted_syscall(int sysno, ...);
 
+// Invokes the `count` system calls in `entries` on the host in a single exit
+// via the installed batch dispatch callback, or one at a time via the system
+// call dispatch callback if no batch dispatch callback is installed.
+//
+// The system calls are executed in order on a single host thread. Each one is
+// executed regardless of whether earlier ones failed, and stores its own return
+// value and errno in its entry. Callers must therefore only batch system calls
+// that do not depend on each other's results. The enclave's errno is not
+// modified. Serialization and dispatch errors are reported through the error
+// handler, as for enc_untrusted_syscall().
+void enc_untrusted_syscall_batch(struct SystemCallBatchEntry *entries,
+                                 size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
 #include <cerrno>
 #include <cstring>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -66,6 +67,29 @@ asylo::primitives::PrimitiveStatus SystemCallDispatcher(
   return asylo::primitives::PrimitiveStatus::OkStatus();
 }
 
+// A system call batch dispatch function which invokes each request locally.
+asylo::primitives::PrimitiveStatus SystemCallBatchDispatcher(
+    const primitives::Extent *requests, size_t count,
+    primitives::Extent *responses) {
+  for (size_t i = 0; i < count; ++i) {
+    ASYLO_RETURN_IF_ERROR(UntrustedInvoke(requests[i], &responses[i]));
+  }
+  return asylo::primitives::PrimitiveStatus::OkStatus();
+}
+
+// A system call batch dispatch function which invokes the requests on another
+// thread, which like the host has an errno of its own.
+asylo::primitives::PrimitiveStatus SeparateErrnoBatchDispatcher(
+    const primitives::Extent *requests, size_t count,
+    primitives::Extent *responses) {
+  asylo::primitives::PrimitiveStatus status;
+  std::thread host_thread([requests, count, responses, &status] {
+    status = SystemCallBatchDispatcher(requests, count, responses);
+  });
+  host_thread.join();
+  return status;
+}
+
 void error_handler(const char *message) {
   fprintf(stderr, "%s\n", message);
   fflush(stderr);
@@ -296,6 +320,57 @@ TEST(SystemCallTest, BoundedBufferByParamLenTest) {
   EXPECT_THAT(fds_actual[1].revents, Eq(fds_actual[1].revents));
 }
 
+// Invokes a batch of system calls through the batch dispatcher and checks that
+// each entry receives its own result and errno.
+TEST(SystemCallTest, BatchTest) {
+  enc_set_dispatch_syscall(SystemCallDispatcher);
+  enc_set_dispatch_syscall_batch(SeparateErrnoBatchDispatcher);
+
+  char buffer[2048];
+  SystemCallBatchEntry entries[3] = {};
+  entries[0].sysno = SYS_getpid;
+  entries[1].sysno = SYS_getcwd;
+  entries[1].parameters[0] = 0;
+  entries[1].parameters[1] = 1;
+  entries[2].sysno = SYS_getcwd;
+  entries[2].parameters[0] = reinterpret_cast<uintptr_t>(buffer);
+  entries[2].parameters[1] = sizeof(buffer);
+
+  errno = 0;
+  enc_untrusted_syscall_batch(entries, 3);
+  EXPECT_THAT(errno, Eq(0));
+
+  EXPECT_THAT(entries[0].result, Eq(getpid()));
+  EXPECT_THAT(entries[0].error_number, Eq(0));
+  EXPECT_THAT(entries[1].result, Eq(-1));
+  EXPECT_THAT(entries[1].error_number, Eq(ERANGE));
+  EXPECT_THAT(entries[2].result, Not(Eq(-1)));
+  EXPECT_THAT(entries[2].error_number, Eq(0));
+
+  char expected[2048];
+  ASSERT_THAT(getcwd(expected, sizeof(expected)), Not(IsNull()));
+  EXPECT_THAT(buffer, StrEq(expected));
+
+  enc_set_dispatch_syscall_batch(nullptr);
+}
+
+// Invokes a batch of system calls without a batch dispatcher, which falls back
+// to dispatching each system call separately.
+TEST(SystemCallTest, BatchWithoutBatchDispatcherTest) {
+  enc_set_dispatch_syscall(SystemCallDispatcher);
+  enc_set_dispatch_syscall_batch(nullptr);
+
+  SystemCallBatchEntry entries[2] = {};
+  entries[0].sysno = SYS_getuid;
+  entries[1].sysno = SYS_getgid;
+  enc_untrusted_syscall_batch(entries, 2);
+
+  EXPECT_THAT(entries[0].result, Eq(getuid()));
+  EXPECT_THAT(entries[0].error_number, Eq(0));
+  EXPECT_THAT(entries[1].result, Eq(getgid()));
+  EXPECT_THAT(entries[1].error_number, Eq(0));
+}
+
 }  // namespace
 }  // namespace system_call
 }  // namespace asylo
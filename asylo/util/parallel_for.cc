@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "asylo/util/thread.h"
+
+namespace asylo {
+
+void ParallelFor(size_t count, size_t max_parallelism,
+                 const std::function<void(size_t index)> &body) {
+  if (max_parallelism == 0) {
+    max_parallelism = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t num_threads = std::min(count, max_parallelism);
+
+  std::atomic<size_t> next_index(0);
+  auto run = [count, &body, &next_index] {
+    for (size_t index = next_index.fetch_add(1); index < count;
+         index = next_index.fetch_add(1)) {
+      body(index);
+    }
+  };
+
+  // The calling thread is one of the |num_threads| threads.
+  std::vector<Thread> helpers;
+  if (num_threads > 1) {
+    helpers.reserve(num_threads - 1);
+    for (size_t i = 1; i < num_threads; ++i) {
+      helpers.emplace_back(run);
+    }
+  }
+  run();
+  for (auto &helper : helpers) {
+    helper.Join();
+  }
+}
+
+}  // namespace asylo
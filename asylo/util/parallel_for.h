@@ -0,0 +1,39 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_PARALLEL_FOR_H_
+#define ASYLO_UTIL_PARALLEL_FOR_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace asylo {
+
+// Calls |body| once with each index in [0, |count|), on up to
+// |max_parallelism| threads including the calling thread, and returns once all
+// calls have returned. Indices are handed out to threads dynamically, so calls
+// of uneven cost are balanced across the threads. A |max_parallelism| of zero
+// uses one thread per hardware thread.
+//
+// |body| must be safe to call concurrently with different indices.
+void ParallelFor(size_t count, size_t max_parallelism,
+                 const std::function<void(size_t index)> &body);
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_PARALLEL_FOR_H_
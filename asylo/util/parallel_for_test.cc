@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/parallel_for.h"
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/container/flat_hash_set.h"
+#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Le;
+
+TEST(ParallelForTest, CallsBodyOnceForEachIndex) {
+  constexpr size_t kCount = 1000;
+  std::vector<std::atomic<int>> calls(kCount);
+  ParallelFor(kCount, /*max_parallelism=*/4,
+              [&calls](size_t index) { calls[index].fetch_add(1); });
+  for (const auto &count : calls) {
+    EXPECT_THAT(count.load(), Eq(1));
+  }
+}
+
+TEST(ParallelForTest, DoesNothingForZeroCount) {
+  ParallelFor(/*count=*/0, /*max_parallelism=*/4,
+              [](size_t index) { FAIL() << "Unexpected call"; });
+}
+
+TEST(ParallelForTest, RunsOnCallingThreadWithParallelismOfOne) {
+  Thread::Id caller = Thread::this_thread_id();
+  ParallelFor(/*count=*/16, /*max_parallelism=*/1, [caller](size_t index) {
+    EXPECT_THAT(Thread::this_thread_id(), Eq(caller));
+  });
+}
+
+TEST(ParallelForTest, UsesAtMostMaxParallelismThreads) {
+  constexpr size_t kMaxParallelism = 3;
+  MutexGuarded<absl::flat_hash_set<Thread::Id>> thread_ids(
+      (absl::flat_hash_set<Thread::Id>()));
+  ParallelFor(/*count=*/256, kMaxParallelism, [&thread_ids](size_t index) {
+    thread_ids.Lock()->insert(Thread::this_thread_id());
+  });
+  EXPECT_THAT(thread_ids.ReaderLock()->size(), Le(kMaxParallelism));
+}
+
+TEST(ParallelForTest, DefaultsToHardwareConcurrency) {
+  std::atomic<size_t> calls(0);
+  ParallelFor(/*count=*/64, /*max_parallelism=*/0,
+              [&calls](size_t index) { calls.fetch_add(1); });
+  EXPECT_THAT(calls.load(), Eq(64));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,229 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_UTIL_READ_MOSTLY_H_
+#define ASYLO_UTIL_READ_MOSTLY_H_
+
+#include <sched.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+
+template <typename T>
+class ReadMostly;
+
+namespace internal {
+
+// The number of reader counters of each ReadMostly<T>. Up to this many threads
+// read without sharing a counter.
+constexpr size_t kReadMostlyShards = 16;
+
+// Returns the reader counter shard of the calling thread. Threads are spread
+// over the shards in the order they first read.
+inline size_t ReadMostlyThreadShard() {
+  static std::atomic<size_t> next_shard(0);
+  thread_local size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kReadMostlyShards;
+  return shard;
+}
+
+}  // namespace internal
+
+// A read-only smart pointer to a snapshot of the value held by a
+// ReadMostly<T>. The snapshot is not freed while the view exists, even if the
+// ReadMostly<T> is updated in the meantime.
+template <typename T>
+class ReadView {
+ public:
+  ReadView(const ReadView &other) = delete;
+  ReadView &operator=(const ReadView &other) = delete;
+
+  ReadView(ReadView &&other)
+      : readers_(other.readers_), value_(other.value_) {
+    other.readers_ = nullptr;
+    other.value_ = nullptr;
+  }
+
+  ReadView &operator=(ReadView &&other) {
+    Release();
+    readers_ = other.readers_;
+    value_ = other.value_;
+    other.readers_ = nullptr;
+    other.value_ = nullptr;
+    return *this;
+  }
+
+  ~ReadView() { Release(); }
+
+  const T &operator*() const { return *value_; }
+  const T *operator->() const { return value_; }
+  const T *get() const { return value_; }
+
+ private:
+  friend class ReadMostly<T>;
+
+  ReadView(std::atomic<int64_t> *readers, const T *value)
+      : readers_(readers), value_(value) {}
+
+  void Release() {
+    if (readers_) {
+      readers_->fetch_sub(1, std::memory_order_release);
+      readers_ = nullptr;
+    }
+  }
+
+  std::atomic<int64_t> *readers_;
+  const T *value_;
+};
+
+// ReadMostly<T> holds an object of type T that is read far more often than it
+// is changed, such as a table of handlers or a configuration. It is an
+// alternative to MutexGuarded<T> for such objects, with the same API inside
+// and outside of enclaves.
+//
+// Readers get an immutable snapshot of the object from Read(), which is
+// wait-free: it never blocks, and it does not write to any memory shared with
+// readers on other threads, up to internal::kReadMostlyShards threads.
+//
+// Writers copy the object, change the copy, and publish it in place of the
+// original. The original is freed once no reader can still be viewing it,
+// which the writer waits for. Writers are serialized, and are slow in
+// comparison to MutexGuarded<T>.
+//
+// Example of common use:
+//
+//     ReadMostly<std::map<std::string, int>> ports;
+//
+//     // Readers see either the map before or after the update.
+//     ports.Update([](std::map<std::string, int> *map) {
+//       (*map)["http"] = 80;
+//     });
+//
+//     int port = ports.Read()->at("http");
+//
+// WARNING: A thread must not update a ReadMostly<T> while it holds a view of
+// it, since the update waits for every view of the original to be destroyed.
+//
+// As with MutexGuarded<T>, it is unsafe to save a reference or pointer to the
+// snapshot, or to one of its subcomponents, and use it after the view has been
+// destroyed.
+template <typename T>
+class ReadMostly {
+  static_assert(std::is_copy_constructible<T>::value,
+                "T must be a copy-constructible type");
+
+ public:
+  ReadMostly() : ReadMostly(T()) {}
+
+  // Constructs a ReadMostly<T> that initially holds |value|.
+  explicit ReadMostly(T value) : current_(new T(std::move(value))) {
+    for (auto &shard : shards_) {
+      shard.readers[0].store(0, std::memory_order_relaxed);
+      shard.readers[1].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ReadMostly(const ReadMostly &other) = delete;
+  ReadMostly &operator=(const ReadMostly &other) = delete;
+
+  // No views of a ReadMostly<T> may exist when it is destroyed.
+  ~ReadMostly() { delete current_.load(std::memory_order_acquire); }
+
+  // Returns a read-only view of a snapshot of the contained value.
+  ReadView<T> Read() const {
+    Shard &shard = shards_[internal::ReadMostlyThreadShard()];
+    std::atomic<int64_t> *readers =
+        &shard.readers[epoch_.load(std::memory_order_seq_cst) & 1];
+    readers->fetch_add(1, std::memory_order_seq_cst);
+    return ReadView<T>(readers, current_.load(std::memory_order_seq_cst));
+  }
+
+  // Replaces the contained value with |value|. Returns once no reader can
+  // still be viewing the previous value.
+  void Store(T value) ABSL_LOCKS_EXCLUDED(writer_mu_) {
+    std::unique_ptr<T> replacement(new T(std::move(value)));
+    absl::MutexLock lock(&writer_mu_);
+    Publish(std::move(replacement));
+  }
+
+  // Calls |update| with a copy of the contained value, and replaces the
+  // contained value with the copy. Returns once no reader can still be viewing
+  // the previous value.
+  void Update(const std::function<void(T *)> &update)
+      ABSL_LOCKS_EXCLUDED(writer_mu_) {
+    absl::MutexLock lock(&writer_mu_);
+    std::unique_ptr<T> replacement(
+        new T(*current_.load(std::memory_order_acquire)));
+    update(replacement.get());
+    Publish(std::move(replacement));
+  }
+
+ private:
+  // The reader counters of one shard, one for each parity of |epoch_|.
+  struct alignas(64) Shard {
+    std::atomic<int64_t> readers[2];
+  };
+
+  // Makes |replacement| the contained value and frees the previous value.
+  void Publish(std::unique_ptr<T> replacement)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mu_) {
+    std::unique_ptr<T> previous(
+        current_.exchange(replacement.release(), std::memory_order_seq_cst));
+    WaitForReaders();
+  }
+
+  // Waits until every reader that may have loaded the previous value has
+  // destroyed its view. A reader counts itself under the parity of the epoch
+  // it started in, which may be either parity by the time it loads the value,
+  // so the epoch is advanced twice, waiting for the readers of the parity
+  // being left each time.
+  void WaitForReaders() ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mu_) {
+    for (int flip = 0; flip < 2; ++flip) {
+      uint64_t parity = epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+      for (const Shard &shard : shards_) {
+        int spins = 0;
+        while (shard.readers[parity].load(std::memory_order_seq_cst) != 0) {
+          if (++spins > kSpinsBeforeYield) {
+            sched_yield();
+          }
+        }
+      }
+    }
+  }
+
+  static constexpr int kSpinsBeforeYield = 100;
+
+  mutable Shard shards_[internal::kReadMostlyShards];
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<T *> current_;
+  absl::Mutex writer_mu_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_UTIL_READ_MOSTLY_H_
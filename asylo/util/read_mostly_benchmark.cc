@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <benchmark/benchmark.h>
+#include "asylo/util/mutex_guarded.h"
+#include "asylo/util/read_mostly.h"
+
+namespace asylo {
+namespace {
+
+// The number of entries in the benchmarked tables, and the number of reads
+// between the updates made by the benchmarks with updates.
+constexpr uint64_t kTableSize = 64;
+constexpr int64_t kReadsPerUpdate = 4096;
+
+using Table = std::unordered_map<uint64_t, uint64_t>;
+
+Table MakeTable() {
+  Table table;
+  for (uint64_t i = 0; i < kTableSize; ++i) {
+    table[i] = i;
+  }
+  return table;
+}
+
+// Looks up an entry of a table guarded by a reader lock, as DispatchTable did
+// on every exit call.
+void BM_MutexGuardedRead(benchmark::State &state) {
+  static MutexGuarded<Table> *table = new MutexGuarded<Table>(MakeTable());
+  uint64_t key = state.thread_index;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table->ReaderLock()->at(key++ % kTableSize));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexGuardedRead)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_ReadMostlyRead(benchmark::State &state) {
+  static ReadMostly<Table> *table = new ReadMostly<Table>(MakeTable());
+  uint64_t key = state.thread_index;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table->Read()->at(key++ % kTableSize));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadMostlyRead)->ThreadRange(1, 16)->UseRealTime();
+
+// As above, but the first thread also updates an entry every kReadsPerUpdate
+// reads.
+void BM_MutexGuardedReadWithUpdates(benchmark::State &state) {
+  static MutexGuarded<Table> *table = new MutexGuarded<Table>(MakeTable());
+  uint64_t key = state.thread_index;
+  for (auto _ : state) {
+    if (state.thread_index == 0 && key % kReadsPerUpdate == 0) {
+      (*table->Lock())[0] = key;
+    }
+    benchmark::DoNotOptimize(table->ReaderLock()->at(key++ % kTableSize));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexGuardedReadWithUpdates)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_ReadMostlyReadWithUpdates(benchmark::State &state) {
+  static ReadMostly<Table> *table = new ReadMostly<Table>(MakeTable());
+  uint64_t key = state.thread_index;
+  for (auto _ : state) {
+    if (state.thread_index == 0 && key % kReadsPerUpdate == 0) {
+      table->Update([key](Table *updated) { (*updated)[0] = key; });
+    }
+    benchmark::DoNotOptimize(table->Read()->at(key++ % kTableSize));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadMostlyReadWithUpdates)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace asylo
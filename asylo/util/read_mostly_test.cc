@@ -0,0 +1,168 @@
+/*
+ *
+ * Copyright 2020 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/util/read_mostly.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsFalse;
+using ::testing::IsTrue;
+
+constexpr int kNumThreads = 16;
+constexpr int kNumReaders = 4;
+constexpr int kNumUpdates = 200;
+constexpr absl::Duration kLongEnoughForThreadSwitch = absl::Milliseconds(500);
+
+// A pair of counters that writers always keep equal, and that counts its live
+// instances.
+struct Pair {
+  Pair() { ++live; }
+  Pair(const Pair &other) : first(other.first), second(other.second) {
+    ++live;
+  }
+  ~Pair() { --live; }
+
+  int first = 0;
+  int second = 0;
+
+  static std::atomic<int> live;
+};
+
+std::atomic<int> Pair::live(0);
+
+TEST(ReadMostlyTest, DefaultCtorSucceeds) {
+  ReadMostly<std::string> safe;
+  EXPECT_THAT(*safe.Read(), Eq(""));
+}
+
+TEST(ReadMostlyTest, StoreReplacesValue) {
+  ReadMostly<std::string> safe("before");
+  EXPECT_THAT(*safe.Read(), Eq("before"));
+  safe.Store("after");
+  EXPECT_THAT(*safe.Read(), Eq("after"));
+}
+
+TEST(ReadMostlyTest, UpdatesFromAllThreadsAreVisibleFromLaterReads) {
+  ReadMostly<int> safe_int(0);
+  std::vector<std::thread> threads;
+  threads.reserve(kNumThreads);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&safe_int] {
+      for (int j = 0; j < 10; ++j) {
+        safe_int.Update([](int *value) { ++*value; });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_THAT(*safe_int.Read(), Eq(kNumThreads * 10));
+}
+
+TEST(ReadMostlyTest, HeldViewsKeepTheirSnapshotAndDelayUpdates) {
+  ReadMostly<std::string> safe("before");
+  std::atomic<bool> updated(false);
+  absl::Notification update_started;
+
+  auto view = safe.Read();
+  std::thread writer([&] {
+    update_started.Notify();
+    safe.Store("after");
+    updated = true;
+  });
+
+  update_started.WaitForNotification();
+  absl::SleepFor(kLongEnoughForThreadSwitch);
+  EXPECT_THAT(updated.load(), IsFalse());
+  EXPECT_THAT(*view, Eq("before"));
+
+  // Views taken during the update see the new value.
+  EXPECT_THAT(*safe.Read(), Eq("after"));
+
+  // The update completes once the last view of the previous value is gone.
+  // Views taken in the meantime must be destroyed too before waiting for it.
+  ReadView<std::string> moved_view = std::move(view);
+  EXPECT_THAT(*moved_view, Eq("before"));
+  moved_view = safe.Read();
+  EXPECT_THAT(*moved_view, Eq("after"));
+  { ReadView<std::string> released = std::move(moved_view); }
+  writer.join();
+  EXPECT_THAT(updated.load(), IsTrue());
+}
+
+TEST(ReadMostlyTest, ReadersSeeConsistentSnapshotsDuringUpdates) {
+  {
+    ReadMostly<Pair> safe_pair;
+    std::atomic<bool> done(false);
+    std::atomic<int> inconsistent_reads(0);
+    std::atomic<int> started_readers(0);
+
+    std::vector<std::thread> readers;
+    readers.reserve(kNumReaders);
+    for (int i = 0; i < kNumReaders; ++i) {
+      readers.emplace_back([&] {
+        ++started_readers;
+        while (!done) {
+          auto view = safe_pair.Read();
+          if (view->first != view->second) {
+            ++inconsistent_reads;
+          }
+        }
+      });
+    }
+
+    while (started_readers < kNumReaders) {
+      std::this_thread::yield();
+    }
+    for (int i = 0; i < kNumUpdates; ++i) {
+      safe_pair.Update([](Pair *pair) {
+        ++pair->first;
+        ++pair->second;
+      });
+    }
+    done = true;
+    for (auto &reader : readers) {
+      reader.join();
+    }
+
+    EXPECT_THAT(inconsistent_reads.load(), Eq(0));
+    EXPECT_THAT(safe_pair.Read()->first, Eq(kNumUpdates));
+
+    // Every replaced snapshot has been freed.
+    EXPECT_THAT(Pair::live.load(), Eq(1));
+  }
+  EXPECT_THAT(Pair::live.load(), Eq(0));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -19,6 +19,7 @@
 #ifndef ASYLO_UTIL_REMOTE_REMOTE_PROXY_CONFIG_H_
 #define ASYLO_UTIL_REMOTE_REMOTE_PROXY_CONFIG_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -76,6 +77,17 @@ class RemoteProxyConnectionConfig {
   const std::shared_ptr<::grpc::ServerCredentials> server_creds_;
 };
 
+// Configuration of the pool of target threads that run invocations from host
+// threads which are not nested in another invocation. See
+// RemoteProxyConfig::EnableWorkerPool.
+struct WorkerPoolConfig {
+  // The number of worker threads.
+  size_t pool_size = 0;
+
+  // The number of invocations that may wait for a free worker.
+  size_t queue_depth = 0;
+};
+
 class RemoteProxyConfig {
  public:
   RemoteProxyConfig(
@@ -97,8 +109,36 @@ class RemoteProxyConfig {
     return connection_config_->server_creds();
   }
 
+  // EnableWorkerPool makes the target side run invocations from host threads
+  // that are not nested in another invocation on a pool of |pool_size|
+  // threads, instead of on a target thread dedicated to each host thread. A
+  // worker stays bound to the host thread only until the invocation returns,
+  // so reentrant call chains still run on a single thread on each side. Up to
+  // |queue_depth| invocations wait for a free worker; beyond that, an
+  // invocation is given a dedicated thread as if the pool were disabled.
+  // Has no effect on the host side.
+  void EnableWorkerPool(size_t pool_size, size_t queue_depth) {
+    WorkerPoolConfig config;
+    config.pool_size = pool_size;
+    config.queue_depth = queue_depth;
+    worker_pool_config_ = config;
+  }
+
+  bool HasWorkerPoolConfig() const { return worker_pool_config_.has_value(); }
+
+  StatusOr<WorkerPoolConfig> GetWorkerPoolConfig() const {
+    if (!HasWorkerPoolConfig()) {
+      return Status(error::GoogleError::FAILED_PRECONDITION,
+                    "WorkerPoolConfig is not set");
+    }
+    return *worker_pool_config_;
+  }
+
  private:
   std::unique_ptr<RemoteProxyConnectionConfig> connection_config_;
+
+  // Configuration for the target-side worker pool.
+  absl::optional<WorkerPoolConfig> worker_pool_config_;
 };
 
 // |RemoteProxyClientConfig| provides |RemoteEnclaveProxyClient| with the
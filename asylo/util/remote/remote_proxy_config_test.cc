@@ -113,5 +113,22 @@ TEST(RemoteProxyServerConfigTest, DefaultsAreAsExpected) {
   EXPECT_THAT(config->server_creds(), Not(IsNull()));
 }
 
+TEST(RemoteProxyServerConfigTest, WorkerPoolConfigAddedCorrectly) {
+  std::unique_ptr<RemoteProxyServerConfig> config;
+  ASYLO_ASSERT_OK_AND_ASSIGN(
+      config, RemoteProxyServerConfig::DefaultsWithHostAddress(kHostAddress));
+  EXPECT_THAT(config->HasWorkerPoolConfig(), Eq(false));
+  EXPECT_THAT(config->GetWorkerPoolConfig(),
+              StatusIs(error::GoogleError::FAILED_PRECONDITION));
+
+  config->EnableWorkerPool(/*pool_size=*/8, /*queue_depth=*/32);
+  EXPECT_THAT(config->HasWorkerPoolConfig(), Eq(true));
+
+  StatusOr<WorkerPoolConfig> config_result = config->GetWorkerPoolConfig();
+  ASSERT_THAT(config_result, IsOk());
+  EXPECT_THAT(config_result.ValueOrDie().pool_size, Eq(8));
+  EXPECT_THAT(config_result.ValueOrDie().queue_depth, Eq(32));
+}
+
 }  // namespace
 }  // namespace asylo